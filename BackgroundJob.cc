@@ -0,0 +1,44 @@
+#include "BackgroundJob.h"
+
+#include <system_error>
+#include <utility>
+
+
+namespace kte {
+BackgroundJob::~BackgroundJob()
+{
+	Cancel();
+	Wait();
+}
+
+
+void
+BackgroundJob::Start(std::function<void()> work)
+{
+	work_ = std::move(work);
+	try {
+		thread_ = std::thread([this] {
+			run();
+		});
+	} catch (const std::system_error &) {
+		run(); // no thread to spare: do the work here
+	}
+}
+
+
+void
+BackgroundJob::Wait()
+{
+	if (thread_.joinable())
+		thread_.join();
+}
+
+
+void
+BackgroundJob::run()
+{
+	work_();
+	work_ = nullptr;
+	done_.store(true, std::memory_order_release);
+}
+} // namespace kte
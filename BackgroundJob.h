@@ -0,0 +1,61 @@
+// BackgroundJob.h - one piece of work on its own thread, polled from the editor
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <thread>
+
+namespace kte {
+// The thread behind a background save, match count, index build or grep.
+// Start() runs the work on a new thread, or on the caller's when no thread
+// can be spawned, so a started job always finishes. The work checks
+// Cancelled() between steps; the editor thread polls Done() and then reads
+// the results, which Done() publishes.
+//
+// Destroying the job cancels and joins it. Declare it as the last member
+// of the state the work uses, so it is joined before that state goes.
+class BackgroundJob {
+public:
+	BackgroundJob() = default;
+
+	~BackgroundJob();
+
+	BackgroundJob(const BackgroundJob &) = delete;
+
+	BackgroundJob &operator=(const BackgroundJob &) = delete;
+
+	// Run work; call at most once
+	void Start(std::function<void()> work);
+
+	// Whether the work has finished; its results are then visible
+	[[nodiscard]] bool Done() const
+	{
+		return done_.load(std::memory_order_acquire);
+	}
+
+
+	// Ask the work to stop early
+	void Cancel()
+	{
+		cancel_.store(true, std::memory_order_relaxed);
+	}
+
+
+	[[nodiscard]] bool Cancelled() const
+	{
+		return cancel_.load(std::memory_order_relaxed);
+	}
+
+
+	// Block until the work has finished
+	void Wait();
+
+private:
+	void run();
+
+	std::function<void()> work_;
+	std::atomic<bool> cancel_{false};
+	std::atomic<bool> done_{false};
+	std::thread thread_;
+};
+} // namespace kte
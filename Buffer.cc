@@ -1,12 +1,19 @@
 #include <fstream>
 #include <sstream>
 #include <filesystem>
+#include <atomic>
 #include <cstdlib>
 #include <limits>
 #include <cerrno>
 #include <cstring>
 #include <string_view>
 
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include "BackgroundJob.h"
 #include "Buffer.h"
 #include "UndoSystem.h"
 #include "UndoTree.h"
@@ -43,6 +50,8 @@ Buffer::Buffer(const Buffer &other)
 	content_          = other.content_;
 	rows_cache_dirty_ = other.rows_cache_dirty_;
 	filename_         = other.filename_;
+	mapped_           = other.mapped_;
+	changed_on_disk_  = other.changed_on_disk_;
 	is_file_backed_   = other.is_file_backed_;
 	dirty_            = other.dirty_;
 	read_only_        = other.read_only_;
@@ -93,6 +102,8 @@ Buffer::operator=(const Buffer &other)
 	content_          = other.content_;
 	rows_cache_dirty_ = other.rows_cache_dirty_;
 	filename_         = other.filename_;
+	mapped_           = other.mapped_;
+	changed_on_disk_  = other.changed_on_disk_;
 	is_file_backed_   = other.is_file_backed_;
 	dirty_            = other.dirty_;
 	read_only_        = other.read_only_;
@@ -102,6 +113,11 @@ Buffer::operator=(const Buffer &other)
 	version_          = other.version_;
 	syntax_enabled_   = other.syntax_enabled_;
 	filetype_         = other.filetype_;
+	// A save started for the old contents no longer describes this buffer
+	save_job_.reset();
+	search_matches_.Clear();
+	trigrams_.Clear();
+	search_overlay_.Clear();
 	// Recreate undo system for this instance
 	undo_tree_ = std::make_unique<UndoTree>();
 	undo_sys_  = std::make_unique<UndoSystem>(*this, *undo_tree_);
@@ -135,6 +151,8 @@ Buffer::Buffer(Buffer &&other) noexcept
 	  coloffs_(other.coloffs_),
 	  rows_(std::move(other.rows_)),
 	  filename_(std::move(other.filename_)),
+	  mapped_(std::move(other.mapped_)),
+	  changed_on_disk_(other.changed_on_disk_),
 	  is_file_backed_(other.is_file_backed_),
 	  dirty_(other.dirty_),
 	  read_only_(other.read_only_),
@@ -142,7 +160,8 @@ Buffer::Buffer(Buffer &&other) noexcept
 	  mark_curx_(other.mark_curx_),
 	  mark_cury_(other.mark_cury_),
 	  undo_tree_(std::move(other.undo_tree_)),
-	  undo_sys_(std::move(other.undo_sys_))
+	  undo_sys_(std::move(other.undo_sys_)),
+	  save_job_(std::move(other.save_job_))
 {
 	// Move syntax/highlighting state
 	version_          = other.version_;
@@ -151,6 +170,9 @@ Buffer::Buffer(Buffer &&other) noexcept
 	highlighter_      = std::move(other.highlighter_);
 	content_          = std::move(other.content_);
 	rows_cache_dirty_ = other.rows_cache_dirty_;
+	search_matches_   = std::move(other.search_matches_);
+	trigrams_         = std::move(other.trigrams_);
+	search_overlay_   = std::move(other.search_overlay_);
 	// Update UndoSystem's buffer reference to point to this object
 	if (undo_sys_) {
 		undo_sys_->UpdateBufferReference(*this);
@@ -165,22 +187,25 @@ Buffer::operator=(Buffer &&other) noexcept
 	if (this == &other)
 		return *this;
 
-	curx_           = other.curx_;
-	cury_           = other.cury_;
-	rx_             = other.rx_;
-	nrows_          = other.nrows_;
-	rowoffs_        = other.rowoffs_;
-	coloffs_        = other.coloffs_;
-	rows_           = std::move(other.rows_);
-	filename_       = std::move(other.filename_);
-	is_file_backed_ = other.is_file_backed_;
-	dirty_          = other.dirty_;
-	read_only_      = other.read_only_;
-	mark_set_       = other.mark_set_;
-	mark_curx_      = other.mark_curx_;
-	mark_cury_      = other.mark_cury_;
-	undo_tree_      = std::move(other.undo_tree_);
-	undo_sys_       = std::move(other.undo_sys_);
+	curx_            = other.curx_;
+	cury_            = other.cury_;
+	rx_              = other.rx_;
+	nrows_           = other.nrows_;
+	rowoffs_         = other.rowoffs_;
+	coloffs_         = other.coloffs_;
+	rows_            = std::move(other.rows_);
+	filename_        = std::move(other.filename_);
+	mapped_          = std::move(other.mapped_);
+	changed_on_disk_ = other.changed_on_disk_;
+	is_file_backed_  = other.is_file_backed_;
+	dirty_           = other.dirty_;
+	read_only_       = other.read_only_;
+	mark_set_        = other.mark_set_;
+	mark_curx_       = other.mark_curx_;
+	mark_cury_       = other.mark_cury_;
+	undo_tree_       = std::move(other.undo_tree_);
+	undo_sys_        = std::move(other.undo_sys_);
+	save_job_        = std::move(other.save_job_);
 
 	// Move syntax/highlighting state
 	version_          = other.version_;
@@ -189,6 +214,9 @@ Buffer::operator=(Buffer &&other) noexcept
 	highlighter_      = std::move(other.highlighter_);
 	content_          = std::move(other.content_);
 	rows_cache_dirty_ = other.rows_cache_dirty_;
+	search_matches_   = std::move(other.search_matches_);
+	trigrams_         = std::move(other.trigrams_);
+	search_overlay_   = std::move(other.search_overlay_);
 	// Update UndoSystem's buffer reference to point to this object
 	if (undo_sys_) {
 		undo_sys_->UpdateBufferReference(*this);
@@ -243,29 +271,32 @@ Buffer::OpenFromFile(const std::string &path, std::string &err)
 		// Empty PieceTable
 		content_.Clear();
 		rows_cache_dirty_ = true;
+		search_matches_.Clear();
+		trigrams_.Clear();
+		if (highlighter_)
+			highlighter_->InvalidateFrom(0);
+		search_overlay_.Clear();
+		mapped_.reset();
+		changed_on_disk_ = false;
 
 		return true;
 	}
 
-	std::ifstream in(norm, std::ios::in | std::ios::binary);
-	if (!in) {
-		err = "Failed to open file: " + norm;
+	// Large files are mapped read-only and become the PieceTable's Original
+	// source without a copy; the mapping lives as long as any piece uses it.
+	auto file = kte::MappedFile::Open(norm, err);
+	if (!file)
 		return false;
-	}
-
-	// Read entire file into PieceTable as-is
-	std::string data;
-	in.seekg(0, std::ios::end);
-	auto sz = in.tellg();
-	if (sz > 0) {
-		data.resize(static_cast<std::size_t>(sz));
-		in.seekg(0, std::ios::beg);
-		in.read(data.data(), static_cast<std::streamsize>(data.size()));
-	}
-	content_.Clear();
-	if (!data.empty())
-		content_.Append(data.data(), data.size());
+	content_.LoadOriginal(std::shared_ptr<const char>(file, file->Data()), file->Size());
+	mapped_           = file->IsMapped() ? file : nullptr;
+	changed_on_disk_  = false;
 	rows_cache_dirty_ = true;
+	search_matches_.Clear();
+	trigrams_.Clear();
+	trigrams_.Refresh(content_);
+	if (highlighter_)
+		highlighter_->InvalidateFrom(0);
+	search_overlay_.Clear();
 	nrows_            = 0; // not used under PieceTable
 	filename_         = norm;
 	is_file_backed_   = true;
@@ -289,30 +320,278 @@ Buffer::OpenFromFile(const std::string &path, std::string &err)
 }
 
 
-bool
-Buffer::Save(std::string &err) const
+// Number of chunks handed to a single writev call
+static constexpr std::size_t kSaveIovBatch = 512;
+
+
+// Write all of iov to fd, resuming after partial writes and EINTR.
+static bool
+writev_all(const int fd, std::vector<iovec> &iov)
 {
-	if (!is_file_backed_ || filename_.empty()) {
-		err = "Buffer is not file-backed; use SaveAs()";
+	std::size_t first = 0;
+	while (first < iov.size()) {
+		const int cnt = static_cast<int>(iov.size() - first);
+		ssize_t n     = ::writev(fd, iov.data() + first, cnt);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			return false;
+		}
+		auto left = static_cast<std::size_t>(n);
+		while (first < iov.size() && left >= iov[first].iov_len) {
+			left -= iov[first].iov_len;
+			++first;
+		}
+		if (left > 0) {
+			iov[first].iov_base = static_cast<char *>(iov[first].iov_base) + left;
+			iov[first].iov_len -= left;
+		}
+	}
+	iov.clear();
+	return true;
+}
+
+
+// Create a fresh temporary file beside target. O_EXCL with a pid/counter
+// suffix keeps concurrent saves apart; the mode argument lets the umask apply
+// as it would for a normal new file.
+static int
+open_save_temp(const std::string &target, std::string &tmp)
+{
+	static std::atomic<unsigned> counter{0};
+	for (int attempt = 0; attempt < 100; ++attempt) {
+		tmp = target + ".kte-save." + std::to_string(::getpid()) + "." + std::to_string(counter++);
+		const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0666);
+		if (fd >= 0 || errno != EEXIST)
+			return fd;
+	}
+	return -1;
+}
+
+
+// Write every chunk of content to fd in writev batches, without
+// materializing the document
+static bool
+write_chunks(const int fd, const PieceTable &content)
+{
+	std::vector<iovec> iov;
+	iov.reserve(kSaveIovBatch);
+	bool ok = true;
+	content.ForEachChunk(0, content.Size(), [&](std::string_view chunk) {
+		iov.push_back(iovec{const_cast<char *>(chunk.data()), chunk.size()});
+		if (iov.size() == kSaveIovBatch)
+			ok = writev_all(fd, iov);
+		return ok;
+	});
+	return ok && writev_all(fd, iov);
+}
+
+
+// The file saving to path writes: the file a symlink points at rather than
+// the link itself
+static std::string
+save_target(const std::string &path)
+{
+	std::error_code ec;
+	if (std::filesystem::is_symlink(path, ec)) {
+		const auto resolved = std::filesystem::canonical(path, ec);
+		if (!ec)
+			return resolved.string();
+	}
+	return path;
+}
+
+
+// Whether write_file() will rewrite target in place: it has other hard
+// links, or its directory will not take a temporary file
+static bool
+rewrites_in_place(const std::string &target)
+{
+	struct stat st{};
+	if (::stat(target.c_str(), &st) != 0)
+		return false;
+	if (st.st_nlink > 1)
+		return true;
+	const std::string dir = std::filesystem::path(target).parent_path().string();
+	return ::access(dir.empty() ? "." : dir.c_str(), W_OK | X_OK) != 0;
+}
+
+
+// Truncate target and write the document into the same inode, for when
+// replacing it would fail or change what the file is. Not atomic: a crash
+// mid-save leaves a partial file. Refuses the inode the document's Original
+// source is still mapped from, as truncating it would take those bytes away
+// mid-write; callers move the document off the mapping first.
+static bool
+write_in_place(const std::string &target, const PieceTable &content, const kte::FileStamp &mapped,
+               std::string &err)
+{
+	if (kte::StatFile(target).SameFile(mapped)) {
+		err = "Cannot rewrite " + target + " in place while it is mapped; save it under another name";
 		return false;
 	}
-	std::ofstream out(filename_, std::ios::out | std::ios::binary | std::ios::trunc);
-	if (!out) {
-		err = "Failed to open for write: " + filename_ + ". Error: " + std::string(std::strerror(errno));
+	const int fd = ::open(target.c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC);
+	if (fd < 0) {
+		err = "Failed to open for write: " + target + ". Error: " + std::string(std::strerror(errno));
 		return false;
 	}
-	// Write the entire buffer in a single block to minimize I/O calls.
-	const char *data = content_.Data();
-	const auto size  = static_cast<std::streamsize>(content_.Size());
-	if (data != nullptr && size > 0) {
-		out.write(data, size);
+	bool ok = write_chunks(fd, content);
+	if (ok)
+		ok = ::fsync(fd) == 0;
+	if (!ok)
+		err = "Write error: " + target + ". Error: " + std::string(std::strerror(errno));
+	if (::close(fd) != 0 && ok) {
+		ok  = false;
+		err = "Write error: " + target + ". Error: " + std::string(std::strerror(errno));
 	}
-	if (!out.good()) {
-		err = "Write error: " + filename_ + ". Error: " + std::string(std::strerror(errno));
+	return ok;
+}
+
+
+// Write the document to path. Normally the pieces go into a temporary file
+// next to path, which is fsynced and renamed over path: a crash mid-save
+// leaves either the old file or the complete new one, and the inode mapped
+// as the buffer's Original source is never truncated while it is read. The
+// replacement gets the old file's permission bits and, where we may set
+// them, its owner and group; ACLs and extended attributes are not carried
+// over. Where a replacement cannot be made (the directory is not writable)
+// or would not be seen by every name of the file (it has other hard
+// links), the file is rewritten in place instead.
+static bool
+write_file(const std::string &path, const PieceTable &content, const kte::FileStamp &mapped, std::string &err)
+{
+	const std::string target = save_target(path);
+	struct stat st{};
+	const bool exists = ::stat(target.c_str(), &st) == 0;
+	if (exists && st.st_nlink > 1)
+		return write_in_place(target, content, mapped, err);
+
+	std::string tmp;
+	const int fd = open_save_temp(target, tmp);
+	if (fd < 0) {
+		if (exists)
+			return write_in_place(target, content, mapped, err);
+		err = "Failed to open for write: " + target + ". Error: " + std::string(std::strerror(errno));
 		return false;
 	}
-	// Note: const method cannot change dirty_. Intentionally const to allow UI code
-	// to decide when to flip dirty flag after successful save.
+	if (exists) {
+		// Only root may give a file away, so EPERM just leaves it ours; any
+		// other failure keeps the original inode, and its owner, instead
+		if (::fchown(fd, st.st_uid, st.st_gid) != 0 && errno != EPERM) {
+			::close(fd);
+			::unlink(tmp.c_str());
+			return write_in_place(target, content, mapped, err);
+		}
+		(void) ::fchmod(fd, st.st_mode & 07777);
+	}
+
+	bool ok = write_chunks(fd, content);
+	if (ok)
+		ok = ::fsync(fd) == 0;
+	if (!ok)
+		err = "Write error: " + tmp + ". Error: " + std::string(std::strerror(errno));
+	if (::close(fd) != 0 && ok) {
+		ok  = false;
+		err = "Write error: " + tmp + ". Error: " + std::string(std::strerror(errno));
+	}
+	if (!ok) {
+		::unlink(tmp.c_str());
+		return false;
+	}
+
+	if (::rename(tmp.c_str(), target.c_str()) != 0) {
+		err = "Failed to replace " + target + ": " + std::string(std::strerror(errno));
+		::unlink(tmp.c_str());
+		return false;
+	}
+	// Make the rename itself durable
+	const std::string dir = std::filesystem::path(target).parent_path().string();
+	const int dfd         = ::open(dir.empty() ? "." : dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	if (dfd >= 0) {
+		(void) ::fsync(dfd);
+		::close(dfd);
+	}
+	return true;
+}
+
+
+// Refuse to save if the file the buffer's Original source is mapped from was
+// modified in place since it was opened: the mapping then no longer holds the
+// bytes we loaded, so saving from it would write corrupted content.
+static bool
+check_mapped_target(const kte::FileStamp &mapped, const std::string &path, std::string &err)
+{
+	if (!mapped.valid)
+		return true;
+	const kte::FileStamp now = kte::StatFile(path);
+	if (now.SameFile(mapped) && now != mapped) {
+		err = "File changed on disk since it was opened: " + path + ". Not saving; reopen the file";
+		return false;
+	}
+	return true;
+}
+
+
+kte::FileStamp
+Buffer::mapped_stamp() const
+{
+	return mapped_ ? mapped_->Stamp() : kte::FileStamp{};
+}
+
+
+void
+Buffer::unmap_for_save(const std::string &path)
+{
+	if (!mapped_)
+		return;
+	const std::string target = save_target(path);
+	if (!kte::StatFile(target).SameFile(mapped_->Stamp()) || !rewrites_in_place(target))
+		return;
+	// The text is unchanged, but readers of the old pieces (a count, an
+	// index build, highlight warming) may be reading the mapping when the
+	// rewrite lands, so their results are dropped too
+	auto text = std::make_shared<std::string>(content_.GetRange(0, content_.Size()));
+	content_.LoadOriginal(std::shared_ptr<const char>(text, text->data()), text->size());
+	mapped_.reset();
+	rows_cache_dirty_ = true;
+	search_matches_.Clear();
+	trigrams_.Clear();
+	trigrams_.Refresh(content_);
+	if (highlighter_)
+		highlighter_->InvalidateFrom(0);
+}
+
+
+bool
+Buffer::CheckOnDisk()
+{
+	if (!mapped_ || changed_on_disk_)
+		return false;
+	if (!mapped_->Damaged()) {
+		const kte::FileStamp now = kte::StatFile(filename_);
+		if (!now.SameFile(mapped_->Stamp()) || now == mapped_->Stamp())
+			return false;
+	}
+	changed_on_disk_ = true;
+	dirty_           = true;
+	return true;
+}
+
+
+bool
+Buffer::Save(std::string &err)
+{
+	if (!is_file_backed_ || filename_.empty()) {
+		err = "Buffer is not file-backed; use SaveAs()";
+		return false;
+	}
+	if (!check_mapped_target(mapped_stamp(), filename_, err))
+		return false;
+	unmap_for_save(filename_);
+	if (!write_file(filename_, content_, mapped_stamp(), err))
+		return false;
+	// Note: dirty_ is left alone, so that UI code decides when to flip the
+	// dirty flag after a successful save.
 	return true;
 }
 
@@ -340,21 +619,11 @@ Buffer::SaveAs(const std::string &path, std::string &err)
 	}
 
 	// Write to the given path
-	std::ofstream out(out_path, std::ios::out | std::ios::binary | std::ios::trunc);
-	if (!out) {
-		err = "Failed to open for write: " + out_path + ". Error: " + std::string(std::strerror(errno));
+	if (!check_mapped_target(mapped_stamp(), out_path, err))
 		return false;
-	}
-	// Write whole content in a single I/O operation
-	const char *data = content_.Data();
-	const auto size  = static_cast<std::streamsize>(content_.Size());
-	if (data != nullptr && size > 0) {
-		out.write(data, size);
-	}
-	if (!out.good()) {
-		err = "Write error: " + out_path + ". Error: " + std::string(std::strerror(errno));
+	unmap_for_save(out_path);
+	if (!write_file(out_path, content_, mapped_stamp(), err))
 		return false;
-	}
 
 	filename_       = out_path;
 	is_file_backed_ = true;
@@ -363,6 +632,100 @@ Buffer::SaveAs(const std::string &path, std::string &err)
 }
 
 
+std::shared_ptr<const Buffer>
+Buffer::Snapshot() const
+{
+	auto snap             = std::make_shared<Buffer>();
+	snap->content_        = content_;
+	snap->filename_       = filename_;
+	snap->is_file_backed_ = is_file_backed_;
+	snap->dirty_          = dirty_;
+	snap->read_only_      = true;
+	snap->version_        = version_;
+	snap->syntax_enabled_ = false;
+	snap->filetype_       = filetype_;
+	return snap;
+}
+
+
+// A background save: the worker writes its own snapshot and sets the
+// result fields
+struct Buffer::SaveJob {
+	PieceTable snapshot;
+	std::string path;
+	kte::FileStamp mapped;
+	std::uint64_t version = 0; // Buffer::version_ when the snapshot was taken
+	bool ok               = false;
+	std::string err;
+	kte::BackgroundJob worker;
+};
+
+
+bool
+Buffer::StartSave(std::string &err)
+{
+	if (!is_file_backed_ || filename_.empty()) {
+		err = "Buffer is not file-backed; use SaveAs()";
+		return false;
+	}
+	if (SaveInProgress()) {
+		err = "Save already in progress: " + filename_;
+		return false;
+	}
+	// Checked here too, so that a refused save leaves the mapping in place;
+	// the worker checks again just before writing
+	if (!check_mapped_target(mapped_stamp(), filename_, err))
+		return false;
+	unmap_for_save(filename_);
+	auto job      = std::make_shared<SaveJob>();
+	job->snapshot = content_; // O(1); shares storage with the live table
+	job->path     = filename_;
+	job->mapped   = mapped_stamp();
+	job->version  = version_;
+	SaveJob *j    = job.get();
+	job->worker.Start([j] {
+		j->ok = check_mapped_target(j->mapped, j->path, j->err)
+		        && write_file(j->path, j->snapshot, j->mapped, j->err);
+	});
+	save_job_ = std::move(job);
+	return true;
+}
+
+
+bool
+Buffer::SaveInProgress() const
+{
+	return save_job_ && !save_job_->worker.Done();
+}
+
+
+bool
+Buffer::PollSave(SaveResult &result)
+{
+	if (!save_job_ || !save_job_->worker.Done())
+		return false;
+	save_job_->worker.Wait();
+	result.ok       = save_job_->ok;
+	result.err      = save_job_->err;
+	result.modified = version_ != save_job_->version;
+	save_job_.reset();
+	if (result.ok && !result.modified) {
+		dirty_ = false;
+		if (undo_sys_)
+			undo_sys_->mark_saved();
+	}
+	return true;
+}
+
+
+void
+Buffer::WaitSave()
+{
+	if (save_job_)
+		save_job_->worker.Wait();
+}
+
+
 std::string
 Buffer::AsString() const
 {
@@ -387,8 +750,10 @@ Buffer::insert_text(int row, int col, std::string_view text)
 	const std::size_t off = content_.LineColToByteOffset(static_cast<std::size_t>(row),
 	                                                     static_cast<std::size_t>(col));
 	if (!text.empty()) {
+		const std::size_t before = content_.LineCount();
 		content_.Insert(off, text.data(), text.size());
 		rows_cache_dirty_ = true;
+		note_edit(std::min(static_cast<std::size_t>(row), before > 0 ? before - 1 : 0), 1, before);
 	}
 }
 
@@ -397,14 +762,57 @@ Buffer::insert_text(int row, int col, std::string_view text)
 std::string_view
 Buffer::GetLineView(std::size_t row) const
 {
-	// Get byte range for the logical line and return a view into materialized data
-	auto range       = content_.GetLineRange(row); // [start,end) in bytes
-	const char *base = content_.Data(); // materializes if needed
-	if (!base)
+	return GetLineView(row, line_scratch_);
+}
+
+
+std::string_view
+Buffer::GetLineView(std::size_t row, std::string &scratch) const
+{
+	// Get byte range for the logical line. Most lines sit inside one piece and
+	// can be viewed in place; a line that spans pieces is assembled into a
+	// scratch copy, so the cost is O(line) rather than O(document).
+	const auto [start, end] = content_.GetLineRange(row); // [start,end) in bytes
+	if (end <= start)
 		return std::string_view();
-	const std::size_t start = range.first;
-	const std::size_t len   = (range.second > range.first) ? (range.second - range.first) : 0;
-	return std::string_view(base + start, len);
+	std::string_view first;
+	bool spans = false;
+	content_.ForEachChunk(start, end - start, [&](std::string_view chunk) {
+		if (first.data() == nullptr) {
+			first = chunk;
+			return true;
+		}
+		spans = true;
+		return false;
+	});
+	if (!spans)
+		return first;
+	scratch.clear();
+	content_.ForEachChunk(start, end - start, [&scratch](std::string_view chunk) {
+		scratch.append(chunk);
+		return true;
+	});
+	return scratch;
+}
+
+
+std::size_t
+Buffer::LineLength(std::size_t row) const
+{
+	const auto [start, end] = content_.GetLineRange(row);
+	if (end <= start)
+		return 0;
+	// Every line but the last ends in '\n'
+	return (row + 1 < content_.LineCount()) ? end - start - 1 : end - start;
+}
+
+
+char
+Buffer::CharAt(std::size_t row, std::size_t col) const
+{
+	if (col >= LineLength(row))
+		return '\0';
+	return content_.ByteAt(content_.GetLineRange(row).first + col);
 }
 
 
@@ -432,6 +840,25 @@ Buffer::content_LineCount_() const
 }
 
 
+void
+Buffer::note_edit(const std::size_t row, const std::size_t old_rows, const std::size_t lines_before)
+{
+	const std::size_t after = content_.LineCount();
+	if (old_rows + after < lines_before) {
+		search_matches_.Clear();
+		trigrams_.Clear();
+		if (highlighter_)
+			highlighter_->InvalidateFrom(static_cast<int>(row));
+		return;
+	}
+	const std::size_t new_rows = old_rows + after - lines_before;
+	search_matches_.Edited(row, old_rows, new_rows);
+	trigrams_.Edited(row, old_rows, new_rows);
+	if (highlighter_)
+		highlighter_->Edited(static_cast<int>(row), static_cast<int>(old_rows), static_cast<int>(new_rows));
+}
+
+
 void
 Buffer::delete_text(int row, int col, std::size_t len)
 {
@@ -470,6 +897,7 @@ Buffer::delete_text(int row, int col, std::size_t len)
 			std::size_t total = content_.Size();
 			content_.Delete(start, total - start);
 			rows_cache_dirty_ = true;
+			note_edit(static_cast<std::size_t>(row), lc - static_cast<std::size_t>(row), lc);
 			return;
 		}
 	}
@@ -479,6 +907,7 @@ Buffer::delete_text(int row, int col, std::size_t len)
 	if (end > start) {
 		content_.Delete(start, end - start);
 		rows_cache_dirty_ = true;
+		note_edit(static_cast<std::size_t>(row), r - static_cast<std::size_t>(row) + 1, lc);
 	}
 }
 
@@ -492,9 +921,11 @@ Buffer::split_line(int row, const int col)
 		row = 0;
 	const std::size_t off = content_.LineColToByteOffset(static_cast<std::size_t>(row),
 	                                                     static_cast<std::size_t>(col));
-	const char nl = '\n';
+	const std::size_t before = content_.LineCount();
+	const char nl            = '\n';
 	content_.Insert(off, &nl, 1);
 	rows_cache_dirty_ = true;
+	note_edit(static_cast<std::size_t>(row), 1, before);
 }
 
 
@@ -509,8 +940,10 @@ Buffer::join_lines(int row)
 	// Delete the newline between line r and r+1
 	std::size_t end_of_line = content_.LineColToByteOffset(r, std::numeric_limits<std::size_t>::max());
 	// end_of_line now equals line end (clamped before newline). The newline should be exactly at this position.
+	const std::size_t before = content_.LineCount();
 	content_.Delete(end_of_line, 1);
 	rows_cache_dirty_ = true;
+	note_edit(r, 2, before);
 }
 
 
@@ -519,12 +952,14 @@ Buffer::insert_row(int row, const std::string_view text)
 {
 	if (row < 0)
 		row = 0;
-	std::size_t off = content_.LineColToByteOffset(static_cast<std::size_t>(row), 0);
+	std::size_t off          = content_.LineColToByteOffset(static_cast<std::size_t>(row), 0);
+	const std::size_t before = content_.LineCount();
 	if (!text.empty())
 		content_.Insert(off, text.data(), text.size());
 	const char nl = '\n';
 	content_.Insert(off + text.size(), &nl, 1);
 	rows_cache_dirty_ = true;
+	note_edit(std::min(static_cast<std::size_t>(row), before), 0, before);
 }
 
 
@@ -537,12 +972,33 @@ Buffer::delete_row(int row)
 	if (r >= content_.LineCount())
 		return;
 	auto range = content_.GetLineRange(r); // [start,end)
-	// If not last line, ensure we include the separating newline by using end as-is (which points to next line start)
-	// If last line, end may equal total_size_. We still delete [start,end) which removes the last line content.
-	std::size_t start = range.first;
-	std::size_t end   = range.second;
+	// If not last line, end points at the next line start, so the separating
+	// newline goes with the row. The last line has no trailing newline; take
+	// the one before it instead so the row count actually drops.
+	std::size_t start        = range.first;
+	std::size_t end          = range.second;
+	const std::size_t before = content_.LineCount();
+	const bool last          = r > 0 && r + 1 == before;
+	if (last)
+		start -= 1;
 	content_.Delete(start, end - start);
 	rows_cache_dirty_ = true;
+	note_edit(last ? r - 1 : r, last ? 2 : 1, before);
+}
+
+
+void
+Buffer::replace_all(const std::vector<PieceTable::Splice> &splices)
+{
+	if (splices.empty())
+		return;
+	const std::size_t first_row = content_.ByteOffsetToLineCol(splices.front().offset).first;
+	content_.ReplaceAll(splices);
+	rows_cache_dirty_ = true;
+	search_matches_.Clear(); // edits anywhere in the buffer; not worth following
+	trigrams_.Clear();
+	if (highlighter_)
+		highlighter_->InvalidateFrom(static_cast<int>(first_row));
 }
 
 
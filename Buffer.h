@@ -9,7 +9,11 @@
 #include <vector>
 #include <string_view>
 
+#include "MappedFile.h"
+#include "MatchIndex.h"
 #include "PieceTable.h"
+#include "SearchOverlay.h"
+#include "TrigramIndex.h"
 #include "UndoSystem.h"
 #include <cstdint>
 #include "syntax/HighlighterEngine.h"
@@ -38,9 +42,42 @@ public:
 	// File operations
 	bool OpenFromFile(const std::string &path, std::string &err);
 
-	bool Save(std::string &err) const; // saves to existing filename; returns false if not file-backed
+	bool Save(std::string &err); // saves to existing filename; returns false if not file-backed
 	bool SaveAs(const std::string &path, std::string &err); // saves to path and makes buffer file-backed
 
+	// Background save: StartSave() snapshots the contents and writes them to
+	// the buffer's file on a worker thread, so editing can continue while the
+	// write runs. Fails if the buffer is not file-backed or a save is running.
+	bool StartSave(std::string &err);
+
+	[[nodiscard]] bool SaveInProgress() const;
+
+	struct SaveResult {
+		bool ok       = false;
+		bool modified = false; // buffer was edited after the snapshot was taken
+		std::string err;
+	};
+
+	// Reports a finished background save once, returning true. A successful
+	// save marks the buffer clean only if it was not edited in the meantime.
+	bool PollSave(SaveResult &result);
+
+	// Block until a running background save has finished (PollSave still reports it)
+	void WaitSave();
+
+	// Notice the file this buffer's Original source is mapped from changing
+	// underneath it: truncated, so that the pages it lost read as zeros, or
+	// rewritten in place. Returns true the first time; the buffer is then
+	// ChangedOnDisk() and dirty, since its contents no longer match the file
+	// and can only be kept by saving them under another name.
+	bool CheckOnDisk();
+
+
+	[[nodiscard]] bool ChangedOnDisk() const
+	{
+		return changed_on_disk_;
+	}
+
 	// Accessors
 	[[nodiscard]] std::size_t Curx() const
 	{
@@ -225,6 +262,10 @@ public:
 	};
 
 
+	// Full materialized row cache. Rebuilding it allocates a string per line of
+	// the document after every edit, so editing, rendering and highlighting use
+	// the lazy per-line accessors below instead; this remains for tests and
+	// tooling that want a snapshot of all rows.
 	[[nodiscard]] const std::vector<Line> &Rows() const
 	{
 		ensure_rows_cache();
@@ -253,10 +294,38 @@ public:
 	}
 
 
-	// Zero-copy view of a line. Points into the materialized backing store; becomes
-	// invalid after subsequent edits. Use immediately.
+	// Length of a line in bytes, excluding its trailing newline; O(log n).
+	[[nodiscard]] std::size_t LineLength(std::size_t row) const;
+
+	// Byte at (row, col), or '\0' past the end of the line (as Line::operator[]).
+	[[nodiscard]] char CharAt(std::size_t row, std::size_t col) const;
+
+
+	// View of a line including its trailing newline. Points into the piece
+	// storage, or into a per-buffer scratch copy when the line spans pieces;
+	// becomes invalid after subsequent edits or the next GetLineView call. Use
+	// immediately.
 	[[nodiscard]] std::string_view GetLineView(std::size_t row) const;
 
+	// As GetLineView(row), but a line that spans pieces is copied into the
+	// caller's scratch, so readers on different threads do not share storage
+	[[nodiscard]] std::string_view GetLineView(std::size_t row, std::string &scratch) const;
+
+
+	// Read-only access to the underlying document, e.g. for chunked reads
+	// (PieceTable::ForEachChunk) that should not materialize the whole file.
+	[[nodiscard]] const PieceTable &Content() const
+	{
+		return content_;
+	}
+
+
+	// Detached read-only copy of this buffer for a background reader such as
+	// the highlighter's warm-up worker. O(1): it shares the piece table's
+	// storage and carries this buffer's Version(), but has no undo history,
+	// highlighter or swap recorder. Edits here never affect the snapshot.
+	[[nodiscard]] std::shared_ptr<const Buffer> Snapshot() const;
+
 
 	[[nodiscard]] const std::string &Filename() const
 	{
@@ -327,12 +396,8 @@ public:
 	void SetDirty(bool d)
 	{
 		dirty_ = d;
-		if (d) {
-			++version_;
-			if (highlighter_) {
-				highlighter_->InvalidateFrom(0);
-			}
-		}
+		if (d)
+			++version_; // the edits themselves were reported to highlighter_
 	}
 
 
@@ -421,6 +486,37 @@ public:
 	}
 
 
+	// Matches of the current find query, kept current by the raw editing
+	// APIs below
+	[[nodiscard]] MatchIndex &SearchMatches()
+	{
+		return search_matches_;
+	}
+
+
+	[[nodiscard]] const MatchIndex &SearchMatches() const
+	{
+		return search_matches_;
+	}
+
+
+	// Trigram index that lets searches skip most of a large buffer, kept
+	// current by the raw editing APIs below. It is a cache of the contents,
+	// so it can be consulted and updated through a const Buffer.
+	[[nodiscard]] TrigramIndex &Trigrams() const
+	{
+		return trigrams_;
+	}
+
+
+	// Search hits of the rows on screen, for renderers. Like Trigrams() it is
+	// a cache, reached through a const Buffer.
+	[[nodiscard]] SearchOverlay &SearchHighlights() const
+	{
+		return search_overlay_;
+	}
+
+
 	// Swap journal integration (set by Editor)
 	void SetSwapRecorder(kte::SwapRecorder *rec)
 	{
@@ -442,6 +538,10 @@ public:
 
 	void delete_row(int row);
 
+	// Apply ascending, non-overlapping byte-range replacements in one pass
+	// (see PieceTable::ReplaceAll), as replace-all does
+	void replace_all(const std::vector<PieceTable::Splice> &splices);
+
 	// Undo system accessors (created per-buffer)
 	[[nodiscard]] UndoSystem *Undo();
 
@@ -457,6 +557,7 @@ private:
 	// PieceTable is the source of truth.
 	PieceTable content_{};
 	mutable bool rows_cache_dirty_ = true; // invalidate on edits / I/O
+	mutable std::string line_scratch_; // GetLineView storage for lines spanning pieces
 
 	// Helper to rebuild rows_ from content_
 	void ensure_rows_cache() const;
@@ -464,7 +565,24 @@ private:
 	// Helper to query content_.LineCount() while keeping header minimal
 	std::size_t content_LineCount_() const;
 
+	// Report to search_matches_, trigrams_ and highlighter_ that rows
+	// [row, row + old_rows) were edited, given the line count before the edit
+	void note_edit(std::size_t row, std::size_t old_rows, std::size_t lines_before);
+
 	std::string filename_;
+	// The file content_'s Original source is mapped from; null when the
+	// contents were read into memory instead.
+	std::shared_ptr<const kte::MappedFile> mapped_;
+	bool changed_on_disk_ = false;
+
+	// mapped_'s stamp, or an invalid one when nothing is mapped
+	[[nodiscard]] kte::FileStamp mapped_stamp() const;
+
+	// If saving to path would rewrite the mapped file in place, move
+	// content_ into memory first, so the buffer does not read the new bytes
+	// at the old offsets
+	void unmap_for_save(const std::string &path);
+
 	bool is_file_backed_   = false;
 	bool dirty_            = false;
 	bool read_only_        = false;
@@ -475,11 +593,18 @@ private:
 	std::unique_ptr<struct UndoTree> undo_tree_;
 	std::unique_ptr<UndoSystem> undo_sys_;
 
+	// Background save in flight, if any
+	struct SaveJob;
+	std::shared_ptr<SaveJob> save_job_;
+
 	// Syntax/highlighting state
 	std::uint64_t version_ = 0; // increment on edits
 	bool syntax_enabled_   = true;
 	std::string filetype_;
 	std::unique_ptr<kte::HighlighterEngine> highlighter_;
+	MatchIndex search_matches_;
+	mutable TrigramIndex trigrams_;
+	mutable SearchOverlay search_overlay_;
 	// Non-owning pointer to swap recorder managed by Editor/SwapManager
 	kte::SwapRecorder *swap_rec_ = nullptr;
 };
\ No newline at end of file
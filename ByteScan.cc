@@ -0,0 +1,597 @@
+#include "ByteScan.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#  define KTE_SCAN_X86 1
+#  include <immintrin.h>
+#endif
+
+
+namespace kte {
+namespace {
+struct Kernels {
+	std::size_t (*count)(const char *, std::size_t);
+
+	void (*find_all)(const char *, std::size_t, std::size_t, std::vector<std::size_t> &);
+
+	const char *(*find_sub)(const char *, std::size_t, const char *, std::size_t);
+
+	const char *(*find_folded)(const char *, std::size_t, const FoldedNeedle &);
+};
+
+
+// ===== Case folding =====
+
+// Simple case folding of code point c, for the blocks FoldCase covers
+std::uint32_t
+fold_code_point(const std::uint32_t c)
+{
+	if (c >= 'A' && c <= 'Z')
+		return c + ('a' - 'A');
+	if (c >= 0xC0 && c <= 0xDE && c != 0xD7)
+		return c + 0x20;
+	if (c >= 0x100 && c <= 0x17F) {
+		// Upper and lower case alternate; dotted/dotless i, long s and the
+		// letters without a case pair are left alone
+		if (c == 0x130 || c == 0x131 || c == 0x138 || c == 0x149 || c == 0x17F)
+			return c;
+		if (c == 0x178)
+			return 0xFF;
+		const bool odd_upper = (c >= 0x139 && c <= 0x148) || (c >= 0x179 && c <= 0x17E);
+		return (c % 2 == 1) == odd_upper ? c + 1 : c;
+	}
+	if (c >= 0x391 && c <= 0x3AB && c != 0x3A2)
+		return c + 0x20;
+	switch (c) {
+	case 0x386:
+		return 0x3AC;
+	case 0x388:
+	case 0x389:
+	case 0x38A:
+		return c + 0x25;
+	case 0x38C:
+		return 0x3CC;
+	case 0x38E:
+	case 0x38F:
+		return c + 0x3F;
+	case 0x3C2:
+		return 0x3C3; // final sigma
+	default:
+		break;
+	}
+	if (c >= 0x400 && c <= 0x40F)
+		return c + 0x50;
+	if (c >= 0x410 && c <= 0x42F)
+		return c + 0x20;
+	if ((c >= 0x460 && c <= 0x481) || (c >= 0x48A && c <= 0x4BF))
+		return c % 2 == 0 ? c + 1 : c;
+	return c;
+}
+
+
+struct FoldTables {
+	unsigned char ascii[256]; // single bytes; bytes >= 0x80 map to themselves
+	std::uint16_t two[0x800]; // code points with a two-byte UTF-8 encoding
+};
+
+
+const FoldTables &
+fold_tables()
+{
+	static const FoldTables tables = [] {
+		FoldTables t{};
+		for (std::uint32_t b = 0; b < 256; ++b)
+			t.ascii[b] = static_cast<unsigned char>(b < 0x80 ? fold_code_point(b) : b);
+		for (std::uint32_t c = 0; c < 0x800; ++c)
+			t.two[c] = static_cast<std::uint16_t>(fold_code_point(c));
+		return t;
+	}();
+	return tables;
+}
+
+
+// Fold the character at p, with avail bytes left, into out and return its
+// length in bytes
+inline std::size_t
+fold_char(const FoldTables &t, const unsigned char *p, const std::size_t avail, unsigned char out[2])
+{
+	const unsigned char b = p[0];
+	if (b >= 0xC2 && b <= 0xDF && avail >= 2 && (p[1] & 0xC0) == 0x80) {
+		const std::uint32_t c = t.two[(b & 0x1Fu) << 6 | (p[1] & 0x3Fu)];
+		out[0]                = static_cast<unsigned char>(0xC0 | c >> 6);
+		out[1]                = static_cast<unsigned char>(0x80 | (c & 0x3F));
+		return 2;
+	}
+	out[0] = t.ascii[b];
+	return 1;
+}
+
+
+// Whether the avail bytes at p start with text that folds to needle
+bool
+folded_equal(const unsigned char *p, const std::size_t avail, const std::string &needle)
+{
+	const FoldTables &t = fold_tables();
+	const auto *n       = reinterpret_cast<const unsigned char *>(needle.data());
+	for (std::size_t i = 0; i < needle.size();) {
+		unsigned char c[2];
+		const std::size_t k = fold_char(t, p + i, avail - i, c);
+		if (i + k > needle.size() || c[0] != n[i] || (k == 2 && c[1] != n[i + 1]))
+			return false;
+		i += k;
+	}
+	return true;
+}
+
+
+// ===== Scalar =====
+
+std::size_t
+count_scalar(const char *data, const std::size_t len)
+{
+	std::size_t n = 0;
+	for (std::size_t i = 0; i < len; ++i)
+		n += data[i] == '\n';
+	return n;
+}
+
+
+void
+find_all_scalar(const char *data, const std::size_t len, const std::size_t base, std::vector<std::size_t> &out)
+{
+	for (std::size_t i = 0; i < len; ++i) {
+		if (data[i] == '\n')
+			out.push_back(base + i);
+	}
+}
+
+
+// Callers guarantee 2 <= nlen <= len in the find_sub kernels; FindSubstring
+// handles the trivial cases.
+const char *
+find_sub_scalar(const char *data, const std::size_t len, const char *needle, const std::size_t nlen)
+{
+	const char *end = data + (len - nlen + 1);
+	for (const char *p = data; p < end; ++p) {
+		p = static_cast<const char *>(std::memchr(p, needle[0], static_cast<std::size_t>(end - p)));
+		if (!p)
+			return nullptr;
+		if (p[nlen - 1] == needle[nlen - 1] && std::memcmp(p + 1, needle + 1, nlen - 2) == 0)
+			return p;
+	}
+	return nullptr;
+}
+
+
+// Callers guarantee 1 <= needle.text.size() <= len
+const char *
+find_folded_scalar(const char *data, const std::size_t len, const FoldedNeedle &needle)
+{
+	const auto *p       = reinterpret_cast<const unsigned char *>(data);
+	const std::size_t n = needle.text.size();
+	for (std::size_t i = 0; i + n <= len; ++i) {
+		if (needle.filter) {
+			const unsigned char f = p[i + needle.fpos];
+			const unsigned char l = p[i + needle.lpos];
+			if ((f != needle.f[0] && f != needle.f[1]) || (l != needle.l[0] && l != needle.l[1]))
+				continue;
+		}
+		if (folded_equal(p + i, len - i, needle.text))
+			return data + i;
+	}
+	return nullptr;
+}
+
+
+#if defined(KTE_SCAN_X86)
+// Emit base + i for every set bit i of mask.
+inline void
+push_mask(std::uint32_t mask, const std::size_t base, std::vector<std::size_t> &out)
+{
+	while (mask) {
+		out.push_back(base + static_cast<std::size_t>(__builtin_ctz(mask)));
+		mask &= mask - 1;
+	}
+}
+
+
+// ===== SSE2 (16 bytes per step) =====
+
+__attribute__((target("sse2"))) std::size_t
+count_sse2(const char *data, const std::size_t len)
+{
+	const __m128i nl = _mm_set1_epi8('\n');
+	std::size_t n    = 0;
+	std::size_t i    = 0;
+	// Accumulate per-lane counts in bytes for up to 255 blocks, then fold with SAD.
+	while (i + 16 <= len) {
+		__m128i acc            = _mm_setzero_si128();
+		const std::size_t stop = std::min(len - 15, i + 255 * 16);
+		for (; i < stop; i += 16) {
+			const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+			acc             = _mm_sub_epi8(acc, _mm_cmpeq_epi8(v, nl));
+		}
+		const __m128i sums = _mm_sad_epu8(acc, _mm_setzero_si128());
+		n += static_cast<std::size_t>(_mm_cvtsi128_si32(sums)) +
+			static_cast<std::size_t>(_mm_extract_epi16(sums, 4));
+	}
+	return n + count_scalar(data + i, len - i);
+}
+
+
+__attribute__((target("sse2"))) void
+find_all_sse2(const char *data, const std::size_t len, const std::size_t base, std::vector<std::size_t> &out)
+{
+	const __m128i nl = _mm_set1_epi8('\n');
+	std::size_t i    = 0;
+	for (; i + 16 <= len; i += 16) {
+		const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+		const auto mask = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(v, nl)));
+		push_mask(mask, base + i, out);
+	}
+	find_all_scalar(data + i, len - i, base + i, out);
+}
+
+
+__attribute__((target("sse2"))) const char *
+find_sub_sse2(const char *data, const std::size_t len, const char *needle, const std::size_t nlen)
+{
+	const __m128i first = _mm_set1_epi8(needle[0]);
+	const __m128i last  = _mm_set1_epi8(needle[nlen - 1]);
+	std::size_t i       = 0;
+	for (; i + nlen - 1 + 16 <= len; i += 16) {
+		const __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+		const __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + nlen - 1));
+		auto mask       = static_cast<std::uint32_t>(
+			_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(f, first), _mm_cmpeq_epi8(l, last))));
+		while (mask) {
+			const char *p = data + i + static_cast<std::size_t>(__builtin_ctz(mask));
+			if (std::memcmp(p + 1, needle + 1, nlen - 2) == 0)
+				return p;
+			mask &= mask - 1;
+		}
+	}
+	return len - i >= nlen ? find_sub_scalar(data + i, len - i, needle, nlen) : nullptr;
+}
+
+
+__attribute__((target("sse2"))) const char *
+find_folded_sse2(const char *data, const std::size_t len, const FoldedNeedle &needle)
+{
+	const auto *p       = reinterpret_cast<const unsigned char *>(data);
+	const std::size_t n = needle.text.size();
+	const __m128i f0    = _mm_set1_epi8(static_cast<char>(needle.f[0]));
+	const __m128i f1    = _mm_set1_epi8(static_cast<char>(needle.f[1]));
+	const __m128i l0    = _mm_set1_epi8(static_cast<char>(needle.l[0]));
+	const __m128i l1    = _mm_set1_epi8(static_cast<char>(needle.l[1]));
+	std::size_t i       = 0;
+	for (; i + n - 1 + 16 <= len; i += 16) {
+		const __m128i f = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + needle.fpos));
+		const __m128i l = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i + needle.lpos));
+		const __m128i mf = _mm_or_si128(_mm_cmpeq_epi8(f, f0), _mm_cmpeq_epi8(f, f1));
+		const __m128i ml = _mm_or_si128(_mm_cmpeq_epi8(l, l0), _mm_cmpeq_epi8(l, l1));
+		auto mask        = static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_and_si128(mf, ml)));
+		while (mask) {
+			const std::size_t at = i + static_cast<std::size_t>(__builtin_ctz(mask));
+			if (folded_equal(p + at, len - at, needle.text))
+				return data + at;
+			mask &= mask - 1;
+		}
+	}
+	return len - i >= n ? find_folded_scalar(data + i, len - i, needle) : nullptr;
+}
+
+
+// ===== AVX2 (32 bytes per step) =====
+
+__attribute__((target("avx2"))) std::size_t
+count_avx2(const char *data, const std::size_t len)
+{
+	const __m256i nl = _mm256_set1_epi8('\n');
+	std::size_t n    = 0;
+	std::size_t i    = 0;
+	while (i + 32 <= len) {
+		__m256i acc            = _mm256_setzero_si256();
+		const std::size_t stop = std::min(len - 31, i + 255 * 32);
+		for (; i < stop; i += 32) {
+			const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+			acc             = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(v, nl));
+		}
+		const __m256i sums = _mm256_sad_epu8(acc, _mm256_setzero_si256());
+		n += static_cast<std::size_t>(_mm256_extract_epi64(sums, 0)) +
+			static_cast<std::size_t>(_mm256_extract_epi64(sums, 1)) +
+			static_cast<std::size_t>(_mm256_extract_epi64(sums, 2)) +
+			static_cast<std::size_t>(_mm256_extract_epi64(sums, 3));
+	}
+	return n + count_sse2(data + i, len - i);
+}
+
+
+__attribute__((target("avx2"))) void
+find_all_avx2(const char *data, const std::size_t len, const std::size_t base, std::vector<std::size_t> &out)
+{
+	const __m256i nl = _mm256_set1_epi8('\n');
+	std::size_t i    = 0;
+	for (; i + 32 <= len; i += 32) {
+		const __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+		const auto mask = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl)));
+		push_mask(mask, base + i, out);
+	}
+	find_all_sse2(data + i, len - i, base + i, out);
+}
+
+
+__attribute__((target("avx2"))) const char *
+find_sub_avx2(const char *data, const std::size_t len, const char *needle, const std::size_t nlen)
+{
+	const __m256i first = _mm256_set1_epi8(needle[0]);
+	const __m256i last  = _mm256_set1_epi8(needle[nlen - 1]);
+	std::size_t i       = 0;
+	for (; i + nlen - 1 + 32 <= len; i += 32) {
+		const __m256i f = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+		const __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + nlen - 1));
+		auto mask       = static_cast<std::uint32_t>(_mm256_movemask_epi8(
+			_mm256_and_si256(_mm256_cmpeq_epi8(f, first), _mm256_cmpeq_epi8(l, last))));
+		while (mask) {
+			const char *p = data + i + static_cast<std::size_t>(__builtin_ctz(mask));
+			if (std::memcmp(p + 1, needle + 1, nlen - 2) == 0)
+				return p;
+			mask &= mask - 1;
+		}
+	}
+	return len - i >= nlen ? find_sub_sse2(data + i, len - i, needle, nlen) : nullptr;
+}
+
+
+__attribute__((target("avx2"))) const char *
+find_folded_avx2(const char *data, const std::size_t len, const FoldedNeedle &needle)
+{
+	const auto *p       = reinterpret_cast<const unsigned char *>(data);
+	const std::size_t n = needle.text.size();
+	const __m256i f0    = _mm256_set1_epi8(static_cast<char>(needle.f[0]));
+	const __m256i f1    = _mm256_set1_epi8(static_cast<char>(needle.f[1]));
+	const __m256i l0    = _mm256_set1_epi8(static_cast<char>(needle.l[0]));
+	const __m256i l1    = _mm256_set1_epi8(static_cast<char>(needle.l[1]));
+	std::size_t i       = 0;
+	for (; i + n - 1 + 32 <= len; i += 32) {
+		const __m256i f = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + needle.fpos));
+		const __m256i l = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i + needle.lpos));
+		const __m256i mf = _mm256_or_si256(_mm256_cmpeq_epi8(f, f0), _mm256_cmpeq_epi8(f, f1));
+		const __m256i ml = _mm256_or_si256(_mm256_cmpeq_epi8(l, l0), _mm256_cmpeq_epi8(l, l1));
+		auto mask        = static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_and_si256(mf, ml)));
+		while (mask) {
+			const std::size_t at = i + static_cast<std::size_t>(__builtin_ctz(mask));
+			if (folded_equal(p + at, len - at, needle.text))
+				return data + at;
+			mask &= mask - 1;
+		}
+	}
+	return len - i >= n ? find_folded_sse2(data + i, len - i, needle) : nullptr;
+}
+
+#endif
+
+
+bool
+cpu_supports(const ScanKernel k)
+{
+	switch (k) {
+	case ScanKernel::Scalar:
+		return true;
+#if defined(KTE_SCAN_X86)
+	case ScanKernel::SSE2:
+		return __builtin_cpu_supports("sse2");
+	case ScanKernel::AVX2:
+		return __builtin_cpu_supports("avx2");
+#else
+	case ScanKernel::SSE2:
+	case ScanKernel::AVX2:
+		return false;
+#endif
+	}
+	return false;
+}
+
+
+Kernels
+kernels_for(const ScanKernel k)
+{
+	switch (k) {
+#if defined(KTE_SCAN_X86)
+	case ScanKernel::AVX2:
+		return {count_avx2, find_all_avx2, find_sub_avx2, find_folded_avx2};
+	case ScanKernel::SSE2:
+		return {count_sse2, find_all_sse2, find_sub_sse2, find_folded_sse2};
+#endif
+	default:
+		return {count_scalar, find_all_scalar, find_sub_scalar, find_folded_scalar};
+	}
+}
+
+
+ScanKernel
+best_kernel()
+{
+#if defined(KTE_SCAN_X86)
+	__builtin_cpu_init();
+#endif
+	if (cpu_supports(ScanKernel::AVX2))
+		return ScanKernel::AVX2;
+	if (cpu_supports(ScanKernel::SSE2))
+		return ScanKernel::SSE2;
+	return ScanKernel::Scalar;
+}
+
+
+// Resolved on first use rather than at static-init time, so scans issued from
+// other static initializers still see a valid kernel.
+std::atomic<ScanKernel> &
+active_kernel()
+{
+	static std::atomic<ScanKernel> kernel{best_kernel()};
+	return kernel;
+}
+} // namespace
+
+
+std::size_t
+CountNewlines(const char *data, const std::size_t len)
+{
+	return kernels_for(active_kernel().load(std::memory_order_relaxed)).count(data, len);
+}
+
+
+void
+FindNewlines(const char *data, const std::size_t len, const std::size_t base, std::vector<std::size_t> &out)
+{
+	kernels_for(active_kernel().load(std::memory_order_relaxed)).find_all(data, len, base, out);
+}
+
+
+const char *
+FindByte(const char *data, const std::size_t len, const char c)
+{
+	// libc memchr is already vectorized and beats a hand-rolled loop here.
+	return static_cast<const char *>(std::memchr(data, c, len));
+}
+
+
+const char *
+FindSubstring(const char *data, const std::size_t len, const char *needle, const std::size_t nlen)
+{
+	if (nlen == 0)
+		return data;
+	if (nlen > len)
+		return nullptr;
+	if (nlen == 1)
+		return FindByte(data, len, needle[0]);
+	return kernels_for(active_kernel().load(std::memory_order_relaxed)).find_sub(data, len, needle, nlen);
+}
+
+
+std::string
+FoldCase(const std::string_view s)
+{
+	const FoldTables &t = fold_tables();
+	const auto *p       = reinterpret_cast<const unsigned char *>(s.data());
+	std::string out;
+	out.reserve(s.size());
+	for (std::size_t i = 0; i < s.size();) {
+		unsigned char c[2];
+		const std::size_t k = fold_char(t, p + i, s.size() - i, c);
+		out.append(reinterpret_cast<const char *>(c), k);
+		i += k;
+	}
+	return out;
+}
+
+
+FoldedNeedle
+FoldNeedle(const std::string_view needle)
+{
+	FoldedNeedle out;
+	out.text            = FoldCase(needle);
+	const auto *p       = reinterpret_cast<const unsigned char *>(out.text.data());
+	const std::size_t n = out.text.size();
+	// Filter on the first and last ASCII bytes, whose other case is known
+	std::size_t first = n;
+	std::size_t last  = n;
+	for (std::size_t i = 0; i < n; ++i) {
+		if (p[i] < 0x80) {
+			if (first == n)
+				first = i;
+			last = i;
+		}
+	}
+	auto cases = [](const unsigned char b, unsigned char alt[2]) {
+		alt[0] = b;
+		alt[1] = b >= 'a' && b <= 'z' ? static_cast<unsigned char>(b - ('a' - 'A')) : b;
+	};
+	if (first < n) {
+		out.fpos = first;
+		out.lpos = last;
+		cases(p[first], out.f);
+		cases(p[last], out.l);
+		return out;
+	}
+	// No ASCII: filter on the lead bytes of the first character's cases
+	out.filter = false;
+	if (n < 2 || p[0] < 0xC2 || p[0] > 0xDF)
+		return out;
+	const FoldTables &t    = fold_tables();
+	const std::uint32_t cp = (p[0] & 0x1Fu) << 6 | (p[1] & 0x3Fu);
+	int leads              = 0;
+	for (std::uint32_t c = 0x80; c < 0x800; ++c) {
+		if (t.two[c] != cp)
+			continue;
+		const auto lead = static_cast<unsigned char>(0xC0 | c >> 6);
+		if (leads > 0 && (out.f[0] == lead || out.f[1] == lead))
+			continue;
+		if (leads == 2)
+			return out; // more than two: nothing to filter on
+		out.f[leads++] = lead;
+	}
+	if (leads == 1)
+		out.f[1] = out.f[0];
+	out.l[0]   = out.f[0];
+	out.l[1]   = out.f[1];
+	out.filter = leads > 0;
+	return out;
+}
+
+
+const char *
+FindSubstringFolded(const char *data, const std::size_t len, const FoldedNeedle &needle)
+{
+	if (needle.text.empty())
+		return data;
+	if (needle.text.size() > len)
+		return nullptr;
+	if (!needle.filter)
+		return find_folded_scalar(data, len, needle);
+	return kernels_for(active_kernel().load(std::memory_order_relaxed)).find_folded(data, len, needle);
+}
+
+
+ScanKernel
+ActiveScanKernel()
+{
+	return active_kernel().load(std::memory_order_relaxed);
+}
+
+
+const char *
+ScanKernelName(const ScanKernel k)
+{
+	switch (k) {
+	case ScanKernel::Scalar:
+		return "scalar";
+	case ScanKernel::SSE2:
+		return "sse2";
+	case ScanKernel::AVX2:
+		return "avx2";
+	}
+	return "unknown";
+}
+
+
+bool
+ScanKernelSupported(const ScanKernel k)
+{
+	return cpu_supports(k);
+}
+
+
+bool
+SetScanKernel(const ScanKernel k)
+{
+	if (!cpu_supports(k))
+		return false;
+	active_kernel().store(k, std::memory_order_relaxed);
+	return true;
+}
+} // namespace kte
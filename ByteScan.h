@@ -0,0 +1,73 @@
+// ByteScan.h - vectorized byte/newline scanning kernels with runtime dispatch
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace kte {
+// Kernel implementations, in increasing order of width. The best kernel the
+// CPU supports is selected on first use; x86 builds probe for AVX2 at runtime
+// and fall back to SSE2 (always present on x86-64) or plain scalar code.
+enum class ScanKernel {
+	Scalar,
+	SSE2,
+	AVX2,
+};
+
+// Number of '\n' bytes in [data, data + len).
+std::size_t CountNewlines(const char *data, std::size_t len);
+
+// Append base + i to out for every '\n' at data[i], in ascending order.
+void FindNewlines(const char *data, std::size_t len, std::size_t base, std::vector<std::size_t> &out);
+
+// First occurrence of c in [data, data + len), or nullptr. Thin wrapper over
+// memchr so scanning code has a single entry point.
+const char *FindByte(const char *data, std::size_t len, char c);
+
+// First occurrence of needle[0, nlen) in [data, data + len), or nullptr. An
+// empty needle matches at data. The vector kernels test the needle's first
+// and last bytes at 16/32 candidate positions per step and compare the
+// middle only where both agree, which rejects almost every position of
+// ordinary text without a byte-by-byte loop.
+const char *FindSubstring(const char *data, std::size_t len, const char *needle, std::size_t nlen);
+
+// s with its letters lower-cased by Unicode simple case folding, limited to
+// ASCII and the Latin-1, Latin Extended-A, Greek and Cyrillic blocks, and to
+// folds that keep a character's UTF-8 length. Other bytes, including
+// invalid UTF-8, are left as they are.
+std::string FoldCase(std::string_view s);
+
+// A needle prepared for FindSubstringFolded
+struct FoldedNeedle {
+	std::string text; // FoldCase of the needle
+	// Needle positions the vector kernels test, and the bytes (one per case)
+	// a match may have there; filter is false when no position qualifies
+	std::size_t fpos = 0;
+	std::size_t lpos = 0;
+	unsigned char f[2]{};
+	unsigned char l[2]{};
+	bool filter = true;
+};
+
+FoldedNeedle FoldNeedle(std::string_view needle);
+
+// First position in [data, data + len) where the text folds to needle.text,
+// or nullptr; the match is needle.text.size() bytes long. The vector kernels
+// work as for FindSubstring, testing two needle bytes for either case with
+// a pair of byte compares each, and fold through lookup tables only where
+// both agree.
+const char *FindSubstringFolded(const char *data, std::size_t len, const FoldedNeedle &needle);
+
+// Kernel currently used by the functions above.
+ScanKernel ActiveScanKernel();
+
+const char *ScanKernelName(ScanKernel k);
+
+bool ScanKernelSupported(ScanKernel k);
+
+// Force a specific kernel (tests and benchmarks). Returns false and leaves the
+// active kernel unchanged if the CPU does not support it.
+bool SetScanKernel(ScanKernel k);
+} // namespace kte
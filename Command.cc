@@ -1,7 +1,6 @@
 #include <algorithm>
 #include <filesystem>
 #include <cstdlib>
-#include <regex>
 #include <fstream>
 #include <sstream>
 #include <cmath>
@@ -15,6 +14,9 @@
 #include "Buffer.h"
 #include "UndoSystem.h"
 #include "HelpText.h"
+#include "ByteScan.h"
+#include "OptimizedSearch.h"
+#include "Regex.h"
 #include "syntax/LanguageHighlighter.h"
 #include "syntax/HighlighterEngine.h"
 #include "syntax/CppHighlighter.h"
@@ -83,12 +85,8 @@ ensure_cursor_visible(const Editor &ed, Buffer &buf)
 		rowoffs = cury - content_rows + 1;
 	}
 
-	// Clamp vertical offset to available content. Use the materialized rows cache
-	// because some legacy editing commands still modify Buffer::Rows() directly.
-	// TerminalRenderer also renders from Buffer::Rows(), so keeping viewport math
-	// consistent with that avoids desync where the cursor goes off-screen when
-	// inserting newlines at EOF.
-	const auto total_rows = buf.Rows().size();
+	// Clamp vertical offset to available content
+	const auto total_rows = buf.Nrows();
 	if (content_rows < total_rows) {
 		std::size_t max_rowoffs = total_rows - content_rows;
 		if (rowoffs > max_rowoffs)
@@ -219,14 +217,14 @@ compute_mark_region(Buffer &buf, std::size_t &sx, std::size_t &sy, std::size_t &
 static std::string
 extract_region_text(const Buffer &buf, std::size_t sx, std::size_t sy, std::size_t ex, std::size_t ey)
 {
-	const auto &rows = buf.Rows();
-	if (sy >= rows.size())
+	const std::size_t nrows = buf.Nrows();
+	if (sy >= nrows)
 		return std::string();
-	if (ey >= rows.size())
-		ey = rows.size() - 1;
+	if (ey >= nrows)
+		ey = nrows - 1;
 	if (sy == ey) {
-		const auto &line = rows[sy];
-		std::size_t xs   = std::min(sx, line.size());
+		const std::string line = buf.GetLineString(sy);
+		std::size_t xs         = std::min(sx, line.size());
 		std::size_t xe   = std::min(ex, line.size());
 		if (xe < xs)
 			std::swap(xs, xe);
@@ -235,20 +233,20 @@ extract_region_text(const Buffer &buf, std::size_t sx, std::size_t sy, std::size
 	std::string out;
 	// first line tail
 	{
-		const auto &line = rows[sy];
-		std::size_t xs   = std::min(sx, line.size());
+		const std::string line = buf.GetLineString(sy);
+		std::size_t xs         = std::min(sx, line.size());
 		out += line.substr(xs);
 		out += '\n';
 	}
 	// middle lines full
 	for (std::size_t y = sy + 1; y < ey; ++y) {
-		out += static_cast<std::string>(rows[y]);
+		out += buf.GetLineString(y);
 		out += '\n';
 	}
 	// last line head
 	{
-		const auto &line = rows[ey];
-		std::size_t xe   = std::min(ex, line.size());
+		const std::string line = buf.GetLineString(ey);
+		std::size_t xe         = std::min(ex, line.size());
 		out += line.substr(0, xe);
 	}
 	return out;
@@ -268,10 +266,9 @@ delete_region(Buffer &buf, std::size_t sx, std::size_t sy, std::size_t ex, std::
 		ey = nrows - 1;
 	if (sy == ey) {
 		// Single line: delete text from xs to xe
-		const auto &rows = buf.Rows();
-		const auto &line = rows[sy];
-		std::size_t xs   = std::min(sx, line.size());
-		std::size_t xe   = std::min(ex, line.size());
+		const std::size_t len = buf.LineLength(sy);
+		std::size_t xs        = std::min(sx, len);
+		std::size_t xe        = std::min(ex, len);
 		if (xe < xs)
 			std::swap(xs, xe);
 		buf.delete_text(static_cast<int>(sy), static_cast<int>(xs), xe - xs);
@@ -284,14 +281,13 @@ delete_region(Buffer &buf, std::size_t sx, std::size_t sy, std::size_t ex, std::
 		// 4. Insert saved suffix at end of first line
 		// 5. Join if needed (no, suffix is appended directly)
 
-		const auto &rows           = buf.Rows();
-		std::size_t first_line_len = rows[sy].size();
-		std::size_t last_line_len  = rows[ey].size();
+		std::size_t first_line_len = buf.LineLength(sy);
+		std::size_t last_line_len  = buf.LineLength(ey);
 		std::size_t xs             = std::min(sx, first_line_len);
 		std::size_t xe             = std::min(ex, last_line_len);
 
 		// Save suffix of last line before any modifications
-		std::string suffix = rows[ey].substr(xe);
+		std::string suffix = buf.GetLineString(ey).substr(xe);
 
 		// Delete tail of first line (from xs to end)
 		if (xs < first_line_len) {
@@ -306,8 +302,7 @@ delete_region(Buffer &buf, std::size_t sx, std::size_t sy, std::size_t ex, std::
 		// Append saved suffix to first line
 		if (!suffix.empty()) {
 			// Get current length of line sy after deletions
-			const auto &rows_after = buf.Rows();
-			std::size_t line_len   = rows_after[sy].size();
+			std::size_t line_len = buf.LineLength(sy);
 			buf.insert_text(static_cast<int>(sy), static_cast<int>(line_len), suffix);
 		}
 	}
@@ -346,20 +341,14 @@ insert_text_at_cursor(Buffer &buf, const std::string &text)
 			if (cur_y >= nrows) {
 				buf.insert_row(static_cast<int>(nrows), "");
 			}
-			const auto &rows = buf.Rows();
-			if (cur_x > rows[cur_y].size())
-				cur_x = rows[cur_y].size();
+			cur_x = std::min(cur_x, buf.LineLength(cur_y));
 			buf.insert_text(static_cast<int>(cur_y), static_cast<int>(cur_x), remain);
 			cur_x += remain.size();
 			break;
 		}
 		// insert segment before newline
 		std::string seg = remain.substr(0, pos);
-		{
-			const auto &rows = buf.Rows();
-			if (cur_x > rows[cur_y].size())
-				cur_x = rows[cur_y].size();
-		}
+		cur_x = std::min(cur_x, buf.LineLength(cur_y));
 		buf.insert_text(static_cast<int>(cur_y), static_cast<int>(cur_x), seg);
 		// split line at cur_x + seg.size()
 		cur_x += seg.size();
@@ -447,10 +436,9 @@ cmd_move_cursor_to(CommandContext &ctx)
 					std::size_t by  = bro + vy;
 					// Clamp by to existing lines later
 					ensure_at_least_one_line(*buf);
-					const auto &lines2 = buf->Rows();
-					if (by >= lines2.size())
-						by = lines2.size() - 1;
-					std::string line2     = static_cast<std::string>(lines2[by]);
+					if (by >= buf->Nrows())
+						by = buf->Nrows() - 1;
+					std::string line2     = buf->GetLineString(by);
 					std::size_t rx_target = bco + vx;
 					std::size_t sx        = inverse_render_to_source_col(line2, rx_target, 8);
 					row                   = by;
@@ -465,12 +453,9 @@ cmd_move_cursor_to(CommandContext &ctx)
 		}
 	}
 	ensure_at_least_one_line(*buf);
-	const auto &lines = buf->Rows();
-	if (row >= lines.size())
-		row = lines.size() - 1;
-	std::string line = static_cast<std::string>(lines[row]);
-	if (col > line.size())
-		col = line.size();
+	if (row >= buf->Nrows())
+		row = buf->Nrows() - 1;
+	col = std::min(col, buf->LineLength(row));
 	buf->SetCursor(col, row);
 	ensure_cursor_visible(ctx.editor, *buf);
 	return true;
@@ -478,66 +463,102 @@ cmd_move_cursor_to(CommandContext &ctx)
 
 
 // --- Search helpers (UI-agnostic) ---
-static std::vector<std::pair<std::size_t, std::size_t> >
-search_compute_matches(const Buffer &buf, const std::string &q)
+// Matches come from the buffer's MatchIndex, which narrows refined queries
+// and rescans only edited rows instead of searching the whole buffer again.
+// In a large buffer a new query is first scanned from the search origin
+// only; the total is counted in the background and PollSearch() picks it up.
+static const std::vector<SearchMatch> &
+search_update(Editor &ed, Buffer &buf, const bool regex, std::string &err)
 {
-	std::vector<std::pair<std::size_t, std::size_t> > out;
-	if (q.empty())
-		return out;
-	const auto &rows = buf.Rows();
-	for (std::size_t y = 0; y < rows.size(); ++y) {
-		std::string line = static_cast<std::string>(rows[y]);
-		std::size_t pos  = 0;
-		while (!q.empty() && (pos = line.find(q, pos)) != std::string::npos) {
-			out.emplace_back(y, pos);
-			pos += q.size();
-		}
-	}
-	return out;
+	std::size_t y = buf.Cury();
+	std::size_t x = buf.Curx();
+	if (ed.SearchOriginSet()) {
+		y = ed.SearchOrigY();
+		x = ed.SearchOrigX();
+	}
+	buf.SearchMatches().SetOptions(regex ? SearchOptions{} : ed.FindOptions());
+	buf.SearchMatches().Update(buf, ed.SearchQuery(), regex, y, x, err);
+	return buf.SearchMatches().Matches();
 }
 
 
-// Regex-based matches (per-line), capturing match length for highlighting
-struct RegexMatch {
-	std::size_t y;
-	std::size_t x;
-	std::size_t len;
-};
+// Status label for a search, naming the find options in effect
+static std::string
+search_label(const Editor &ed, const bool regex)
+{
+	const SearchOptions &opts = ed.FindOptions();
+	if (regex)
+		return "Regex: ";
+	if (!opts.ignore_case && !opts.whole_word)
+		return "Find: ";
+	return std::string("Find [") + (opts.ignore_case ? "i" : "") + (opts.whole_word ? "w" : "") + "]: ";
+}
 
 
-static std::vector<RegexMatch>
-search_compute_matches_regex(const Buffer &buf, const std::string &pattern, std::string &err_out)
+static const std::vector<SearchMatch> &
+search_compute_matches(Editor &ed, Buffer &buf)
 {
-	std::vector<RegexMatch> out;
-	err_out.clear();
-	if (pattern.empty())
-		return out;
-	try {
-		const std::regex rx(pattern);
-		const auto &rows = buf.Rows();
-		for (std::size_t y = 0; y < rows.size(); ++y) {
-			std::string line = static_cast<std::string>(rows[y]);
-			for (auto it = std::sregex_iterator(line.begin(), line.end(), rx);
-			     it != std::sregex_iterator(); ++it) {
-				const auto &m = *it;
-				out.push_back(RegexMatch{
-					y, static_cast<std::size_t>(m.position()), static_cast<std::size_t>(m.length())
-				});
-			}
-		}
-	} catch (const std::regex_error &e) {
-		err_out = e.what();
-		// Return empty results on error
-	}
-	return out;
+	std::string err;
+	return search_update(ed, buf, false, err);
 }
 
 
+static const std::vector<SearchMatch> &
+search_compute_matches_regex(Editor &ed, Buffer &buf, std::string &err_out)
+{
+	return search_update(ed, buf, true, err_out);
+}
+
+
+static bool
+search_match_before(const SearchMatch &m, const std::pair<std::size_t, std::size_t> &pos)
+{
+	return m.y < pos.first || (m.y == pos.first && m.x < pos.second);
+}
+
+
+// Index of the first match at or after the search origin (else the cursor).
+// Wraps to the first match once every match is known; -1 if there is none.
+static int
+search_first_index(const Editor &ed, const Buffer &buf, const std::vector<SearchMatch> &matches)
+{
+	std::pair<std::size_t, std::size_t> origin{buf.Cury(), buf.Curx()};
+	if (ed.SearchOriginSet())
+		origin = {ed.SearchOrigY(), ed.SearchOrigX()};
+	const auto it = std::lower_bound(matches.begin(), matches.end(), origin, search_match_before);
+	if (it != matches.end())
+		return static_cast<int>(it - matches.begin());
+	return matches.empty() || !buf.SearchMatches().Complete() ? -1 : 0;
+}
+
+
+// Index of the match shown now, for renumbering after matches were
+// recounted; the first match after the origin if none is shown
+static int
+search_current_index(const Editor &ed, const Buffer &buf, const std::vector<SearchMatch> &matches)
+{
+	if (ed.SearchIndex() < 0)
+		return search_first_index(ed, buf, matches);
+	const std::pair<std::size_t, std::size_t> cur{ed.SearchMatchY(), ed.SearchMatchX()};
+	const auto it = std::lower_bound(matches.begin(), matches.end(), cur, search_match_before);
+	if (it != matches.end() && it->y == cur.first && it->x == cur.second)
+		return static_cast<int>(it - matches.begin());
+	return search_first_index(ed, buf, matches);
+}
+
+
+// Move to match SearchIndex() and report "n/total" after label. While the
+// background count runs, the total shows as "..." and n counts from the
+// origin.
 static void
-search_apply_match_regex(Editor &ed, Buffer &buf, const std::vector<RegexMatch> &matches)
+search_show_match(Editor &ed, Buffer &buf, const std::vector<SearchMatch> &matches, const std::string &label)
 {
 	const std::string &q = ed.SearchQuery();
-	if (matches.empty()) {
+	const bool complete  = buf.SearchMatches().Complete();
+	int idx              = ed.SearchIndex();
+	if (complete && (idx < 0 || idx >= static_cast<int>(matches.size())))
+		idx = 0;
+	if (idx < 0 || idx >= static_cast<int>(matches.size())) {
 		ed.SetSearchMatch(0, 0, 0);
 		// Restore cursor to origin if present
 		if (ed.SearchOriginSet()) {
@@ -545,49 +566,273 @@ search_apply_match_regex(Editor &ed, Buffer &buf, const std::vector<RegexMatch>
 			buf.SetOffsets(ed.SearchOrigRowoffs(), ed.SearchOrigColoffs());
 		}
 		ed.SetSearchIndex(-1);
-		ed.SetStatus("Regex: " + q);
+		ed.SetStatus(label + q + (complete ? "" : "  ..."));
 		return;
 	}
-	int idx = ed.SearchIndex();
-	if (idx < 0 || idx >= static_cast<int>(matches.size()))
-		idx = 0;
 	const auto &m = matches[static_cast<std::size_t>(idx)];
 	ed.SetSearchMatch(m.y, m.x, m.len);
 	buf.SetCursor(m.x, m.y);
 	ensure_cursor_visible(ed, buf);
 	char tmp[64];
-	snprintf(tmp, sizeof(tmp), "%d/%zu", idx + 1, matches.size());
-	ed.SetStatus(std::string("Regex: ") + q + "  " + tmp);
+	if (complete)
+		snprintf(tmp, sizeof(tmp), "%d/%zu", idx + 1, matches.size());
+	else
+		snprintf(tmp, sizeof(tmp), "%d/...", idx + 1);
+	ed.SetStatus(label + q + "  " + tmp);
 	ed.SetSearchIndex(idx);
 }
 
 
 static void
-search_apply_match(Editor &ed, Buffer &buf, const std::vector<std::pair<std::size_t, std::size_t> > &matches)
+search_apply_match_regex(Editor &ed, Buffer &buf, const std::vector<SearchMatch> &matches)
 {
-	const std::string &q = ed.SearchQuery();
-	if (matches.empty()) {
-		ed.SetSearchMatch(0, 0, 0);
-		// Restore cursor to origin if present
-		if (ed.SearchOriginSet()) {
-			buf.SetCursor(ed.SearchOrigX(), ed.SearchOrigY());
-			buf.SetOffsets(ed.SearchOrigRowoffs(), ed.SearchOrigColoffs());
-		}
-		ed.SetSearchIndex(-1);
-		ed.SetStatus("Find: " + q);
+	search_show_match(ed, buf, matches, search_label(ed, true));
+}
+
+
+static void
+search_apply_match(Editor &ed, Buffer &buf, const std::vector<SearchMatch> &matches)
+{
+	search_show_match(ed, buf, matches, search_label(ed, false));
+}
+
+
+// Step delta matches from the current one, wrapping around. Stepping past
+// the matches found so far waits for the background count.
+static void
+search_step(Editor &ed, Buffer &buf, const int delta)
+{
+	MatchIndex &index = buf.SearchMatches();
+	int idx           = ed.SearchIndex();
+	if (!index.Complete() && (idx < 0 || idx + delta < 0 ||
+	                          idx + delta >= static_cast<int>(index.Matches().size()))) {
+		index.Wait();
+		index.Poll();
+		idx = search_current_index(ed, buf, index.Matches());
+	}
+	const auto &matches = index.Matches();
+	if (!matches.empty()) {
+		if (idx < 0)
+			idx = 0;
+		const int n = static_cast<int>(matches.size());
+		idx         = ((idx + delta) % n + n) % n;
+		ed.SetSearchIndex(idx);
+	}
+	search_show_match(ed, buf, matches, search_label(ed, index.IsRegex()));
+}
+
+
+// --- Project-wide search (C-k /) ---
+// Results go to the read-only +GREP+ buffer: a header line, then one line per
+// hit in Grep::Hits() order, so row r (r > 0) is hit r - 1.
+
+static const char *const kGrepBufferName = "+GREP+";
+
+
+static bool
+is_grep_results(const Buffer &buf)
+{
+	return buf.Filename() == kGrepBufferName && !buf.IsFileBacked();
+}
+
+
+static std::size_t
+grep_buffer_index(Editor &ed)
+{
+	const std::vector<Buffer> &bufs = ed.Buffers();
+	for (std::size_t i = 0; i < bufs.size(); ++i) {
+		if (is_grep_results(bufs[i]))
+			return i;
+	}
+	return static_cast<std::size_t>(-1);
+}
+
+
+static void
+grep_report(Editor &ed)
+{
+	const kte::Grep &grep = ed.GrepSearch();
+	std::string msg       = "Grep: " + std::to_string(grep.Hits().size()) + " hit(s) in " +
+	                  std::to_string(grep.FilesSearched()) + " file(s)";
+	if (grep.BinarySkipped() > 0)
+		msg += ", " + std::to_string(grep.BinarySkipped()) + " binary skipped";
+	if (grep.ChangedSkipped() > 0)
+		msg += ", " + std::to_string(grep.ChangedSkipped()) + " changed while searched";
+	if (grep.Truncated())
+		msg += " (stopped at " + std::to_string(kte::Grep::kMaxHits) + ")";
+	if (grep.Running())
+		msg += "...";
+	ed.SetStatus(msg);
+}
+
+
+// Search every named buffer and the files under the working directory; open
+// buffers are searched as edited rather than as saved
+static bool
+grep_start(Editor &ed, const std::string &query, const bool regex)
+{
+	if (query.empty()) {
+		ed.SetStatus("Grep canceled (empty query)");
+		return true;
+	}
+	std::vector<kte::Grep::Source> sources;
+	for (const Buffer &b: ed.Buffers()) {
+		if (!b.Filename().empty() && !is_grep_results(b))
+			sources.push_back(kte::Grep::Source{b.Filename(), b.Content().Snapshot()});
+	}
+	std::string root;
+	try {
+		root = std::filesystem::current_path().string();
+	} catch (...) {
+		root = ".";
+	}
+	std::string err;
+	if (!ed.GrepSearch().Start(std::move(sources), root, query, regex, err)) {
+		ed.SetStatus("Regex error: " + err);
+		return false;
+	}
+
+	std::size_t idx = grep_buffer_index(ed);
+	if (idx == static_cast<std::size_t>(-1)) {
+		Buffer results;
+		results.SetVirtualName(kGrepBufferName);
+		idx = ed.AddBuffer(std::move(results));
+	}
+	Buffer &out = ed.Buffers()[idx];
+	if (out.Content().Size() > 0)
+		out.delete_text(0, 0, out.Content().Size());
+	out.insert_text(0, 0, std::string(regex ? "grep-regex: " : "grep: ") + query + " in " + root + "\n");
+	out.SetReadOnly(true);
+	out.SetDirty(false);
+	out.SetCursor(0, 0);
+	out.SetOffsets(0, 0);
+	ed.SwitchTo(idx);
+	grep_report(ed);
+	return true;
+}
+
+
+// Append the hits found since the last poll to +GREP+
+static void
+grep_poll(Editor &ed)
+{
+	kte::Grep &grep = ed.GrepSearch();
+	std::string lines;
+	if (!grep.Poll(lines))
+		return;
+	const std::size_t idx = grep_buffer_index(ed);
+	if (idx == static_cast<std::size_t>(-1)) {
+		grep.Cancel(); // results buffer was closed
 		return;
 	}
-	int idx = ed.SearchIndex();
-	if (idx < 0 || idx >= static_cast<int>(matches.size()))
-		idx = 0;
-	auto [y, x] = matches[static_cast<std::size_t>(idx)];
-	ed.SetSearchMatch(y, x, q.size());
-	buf.SetCursor(x, y);
-	ensure_cursor_visible(ed, buf);
-	char tmp[64];
-	snprintf(tmp, sizeof(tmp), "%d/%zu", idx + 1, matches.size());
-	ed.SetStatus(std::string("Find: ") + q + "  " + tmp);
-	ed.SetSearchIndex(idx);
+	Buffer &out = ed.Buffers()[idx];
+	if (!lines.empty()) {
+		const std::size_t last = out.Nrows() - 1;
+		out.insert_text(static_cast<int>(last), static_cast<int>(out.LineLength(last)), lines);
+		out.SetDirty(false);
+	}
+	grep_report(ed);
+}
+
+
+void
+PollSearch(Editor &ed)
+{
+	grep_poll(ed);
+	Buffer *buf = ed.CurrentBuffer();
+	if (!buf || !buf->SearchMatches().Poll() || !ed.SearchActive())
+		return;
+	const auto &matches = buf->SearchMatches().Matches();
+	ed.SetSearchIndex(search_current_index(ed, *buf, matches));
+	search_show_match(ed, *buf, matches, search_label(ed, buf->SearchMatches().IsRegex()));
+}
+
+
+// --- Replace-all helpers ---
+// Both collect every replacement first and apply them as one bulk edit
+// (Buffer::replace_all), so the document is rewritten in a single pass.
+
+// Replace every non-overlapping occurrence of find, matched under opts,
+// with with; returns the number replaced
+static std::size_t
+replace_all_literal(Buffer &buf, const std::string &find, const std::string &with, const SearchOptions &opts)
+{
+	OptimizedSearch os;
+	os.SetOptions(opts);
+	const std::vector<std::size_t> hits = os.find_all(buf.Content(), find);
+	std::vector<PieceTable::Splice> splices;
+	splices.reserve(hits.size());
+	for (const std::size_t at: hits)
+		splices.push_back(PieceTable::Splice{at, find.size(), with});
+	buf.replace_all(splices);
+	return hits.size();
+}
+
+
+// Replace the matches of rx with fmt line by line, streaming the document
+// chunk by chunk; returns the number of matches and sets lines to the
+// number of lines that changed
+static std::size_t
+replace_all_regex(Buffer &buf, kte::Regex &rx, const std::string &fmt, std::size_t &lines)
+{
+	struct Changed {
+		std::size_t offset; // line start
+		std::size_t len; // old line length
+		std::size_t end; // end of the new line in out
+	};
+	std::vector<Changed> changed;
+	std::string out; // new text of the changed lines
+	std::string after;
+	std::size_t count = 0;
+	auto do_line      = [&](const std::string_view line, const std::size_t offset) {
+		const std::size_t n = rx.Replace(line, fmt, after);
+		count += n;
+		if (n > 0 && after != line) {
+			out += after;
+			changed.push_back(Changed{offset, line.size(), out.size()});
+		}
+	};
+
+	const PieceTable &text = buf.Content();
+	std::string carry; // start of a line that continues into the next chunk
+	std::size_t chunk_off = 0;
+	std::size_t line_off  = 0;
+	text.ForEachChunk(0, text.Size(), [&](const std::string_view chunk) {
+		std::size_t pos = 0;
+		for (;;) {
+			const char *nl = pos < chunk.size()
+				                 ? kte::FindByte(chunk.data() + pos, chunk.size() - pos, '\n')
+				                 : nullptr;
+			if (!nl) {
+				carry.append(chunk.substr(pos));
+				break;
+			}
+			const auto end = static_cast<std::size_t>(nl - chunk.data());
+			if (carry.empty()) {
+				do_line(chunk.substr(pos, end - pos), line_off);
+			} else {
+				carry.append(chunk.substr(pos, end - pos));
+				do_line(carry, line_off);
+				carry.clear();
+			}
+			pos      = end + 1;
+			line_off = chunk_off + pos;
+		}
+		chunk_off += chunk.size();
+		return true;
+	});
+	do_line(carry, line_off); // the last line has no newline
+
+	std::vector<PieceTable::Splice> splices;
+	splices.reserve(changed.size());
+	std::size_t begin = 0;
+	for (const Changed &c: changed) {
+		splices.push_back(PieceTable::Splice{c.offset, c.len, std::string_view(out).substr(begin, c.end - begin)});
+		begin = c.end;
+	}
+	buf.replace_all(splices);
+	lines = changed.size();
+	return count;
 }
 
 
@@ -627,14 +872,13 @@ cmd_save(CommandContext &ctx)
 		ctx.editor.SetStatus("Save as: ");
 		return true;
 	}
-	if (!buf->Save(err)) {
+	// Write on a worker so a slow disk does not stall input and redraws;
+	// Editor::PollSaves reports completion and clears the dirty flag.
+	if (!buf->StartSave(err)) {
 		ctx.editor.SetStatus(err);
 		return false;
 	}
-	buf->SetDirty(false);
-	ctx.editor.SetStatus("Saved " + buf->Filename());
-	if (auto *u = buf->Undo())
-		u->mark_saved();
+	ctx.editor.SetStatus("Saving " + buf->Filename() + "...");
 	return true;
 }
 
@@ -654,6 +898,70 @@ cmd_show_working_directory(CommandContext &ctx)
 }
 
 
+static bool
+cmd_grep_start(CommandContext &ctx)
+{
+	ctx.editor.StartPrompt(Editor::PromptKind::Grep, "Grep", "");
+	ctx.editor.SetStatus("Grep: ");
+	return true;
+}
+
+
+static bool
+cmd_grep(CommandContext &ctx)
+{
+	return grep_start(ctx.editor, ctx.arg, false);
+}
+
+
+static bool
+cmd_grep_regex(CommandContext &ctx)
+{
+	return grep_start(ctx.editor, ctx.arg, true);
+}
+
+
+// Open the hit on the current +GREP+ line
+static bool
+cmd_grep_goto(CommandContext &ctx)
+{
+	Buffer *buf = ctx.editor.CurrentBuffer();
+	if (!buf || !is_grep_results(*buf))
+		return false;
+	const std::vector<kte::Grep::Hit> &hits = ctx.editor.GrepSearch().Hits();
+	const std::size_t row                   = buf->Cury();
+	if (row == 0 || row > hits.size()) {
+		ctx.editor.SetStatus("No grep hit on this line");
+		return true;
+	}
+	const kte::Grep::Hit hit = hits[row - 1];
+
+	std::size_t target              = static_cast<std::size_t>(-1);
+	const std::vector<Buffer> &bufs = ctx.editor.Buffers();
+	for (std::size_t i = 0; i < bufs.size(); ++i) {
+		if (bufs[i].Filename() == hit.path && !is_grep_results(bufs[i])) {
+			target = i;
+			break;
+		}
+	}
+	if (target != static_cast<std::size_t>(-1)) {
+		ctx.editor.SwitchTo(target);
+	} else {
+		std::string err;
+		if (!ctx.editor.OpenFile(hit.path, err)) {
+			ctx.editor.SetStatus(err);
+			return false;
+		}
+	}
+	Buffer *dst         = ctx.editor.CurrentBuffer();
+	const std::size_t y = std::min(hit.line, dst->Nrows() > 0 ? dst->Nrows() - 1 : 0);
+	dst->SetCursor(std::min(hit.col, dst->LineLength(y)), y);
+	ensure_cursor_visible(ctx.editor, *dst);
+	ctx.editor.SetStatus(hit.path + ":" + std::to_string(hit.line + 1));
+	return true;
+}
+
+
 static bool
 cmd_change_working_directory_start(CommandContext &ctx)
 {
@@ -722,6 +1030,11 @@ cmd_save_and_quit(CommandContext &ctx)
 {
 	// Try save current buffer (if any), then mark quit requested.
 	Buffer *buf = ctx.editor.CurrentBuffer();
+	if (buf) {
+		// Let a background save finish first; it may already have written everything
+		buf->WaitSave();
+		ctx.editor.PollSaves();
+	}
 	if (buf && buf->Dirty()) {
 		std::string err;
 		if (buf->IsFileBacked()) {
@@ -770,6 +1083,8 @@ cmd_refresh(CommandContext &ctx)
 				buf->SetCursor(ctx.editor.SearchOrigX(), ctx.editor.SearchOrigY());
 				buf->SetOffsets(ctx.editor.SearchOrigRowoffs(), ctx.editor.SearchOrigColoffs());
 			}
+			if (buf)
+				buf->SearchMatches().Clear();
 			ctx.editor.SetSearchActive(false);
 			ctx.editor.SetSearchQuery("");
 			ctx.editor.SetSearchMatch(0, 0, 0);
@@ -791,6 +1106,8 @@ cmd_refresh(CommandContext &ctx)
 			buf->SetCursor(ctx.editor.SearchOrigX(), ctx.editor.SearchOrigY());
 			buf->SetOffsets(ctx.editor.SearchOrigRowoffs(), ctx.editor.SearchOrigColoffs());
 		}
+		if (buf)
+			buf->SearchMatches().Clear();
 		ctx.editor.SetSearchActive(false);
 		ctx.editor.SetSearchQuery("");
 		ctx.editor.SetSearchMatch(0, 0, 0);
@@ -950,6 +1267,23 @@ cmd_syntax(CommandContext &ctx)
 }
 
 
+// Mode and memory use of a buffer's trigram index
+static std::string
+trigram_status(const TrigramIndex &index)
+{
+	static const char *const modes[] = {"auto", "on", "off"};
+	std::string msg = std::string("trigram-index: ") + modes[static_cast<int>(index.GetMode())];
+	if (index.Building())
+		msg += ", building";
+	else if (index.Ready())
+		msg += ", " + std::to_string(index.Blocks()) + " blocks";
+	else
+		msg += ", not built";
+	msg += ", " + std::to_string(index.Bytes() >> 10) + " KiB of " + std::to_string(index.Limit() >> 20) + " MiB";
+	return msg;
+}
+
+
 static bool
 cmd_set_option(CommandContext &ctx)
 {
@@ -988,6 +1322,45 @@ cmd_set_option(CommandContext &ctx)
 			ctx.editor.SetStatus("filetype: off");
 		return true;
 	}
+	if (key == "ignorecase" || key == "wholeword") {
+		SearchOptions opts = ctx.editor.FindOptions();
+		bool &option       = key == "ignorecase" ? opts.ignore_case : opts.whole_word;
+		if (val == "on") {
+			option = true;
+		} else if (val == "off") {
+			option = false;
+		} else if (!val.empty()) {
+			ctx.editor.SetStatus("usage: :set " + key + "=on|off");
+			return true;
+		}
+		ctx.editor.SetFindOptions(opts);
+		ctx.editor.SetStatus(key + (option ? ": on" : ": off"));
+		return true;
+	}
+	if (key == "trigram-index" || key == "trigram-limit") {
+		TrigramIndex &index = b->Trigrams();
+		if (key == "trigram-limit") {
+			const unsigned long long mib = std::strtoull(val.c_str(), nullptr, 10);
+			if (mib == 0) {
+				ctx.editor.SetStatus("usage: :set trigram-limit=MIB");
+				return true;
+			}
+			index.SetLimit(static_cast<std::size_t>(mib) << 20);
+		} else if (val == "on") {
+			index.SetMode(TrigramIndex::Mode::On);
+		} else if (val == "off") {
+			index.SetMode(TrigramIndex::Mode::Off);
+		} else if (val == "auto") {
+			index.SetMode(TrigramIndex::Mode::Auto);
+		} else if (!val.empty()) {
+			ctx.editor.SetStatus("usage: :set trigram-index=on|off|auto");
+			return true;
+		}
+		index.Refresh(b->Content());
+		index.Poll();
+		ctx.editor.SetStatus(trigram_status(index));
+		return true;
+	}
 	ctx.editor.SetStatus("unknown option: " + key);
 	return true;
 }
@@ -1348,11 +1721,51 @@ cmd_find_start(const CommandContext &ctx)
 	ctx.editor.SetSearchMatch(0, 0, 0);
 	ctx.editor.SetSearchIndex(-1);
 	ctx.editor.StartPrompt(Editor::PromptKind::Search, "Find", "");
-	ctx.editor.SetStatus("Find: ");
+	ctx.editor.SetStatus(search_label(ctx.editor, false));
 	return true;
 }
 
 
+// Flip one find option. In a literal find prompt, search again with it.
+static bool
+toggle_find_option(const CommandContext &ctx, bool SearchOptions::*option, const char *name)
+{
+	SearchOptions opts = ctx.editor.FindOptions();
+	opts.*option       = !(opts.*option);
+	ctx.editor.SetFindOptions(opts);
+	Buffer *buf = ctx.editor.CurrentBuffer();
+	const bool finding = ctx.editor.PromptActive() &&
+	                     (ctx.editor.CurrentPromptKind() == Editor::PromptKind::Search ||
+	                      ctx.editor.CurrentPromptKind() == Editor::PromptKind::ReplaceFind);
+	if (!finding || !buf) {
+		ctx.editor.SetStatus(std::string(name) + (opts.*option ? ": on" : ": off"));
+		return true;
+	}
+	if (ctx.editor.SearchQuery().empty()) {
+		ctx.editor.SetStatus(search_label(ctx.editor, false));
+		return true;
+	}
+	const auto &matches = search_compute_matches(ctx.editor, *buf);
+	ctx.editor.SetSearchIndex(search_first_index(ctx.editor, *buf, matches));
+	search_apply_match(ctx.editor, *buf, matches);
+	return true;
+}
+
+
+static bool
+cmd_toggle_search_case(CommandContext &ctx)
+{
+	return toggle_find_option(ctx, &SearchOptions::ignore_case, "ignorecase");
+}
+
+
+static bool
+cmd_toggle_search_word(CommandContext &ctx)
+{
+	return toggle_find_option(ctx, &SearchOptions::whole_word, "wholeword");
+}
+
+
 static bool
 cmd_regex_find_start(const CommandContext &ctx)
 {
@@ -1884,20 +2297,18 @@ cmd_insert_text(CommandContext &ctx)
 			if (ctx.editor.CurrentPromptKind() == Editor::PromptKind::RegexSearch ||
 			    ctx.editor.CurrentPromptKind() == Editor::PromptKind::RegexReplaceFind) {
 				std::string err;
-				auto rmatches = search_compute_matches_regex(*buf, ctx.editor.SearchQuery(), err);
+				const auto &rmatches = search_compute_matches_regex(ctx.editor, *buf, err);
 				if (!err.empty()) {
 					ctx.editor.SetStatus(
 						std::string("Regex: ") + ctx.editor.PromptText() + "  [error: " + err +
 						"]");
 				}
-				if (ctx.editor.SearchIndex() >= static_cast<int>(rmatches.size()))
-					ctx.editor.SetSearchIndex(rmatches.empty() ? -1 : 0);
+				ctx.editor.SetSearchIndex(search_first_index(ctx.editor, *buf, rmatches));
 				search_apply_match_regex(ctx.editor, *buf, rmatches);
 			} else {
-				auto matches = search_compute_matches(*buf, ctx.editor.SearchQuery());
-				// Keep index stable unless out of range
-				if (ctx.editor.SearchIndex() >= static_cast<int>(matches.size()))
-					ctx.editor.SetSearchIndex(matches.empty() ? -1 : 0);
+				const auto &matches = search_compute_matches(ctx.editor, *buf);
+				// Show the first match at or after where the search started
+				ctx.editor.SetSearchIndex(search_first_index(ctx.editor, *buf, matches));
 				search_apply_match(ctx.editor, *buf, matches);
 			}
 		} else {
@@ -1912,41 +2323,10 @@ cmd_insert_text(CommandContext &ctx)
 		q += ctx.arg; // arg already printable text
 		ctx.editor.SetSearchQuery(q);
 
-		// Recompute matches and move cursor to current index
-		const auto &rows = buf->Rows();
-		std::vector<std::pair<std::size_t, std::size_t> > matches;
-		if (!q.empty()) {
-			for (std::size_t y = 0; y < rows.size(); ++y) {
-				std::string line = static_cast<std::string>(rows[y]);
-				std::size_t pos  = 0;
-				while (!q.empty() && (pos = line.find(q, pos)) != std::string::npos) {
-					matches.emplace_back(y, pos);
-					pos += q.size();
-				}
-			}
-		}
-		if (matches.empty()) {
-			ctx.editor.SetSearchMatch(0, 0, 0);
-			// Restore to origin if available
-			if (ctx.editor.SearchOriginSet()) {
-				buf->SetCursor(ctx.editor.SearchOrigX(), ctx.editor.SearchOrigY());
-				buf->SetOffsets(ctx.editor.SearchOrigRowoffs(), ctx.editor.SearchOrigColoffs());
-			}
-			ctx.editor.SetSearchIndex(-1);
-			ctx.editor.SetStatus("Find: " + q);
-		} else {
-			int idx = ctx.editor.SearchIndex();
-			if (idx < 0 || idx >= static_cast<int>(matches.size()))
-				idx = 0;
-			auto [y, x] = matches[static_cast<std::size_t>(idx)];
-			ctx.editor.SetSearchMatch(y, x, q.size());
-			buf->SetCursor(x, y);
-			ensure_cursor_visible(ctx.editor, *buf);
-			char tmp[64];
-			snprintf(tmp, sizeof(tmp), "%d/%zu", idx + 1, matches.size());
-			ctx.editor.SetStatus(std::string("Find: ") + q + "  " + tmp);
-			ctx.editor.SetSearchIndex(idx);
-		}
+		// Recompute matches and move to the first one after the origin
+		const auto &matches = search_compute_matches(ctx.editor, *buf);
+		ctx.editor.SetSearchIndex(search_first_index(ctx.editor, *buf, matches));
+		search_apply_match(ctx.editor, *buf, matches);
 		return true;
 	}
 	// Disallow newlines in InsertText; they should come via Newline
@@ -1955,15 +2335,14 @@ cmd_insert_text(CommandContext &ctx)
 		return false;
 	}
 	ensure_at_least_one_line(*buf);
-	auto &rows    = buf->Rows();
 	std::size_t y = buf->Cury();
 	std::size_t x = buf->Curx();
-	if (y >= rows.size()) {
-		rows.resize(y + 1);
-	}
+	while (y >= buf->Nrows())
+		buf->insert_row(static_cast<int>(buf->Nrows()), "");
+	x          = std::min(x, buf->LineLength(y));
 	int repeat = ctx.count > 0 ? ctx.count : 1;
 	for (int i = 0; i < repeat; ++i) {
-		rows[y].insert(x, ctx.arg);
+		buf->insert_text(static_cast<int>(y), static_cast<int>(x), ctx.arg);
 		x += ctx.arg.size();
 	}
 	buf->SetDirty(true);
@@ -2144,13 +2523,16 @@ cmd_show_help(CommandContext &ctx)
 			"  C-k a        Mark all and jump to end\n"
 			"  C-k v        Toggle visual file picker (GUI)\n"
 			"  C-k w        Show working directory\n"
-			"  C-k o        Change working directory (prompt)\n\n"
+			"  C-k o        Change working directory (prompt)\n"
+			"  C-k /        Grep open buffers and files (prompt)\n\n"
 			"ESC/Alt commands:\n"
 			"  ESC q        Reflow paragraph\n"
 			"  ESC BACKSPACE Delete previous word\n"
 			"  ESC d        Delete next word\n"
-			"  Alt-w        Copy region to kill ring\n\n"
-			"Buffers:\n  +HELP+ is read-only. Press C-k ' to toggle if you need to edit; C-k h restores it.\n");
+			"  ESC c        Toggle case-insensitive find\n"
+			"  Alt-w        Copy region to kill ring; in find, whole words\n\n"
+			"Buffers:\n  +HELP+ is read-only. Press C-k ' to toggle if you need to edit; C-k h restores it.\n"
+			"  +GREP+ lists grep hits; Enter on a hit opens it.\n");
 	};
 
 	auto populate_from_text = [](Buffer &b, const std::string &text) {
@@ -2260,9 +2642,10 @@ cmd_newline(CommandContext &ctx)
 			ctx.editor.SetSearchMatch(0, 0, 0);
 			ctx.editor.ClearSearchOrigin();
 			ctx.editor.SetStatus(kind == Editor::PromptKind::RegexSearch ? "Regex find done" : "Find done");
-			Buffer *b = ctx.editor.CurrentBuffer();
-			if (b)
+			if (Buffer *b = ctx.editor.CurrentBuffer()) {
+				b->SearchMatches().Clear();
 				ensure_cursor_visible(ctx.editor, *b);
+			}
 		} else if (kind == Editor::PromptKind::ReplaceFind) {
 			// Proceed to replacement text prompt
 			ctx.editor.SetReplaceFindTmp(value);
@@ -2270,7 +2653,7 @@ cmd_newline(CommandContext &ctx)
 			ctx.editor.SetSearchActive(true);
 			ctx.editor.SetSearchQuery(value);
 			if (Buffer *b = ctx.editor.CurrentBuffer()) {
-				auto matches = search_compute_matches(*b, ctx.editor.SearchQuery());
+				const auto &matches = search_compute_matches(ctx.editor, *b);
 				search_apply_match(ctx.editor, *b, matches);
 			}
 			ctx.editor.StartPrompt(Editor::PromptKind::ReplaceWith, "Replace: with", "");
@@ -2304,52 +2687,13 @@ cmd_newline(CommandContext &ctx)
 				ctx.editor.SetSearchIndex(-1);
 				return true;
 			}
-			// Save original cursor to restore after operations
-			std::size_t orig_x = buf->Curx();
-			std::size_t orig_y = buf->Cury();
-			auto &rows         = buf->Rows();
-			std::size_t total  = 0;
-			UndoSystem *u      = buf->Undo();
-			if (u)
+			if (UndoSystem *u = buf->Undo())
 				u->commit(); // end any pending batch
-			for (std::size_t y = 0; y < rows.size(); ++y) {
-				std::size_t pos = 0;
-				while (!find.empty()) {
-					pos = rows[y].find(find, pos);
-					if (pos == std::string::npos)
-						break;
-					// Perform delete of matched segment
-					rows[y].erase(pos, find.size());
-					if (u) {
-						buf->SetCursor(pos, y);
-						u->Begin(UndoType::Delete);
-						u->Append(std::string_view(find));
-					}
-					// Insert replacement
-					if (!with.empty()) {
-						rows[y].insert(pos, with);
-						if (u) {
-							buf->SetCursor(pos, y);
-							u->Begin(UndoType::Insert);
-							u->Append(std::string_view(with));
-						}
-						pos += with.size();
-					}
-					++total;
-					if (with.empty()) {
-						// Avoid infinite loop when replacing with empty
-						// pos remains the same; move forward by 1 to continue search
-						if (pos < rows[y].size())
-							++pos;
-						else
-							break;
-					}
-				}
-			}
+			const std::size_t total = replace_all_literal(*buf, find, with, ctx.editor.FindOptions());
 			buf->SetDirty(true);
-			// Restore original cursor
-			if (orig_y < rows.size())
-				buf->SetCursor(orig_x, orig_y);
+			// The cursor stays put unless its row is gone
+			if (buf->Cury() >= buf->Nrows())
+				buf->SetCursor(0, buf->Nrows() - 1);
 			ensure_cursor_visible(ctx.editor, *buf);
 			char msg[128];
 			std::snprintf(msg, sizeof(msg), "Replaced %zu occurrence%s", total, (total == 1 ? "" : "s"));
@@ -2648,6 +2992,8 @@ cmd_newline(CommandContext &ctx)
 			} catch (const std::exception &e) {
 				ctx.editor.SetStatus(std::string("chdir failed: ") + e.what());
 			}
+		} else if (kind == Editor::PromptKind::Grep) {
+			grep_start(ctx.editor, value, false);
 		} else if (kind == Editor::PromptKind::RegexReplaceFind) {
 			// Proceed to regex replacement text prompt
 			ctx.editor.SetReplaceFindTmp(value);
@@ -2656,7 +3002,7 @@ cmd_newline(CommandContext &ctx)
 			ctx.editor.SetSearchQuery(value);
 			if (Buffer *b = ctx.editor.CurrentBuffer()) {
 				std::string err;
-				auto rm = search_compute_matches_regex(*b, ctx.editor.SearchQuery(), err);
+				const auto &rm = search_compute_matches_regex(ctx.editor, *b, err);
 				if (!err.empty()) {
 					ctx.editor.SetStatus(std::string("Regex: ") + value + "  [error: " + err + "]");
 				}
@@ -2692,11 +3038,10 @@ cmd_newline(CommandContext &ctx)
 				ctx.editor.SetSearchIndex(-1);
 				return true;
 			}
-			std::regex rx;
-			try {
-				rx = std::regex(patt);
-			} catch (const std::regex_error &e) {
-				ctx.editor.SetStatus(std::string("Regex error: ") + e.what());
+			kte::Regex rx;
+			std::string rx_err;
+			if (!rx.Compile(patt, rx_err)) {
+				ctx.editor.SetStatus("Regex error: " + rx_err);
 				// Clear search UI state
 				ctx.editor.SetSearchActive(false);
 				ctx.editor.SetSearchQuery("");
@@ -2705,18 +3050,16 @@ cmd_newline(CommandContext &ctx)
 				ctx.editor.SetSearchIndex(-1);
 				return true;
 			}
-			auto &rows          = buf->Rows();
-			std::size_t changed = 0;
-			for (auto &line: rows) {
-				std::string before = static_cast<std::string>(line);
-				std::string after  = std::regex_replace(before, rx, repl);
-				if (after != before) {
-					line = after;
-					++changed;
-				}
-			}
+			if (UndoSystem *u = buf->Undo())
+				u->commit(); // end any pending batch
+			std::size_t lines       = 0;
+			const std::size_t total = replace_all_regex(*buf, rx, repl, lines);
 			buf->SetDirty(true);
-			ctx.editor.SetStatus("Regex replaced in " + std::to_string(changed) + " line(s)");
+			// The cursor stays put unless its row is gone
+			if (buf->Cury() >= buf->Nrows())
+				buf->SetCursor(0, buf->Nrows() - 1);
+			ctx.editor.SetStatus("Regex replaced " + std::to_string(total) + " match(es) in " +
+			                     std::to_string(lines) + " line(s)");
 			// Clear search UI state
 			ctx.editor.SetSearchActive(false);
 			ctx.editor.SetSearchQuery("");
@@ -2735,9 +3078,10 @@ cmd_newline(CommandContext &ctx)
 		ctx.editor.SetSearchMatch(0, 0, 0);
 		ctx.editor.ClearSearchOrigin();
 		ctx.editor.SetStatus("Find done");
-		Buffer *buf = ctx.editor.CurrentBuffer();
-		if (buf)
+		if (Buffer *buf = ctx.editor.CurrentBuffer()) {
+			buf->SearchMatches().Clear();
 			ensure_cursor_visible(ctx.editor, *buf);
+		}
 		return true;
 	}
 	Buffer *buf = ctx.editor.CurrentBuffer();
@@ -2746,20 +3090,14 @@ cmd_newline(CommandContext &ctx)
 		return false;
 	}
 	ensure_at_least_one_line(*buf);
-	auto &rows    = buf->Rows();
 	std::size_t y = buf->Cury();
 	std::size_t x = buf->Curx();
 	int repeat    = ctx.count > 0 ? ctx.count : 1;
 	for (int i = 0; i < repeat; ++i) {
-		if (y >= rows.size())
-			rows.resize(y + 1);
-		auto &line = rows[y];
-		std::string tail;
-		if (x < line.size()) {
-			tail = line.substr(x);
-			line.erase(x);
-		}
-		rows.insert(rows.begin() + static_cast<std::ptrdiff_t>(y + 1), Buffer::Line(tail));
+		while (y >= buf->Nrows())
+			buf->insert_row(static_cast<int>(buf->Nrows()), "");
+		x = std::min(x, buf->LineLength(y));
+		buf->split_line(static_cast<int>(y), static_cast<int>(x));
 		y += 1;
 		x = 0;
 	}
@@ -2791,15 +3129,17 @@ cmd_backspace(CommandContext &ctx)
 				if (ctx.editor.CurrentPromptKind() == Editor::PromptKind::RegexSearch ||
 				    ctx.editor.CurrentPromptKind() == Editor::PromptKind::RegexReplaceFind) {
 					std::string err;
-					auto rm = search_compute_matches_regex(*buf2, ctx.editor.SearchQuery(), err);
+					const auto &rm = search_compute_matches_regex(ctx.editor, *buf2, err);
 					if (!err.empty()) {
 						ctx.editor.SetStatus(
 							std::string("Regex: ") + ctx.editor.PromptText() + "  [error: "
 							+ err + "]");
 					}
+					ctx.editor.SetSearchIndex(search_first_index(ctx.editor, *buf2, rm));
 					search_apply_match_regex(ctx.editor, *buf2, rm);
 				} else {
-					auto matches = search_compute_matches(*buf2, ctx.editor.SearchQuery());
+					const auto &matches = search_compute_matches(ctx.editor, *buf2);
+					ctx.editor.SetSearchIndex(search_first_index(ctx.editor, *buf2, matches));
 					search_apply_match(ctx.editor, *buf2, matches);
 				}
 			}
@@ -2817,7 +3157,8 @@ cmd_backspace(CommandContext &ctx)
 		}
 		Buffer *buf2 = ctx.editor.CurrentBuffer();
 		if (buf2) {
-			auto matches = search_compute_matches(*buf2, ctx.editor.SearchQuery());
+			const auto &matches = search_compute_matches(ctx.editor, *buf2);
+			ctx.editor.SetSearchIndex(search_first_index(ctx.editor, *buf2, matches));
 			search_apply_match(ctx.editor, *buf2, matches);
 		}
 		return true;
@@ -2828,16 +3169,18 @@ cmd_backspace(CommandContext &ctx)
 		return false;
 	}
 	ensure_at_least_one_line(*buf);
-	auto &rows    = buf->Rows();
 	std::size_t y = buf->Cury();
 	std::size_t x = buf->Curx();
 	UndoSystem *u = buf->Undo();
 	int repeat    = ctx.count > 0 ? ctx.count : 1;
+	if (y >= buf->Nrows())
+		y = buf->Nrows() - 1;
+	x = std::min(x, buf->LineLength(y));
 	for (int i = 0; i < repeat; ++i) {
 		if (x > 0) {
 			// Delete character before cursor
-			char deleted = rows[y][x - 1];
-			rows[y].erase(x - 1, 1);
+			char deleted = buf->CharAt(y, x - 1);
+			buf->delete_text(static_cast<int>(y), static_cast<int>(x - 1), 1);
 			--x;
 			// Update buffer cursor BEFORE Begin so batching sees correct cursor for backspace
 			buf->SetCursor(x, y);
@@ -2848,9 +3191,8 @@ cmd_backspace(CommandContext &ctx)
 			}
 		} else if (y > 0) {
 			// join with previous line
-			std::size_t prev_len = rows[y - 1].size();
-			rows[y - 1] += rows[y];
-			rows.erase(rows.begin() + static_cast<std::ptrdiff_t>(y));
+			std::size_t prev_len = buf->LineLength(y - 1);
+			buf->join_lines(static_cast<int>(y - 1));
 			y = y - 1;
 			x = prev_len;
 			// Update cursor to the join point BEFORE Begin to keep invariants consistent
@@ -2882,27 +3224,25 @@ cmd_delete_char(CommandContext &ctx)
 		return false;
 	}
 	ensure_at_least_one_line(*buf);
-	auto &rows    = buf->Rows();
 	std::size_t y = buf->Cury();
 	std::size_t x = buf->Curx();
 	UndoSystem *u = buf->Undo();
 	int repeat    = ctx.count > 0 ? ctx.count : 1;
 	for (int i = 0; i < repeat; ++i) {
-		if (y >= rows.size())
+		if (y >= buf->Nrows())
 			break;
-		if (x < rows[y].size()) {
+		if (x < buf->LineLength(y)) {
 			// Forward delete at cursor
-			char deleted = rows[y][x];
-			rows[y].erase(x, 1);
+			char deleted = buf->CharAt(y, x);
+			buf->delete_text(static_cast<int>(y), static_cast<int>(x), 1);
 			// Record undo after deletion (cursor stays at same position)
 			if (u) {
 				u->Begin(UndoType::Delete);
 				u->Append(deleted);
 			}
-		} else if (y + 1 < rows.size()) {
+		} else if (y + 1 < buf->Nrows()) {
 			// join next line
-			rows[y] += rows[y + 1];
-			rows.erase(rows.begin() + static_cast<std::ptrdiff_t>(y + 1));
+			buf->join_lines(static_cast<int>(y));
 			// Record newline deletion at end of this line; commit immediately
 			if (u) {
 				u->Begin(UndoType::Newline);
@@ -2965,23 +3305,22 @@ cmd_kill_to_eol(CommandContext &ctx)
 		return false;
 	}
 	ensure_at_least_one_line(*buf);
-	auto &rows    = buf->Rows();
 	std::size_t y = buf->Cury();
 	std::size_t x = buf->Curx();
 	int repeat    = ctx.count > 0 ? ctx.count : 1;
 	std::string killed_total;
 	for (int i = 0; i < repeat; ++i) {
-		if (y >= rows.size())
+		if (y >= buf->Nrows())
 			break;
-		if (x < rows[y].size()) {
+		const std::size_t len = buf->LineLength(y);
+		if (x < len) {
 			// delete from cursor to end of line
-			killed_total += rows[y].substr(x);
-			rows[y].erase(x);
-		} else if (y + 1 < rows.size()) {
+			killed_total += buf->GetLineString(y).substr(x);
+			buf->delete_text(static_cast<int>(y), static_cast<int>(x), len - x);
+		} else if (y + 1 < buf->Nrows()) {
 			// at EOL: delete the newline (join with next line)
 			killed_total += "\n";
-			rows[y] += rows[y + 1];
-			rows.erase(rows.begin() + static_cast<std::ptrdiff_t>(y + 1));
+			buf->join_lines(static_cast<int>(y));
 		} else {
 			// nothing to delete
 			break;
@@ -3009,32 +3348,30 @@ cmd_kill_line(CommandContext &ctx)
 		return false;
 	}
 	ensure_at_least_one_line(*buf);
-	auto &rows    = buf->Rows();
 	std::size_t y = buf->Cury();
 	std::size_t x = buf->Curx();
 	(void) x; // cursor x will be reset to 0
 	int repeat = ctx.count > 0 ? ctx.count : 1;
 	std::string killed_total;
 	for (int i = 0; i < repeat; ++i) {
-		if (rows.empty())
-			break;
-		if (rows.size() == 1) {
+		const std::size_t nrows = buf->Nrows();
+		if (nrows == 1) {
 			// last remaining line: clear its contents
-			killed_total += static_cast<std::string>(rows[0]);
-			rows[0].Clear();
+			killed_total += buf->GetLineString(0);
+			buf->delete_text(0, 0, buf->LineLength(0));
 			y = 0;
-		} else if (y < rows.size()) {
+		} else if (y < nrows) {
 			// erase current line; keep y pointing at the next line
-			killed_total += static_cast<std::string>(rows[y]);
+			killed_total += buf->GetLineString(y);
 			killed_total += "\n";
-			rows.erase(rows.begin() + static_cast<std::ptrdiff_t>(y));
-			if (y >= rows.size()) {
+			buf->delete_row(static_cast<int>(y));
+			if (y >= buf->Nrows()) {
 				// deleted last line; move to previous
-				y = rows.size() - 1;
+				y = buf->Nrows() - 1;
 			}
 		} else {
 			// out of range
-			y = rows.empty() ? 0 : rows.size() - 1;
+			y = nrows - 1;
 		}
 	}
 	buf->SetCursor(0, y);
@@ -3097,9 +3434,8 @@ cmd_move_file_end(CommandContext &ctx)
 	if (!buf)
 		return false;
 	ensure_at_least_one_line(*buf);
-	auto &rows    = buf->Rows();
-	std::size_t y = rows.empty() ? 0 : rows.size() - 1;
-	std::size_t x = rows.empty() ? 0 : rows[y].size();
+	std::size_t y = buf->Nrows() - 1;
+	std::size_t x = buf->LineLength(y);
 	buf->SetCursor(x, y);
 	ensure_cursor_visible(ctx.editor, *buf);
 	return true;
@@ -3175,6 +3511,10 @@ cmd_kill_region(CommandContext &ctx)
 static bool
 cmd_copy_region(CommandContext &ctx)
 {
+	// Esc w in a literal find prompt toggles whole-word matching instead
+	if (ctx.editor.PromptActive() && (ctx.editor.CurrentPromptKind() == Editor::PromptKind::Search ||
+	                                  ctx.editor.CurrentPromptKind() == Editor::PromptKind::ReplaceFind))
+		return cmd_toggle_search_word(ctx);
 	Buffer *buf = ctx.editor.CurrentBuffer();
 	if (!buf)
 		return false;
@@ -3226,52 +3566,24 @@ cmd_move_left(CommandContext &ctx)
 	     ctx.editor.CurrentPromptKind() == Editor::PromptKind::ReplaceFind)) {
 		if (ctx.editor.CurrentPromptKind() == Editor::PromptKind::RegexSearch) {
 			std::string err;
-			auto rmatches = search_compute_matches_regex(*buf, ctx.editor.SearchQuery(), err);
+			search_compute_matches_regex(ctx.editor, *buf, err);
 			if (!err.empty()) {
 				ctx.editor.SetStatus(
 					std::string("Regex: ") + ctx.editor.PromptText() + "  [error: " + err + "]");
 			}
-			if (!rmatches.empty()) {
-				int idx = ctx.editor.SearchIndex();
-				if (idx < 0)
-					idx = 0;
-				idx = (idx - 1 + static_cast<int>(rmatches.size())) % static_cast<int>(rmatches.size());
-				ctx.editor.SetSearchIndex(idx);
-				search_apply_match_regex(ctx.editor, *buf, rmatches);
-			} else {
-				search_apply_match_regex(ctx.editor, *buf, rmatches);
-			}
+			search_step(ctx.editor, *buf, -1);
 		} else {
-			auto matches = search_compute_matches(*buf, ctx.editor.SearchQuery());
-			if (!matches.empty()) {
-				int idx = ctx.editor.SearchIndex();
-				if (idx < 0)
-					idx = 0;
-				idx = (idx - 1 + static_cast<int>(matches.size())) % static_cast<int>(matches.size());
-				ctx.editor.SetSearchIndex(idx);
-				search_apply_match(ctx.editor, *buf, matches);
-			} else {
-				search_apply_match(ctx.editor, *buf, matches);
-			}
+			search_compute_matches(ctx.editor, *buf);
+			search_step(ctx.editor, *buf, -1);
 		}
 		return true;
 	}
 	if (ctx.editor.SearchActive()) {
-		auto matches = search_compute_matches(*buf, ctx.editor.SearchQuery());
-		if (!matches.empty()) {
-			int idx = ctx.editor.SearchIndex();
-			if (idx < 0)
-				idx = 0;
-			idx = (idx - 1 + static_cast<int>(matches.size())) % static_cast<int>(matches.size());
-			ctx.editor.SetSearchIndex(idx);
-			search_apply_match(ctx.editor, *buf, matches);
-		} else {
-			search_apply_match(ctx.editor, *buf, matches);
-		}
+		search_compute_matches(ctx.editor, *buf);
+		search_step(ctx.editor, *buf, -1);
 		return true;
 	}
 	ensure_at_least_one_line(*buf);
-	auto &rows    = buf->Rows();
 	std::size_t y = buf->Cury();
 	std::size_t x = buf->Curx();
 	int repeat    = ctx.count > 0 ? ctx.count : 1;
@@ -3280,7 +3592,7 @@ cmd_move_left(CommandContext &ctx)
 			--x;
 		} else if (y > 0) {
 			--y;
-			x = rows[y].size();
+			x = buf->LineLength(y);
 		}
 	}
 	buf->SetCursor(x, y);
@@ -3303,59 +3615,31 @@ cmd_move_right(CommandContext &ctx)
 	     ctx.editor.CurrentPromptKind() == Editor::PromptKind::ReplaceFind)) {
 		if (ctx.editor.CurrentPromptKind() == Editor::PromptKind::RegexSearch) {
 			std::string err;
-			auto rmatches = search_compute_matches_regex(*buf, ctx.editor.SearchQuery(), err);
+			search_compute_matches_regex(ctx.editor, *buf, err);
 			if (!err.empty()) {
 				ctx.editor.SetStatus(
 					std::string("Regex: ") + ctx.editor.PromptText() + "  [error: " + err + "]");
 			}
-			if (!rmatches.empty()) {
-				int idx = ctx.editor.SearchIndex();
-				if (idx < 0)
-					idx = 0;
-				idx = (idx + 1) % static_cast<int>(rmatches.size());
-				ctx.editor.SetSearchIndex(idx);
-				search_apply_match_regex(ctx.editor, *buf, rmatches);
-			} else {
-				search_apply_match_regex(ctx.editor, *buf, rmatches);
-			}
+			search_step(ctx.editor, *buf, 1);
 		} else {
-			auto matches = search_compute_matches(*buf, ctx.editor.SearchQuery());
-			if (!matches.empty()) {
-				int idx = ctx.editor.SearchIndex();
-				if (idx < 0)
-					idx = 0;
-				idx = (idx + 1) % static_cast<int>(matches.size());
-				ctx.editor.SetSearchIndex(idx);
-				search_apply_match(ctx.editor, *buf, matches);
-			} else {
-				search_apply_match(ctx.editor, *buf, matches);
-			}
+			search_compute_matches(ctx.editor, *buf);
+			search_step(ctx.editor, *buf, 1);
 		}
 		return true;
 	}
 	if (ctx.editor.SearchActive()) {
-		auto matches = search_compute_matches(*buf, ctx.editor.SearchQuery());
-		if (!matches.empty()) {
-			int idx = ctx.editor.SearchIndex();
-			if (idx < 0)
-				idx = 0;
-			idx = (idx + 1) % static_cast<int>(matches.size());
-			ctx.editor.SetSearchIndex(idx);
-			search_apply_match(ctx.editor, *buf, matches);
-		} else {
-			search_apply_match(ctx.editor, *buf, matches);
-		}
+		search_compute_matches(ctx.editor, *buf);
+		search_step(ctx.editor, *buf, 1);
 		return true;
 	}
 	ensure_at_least_one_line(*buf);
-	auto &rows    = buf->Rows();
 	std::size_t y = buf->Cury();
 	std::size_t x = buf->Curx();
 	int repeat    = ctx.count > 0 ? ctx.count : 1;
 	while (repeat-- > 0) {
-		if (y < rows.size() && x < rows[y].size()) {
+		if (y < buf->Nrows() && x < buf->LineLength(y)) {
 			++x;
-		} else if (y + 1 < rows.size()) {
+		} else if (y + 1 < buf->Nrows()) {
 			++y;
 			x = 0;
 		}
@@ -3377,29 +3661,19 @@ cmd_move_up(CommandContext &ctx)
 	if ((ctx.editor.PromptActive() && ctx.editor.CurrentPromptKind() == Editor::PromptKind::Search) || ctx.editor.
 	    SearchActive()) {
 		// Up == previous match
-		auto matches = search_compute_matches(*buf, ctx.editor.SearchQuery());
-		if (!matches.empty()) {
-			int idx = ctx.editor.SearchIndex();
-			if (idx < 0)
-				idx = 0;
-			idx = (idx - 1 + static_cast<int>(matches.size())) % static_cast<int>(matches.size());
-			ctx.editor.SetSearchIndex(idx);
-			search_apply_match(ctx.editor, *buf, matches);
-		} else {
-			search_apply_match(ctx.editor, *buf, matches);
-		}
+		search_compute_matches(ctx.editor, *buf);
+		search_step(ctx.editor, *buf, -1);
 		return true;
 	}
 	ensure_at_least_one_line(*buf);
-	auto &rows    = buf->Rows();
 	std::size_t y = buf->Cury();
 	std::size_t x = buf->Curx();
 	int repeat    = ctx.count > 0 ? ctx.count : 1;
 	if (repeat > static_cast<int>(y))
 		repeat = static_cast<int>(y);
 	y -= static_cast<std::size_t>(repeat);
-	if (x > rows[y].size())
-		x = rows[y].size();
+	if (x > buf->LineLength(y))
+		x = buf->LineLength(y);
 	buf->SetCursor(x, y);
 	ensure_cursor_visible(ctx.editor, *buf);
 	return true;
@@ -3417,30 +3691,20 @@ cmd_move_down(CommandContext &ctx)
 	if ((ctx.editor.PromptActive() && ctx.editor.CurrentPromptKind() == Editor::PromptKind::Search) || ctx.editor.
 	    SearchActive()) {
 		// Down == next match
-		auto matches = search_compute_matches(*buf, ctx.editor.SearchQuery());
-		if (!matches.empty()) {
-			int idx = ctx.editor.SearchIndex();
-			if (idx < 0)
-				idx = 0;
-			idx = (idx + 1) % static_cast<int>(matches.size());
-			ctx.editor.SetSearchIndex(idx);
-			search_apply_match(ctx.editor, *buf, matches);
-		} else {
-			search_apply_match(ctx.editor, *buf, matches);
-		}
+		search_compute_matches(ctx.editor, *buf);
+		search_step(ctx.editor, *buf, 1);
 		return true;
 	}
 	ensure_at_least_one_line(*buf);
-	auto &rows           = buf->Rows();
 	std::size_t y        = buf->Cury();
 	std::size_t x        = buf->Curx();
 	int repeat           = ctx.count > 0 ? ctx.count : 1;
-	std::size_t max_down = rows.size() - 1 - y;
+	std::size_t max_down = buf->Nrows() - 1 - y;
 	if (repeat > static_cast<int>(max_down))
 		repeat = static_cast<int>(max_down);
 	y += static_cast<std::size_t>(repeat);
-	if (x > rows[y].size())
-		x = rows[y].size();
+	if (x > buf->LineLength(y))
+		x = buf->LineLength(y);
 	buf->SetCursor(x, y);
 	ensure_cursor_visible(ctx.editor, *buf);
 	return true;
@@ -3472,9 +3736,8 @@ cmd_move_end(CommandContext &ctx)
 	if (auto *u = buf->Undo())
 		u->commit();
 	ensure_at_least_one_line(*buf);
-	auto &rows    = buf->Rows();
 	std::size_t y = buf->Cury();
-	std::size_t x = (y < rows.size()) ? rows[y].size() : 0;
+	std::size_t x = buf->LineLength(y);
 	buf->SetCursor(x, y);
 	ensure_cursor_visible(ctx.editor, *buf);
 	return true;
@@ -3490,7 +3753,7 @@ cmd_page_up(CommandContext &ctx)
 	if (auto *u = buf->Undo())
 		u->commit();
 	ensure_at_least_one_line(*buf);
-	auto &rows               = buf->Rows();
+	const std::size_t nrows  = buf->Nrows();
 	int repeat               = ctx.count > 0 ? ctx.count : 1;
 	std::size_t content_rows = std::max<std::size_t>(1, ctx.editor.ContentRows());
 
@@ -3503,8 +3766,8 @@ cmd_page_up(CommandContext &ctx)
 			rowoffs = 0;
 	}
 	// Clamp to valid range
-	if (rows.size() > content_rows) {
-		std::size_t max_top = rows.size() - content_rows;
+	if (nrows > content_rows) {
+		std::size_t max_top = nrows - content_rows;
 		if (rowoffs > max_top)
 			rowoffs = max_top;
 	} else {
@@ -3512,8 +3775,8 @@ cmd_page_up(CommandContext &ctx)
 	}
 	// Move cursor to first visible line, column 0
 	std::size_t y = rowoffs;
-	if (y >= rows.size())
-		y = rows.empty() ? 0 : rows.size() - 1;
+	if (y >= nrows)
+		y = nrows - 1;
 	buf->SetOffsets(rowoffs, 0);
 	buf->SetCursor(0, y);
 	return true;
@@ -3529,19 +3792,15 @@ cmd_page_down(CommandContext &ctx)
 	if (auto *u = buf->Undo())
 		u->commit();
 	ensure_at_least_one_line(*buf);
-	auto &rows               = buf->Rows();
+	const std::size_t nrows  = buf->Nrows();
 	int repeat               = ctx.count > 0 ? ctx.count : 1;
 	std::size_t content_rows = std::max<std::size_t>(1, ctx.editor.ContentRows());
 
 	std::size_t rowoffs = buf->Rowoffs();
 	// Compute maximum top offset
 	std::size_t max_top = 0;
-	if (!rows.empty()) {
-		if (rows.size() > content_rows)
-			max_top = rows.size() - content_rows;
-		else
-			max_top = 0;
-	}
+	if (nrows > content_rows)
+		max_top = nrows - content_rows;
 	while (repeat-- > 0) {
 		if (rowoffs + content_rows <= max_top)
 			rowoffs += content_rows;
@@ -3549,7 +3808,7 @@ cmd_page_down(CommandContext &ctx)
 			rowoffs = max_top;
 	}
 	// Move cursor to first visible line, column 0
-	std::size_t y = std::min<std::size_t>(rowoffs, rows.empty() ? 0 : rows.size() - 1);
+	std::size_t y = std::min<std::size_t>(rowoffs, nrows - 1);
 	buf->SetOffsets(rowoffs, 0);
 	buf->SetCursor(0, y);
 	return true;
@@ -3563,7 +3822,7 @@ cmd_scroll_up(CommandContext &ctx)
 	if (!buf)
 		return false;
 	ensure_at_least_one_line(*buf);
-	const auto &rows         = buf->Rows();
+	const std::size_t nrows  = buf->Nrows();
 	std::size_t content_rows = std::max<std::size_t>(1, ctx.editor.ContentRows());
 	std::size_t rowoffs      = buf->Rowoffs();
 
@@ -3580,8 +3839,8 @@ cmd_scroll_up(CommandContext &ctx)
 	std::size_t cury = buf->Cury();
 	if (cury >= rowoffs + content_rows) {
 		std::size_t new_y = rowoffs + content_rows - 1;
-		if (new_y >= rows.size() && !rows.empty())
-			new_y = rows.size() - 1;
+		if (new_y >= nrows)
+			new_y = nrows - 1;
 		buf->SetCursor(buf->Curx(), new_y);
 	}
 
@@ -3596,7 +3855,7 @@ cmd_scroll_down(CommandContext &ctx)
 	if (!buf)
 		return false;
 	ensure_at_least_one_line(*buf);
-	const auto &rows         = buf->Rows();
+	const std::size_t nrows  = buf->Nrows();
 	std::size_t content_rows = std::max<std::size_t>(1, ctx.editor.ContentRows());
 	std::size_t rowoffs      = buf->Rowoffs();
 
@@ -3605,8 +3864,8 @@ cmd_scroll_down(CommandContext &ctx)
 
 	// Compute maximum top offset
 	std::size_t max_top = 0;
-	if (!rows.empty() && rows.size() > content_rows)
-		max_top = rows.size() - content_rows;
+	if (nrows > content_rows)
+		max_top = nrows - content_rows;
 
 	rowoffs += static_cast<std::size_t>(scroll_amount);
 	if (rowoffs > max_top)
@@ -3640,43 +3899,42 @@ cmd_word_prev(CommandContext &ctx)
 	if (auto *u = buf->Undo())
 		u->commit();
 	ensure_at_least_one_line(*buf);
-	auto &rows    = buf->Rows();
 	std::size_t y = buf->Cury();
 	std::size_t x = buf->Curx();
 	int repeat    = ctx.count > 0 ? ctx.count : 1;
 	while (repeat-- > 0) {
-		if (y >= rows.size()) {
-			y = rows.empty() ? 0 : rows.size() - 1;
-			x = rows[y].size();
+		if (y >= buf->Nrows()) {
+			y = buf->Nrows() - 1;
+			x = buf->LineLength(y);
 		}
 		// If at start of line and not first line, move to end of previous line
 		if (x == 0) {
 			if (y == 0)
 				break;
 			--y;
-			x = rows[y].size();
+			x = buf->LineLength(y);
 		}
 		// Move left one first
 		if (x > 0)
 			--x;
 		// Skip any whitespace leftwards
-		while (y < rows.size() && (x > 0 || (x == 0 && y > 0))) {
+		while (y < buf->Nrows() && (x > 0 || (x == 0 && y > 0))) {
 			if (x == 0) {
 				--y;
-				x = rows[y].size();
+				x = buf->LineLength(y);
 				if (x == 0)
 					continue;
 			}
-			unsigned char c = x > 0 ? static_cast<unsigned char>(rows[y][x - 1]) : 0;
+			unsigned char c = x > 0 ? static_cast<unsigned char>(buf->CharAt(y, x - 1)) : 0;
 			if (!std::isspace(c))
 				break;
 			--x;
 		}
 		// Skip word characters leftwards
-		while (y < rows.size() && (x > 0 || (x == 0 && y > 0))) {
+		while (y < buf->Nrows() && (x > 0 || (x == 0 && y > 0))) {
 			if (x == 0)
 				break;
-			unsigned char c = static_cast<unsigned char>(rows[y][x - 1]);
+			unsigned char c = static_cast<unsigned char>(buf->CharAt(y, x - 1));
 			if (!is_word_char(c))
 				break;
 			--x;
@@ -3697,21 +3955,20 @@ cmd_word_next(CommandContext &ctx)
 	if (auto *u = buf->Undo())
 		u->commit();
 	ensure_at_least_one_line(*buf);
-	auto &rows    = buf->Rows();
 	std::size_t y = buf->Cury();
 	std::size_t x = buf->Curx();
 	int repeat    = ctx.count > 0 ? ctx.count : 1;
 	while (repeat-- > 0) {
-		if (y >= rows.size())
+		if (y >= buf->Nrows())
 			break;
 		// First, if currently on a word, skip to its end
-		while (y < rows.size()) {
-			if (x < rows[y].size() && is_word_char(static_cast<unsigned char>(rows[y][x]))) {
+		while (y < buf->Nrows()) {
+			if (x < buf->LineLength(y) && is_word_char(static_cast<unsigned char>(buf->CharAt(y, x)))) {
 				++x;
 				continue;
 			}
-			if (x >= rows[y].size()) {
-				if (y + 1 >= rows.size())
+			if (x >= buf->LineLength(y)) {
+				if (y + 1 >= buf->Nrows())
 					break;
 				++y;
 				x = 0;
@@ -3720,16 +3977,16 @@ cmd_word_next(CommandContext &ctx)
 			break;
 		}
 		// Then, skip any non-word characters (including punctuation and whitespace)
-		while (y < rows.size()) {
-			if (x < rows[y].size()) {
-				unsigned char c = static_cast<unsigned char>(rows[y][x]);
+		while (y < buf->Nrows()) {
+			if (x < buf->LineLength(y)) {
+				unsigned char c = static_cast<unsigned char>(buf->CharAt(y, x));
 				if (is_word_char(c))
 					break;
 				++x;
 				continue;
 			}
-			if (x >= rows[y].size()) {
-				if (y + 1 >= rows.size())
+			if (x >= buf->LineLength(y)) {
+				if (y + 1 >= buf->Nrows())
 					break;
 				++y;
 				x = 0;
@@ -3752,15 +4009,14 @@ cmd_delete_word_prev(CommandContext &ctx)
 	if (auto *u = buf->Undo())
 		u->commit();
 	ensure_at_least_one_line(*buf);
-	auto &rows    = buf->Rows();
 	std::size_t y = buf->Cury();
 	std::size_t x = buf->Curx();
 	int repeat    = ctx.count > 0 ? ctx.count : 1;
 	std::string killed_total;
 	for (int i = 0; i < repeat; ++i) {
-		if (y >= rows.size()) {
-			y = rows.empty() ? 0 : rows.size() - 1;
-			x = rows[y].size();
+		if (y >= buf->Nrows()) {
+			y = buf->Nrows() - 1;
+			x = buf->LineLength(y);
 		}
 		std::size_t start_y = y;
 		std::size_t start_x = x;
@@ -3769,61 +4025,36 @@ cmd_delete_word_prev(CommandContext &ctx)
 			if (y == 0)
 				break;
 			--y;
-			x = rows[y].size();
+			x = buf->LineLength(y);
 		}
 		// Move left one first
 		if (x > 0)
 			--x;
 		// Skip any whitespace leftwards
-		while (y < rows.size() && (x > 0 || (x == 0 && y > 0))) {
+		while (y < buf->Nrows() && (x > 0 || (x == 0 && y > 0))) {
 			if (x == 0) {
 				--y;
-				x = rows[y].size();
+				x = buf->LineLength(y);
 				if (x == 0)
 					continue;
 			}
-			unsigned char c = x > 0 ? static_cast<unsigned char>(rows[y][x - 1]) : 0;
+			unsigned char c = x > 0 ? static_cast<unsigned char>(buf->CharAt(y, x - 1)) : 0;
 			if (!std::isspace(c))
 				break;
 			--x;
 		}
 		// Skip word characters leftwards
-		while (y < rows.size() && (x > 0 || (x == 0 && y > 0))) {
+		while (y < buf->Nrows() && (x > 0 || (x == 0 && y > 0))) {
 			if (x == 0)
 				break;
-			unsigned char c = static_cast<unsigned char>(rows[y][x - 1]);
+			unsigned char c = static_cast<unsigned char>(buf->CharAt(y, x - 1));
 			if (!is_word_char(c))
 				break;
 			--x;
 		}
 		// Now delete from (x, y) to (start_x, start_y)
-		std::string deleted;
-		if (y == start_y) {
-			// same line
-			if (x < start_x) {
-				deleted = rows[y].substr(x, start_x - x);
-				rows[y].erase(x, start_x - x);
-			}
-		} else {
-			// spans multiple lines
-			// First, collect text from (x, y) to end of line y
-			deleted = rows[y].substr(x);
-			rows[y].erase(x);
-			// Then collect complete lines between y and start_y
-			for (std::size_t ly = y + 1; ly < start_y; ++ly) {
-				deleted += "\n";
-				deleted += static_cast<std::string>(rows[ly]);
-			}
-			// Finally, collect from beginning of start_y to start_x
-			if (start_y < rows.size()) {
-				deleted += "\n";
-				deleted += rows[start_y].substr(0, start_x);
-				rows[y] += rows[start_y].substr(start_x);
-				// Remove lines from y+1 to start_y inclusive
-				rows.erase(rows.begin() + static_cast<std::ptrdiff_t>(y + 1),
-				           rows.begin() + static_cast<std::ptrdiff_t>(start_y + 1));
-			}
-		}
+		const std::string deleted = extract_region_text(*buf, x, y, start_x, start_y);
+		buf->delete_text(static_cast<int>(y), static_cast<int>(x), deleted.size());
 		// Prepend to killed_total (since we're deleting backwards)
 		killed_total = deleted + killed_total;
 	}
@@ -3850,24 +4081,23 @@ cmd_delete_word_next(CommandContext &ctx)
 	if (auto *u = buf->Undo())
 		u->commit();
 	ensure_at_least_one_line(*buf);
-	auto &rows    = buf->Rows();
 	std::size_t y = buf->Cury();
 	std::size_t x = buf->Curx();
 	int repeat    = ctx.count > 0 ? ctx.count : 1;
 	std::string killed_total;
 	for (int i = 0; i < repeat; ++i) {
-		if (y >= rows.size())
+		if (y >= buf->Nrows())
 			break;
 		std::size_t start_y = y;
 		std::size_t start_x = x;
 		// First, if currently on a word, skip to its end
-		while (y < rows.size()) {
-			if (x < rows[y].size() && is_word_char(static_cast<unsigned char>(rows[y][x]))) {
+		while (y < buf->Nrows()) {
+			if (x < buf->LineLength(y) && is_word_char(static_cast<unsigned char>(buf->CharAt(y, x)))) {
 				++x;
 				continue;
 			}
-			if (x >= rows[y].size()) {
-				if (y + 1 >= rows.size())
+			if (x >= buf->LineLength(y)) {
+				if (y + 1 >= buf->Nrows())
 					break;
 				++y;
 				x = 0;
@@ -3876,16 +4106,16 @@ cmd_delete_word_next(CommandContext &ctx)
 			break;
 		}
 		// Then, skip any non-word characters (including punctuation and whitespace)
-		while (y < rows.size()) {
-			if (x < rows[y].size()) {
-				unsigned char c = static_cast<unsigned char>(rows[y][x]);
+		while (y < buf->Nrows()) {
+			if (x < buf->LineLength(y)) {
+				unsigned char c = static_cast<unsigned char>(buf->CharAt(y, x));
 				if (is_word_char(c))
 					break;
 				++x;
 				continue;
 			}
-			if (x >= rows[y].size()) {
-				if (y + 1 >= rows.size())
+			if (x >= buf->LineLength(y)) {
+				if (y + 1 >= buf->Nrows())
 					break;
 				++y;
 				x = 0;
@@ -3893,36 +4123,10 @@ cmd_delete_word_next(CommandContext &ctx)
 			}
 		}
 		// Now delete from (start_x, start_y) to (x, y)
-		std::string deleted;
-		if (start_y == y) {
-			// same line
-			if (start_x < x) {
-				deleted = rows[y].substr(start_x, x - start_x);
-				rows[y].erase(start_x, x - start_x);
-				x = start_x;
-			}
-		} else {
-			// spans multiple lines
-			// First, collect text from start_x to end of line start_y
-			deleted = rows[start_y].substr(start_x);
-			rows[start_y].erase(start_x);
-			// Then collect complete lines between start_y and y
-			for (std::size_t ly = start_y + 1; ly < y; ++ly) {
-				deleted += "\n";
-				deleted += static_cast<std::string>(rows[ly]);
-			}
-			// Finally, collect from beginning of y to x
-			if (y < rows.size()) {
-				deleted += "\n";
-				deleted += rows[y].substr(0, x);
-				rows[start_y] += rows[y].substr(x);
-				// Remove lines from start_y+1 to y inclusive
-				rows.erase(rows.begin() + static_cast<std::ptrdiff_t>(start_y + 1),
-				           rows.begin() + static_cast<std::ptrdiff_t>(y + 1));
-			}
-			y = start_y;
-			x = start_x;
-		}
+		const std::string deleted = extract_region_text(*buf, start_x, start_y, x, y);
+		buf->delete_text(static_cast<int>(start_y), static_cast<int>(start_x), deleted.size());
+		y = start_y;
+		x = start_x;
 		killed_total += deleted;
 	}
 	buf->SetCursor(x, y);
@@ -3954,9 +4158,8 @@ cmd_indent_region(CommandContext &ctx)
 		ctx.editor.SetStatus("No region to indent");
 		return false;
 	}
-	auto &rows = buf->Rows();
-	for (std::size_t y = sy; y <= ey && y < rows.size(); ++y) {
-		rows[y].insert(0, "\t");
+	for (std::size_t y = sy; y <= ey && y < buf->Nrows(); ++y) {
+		buf->insert_text(static_cast<int>(y), 0, "\t");
 	}
 	buf->SetDirty(true);
 	buf->ClearMark();
@@ -3980,19 +4183,18 @@ cmd_unindent_region(CommandContext &ctx)
 		ctx.editor.SetStatus("No region to unindent");
 		return false;
 	}
-	auto &rows = buf->Rows();
-	for (std::size_t y = sy; y <= ey && y < rows.size(); ++y) {
-		auto &line = rows[y];
-		if (!line.empty()) {
-			if (line[0] == '\t') {
-				line.erase(0, 1);
-			} else if (line[0] == ' ') {
+	for (std::size_t y = sy; y <= ey && y < buf->Nrows(); ++y) {
+		const std::size_t len = buf->LineLength(y);
+		if (len > 0) {
+			if (buf->CharAt(y, 0) == '\t') {
+				buf->delete_text(static_cast<int>(y), 0, 1);
+			} else if (buf->CharAt(y, 0) == ' ') {
 				std::size_t spaces = 0;
-				while (spaces < line.size() && spaces < 8 && line[spaces] == ' ') {
+				while (spaces < len && spaces < 8 && buf->CharAt(y, spaces) == ' ') {
 					++spaces;
 				}
 				if (spaces > 0)
-					line.erase(0, spaces);
+					buf->delete_text(static_cast<int>(y), 0, spaces);
 			}
 		}
 	}
@@ -4010,16 +4212,15 @@ cmd_reflow_paragraph(CommandContext &ctx)
 	if (!buf)
 		return false;
 	ensure_at_least_one_line(*buf);
-	auto &rows    = buf->Rows();
 	std::size_t y = buf->Cury();
 	// Treat a universal-argument count of 1 as "no width specified".
 	// Editor::UArgGet() returns 1 when no explicit count was provided.
 	int width              = ctx.count > 1 ? ctx.count : 72;
 	std::size_t para_start = y;
-	while (para_start > 0 && !rows[para_start - 1].empty())
+	while (para_start > 0 && buf->LineLength(para_start - 1) != 0)
 		--para_start;
 	std::size_t para_end = y;
-	while (para_end + 1 < rows.size() && !rows[para_end + 1].empty())
+	while (para_end + 1 < buf->Nrows() && buf->LineLength(para_end + 1) != 0)
 		++para_end;
 	if (para_start > para_end)
 		return false;
@@ -4138,7 +4339,7 @@ cmd_reflow_paragraph(CommandContext &ctx)
 	// Determine if this region looks like a list: any line starting with bullet
 	bool region_has_bullet = false;
 	for (std::size_t i = para_start; i <= para_end; ++i) {
-		std::string s = static_cast<std::string>(rows[i]);
+		std::string s = buf->GetLineString(i);
 		std::string indent;
 		char marker;
 		std::size_t idx;
@@ -4151,7 +4352,7 @@ cmd_reflow_paragraph(CommandContext &ctx)
 	if (region_has_bullet) {
 		// Parse as list items; support hanging indent continuations
 		for (std::size_t i = para_start; i <= para_end; ++i) {
-			std::string s = static_cast<std::string>(rows[i]);
+			std::string s = buf->GetLineString(i);
 			std::string indent;
 			char marker           = 0;
 			std::size_t after_idx = 0;
@@ -4162,7 +4363,7 @@ cmd_reflow_paragraph(CommandContext &ctx)
 				// consume continuation lines that are part of this bullet item
 				std::size_t j = i + 1;
 				while (j <= para_end) {
-					std::string ns = static_cast<std::string>(rows[j]);
+					std::string ns = buf->GetLineString(j);
 					if (starts_with(ns, indent + "  ")) {
 						content += ' ';
 						content += ns.substr(indent.size() + 2);
@@ -4188,7 +4389,7 @@ cmd_reflow_paragraph(CommandContext &ctx)
 				std::string content     = s.substr(base_indent.size());
 				std::size_t j           = i + 1;
 				while (j <= para_end) {
-					std::string ns      = static_cast<std::string>(rows[j]);
+					std::string ns      = buf->GetLineString(j);
 					std::string nindent = leading_ws(ns);
 					std::string tmp_indent;
 					char tmp_marker;
@@ -4211,11 +4412,11 @@ cmd_reflow_paragraph(CommandContext &ctx)
 		}
 	} else {
 		// Normal paragraph: preserve indentation of first line
-		std::string s0  = static_cast<std::string>(rows[para_start]);
+		std::string s0  = buf->GetLineString(para_start);
 		std::string pfx = leading_ws(s0);
 		std::string content;
 		for (std::size_t i = para_start; i <= para_end; ++i) {
-			std::string si = static_cast<std::string>(rows[i]);
+			std::string si = buf->GetLineString(i);
 			// strip the same prefix length if present
 			if (si.size() >= pfx.size() && starts_with(si, pfx))
 				si.erase(0, pfx.size());
@@ -4230,10 +4431,15 @@ cmd_reflow_paragraph(CommandContext &ctx)
 	if (new_lines.empty())
 		new_lines.push_back("");
 
-	rows.erase(rows.begin() + static_cast<std::ptrdiff_t>(para_start),
-	           rows.begin() + static_cast<std::ptrdiff_t>(para_end + 1));
-	rows.insert(rows.begin() + static_cast<std::ptrdiff_t>(para_start),
-	            new_lines.begin(), new_lines.end());
+	std::string replacement;
+	for (std::size_t i = 0; i < new_lines.size(); ++i) {
+		if (i > 0)
+			replacement.push_back('\n');
+		replacement += new_lines[i];
+	}
+	const std::string old_text = extract_region_text(*buf, 0, para_start, buf->LineLength(para_end), para_end);
+	buf->delete_text(static_cast<int>(para_start), 0, old_text.size());
+	buf->insert_text(static_cast<int>(para_start), 0, replacement);
 
 	// Place cursor at the end of the paragraph
 	std::size_t new_last_y = para_start + (new_lines.empty() ? 0 : new_lines.size() - 1);
@@ -4275,9 +4481,8 @@ cmd_mark_all_and_jump_end(CommandContext &ctx)
 		return false;
 	ensure_at_least_one_line(*buf);
 	buf->SetMark(0, 0);
-	auto &rows         = buf->Rows();
-	std::size_t last_y = rows.empty() ? 0 : rows.size() - 1;
-	std::size_t last_x = last_y < rows.size() ? rows[last_y].size() : 0;
+	std::size_t last_y = buf->Nrows() - 1;
+	std::size_t last_x = buf->LineLength(last_y);
 	buf->SetCursor(last_x, last_y);
 	ensure_cursor_visible(ctx.editor, *buf);
 	return true;
@@ -4513,6 +4718,29 @@ InstallDefaultCommands()
 		CommandId::CenterOnCursor, "center-on-cursor", "Center viewport on current line", cmd_center_on_cursor,
 		false, false
 	});
+	// Project-wide search
+	CommandRegistry::Register({
+		CommandId::GrepStart, "grep-start", "Search open buffers and files (prompt)", cmd_grep_start, false, false
+	});
+	CommandRegistry::Register({
+		CommandId::Grep, "grep", "Search open buffers and files for text", cmd_grep, true, false
+	});
+	CommandRegistry::Register({
+		CommandId::GrepRegex, "grep-regex", "Search open buffers and files for a regex", cmd_grep_regex, true,
+		false
+	});
+	CommandRegistry::Register({
+		CommandId::GrepGoto, "grep-goto", "Open the grep hit on the current line", cmd_grep_goto, false, false
+	});
+	// Find options
+	CommandRegistry::Register({
+		CommandId::ToggleSearchCase, "toggle-search-case", "Toggle case-insensitive find", cmd_toggle_search_case,
+		true, false
+	});
+	CommandRegistry::Register({
+		CommandId::ToggleSearchWord, "toggle-search-word", "Toggle whole-word find", cmd_toggle_search_word, true,
+		false
+	});
 }
 
 
@@ -4532,6 +4760,12 @@ Execute(Editor &ed, CommandId id, const std::string &arg, int count)
 	    CommandId::CopyRegion && id != CommandId::DeleteWordPrev && id != CommandId::DeleteWordNext) {
 		ed.SetKillChain(false);
 	}
+	// Enter on a +GREP+ line opens that hit
+	if (id == CommandId::Newline && !ed.PromptActive()) {
+		const Buffer *b = ed.CurrentBuffer();
+		if (b && is_grep_results(*b))
+			return Execute(ed, CommandId::GrepGoto, arg, count);
+	}
 	// If buffer is read-only, block mutating commands outside of prompts
 	if (!ed.PromptActive()) {
 		Buffer *b = ed.CurrentBuffer();
@@ -108,6 +108,14 @@ enum class CommandId {
 	SetOption, // generic ":set key=value" (v1: filetype=<lang>)
 	// Viewport control
 	CenterOnCursor, // center the viewport on the current cursor line (C-k k)
+	// Project-wide search
+	GrepStart, // prompt for a query and search buffers and files (C-k /)
+	Grep, // arg: literal query to search buffers and files for
+	GrepRegex, // arg: regex to search buffers and files for
+	GrepGoto, // jump to the hit on the current +GREP+ line (Enter there)
+	// Literal find options
+	ToggleSearchCase, // case-insensitive find (Esc c)
+	ToggleSearchWord, // whole-word find (Esc w in a find prompt)
 };
 
 
@@ -162,4 +170,10 @@ void InstallDefaultCommands();
 // Returns true if the command executed successfully.
 bool Execute(Editor &ed, CommandId id, const std::string &arg = std::string(), int count = 0);
 
-bool Execute(Editor &ed, const std::string &name, const std::string &arg = std::string(), int count = 0);
\ No newline at end of file
+bool Execute(Editor &ed, const std::string &name, const std::string &arg = std::string(), int count = 0);
+
+
+// Apply a finished background match count to the find state (index and
+// "n/total" status), and append new grep results to the +GREP+ buffer.
+// Frontends call this once per step, before drawing.
+void PollSearch(Editor &ed);
\ No newline at end of file
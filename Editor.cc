@@ -162,9 +162,9 @@ Editor::OpenFile(const std::string &path, std::string &err)
 		Buffer &cur                  = buffers_[curbuf_];
 		const bool unnamed           = cur.Filename().empty() && !cur.IsFileBacked();
 		const bool clean             = !cur.Dirty();
-		const auto &rows             = cur.Rows();
-		const bool rows_empty        = rows.empty();
-		const bool single_empty_line = (!rows.empty() && rows.size() == 1 && rows[0].size() == 0);
+		const std::size_t nrows      = cur.Nrows();
+		const bool rows_empty        = nrows == 0;
+		const bool single_empty_line = (nrows == 1 && cur.LineLength(0) == 0);
 		if (unnamed && clean && (rows_empty || single_empty_line)) {
 			bool ok = cur.OpenFromFile(path, err);
 			if (!ok)
@@ -178,9 +178,8 @@ Editor::OpenFile(const std::string &path, std::string &err)
 			// Setup highlighting using registry (extension + shebang)
 			cur.EnsureHighlighter();
 			std::string first = "";
-			const auto &rows  = cur.Rows();
-			if (!rows.empty())
-				first = static_cast<std::string>(rows[0]);
+			if (cur.Nrows() > 0)
+				first = cur.GetLineString(0);
 			std::string ft = kte::HighlighterRegistry::DetectForPath(path, first);
 			if (!ft.empty()) {
 				cur.SetFiletype(ft);
@@ -214,11 +213,8 @@ Editor::OpenFile(const std::string &path, std::string &err)
 	// Initialize syntax highlighting by extension + shebang via registry (v2)
 	b.EnsureHighlighter();
 	std::string first = "";
-	{
-		const auto &rows = b.Rows();
-		if (!rows.empty())
-			first = static_cast<std::string>(rows[0]);
-	}
+	if (b.Nrows() > 0)
+		first = b.GetLineString(0);
 	std::string ft = kte::HighlighterRegistry::DetectForPath(path, first);
 	if (!ft.empty()) {
 		b.SetFiletype(ft);
@@ -290,6 +286,37 @@ Editor::CloseBuffer(std::size_t index)
 }
 
 
+void
+Editor::PollSaves()
+{
+	for (auto &buf: buffers_) {
+		Buffer::SaveResult res;
+		if (!buf.PollSave(res))
+			continue;
+		if (!res.ok)
+			SetStatus(res.err);
+		else if (res.modified)
+			SetStatus("Saved " + buf.Filename() + " (modified since save started)");
+		else
+			SetStatus("Saved " + buf.Filename());
+	}
+}
+
+
+void
+Editor::PollFiles()
+{
+	const std::time_t now = std::time(nullptr);
+	if (now == files_checked_)
+		return;
+	files_checked_ = now;
+	for (auto &buf: buffers_) {
+		if (buf.CheckOnDisk())
+			SetStatus(buf.Filename() + " changed on disk; save it under another name to keep this buffer");
+	}
+}
+
+
 void
 Editor::Reset()
 {
@@ -8,6 +8,8 @@
 #include <vector>
 
 #include "Buffer.h"
+#include "Grep.h"
+#include "OptimizedSearch.h"
 #include "Swap.h"
 
 
@@ -276,6 +278,19 @@ public:
 	}
 
 
+	// Literal find and replace options (Esc c, Esc w in a find prompt)
+	void SetFindOptions(const SearchOptions &opts)
+	{
+		find_options_ = opts;
+	}
+
+
+	[[nodiscard]] const SearchOptions &FindOptions() const
+	{
+		return find_options_;
+	}
+
+
 	void SetSearchMatch(std::size_t y, std::size_t x, std::size_t len)
 	{
 		search_y_   = y;
@@ -377,6 +392,7 @@ public:
 		Chdir,
 		ReplaceFind, // step 1 of Search & Replace: find what
 		ReplaceWith, // step 2 of Search & Replace: replace with
+		Grep, // project-wide search query (C-k /)
 		Command // generic command prompt (": ")
 	};
 
@@ -505,6 +521,15 @@ public:
 	// Reset to initial state
 	void Reset();
 
+	// Apply the results of finished background saves (status line, dirty
+	// flags). Frontends call this once per step, before drawing.
+	void PollSaves();
+
+	// Warn about buffers whose mapped file changed on disk underneath them
+	// (Buffer::CheckOnDisk), checking at most once a second. Frontends call
+	// this once per step, with PollSaves().
+	void PollFiles();
+
 	// Direct access when needed (try to prefer methods above)
 	[[nodiscard]] const std::vector<Buffer> &Buffers() const
 	{
@@ -525,6 +550,13 @@ public:
 	}
 
 
+	// Project-wide search whose results fill the +GREP+ buffer
+	[[nodiscard]] kte::Grep &GrepSearch()
+	{
+		return grep_;
+	}
+
+
 	// --- GUI: Visual File Picker state ---
 	void SetFilePickerVisible(bool on)
 	{
@@ -560,12 +592,17 @@ private:
 	int uarg_          = 0, ucount_ = 0; // C-u support
 	bool repeatable_   = false; // whether the next command is repeatable
 
+	std::time_t files_checked_ = 0; // when PollFiles() last checked the buffers
+
 	std::vector<Buffer> buffers_;
 	std::size_t curbuf_ = 0; // index into buffers_
 
 	// Swap journaling manager (lifetime = editor)
 	std::unique_ptr<kte::SwapManager> swap_;
 
+	// Running or finished grep (lifetime = editor)
+	kte::Grep grep_;
+
 	// Kill ring (Emacs-like)
 	std::vector<std::string> kill_ring_;
 	std::size_t kill_ring_max_ = 60;
@@ -579,6 +616,7 @@ private:
 	// Search state
 	bool search_active_ = false;
 	std::string search_query_;
+	SearchOptions find_options_;
 	std::size_t search_y_ = 0, search_x_ = 0, search_len_ = 0;
 	// Search session bookkeeping
 	bool search_origin_set_          = false;
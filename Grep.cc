@@ -0,0 +1,360 @@
+#include "Grep.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <iterator>
+#include <mutex>
+#include <string_view>
+#include <unordered_set>
+
+#include "BackgroundJob.h"
+#include "ByteScan.h"
+#include "MappedFile.h"
+#include "PieceTable.h"
+#include "Regex.h"
+#include "WorkerPool.h"
+
+
+namespace kte {
+namespace {
+// Files handed to the worker pool at a time; bounds the files open and the
+// results held outside the queue at once
+constexpr std::size_t kBatchFiles = 64;
+// Leading bytes checked for a NUL to decide that a file is binary
+constexpr std::size_t kBinaryProbe = 8192;
+
+
+// What searching one file or source produced
+struct Found {
+	std::vector<Grep::Hit> hits;
+	std::string lines;
+	bool searched = false;
+	bool binary   = false;
+	bool changed  = false; // truncated while mapped: hits discarded
+};
+
+
+// Call fn(line, row) for each line of text until it returns false
+template<typename Fn>
+void
+for_each_line(const std::string_view text, Fn &&fn)
+{
+	std::size_t row = 0;
+	for (std::size_t pos = 0;; ++row) {
+		const char *nl = pos < text.size() ? FindByte(text.data() + pos, text.size() - pos, '\n') : nullptr;
+		const std::size_t end = nl ? static_cast<std::size_t>(nl - text.data()) : text.size();
+		if (!fn(text.substr(pos, end - pos), row) || !nl)
+			return;
+		pos = end + 1;
+	}
+}
+
+
+template<typename Fn>
+void
+for_each_line(const PieceTable &text, Fn &&fn)
+{
+	std::string carry; // start of a line that continues into the next chunk
+	std::size_t row = 0;
+	bool more       = true;
+	text.ForEachChunk(0, text.Size(), [&](const std::string_view chunk) {
+		std::size_t pos = 0;
+		for (;;) {
+			const char *nl = pos < chunk.size()
+				                 ? FindByte(chunk.data() + pos, chunk.size() - pos, '\n')
+				                 : nullptr;
+			if (!nl) {
+				carry.append(chunk.substr(pos));
+				return true;
+			}
+			const auto end        = static_cast<std::size_t>(nl - chunk.data());
+			std::string_view line = chunk.substr(pos, end - pos);
+			if (!carry.empty()) {
+				carry.append(line);
+				line = carry;
+			}
+			more = fn(line, row++);
+			carry.clear();
+			if (!more)
+				return false;
+			pos = end + 1;
+		}
+	});
+	if (more)
+		fn(std::string_view(carry), row);
+}
+} // namespace
+
+
+// A background search. The worker owns everything but the queue (hits,
+// lines and the counts), which both sides access under mtx.
+struct Grep::Job {
+	// A source or a file to search
+	struct Item {
+		const Source *source = nullptr;
+		std::string path;
+	};
+
+	std::vector<Source> sources;
+	std::string root;
+	std::string query;
+	bool regex = false;
+	Regex rx; // copied per item: a Regex must not be shared between threads
+
+	std::mutex mtx;
+	std::vector<Hit> hits;
+	std::string lines;
+	std::size_t files   = 0;
+	std::size_t binary  = 0;
+	std::size_t changed = 0;
+
+	std::atomic<std::size_t> found{0}; // hits claimed, including refused ones
+	BackgroundJob worker;
+
+
+	[[nodiscard]] bool stopped() const
+	{
+		return worker.Cancelled() || found.load(std::memory_order_relaxed) >= kMaxHits;
+	}
+
+
+	// Record a hit unless the search is over; false once it is
+	bool add(Found &out, const std::string &path, std::string_view line, const std::size_t row,
+	         const std::size_t col)
+	{
+		if (worker.Cancelled() || found.fetch_add(1, std::memory_order_relaxed) >= kMaxHits)
+			return false;
+		if (!line.empty() && line.back() == '\r')
+			line.remove_suffix(1);
+		out.hits.push_back(Hit{path, row, col});
+		const bool under = path.size() > root.size() && path.compare(0, root.size(), root) == 0 &&
+		                   path[root.size()] == '/';
+		out.lines += under ? std::string_view(path).substr(root.size() + 1) : std::string_view(path);
+		out.lines += ':' + std::to_string(row + 1) + ':' + std::to_string(col + 1) + ": ";
+		out.lines += line.substr(0, kMaxLineBytes);
+		out.lines += '\n';
+		return true;
+	}
+
+
+	// Literal search of a whole file: find each match, then its line
+	void search_literal(const std::string_view text, const std::string &path, Found &out)
+	{
+		const char *data       = text.data();
+		std::size_t row        = 0;
+		std::size_t line_start = 0; // start of line row
+		for (;;) {
+			const char *hit = FindSubstring(data + line_start, text.size() - line_start, query.data(),
+			                                query.size());
+			if (!hit)
+				return;
+			const auto at = static_cast<std::size_t>(hit - data);
+			row += CountNewlines(data + line_start, at - line_start);
+			const std::size_t nl    = text.rfind('\n', at);
+			const std::size_t begin = nl == std::string_view::npos ? 0 : nl + 1;
+			const char *e           = FindByte(data + at, text.size() - at, '\n');
+			const std::size_t end   = e ? static_cast<std::size_t>(e - data) : text.size();
+			if (!add(out, path, text.substr(begin, end - begin), row, at - begin) || !e)
+				return;
+			line_start = end + 1;
+			++row;
+		}
+	}
+
+
+	void search(const Item &item, Found &out)
+	{
+		Regex local;
+		if (regex)
+			local = rx;
+		std::vector<Regex::Span> groups;
+		const std::string &path = item.source ? item.source->name : item.path;
+		auto line_fn            = [&](const std::string_view line, const std::size_t row) {
+			std::size_t col = 0;
+			if (regex) {
+				if (!local.Search(line, 0, groups))
+					return !worker.Cancelled();
+				col = groups[0].first;
+			} else {
+				const char *hit = FindSubstring(line.data(), line.size(), query.data(), query.size());
+				if (!hit)
+					return true;
+				col = static_cast<std::size_t>(hit - line.data());
+			}
+			return add(out, path, line, row, col);
+		};
+
+		if (item.source) {
+			for_each_line(*item.source->text, line_fn);
+			out.searched = true;
+			return;
+		}
+		std::string err;
+		const auto file = MappedFile::Open(item.path, err);
+		if (!file)
+			return; // unreadable: skip it
+		const std::string_view text(file->Data(), file->Size());
+		const bool binary = std::memchr(text.data(), '\0', std::min(text.size(), kBinaryProbe)) != nullptr;
+		if (!binary) {
+			if (regex)
+				for_each_line(text, line_fn);
+			else
+				search_literal(text, item.path, out);
+		}
+		// A file truncated under its mapping reads as zeros past the cut
+		// (see MappedFile), so neither its hits nor a NUL found are real:
+		// give the hits back and count the file as changed
+		if (file->Damaged()) {
+			found.fetch_sub(out.hits.size(), std::memory_order_relaxed);
+			out.hits.clear();
+			out.lines.clear();
+			out.changed = true;
+			return;
+		}
+		out.binary   = binary;
+		out.searched = !binary;
+	}
+
+
+	// Search batch on the pool and queue the results in batch order
+	void flush(std::vector<Item> &batch)
+	{
+		std::vector<Found> results(batch.size());
+		WorkerPool::Shared().Run(batch.size(), [this, &batch, &results](const std::size_t i) {
+			if (!stopped())
+				search(batch[i], results[i]);
+		});
+		batch.clear();
+		std::lock_guard<std::mutex> lock(mtx);
+		for (Found &f: results) {
+			files += f.searched ? 1 : 0;
+			binary += f.binary ? 1 : 0;
+			changed += f.changed ? 1 : 0;
+			hits.insert(hits.end(), std::make_move_iterator(f.hits.begin()), std::make_move_iterator(f.hits.end()));
+			lines += f.lines;
+		}
+	}
+
+
+	void run()
+	{
+		namespace fs = std::filesystem;
+		std::vector<Item> batch;
+		std::unordered_set<std::string> open;
+		for (const Source &s: sources) {
+			open.insert(s.name);
+			batch.push_back(Item{&s, std::string()});
+			if (batch.size() == kBatchFiles)
+				flush(batch);
+		}
+
+		// Walk the tree lazily, skipping hidden directories (.git and the like)
+		std::error_code ec;
+		fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec);
+		for (; !ec && it != fs::recursive_directory_iterator() && !stopped(); it.increment(ec)) {
+			const fs::directory_entry &entry = *it;
+			std::error_code fec;
+			if (entry.is_directory(fec)) {
+				const std::string name = entry.path().filename().string();
+				if (name.size() > 1 && name[0] == '.')
+					it.disable_recursion_pending();
+				continue;
+			}
+			if (!entry.is_regular_file(fec))
+				continue;
+			std::string path = entry.path().string();
+			if (open.count(path))
+				continue;
+			batch.push_back(Item{nullptr, std::move(path)});
+			if (batch.size() == kBatchFiles)
+				flush(batch);
+		}
+		flush(batch);
+	}
+};
+
+
+Grep::Grep() = default;
+
+
+Grep::~Grep() = default;
+
+
+bool
+Grep::Start(std::vector<Source> sources, const std::string &root, const std::string &query, const bool regex,
+            std::string &err)
+{
+	err.clear();
+	job_.reset();
+	hits_.clear();
+	files_     = 0;
+	binary_    = 0;
+	changed_   = 0;
+	truncated_ = false;
+	if (query.empty())
+		return true;
+
+	auto job     = std::make_shared<Job>();
+	job->sources = std::move(sources);
+	job->query   = query;
+	job->regex   = regex;
+	if (regex && !job->rx.Compile(query, err))
+		return false;
+	std::error_code ec;
+	job->root = std::filesystem::weakly_canonical(root, ec).string();
+	if (ec)
+		job->root = root;
+	while (job->root.size() > 1 && job->root.back() == '/')
+		job->root.pop_back();
+
+	Job *j = job.get();
+	job->worker.Start([j] {
+		j->run();
+	});
+	job_ = std::move(job);
+	return true;
+}
+
+
+bool
+Grep::Poll(std::string &lines)
+{
+	if (!job_)
+		return false;
+	const bool finished = job_->worker.Done();
+	{
+		std::lock_guard<std::mutex> lock(job_->mtx);
+		if (job_->hits.empty() && !finished)
+			return false;
+		lines += job_->lines;
+		job_->lines.clear();
+		hits_.insert(hits_.end(), std::make_move_iterator(job_->hits.begin()),
+		             std::make_move_iterator(job_->hits.end()));
+		job_->hits.clear();
+		files_     = job_->files;
+		binary_    = job_->binary;
+		changed_   = job_->changed;
+		truncated_ = job_->found.load(std::memory_order_relaxed) >= kMaxHits;
+	}
+	if (finished)
+		job_.reset();
+	return true;
+}
+
+
+void
+Grep::Wait()
+{
+	if (job_)
+		job_->worker.Wait();
+}
+
+
+void
+Grep::Cancel()
+{
+	job_.reset();
+}
+} // namespace kte
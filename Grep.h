@@ -0,0 +1,117 @@
+// Grep.h - search across open buffers and the files under a directory
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+class PieceTable;
+
+namespace kte {
+// A project-wide search: every open buffer, then every file under a root
+// directory. A background thread walks the tree and hands files to
+// WorkerPool::Shared() in batches. Files are read through MappedFile, so
+// large ones are mapped rather than copied, and files with a NUL byte near
+// the start are taken as binary and skipped, as are hidden directories.
+// A file truncated while it is searched is skipped too, rather than
+// reported with the zeros its mapping reads as past the cut.
+// A line is reported once, at its first match: a literal query matches as
+// find does, a regex query as kte::Regex does on that line.
+//
+// Memory stays bounded however large the tree is: the walk is lazy, one
+// batch of files is open at a time, reported lines are truncated to
+// kMaxLineBytes and the search stops after kMaxHits hits. Results arrive
+// through Poll() while the search runs, always in the same order: sources
+// first, then files in directory walk order.
+class Grep {
+public:
+	// An open buffer to search instead of its file on disk
+	struct Source {
+		std::string name; // file path, or the buffer's virtual name
+		std::shared_ptr<const PieceTable> text;
+	};
+
+	struct Hit {
+		std::string path; // Source::name or file path
+		std::size_t line; // zero-based
+		std::size_t col;
+	};
+
+	static constexpr std::size_t kMaxHits      = 10000;
+	static constexpr std::size_t kMaxLineBytes = 200;
+
+	Grep();
+
+	~Grep();
+
+	Grep(const Grep &) = delete;
+
+	Grep &operator=(const Grep &) = delete;
+
+	// Start a search for query, replacing any search in progress. Files
+	// under root that are also sources are searched as the source. On a
+	// regex syntax error returns false and sets err.
+	bool Start(std::vector<Source> sources, const std::string &root, const std::string &query, bool regex,
+	           std::string &err);
+
+	// Append the hits found since the last call to Hits(), and one
+	// "path:line:col: text\n" line per hit to lines; paths under the root
+	// are shown relative to it. Returns true if there was anything new or
+	// the search has just finished.
+	bool Poll(std::string &lines);
+
+	// Block until the search has finished (Poll still collects the rest)
+	void Wait();
+
+	// Stop the search, keeping the hits collected so far
+	void Cancel();
+
+	[[nodiscard]] bool Running() const
+	{
+		return static_cast<bool>(job_);
+	}
+
+
+	[[nodiscard]] const std::vector<Hit> &Hits() const
+	{
+		return hits_;
+	}
+
+
+	[[nodiscard]] std::size_t FilesSearched() const
+	{
+		return files_;
+	}
+
+
+	[[nodiscard]] std::size_t BinarySkipped() const
+	{
+		return binary_;
+	}
+
+
+	// Files truncated while being searched; their hits are dropped
+	[[nodiscard]] std::size_t ChangedSkipped() const
+	{
+		return changed_;
+	}
+
+
+	// Whether the search stopped on reaching kMaxHits
+	[[nodiscard]] bool Truncated() const
+	{
+		return truncated_;
+	}
+
+private:
+	struct Job;
+
+	std::shared_ptr<Job> job_;
+	std::vector<Hit> hits_;
+	std::size_t files_   = 0;
+	std::size_t binary_  = 0;
+	std::size_t changed_ = 0;
+	bool truncated_      = false;
+};
+} // namespace kte
@@ -23,6 +23,7 @@ HelpText::Text()
 		"  C-k -        Unindent region (mark required)\n"
 		"  C-k =        Indent region (mark required)\n"
 		"  C-k ;        Command prompt (:\\ )\n"
+		"  C-k /        Grep open buffers and files (prompt)\n"
 		"  C-k C-d      Kill entire line\n"
 		"  C-k C-q      Quit now (no confirm)\n"
 		"  C-k C-x      Save and quit\n"
@@ -52,12 +53,13 @@ HelpText::Text()
 		"  ESC <        Go to beginning of file\n"
 		"  ESC >        Go to end of file\n"
 		"  ESC m        Toggle mark\n"
-		"  ESC w        Copy region to kill ring (Alt-w)\n"
+		"  ESC w        Copy region to kill ring (Alt-w); in find, whole words\n"
 		"  ESC b        Previous word\n"
 		"  ESC f        Next word\n"
 		"  ESC d        Delete next word (Alt-d)\n"
 		"  ESC BACKSPACE Delete previous word (Alt-Backspace)\n"
 		"  ESC q        Reflow paragraph\n"
+		"  ESC c        Toggle case-insensitive find\n"
 		"\n"
 		"Control keys:\n"
 		"  C-a C-e      Line start / end\n"
@@ -73,6 +75,7 @@ HelpText::Text()
 		"  C-u [digits] Universal argument (repeat count)\n"
 		"\n"
 		"Buffers:\n  +HELP+ is read-only. Press C-k ' to toggle; C-k h restores it.\n"
+		"  +GREP+ lists grep hits; Enter on a hit opens it.\n"
 		"\n"
 		"GUI appearance (command prompt):\n"
 		"  : theme NAME         Set GUI theme (amber, eink, everforest, gruvbox, kanagawa-paper, lcars, nord, old-book, plan9, solarized, weyland-yutani, zenburn)\n"
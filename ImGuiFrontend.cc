@@ -151,9 +151,8 @@ GUIFrontend::Init(Editor &ed)
 				if (!eng->HasHighlighter()) {
 					// Try detect from filename and first line; fall back to cpp or existing filetype
 					std::string first_line;
-					const auto &rows = b->Rows();
-					if (!rows.empty())
-						first_line = static_cast<std::string>(rows[0]);
+					if (b->Nrows() > 0)
+						first_line = b->GetLineString(0);
 					std::string ft = kte::HighlighterRegistry::DetectForPath(
 						b->Filename(), first_line);
 					if (!ft.empty()) {
@@ -312,6 +311,12 @@ GUIFrontend::Step(Editor &ed, bool &running)
 		}
 	}
 
+	// Report background saves and match counts that finished since the last
+	// step, and mapped files changed on disk
+	ed.PollSaves();
+	ed.PollFiles();
+	PollSearch(ed);
+
 	if (ed.QuitRequested()) {
 		running = false;
 	}
@@ -7,7 +7,6 @@
 #include <string>
 
 #include <imgui.h>
-#include <regex>
 
 #include "ImGuiRenderer.h"
 #include "Highlight.h"
@@ -66,12 +65,12 @@ ImGuiRenderer::Draw(Editor &ed)
 	if (!buf) {
 		ImGui::TextUnformatted("[no buffer]");
 	} else {
-		const auto &lines   = buf->Rows();
-		std::size_t cy      = buf->Cury();
-		std::size_t cx      = buf->Curx();
-		const float line_h  = ImGui::GetTextLineHeight();
-		const float row_h   = ImGui::GetTextLineHeightWithSpacing();
-		const float space_w = ImGui::CalcTextSize(" ").x;
+		const std::size_t nrows = buf->Nrows();
+		std::size_t cy          = buf->Cury();
+		std::size_t cx          = buf->Curx();
+		const float line_h      = ImGui::GetTextLineHeight();
+		const float row_h       = ImGui::GetTextLineHeightWithSpacing();
+		const float space_w     = ImGui::CalcTextSize(" ").x;
 
 		// Two-way sync between Buffer::Rowoffs and ImGui scroll position:
 		// - If command layer changed Buffer::Rowoffs since last frame, drive ImGui scroll from it.
@@ -102,7 +101,6 @@ ImGuiRenderer::Draw(Editor &ed)
 		ImVec2 child_window_pos = ImGui::GetWindowPos();
 		float scroll_y          = ImGui::GetScrollY();
 		float scroll_x          = ImGui::GetScrollX();
-		std::size_t rowoffs     = 0; // we render from the first line; scrolling is handled by ImGui
 
 		// Synchronize buffer offsets from ImGui scroll if user scrolled manually
 		bool forced_scroll = false;
@@ -191,8 +189,8 @@ ImGuiRenderer::Draw(Editor &ed)
 
 			// Compute cursor's rendered X position (accounting for tabs)
 			std::size_t cursor_rx = 0;
-			if (cy < lines.size()) {
-				std::string cur_line   = static_cast<std::string>(lines[cy]);
+			if (cy < nrows) {
+				std::string cur_line   = buf->GetLineString(cy);
 				const std::size_t tabw = 8;
 				for (std::size_t i = 0; i < cx && i < cur_line.size(); ++i) {
 					if (cur_line[i] == '\t') {
@@ -238,12 +236,8 @@ ImGuiRenderer::Draw(Editor &ed)
 
 			// Convert to buffer row
 			std::size_t by = static_cast<std::size_t>(by_l);
-			if (by >= lines.size()) {
-				if (!lines.empty())
-					by = lines.size() - 1;
-				else
-					by = 0;
-			}
+			if (by >= nrows)
+				by = nrows - 1;
 
 			// Compute click X position relative to left edge of child window (in pixels)
 			// This gives us the visual offset from the start of displayed content
@@ -256,11 +250,11 @@ ImGuiRenderer::Draw(Editor &ed)
 			std::size_t clicked_rx = static_cast<std::size_t>(visual_x / space_w) + coloffs_now;
 
 			// Empty buffer guard: if there are no lines yet, just move to 0:0
-			if (lines.empty()) {
+			if (nrows == 0) {
 				Execute(ed, CommandId::MoveCursorTo, std::string("0:0"));
 			} else {
 				// Convert rendered column (clicked_rx) to source column accounting for tabs
-				std::string line_clicked = static_cast<std::string>(lines[by]);
+				std::string line_clicked = buf->GetLineString(by);
 				const std::size_t tabw   = 8;
 
 				// Iterate through source columns, computing rendered position, to find closest match
@@ -293,45 +287,37 @@ ImGuiRenderer::Draw(Editor &ed)
 				Execute(ed, CommandId::MoveCursorTo, std::string(tmp));
 			}
 		}
-		for (std::size_t i = rowoffs; i < lines.size(); ++i) {
+		// Only rows inside the scrolled viewport are fetched and drawn; the
+		// cursor is placed so that the rows above and below still take up
+		// their height and the scrollbar spans the whole document.
+		const ImVec2 content_origin = ImGui::GetCursorScreenPos();
+		const float view_h          = ImGui::GetWindowHeight();
+		const std::size_t first_vis = std::min(nrows, static_cast<std::size_t>(ImGui::GetScrollY() / row_h));
+		const std::size_t last_vis  = std::min(nrows, first_vis + static_cast<std::size_t>(view_h / row_h) + 2);
+		ImGui::SetCursorScreenPos(ImVec2(content_origin.x,
+		                                 content_origin.y + static_cast<float>(first_vis) * row_h));
+		// Search hits for the same rows
+		const bool search_mode = ed.SearchActive() && !ed.SearchQuery().empty();
+		if (search_mode) {
+			const bool regex = ed.PromptActive() && (
+				                   ed.CurrentPromptKind() == Editor::PromptKind::RegexSearch ||
+				                   ed.CurrentPromptKind() == Editor::PromptKind::RegexReplaceFind);
+			buf->SearchHighlights().PrefetchViewport(*buf, first_vis, last_vis - first_vis, buf->Version(),
+			                                         ed.SearchQuery(), regex, ed.FindOptions());
+		}
+		for (std::size_t i = first_vis; i < last_vis; ++i) {
 			// Capture the screen position before drawing the line
 			ImVec2 line_pos  = ImGui::GetCursorScreenPos();
-			std::string line = static_cast<std::string>(lines[i]);
+			std::string line = buf->GetLineString(i);
 
 			// Expand tabs to spaces with width=8 and apply horizontal scroll offset
 			const std::size_t tabw = 8;
 			std::string expanded;
 			expanded.reserve(line.size() + 16);
 			std::size_t rx_abs_draw = 0; // rendered column for drawing
-			// Compute search highlight ranges for this line in source indices
-			bool search_mode = ed.SearchActive() && !ed.SearchQuery().empty();
-			std::vector<std::pair<std::size_t, std::size_t> > hl_src_ranges;
-			if (search_mode) {
-				// If we're in RegexSearch or RegexReplaceFind mode, compute ranges using regex; otherwise plain substring
-				if (ed.PromptActive() && (
-					    ed.CurrentPromptKind() == Editor::PromptKind::RegexSearch || ed.
-					    CurrentPromptKind() == Editor::PromptKind::RegexReplaceFind)) {
-					try {
-						std::regex rx(ed.SearchQuery());
-						for (auto it = std::sregex_iterator(line.begin(), line.end(), rx);
-						     it != std::sregex_iterator(); ++it) {
-							const auto &m  = *it;
-							std::size_t sx = static_cast<std::size_t>(m.position());
-							std::size_t ex = sx + static_cast<std::size_t>(m.length());
-							hl_src_ranges.emplace_back(sx, ex);
-						}
-					} catch (const std::regex_error &) {
-						// ignore invalid patterns here; status line already shows the error
-					}
-				} else {
-					const std::string &q = ed.SearchQuery();
-					std::size_t pos      = 0;
-					while (!q.empty() && (pos = line.find(q, pos)) != std::string::npos) {
-						hl_src_ranges.emplace_back(pos, pos + q.size());
-						pos += q.size();
-					}
-				}
-			}
+			// Search hits on this line, [start, end) in source indices
+			static const std::vector<std::pair<std::size_t, std::size_t> > no_hits;
+			const auto &hl_src_ranges = search_mode ? buf->SearchHighlights().Hits(*buf, i) : no_hits;
 			auto src_to_rx = [&](std::size_t upto_src_exclusive) -> std::size_t {
 				std::size_t rx = 0;
 				std::size_t s  = 0;
@@ -385,8 +371,6 @@ ImGuiRenderer::Draw(Editor &ed)
 
 			// Draw syntax-colored runs (text above background highlights)
 			if (buf->SyntaxEnabled() && buf->Highlighter() && buf->Highlighter()->HasHighlighter()) {
-				kte::LineHighlight lh = buf->Highlighter()->GetLine(
-					*buf, static_cast<int>(i), buf->Version());
 				// Sanitize spans defensively: clamp to [0, line.size()], ensure end>=start, drop empties
 				struct SSpan {
 					std::size_t s;
@@ -394,21 +378,25 @@ ImGuiRenderer::Draw(Editor &ed)
 					kte::TokenKind k;
 				};
 				std::vector<SSpan> spans;
-				spans.reserve(lh.spans.size());
 				const std::size_t line_len = line.size();
-				for (const auto &sp: lh.spans) {
-					int s_raw = sp.col_start;
-					int e_raw = sp.col_end;
-					if (e_raw < s_raw)
-						std::swap(e_raw, s_raw);
-					std::size_t s = static_cast<std::size_t>(std::max(
-						0, std::min(s_raw, static_cast<int>(line_len))));
-					std::size_t e = static_cast<std::size_t>(std::max(
-						static_cast<int>(s), std::min(e_raw, static_cast<int>(line_len))));
-					if (e <= s)
-						continue;
-					spans.push_back(SSpan{s, e, sp.kind});
-				}
+				buf->Highlighter()->WithLine(
+					*buf, static_cast<int>(i), buf->Version(),
+					[&](const std::vector<kte::HighlightSpan> &line_spans) {
+						spans.reserve(line_spans.size());
+						for (const auto &sp: line_spans) {
+							int s_raw = sp.col_start;
+							int e_raw = sp.col_end;
+							if (e_raw < s_raw)
+								std::swap(e_raw, s_raw);
+							std::size_t s = static_cast<std::size_t>(std::max(
+								0, std::min(s_raw, static_cast<int>(line_len))));
+							std::size_t e = static_cast<std::size_t>(std::max(
+								static_cast<int>(s), std::min(e_raw, static_cast<int>(line_len))));
+							if (e <= s)
+								continue;
+							spans.push_back(SSpan{s, e, sp.kind});
+						}
+					});
 				std::sort(spans.begin(), spans.end(), [](const SSpan &a, const SSpan &b) {
 					return a.s < b.s;
 				});
@@ -489,6 +477,9 @@ ImGuiRenderer::Draw(Editor &ed)
 				ImGui::GetWindowDrawList()->AddRectFilled(p0, p1, col);
 			}
 		}
+		ImGui::SetCursorScreenPos(ImVec2(content_origin.x,
+		                                 content_origin.y + static_cast<float>(nrows) * row_h));
+		ImGui::Dummy(ImVec2(0.0f, 0.0f));
 		ImGui::EndChild();
 
 		// Status bar spanning full width
@@ -630,7 +621,7 @@ ImGuiRenderer::Draw(Editor &ed)
 				left += " *";
 			// Append total line count as "<n>L"
 			{
-				unsigned long lcount = static_cast<unsigned long>(buf->Rows().size());
+				unsigned long lcount = static_cast<unsigned long>(buf->Nrows());
 				left += " ";
 				left += std::to_string(lcount);
 				left += "L";
@@ -114,6 +114,9 @@ KLookupKCommand(const int ascii_key, const bool ctrl, CommandId &out) -> bool
 	case ';':
 		out = CommandId::CommandPromptStart; // C-k ; : generic command prompt
 		return true;
+	case '/':
+		out = CommandId::GrepStart; // C-k / : grep open buffers and files
+		return true;
 	default:
 		break;
 	}
@@ -214,6 +217,9 @@ KLookupEscCommand(const int ascii_key, CommandId &out) -> bool
 	case 'q':
 		out = CommandId::ReflowParagraph; // Esc q (reflow paragraph)
 		return true;
+	case 'c':
+		out = CommandId::ToggleSearchCase; // Esc c (case-insensitive find)
+		return true;
 	default:
 		break;
 	}
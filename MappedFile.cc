@@ -0,0 +1,222 @@
+#include "MappedFile.h"
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+
+#if defined(__unix__) || defined(__APPLE__)
+#  define KTE_HAVE_MMAP 1
+#  include <fcntl.h>
+#  include <signal.h>
+#  include <sys/mman.h>
+#  include <sys/stat.h>
+#  include <unistd.h>
+#endif
+
+
+namespace kte {
+#if defined(KTE_HAVE_MMAP)
+static FileStamp
+stamp_from(const struct stat &st)
+{
+	FileStamp s;
+	s.valid = true;
+	s.dev   = static_cast<std::uint64_t>(st.st_dev);
+	s.ino   = static_cast<std::uint64_t>(st.st_ino);
+	s.size  = static_cast<std::uint64_t>(st.st_size);
+#  if defined(__APPLE__)
+	s.mtime_ns = static_cast<std::int64_t>(st.st_mtimespec.tv_sec) * 1000000000 + st.st_mtimespec.tv_nsec;
+#  else
+	s.mtime_ns = static_cast<std::int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+#  endif
+	return s;
+}
+#endif
+
+
+#if defined(KTE_HAVE_MMAP)
+// The live mappings and the SIGBUS handler that repairs them. The handler
+// only reads the slots, which are lock-free atomics, and makes one mmap
+// call, so it is safe to run on whichever thread faulted.
+struct MapGuard {
+	static constexpr std::size_t kSlots = 1024;
+
+	static std::array<std::atomic<MappedFile *>, kSlots> slots;
+	static struct sigaction previous;
+	static std::uintptr_t page_size;
+
+
+	static void
+	install()
+	{
+		static std::once_flag once;
+		std::call_once(once, [] {
+			page_size = static_cast<std::uintptr_t>(::sysconf(_SC_PAGESIZE));
+			struct sigaction sa{};
+			sa.sa_sigaction = on_sigbus;
+			sa.sa_flags     = SA_SIGINFO;
+			sigemptyset(&sa.sa_mask);
+			::sigaction(SIGBUS, &sa, &previous);
+		});
+	}
+
+
+	// Take a slot for mf; false when every slot is in use
+	static bool
+	add(MappedFile *mf)
+	{
+		install();
+		for (auto &slot: slots) {
+			MappedFile *expected = nullptr;
+			if (slot.compare_exchange_strong(expected, mf, std::memory_order_acq_rel))
+				return true;
+		}
+		return false;
+	}
+
+
+	static void
+	remove(const MappedFile *mf)
+	{
+		for (auto &slot: slots) {
+			if (slot.load(std::memory_order_relaxed) == mf) {
+				slot.store(nullptr, std::memory_order_release);
+				return;
+			}
+		}
+	}
+
+
+	// A truncation only removes pages from the end of the file, so every page
+	// of the mapping from the faulting one on is gone: back them with zero
+	// pages and return, and the faulting read runs again and completes.
+	static void
+	on_sigbus(int sig, siginfo_t *info, void *uctx)
+	{
+		const auto addr = reinterpret_cast<std::uintptr_t>(info->si_addr);
+		for (auto &slot: slots) {
+			MappedFile *mf = slot.load(std::memory_order_acquire);
+			if (!mf)
+				continue;
+			const auto begin = reinterpret_cast<std::uintptr_t>(mf->data_);
+			const auto end   = begin + mf->size_;
+			if (addr < begin || addr >= end)
+				continue;
+			const std::uintptr_t page = addr & ~(page_size - 1);
+			void *got                 = ::mmap(reinterpret_cast<void *>(page), end - page, PROT_READ,
+			                                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0);
+			if (got == MAP_FAILED)
+				break;
+			mf->damaged_.store(true, std::memory_order_relaxed);
+			return;
+		}
+		// Not a mapping of ours: hand the fault to whoever had SIGBUS before
+		if (previous.sa_flags & SA_SIGINFO) {
+			previous.sa_sigaction(sig, info, uctx);
+			return;
+		}
+		if (previous.sa_handler != SIG_DFL && previous.sa_handler != SIG_IGN) {
+			previous.sa_handler(sig);
+			return;
+		}
+		// Returning re-runs the faulting access under the default action
+		::signal(SIGBUS, SIG_DFL);
+	}
+};
+
+
+std::array<std::atomic<MappedFile *>, MapGuard::kSlots> MapGuard::slots{};
+struct sigaction MapGuard::previous{};
+std::uintptr_t MapGuard::page_size = 4096;
+#endif
+
+
+FileStamp
+StatFile(const std::string &path)
+{
+#if defined(KTE_HAVE_MMAP)
+	struct stat st{};
+	if (::stat(path.c_str(), &st) != 0)
+		return {};
+	return stamp_from(st);
+#else
+	(void) path;
+	return {};
+#endif
+}
+
+
+std::shared_ptr<const MappedFile>
+MappedFile::Open(const std::string &path, std::string &err)
+{
+	std::shared_ptr<MappedFile> mf(new MappedFile());
+#if defined(KTE_HAVE_MMAP)
+	const int fd = ::open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		err = "Failed to open file: " + path + ". Error: " + std::string(std::strerror(errno));
+		return nullptr;
+	}
+	struct stat st{};
+	if (::fstat(fd, &st) != 0) {
+		err = "Failed to stat file: " + path + ". Error: " + std::string(std::strerror(errno));
+		::close(fd);
+		return nullptr;
+	}
+	mf->stamp_             = stamp_from(st);
+	const std::size_t size = static_cast<std::size_t>(st.st_size);
+	if (S_ISREG(st.st_mode) && size >= kMapThreshold) {
+		void *addr = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if (addr != MAP_FAILED) {
+#  if defined(POSIX_MADV_SEQUENTIAL)
+			// Line indexing walks the whole file once right after open
+			::posix_madvise(addr, size, POSIX_MADV_SEQUENTIAL);
+#  endif
+			mf->data_   = static_cast<const char *>(addr);
+			mf->size_   = size;
+			mf->mapped_ = true;
+			if (MapGuard::add(mf.get())) {
+				::close(fd);
+				return mf;
+			}
+			// No slot to guard it with: read it instead
+			::munmap(addr, size);
+			mf->data_   = nullptr;
+			mf->size_   = 0;
+			mf->mapped_ = false;
+		}
+		// Fall through to a plain read (e.g. filesystems without mmap support)
+	}
+	::close(fd);
+#endif
+
+	std::ifstream in(path, std::ios::in | std::ios::binary);
+	if (!in) {
+		err = "Failed to open file: " + path;
+		return nullptr;
+	}
+	in.seekg(0, std::ios::end);
+	auto sz = in.tellg();
+	if (sz > 0) {
+		mf->copy_.resize(static_cast<std::size_t>(sz));
+		in.seekg(0, std::ios::beg);
+		in.read(mf->copy_.data(), static_cast<std::streamsize>(mf->copy_.size()));
+	}
+	mf->data_ = mf->copy_.data();
+	mf->size_ = mf->copy_.size();
+	return mf;
+}
+
+
+MappedFile::~MappedFile()
+{
+#if defined(KTE_HAVE_MMAP)
+	if (mapped_) {
+		MapGuard::remove(this);
+		::munmap(const_cast<char *>(data_), size_);
+	}
+#endif
+}
+} // namespace kte
@@ -0,0 +1,107 @@
+// MappedFile.h - read-only file contents, memory-mapped when possible
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace kte {
+// Identity of a file on disk, used to notice when it changed underneath us.
+struct FileStamp {
+	bool valid{false};
+	std::uint64_t dev{0};
+	std::uint64_t ino{0};
+	std::uint64_t size{0};
+	std::int64_t mtime_ns{0};
+
+	[[nodiscard]] bool SameFile(const FileStamp &o) const
+	{
+		return valid && o.valid && dev == o.dev && ino == o.ino;
+	}
+
+
+	bool operator==(const FileStamp &o) const
+	{
+		return valid == o.valid && dev == o.dev && ino == o.ino && size == o.size && mtime_ns == o.mtime_ns;
+	}
+
+
+	bool operator!=(const FileStamp &o) const
+	{
+		return !(*this == o);
+	}
+};
+
+// Stat path; returns an invalid stamp if it does not exist or cannot be read.
+FileStamp StatFile(const std::string &path);
+
+
+// Immutable bytes of a file. Files at or above kMapThreshold are mapped
+// read-only (MAP_PRIVATE) so opening them costs no copy; smaller files, and
+// platforms or filesystems where mmap fails, are read into memory instead.
+//
+// A mapping reflects the file as it is on disk: if another process truncates
+// or rewrites the file in place, the mapped bytes change too. Reading a page
+// that a truncation cut off would raise SIGBUS, so every mapping is
+// registered with a SIGBUS handler that backs the lost pages with zeros,
+// lets the read complete and marks the file Damaged(). Callers poll
+// Damaged(), and compare Stamp() against StatFile() to notice an in-place
+// rewrite, before trusting the contents again.
+class MappedFile {
+public:
+	static constexpr std::size_t kMapThreshold = 256 * 1024;
+
+	static std::shared_ptr<const MappedFile> Open(const std::string &path, std::string &err);
+
+	~MappedFile();
+
+	MappedFile(const MappedFile &) = delete;
+
+	MappedFile &operator=(const MappedFile &) = delete;
+
+
+	[[nodiscard]] const char *Data() const
+	{
+		return data_;
+	}
+
+
+	[[nodiscard]] std::size_t Size() const
+	{
+		return size_;
+	}
+
+
+	[[nodiscard]] bool IsMapped() const
+	{
+		return mapped_;
+	}
+
+
+	[[nodiscard]] const FileStamp &Stamp() const
+	{
+		return stamp_;
+	}
+
+
+	// Whether a read hit pages the file no longer has; they now read as zeros
+	[[nodiscard]] bool Damaged() const
+	{
+		return damaged_.load(std::memory_order_relaxed);
+	}
+
+private:
+	MappedFile() = default;
+
+	friend struct MapGuard;
+
+	const char *data_ = nullptr;
+	std::size_t size_ = 0;
+	bool mapped_      = false;
+	std::string copy_; // backing store when not mapped
+	FileStamp stamp_;
+	std::atomic<bool> damaged_{false};
+};
+} // namespace kte
@@ -0,0 +1,422 @@
+#include "MatchIndex.h"
+
+#include <algorithm>
+
+#include "BackgroundJob.h"
+#include "Buffer.h"
+#include "ByteScan.h"
+#include "WorkerPool.h"
+
+
+namespace {
+// Bytes Update() scans itself: the whole buffer when it is no larger, else
+// at most this much from the origin while looking for the first match
+constexpr std::size_t kSyncScanBytes = 1u << 20;
+// Rows are scanned in blocks of about this many bytes; the background
+// count checks for cancellation between blocks
+constexpr std::size_t kBlockBytes = 64u << 10;
+// The background count hands rows to the worker pool in ranges of about
+// this many bytes
+constexpr std::size_t kRangeBytes = 4u << 20;
+
+
+// Line row without its trailing newline
+std::string_view
+line_of(const Buffer &buf, const std::size_t row)
+{
+	std::string_view line = buf.GetLineView(row);
+	if (!line.empty() && line.back() == '\n')
+		line.remove_suffix(1);
+	return line;
+}
+
+
+// Whether some proper prefix of s is also a suffix, i.e. whether two
+// occurrences of s can overlap
+bool
+has_border(const std::string &s)
+{
+	std::vector<std::size_t> fail(s.size(), 0);
+	for (std::size_t i = 1, k = 0; i < s.size(); ++i) {
+		while (k > 0 && s[i] != s[k])
+			k = fail[k - 1];
+		if (s[i] == s[k])
+			++k;
+		fail[i] = k;
+	}
+	return !s.empty() && fail.back() > 0;
+}
+
+
+// The runs of ASCII bytes in s. A case-insensitive match of s contains each
+// of them in some case, which is all the trigram index (folding ASCII
+// letters only) can test for.
+std::vector<std::string>
+ascii_runs(const std::string &s)
+{
+	std::vector<std::string> runs(1);
+	for (const char c: s) {
+		if (static_cast<unsigned char>(c) < 0x80)
+			runs.back() += c;
+		else if (!runs.back().empty())
+			runs.emplace_back();
+	}
+	if (runs.back().empty())
+		runs.pop_back();
+	return runs;
+}
+
+
+bool
+row_less(const SearchMatch &m, const std::size_t row)
+{
+	return m.y < row;
+}
+
+
+// Append the matches on one line; rx is null for a literal query, which os
+// searches for
+void
+scan_line(const std::string_view line, const std::size_t y, const std::string &query, OptimizedSearch &os,
+          kte::Regex *rx, std::vector<SearchMatch> &out)
+{
+	if (rx) {
+		std::vector<kte::Regex::Span> spans;
+		rx->FindAll(line, spans);
+		for (const auto &s: spans)
+			out.push_back(SearchMatch{y, s.first, s.second - s.first});
+		return;
+	}
+	for (std::size_t pos = 0, x; (x = os.find_in(line, query, pos)) != std::string::npos;) {
+		out.push_back(SearchMatch{y, x, query.size()});
+		pos = x + query.size();
+	}
+}
+
+
+// Append the matches on rows [lo, hi) of text, copying the rows into block
+void
+scan_rows(const PieceTable &text, const std::size_t lo, const std::size_t hi, const std::string &query,
+          OptimizedSearch &os, kte::Regex *rx, std::vector<SearchMatch> &out, std::string &block)
+{
+	if (lo >= hi)
+		return;
+	const std::size_t b = text.GetLineRange(lo).first;
+	const std::size_t e = text.GetLineRange(hi - 1).second;
+	block.clear();
+	if (e > b) {
+		text.ForEachChunk(b, e - b, [&block](std::string_view chunk) {
+			block.append(chunk);
+			return true;
+		});
+	}
+	std::size_t pos = 0;
+	for (std::size_t y = lo; y < hi; ++y) {
+		const char *nl = pos < block.size()
+			                 ? kte::FindByte(block.data() + pos, block.size() - pos, '\n')
+			                 : nullptr;
+		const std::size_t end = nl ? static_cast<std::size_t>(nl - block.data()) : block.size();
+		scan_line(std::string_view(block.data() + pos, end - pos), y, query, os, rx, out);
+		pos = nl ? end + 1 : block.size();
+	}
+}
+
+
+// End of a block of rows starting at lo that spans about bytes bytes
+std::size_t
+block_end(const PieceTable &text, const std::size_t lo, const std::size_t bytes)
+{
+	const std::size_t start  = text.GetLineRange(lo).first;
+	const std::size_t target = std::min(text.Size(), start + bytes);
+	const std::size_t hi     = text.ByteOffsetToLineCol(target).first + 1;
+	return std::min(std::max(hi, lo + 1), text.LineCount());
+}
+} // namespace
+
+
+// A background count: the worker reads its own snapshot and fills result
+struct MatchIndex::ScanJob {
+	std::shared_ptr<const PieceTable> snapshot;
+	std::vector<std::pair<std::size_t, std::size_t> > ranges; // rows to count
+	std::string query;
+	bool regex = false;
+	kte::Regex rx;
+	SearchOptions opts;
+	std::size_t threads = 0;
+	std::vector<SearchMatch> result;
+	kte::BackgroundJob worker;
+};
+
+
+bool
+MatchIndex::Update(const Buffer &buf, const std::string &query, const bool regex, const std::size_t from_y,
+                   const std::size_t from_x, std::string &err)
+{
+	err.clear();
+	if (query.empty()) {
+		Clear();
+		return true;
+	}
+	if (active_ && regex == regex_ && rows_ == buf.Nrows()) {
+		for (const auto &[lo, hi]: dirty_)
+			rescan(buf, lo, hi);
+		dirty_.clear();
+		if (query == query_)
+			return true;
+		if (!regex_) {
+			// Backspace: a shorter query we narrowed from is still exact
+			while (!history_.empty() && history_.back().first.size() >= query.size()) {
+				auto entry = std::move(history_.back());
+				history_.pop_back();
+				if (entry.first == query) {
+					job_.reset();
+					query_   = query;
+					matches_ = std::move(entry.second);
+					return true;
+				}
+			}
+			if (Complete() && narrow(buf, query))
+				return true;
+		}
+	}
+
+	Clear();
+	regex_ = regex;
+	query_ = query;
+	if (regex_ && !rx_.Compile(query_, err)) {
+		query_.clear();
+		return false;
+	}
+	full_scan(buf, from_y, from_x);
+	rows_   = buf.Nrows();
+	active_ = true;
+	return true;
+}
+
+
+bool
+MatchIndex::Poll()
+{
+	if (!job_ || !job_->worker.Done())
+		return false;
+	job_->worker.Wait();
+	matches_ = std::move(job_->result);
+	job_.reset();
+	return true;
+}
+
+
+void
+MatchIndex::Wait()
+{
+	if (job_)
+		job_->worker.Wait();
+}
+
+
+void
+MatchIndex::Edited(const std::size_t row, const std::size_t old_rows, const std::size_t new_rows)
+{
+	if (!active_)
+		return;
+	if (job_ || old_rows > rows_) {
+		Clear(); // not an edit we can follow; rescan from scratch
+		return;
+	}
+	rows_ = rows_ - old_rows + new_rows;
+	history_.clear();
+
+	// Drop matches on the replaced rows and shift the ones after them
+	auto first = std::lower_bound(matches_.begin(), matches_.end(), row, row_less);
+	auto last  = std::lower_bound(first, matches_.end(), row + old_rows, row_less);
+	first      = matches_.erase(first, last);
+	if (new_rows != old_rows) {
+		for (auto it = first; it != matches_.end(); ++it)
+			it->y = it->y - old_rows + new_rows;
+	}
+
+	// Merge the new rows into the pending ranges, shifting later ones
+	std::size_t lo = row;
+	std::size_t hi = row + new_rows;
+	std::vector<std::pair<std::size_t, std::size_t> > merged;
+	merged.reserve(dirty_.size() + 1);
+	for (const auto &d: dirty_) {
+		if (d.second < row) {
+			merged.push_back(d);
+		} else if (d.first > row + old_rows) {
+			merged.emplace_back(d.first - old_rows + new_rows, d.second - old_rows + new_rows);
+		} else {
+			lo = std::min(lo, d.first);
+			if (d.second > row + old_rows)
+				hi = std::max(hi, d.second - old_rows + new_rows);
+		}
+	}
+	if (lo < hi)
+		merged.emplace_back(lo, hi);
+	std::sort(merged.begin(), merged.end());
+	dirty_ = std::move(merged);
+}
+
+
+void
+MatchIndex::SetOptions(const SearchOptions &opts)
+{
+	if (opts == opts_)
+		return;
+	Clear();
+	opts_ = opts;
+	search_.SetOptions(opts);
+}
+
+
+void
+MatchIndex::Clear()
+{
+	job_.reset();
+	active_ = false;
+	query_.clear();
+	matches_.clear();
+	rows_ = 0;
+	dirty_.clear();
+	history_.clear();
+}
+
+
+void
+MatchIndex::full_scan(const Buffer &buf, std::size_t from_y, const std::size_t from_x)
+{
+	matches_.clear();
+	const PieceTable &content = buf.Content();
+	const std::size_t nrows   = buf.Nrows();
+	kte::Regex *rx            = regex_ ? &rx_ : nullptr;
+	if (nrows == 0)
+		return;
+
+	// Rows that can hold a match: those the trigram index lets through, or
+	// all of them
+	std::vector<std::pair<std::size_t, std::size_t> > ranges;
+	const std::vector<std::string> literal = opts_.ignore_case ? ascii_runs(query_) : std::vector<std::string>{query_};
+	if (!buf.Trigrams().Candidates(content, regex_ ? rx_.RequiredLiterals() : literal, ranges))
+		ranges.assign(1, {0, nrows});
+	std::size_t bytes = 0;
+	for (const auto &[lo, hi]: ranges)
+		bytes += content.GetLineRange(hi - 1).second - content.GetLineRange(lo).first;
+	if (bytes <= kSyncScanBytes) {
+		for (const auto &[lo, hi]: ranges)
+			scan_rows(content, lo, hi, query_, search_, rx, matches_, block_);
+		return;
+	}
+
+	// Scan from the origin until the first match at or after it
+	from_y              = std::min(from_y, nrows - 1);
+	std::size_t scanned = 0;
+	bool found          = false;
+	for (auto r = ranges.begin(); r != ranges.end() && !found && scanned < kSyncScanBytes; ++r) {
+		for (std::size_t y = std::max(r->first, from_y); y < r->second && !found && scanned < kSyncScanBytes;) {
+			const std::size_t hi = std::min(block_end(content, y, kBlockBytes), r->second);
+			scan_rows(content, y, hi, query_, search_, rx, matches_, block_);
+			scanned += block_.size();
+			y     = hi;
+			found = std::any_of(matches_.begin(), matches_.end(), [&](const SearchMatch &m) {
+				return m.y > from_y || m.x >= from_x;
+			});
+		}
+	}
+
+	// Count the candidate rows in the background
+	auto job      = std::make_shared<ScanJob>();
+	job->snapshot = content.Snapshot();
+	job->ranges   = std::move(ranges);
+	job->query    = query_;
+	job->regex    = regex_;
+	job->rx       = rx_;
+	job->opts     = opts_;
+	job->threads  = threads_;
+	ScanJob *j    = job.get();
+	job->worker.Start([j] {
+		const PieceTable &text = *j->snapshot;
+		// Line-aligned row ranges, counted in parallel and joined in order
+		std::vector<std::pair<std::size_t, std::size_t> > parts;
+		for (const auto &[lo, hi]: j->ranges) {
+			for (std::size_t y = lo; y < hi;) {
+				const std::size_t end = std::min(block_end(text, y, kRangeBytes), hi);
+				parts.emplace_back(y, end);
+				y = end;
+			}
+		}
+		std::vector<std::vector<SearchMatch> > found(parts.size());
+		kte::WorkerPool::Shared().Run(parts.size(), [j, &text, &parts, &found](const std::size_t i) {
+			// Neither a Regex nor an OptimizedSearch may be shared
+			// between threads
+			kte::Regex rx = j->rx;
+			OptimizedSearch os;
+			os.SetOptions(j->opts);
+			std::string block;
+			for (std::size_t y = parts[i].first; y < parts[i].second;) {
+				if (j->worker.Cancelled())
+					return;
+				const std::size_t hi = std::min(block_end(text, y, kBlockBytes), parts[i].second);
+				scan_rows(text, y, hi, j->query, os, j->regex ? &rx : nullptr, found[i], block);
+				y = hi;
+			}
+		}, j->threads);
+		for (auto &part: found)
+			j->result.insert(j->result.end(), part.begin(), part.end());
+	});
+	job_ = std::move(job);
+}
+
+
+bool
+MatchIndex::narrow(const Buffer &buf, const std::string &query)
+{
+	if (query.size() <= query_.size() || query.compare(0, query_.size(), query_) != 0)
+		return false;
+	// Non-overlapping matches of a query that cannot overlap itself are all
+	// of its occurrences, so every match of the longer query is among them.
+	// Not so for whole words: the longer query may end a word where the
+	// shorter one did not.
+	if (opts_.whole_word)
+		return false;
+	const bool fold = opts_.ignore_case;
+	if (has_border(fold ? kte::FoldCase(query_) : query_))
+		return false;
+	const std::string want = fold ? kte::FoldCase(query) : std::string();
+	std::vector<SearchMatch> kept;
+	std::string_view line;
+	std::size_t row = 0;
+	bool have_row   = false;
+	std::size_t end = 0; // matches on a row must not overlap
+	for (const SearchMatch &m: matches_) {
+		if (!have_row || m.y != row) {
+			line     = line_of(buf, m.y);
+			row      = m.y;
+			have_row = true;
+			end      = 0;
+		}
+		const std::string_view at = line.substr(m.x, query.size());
+		if (m.x < end || (fold ? kte::FoldCase(at) != want : at != query))
+			continue;
+		kept.push_back(SearchMatch{m.y, m.x, query.size()});
+		end = m.x + query.size();
+	}
+	history_.emplace_back(std::move(query_), std::move(matches_));
+	query_   = query;
+	matches_ = std::move(kept);
+	return true;
+}
+
+
+void
+MatchIndex::rescan(const Buffer &buf, const std::size_t lo, std::size_t hi)
+{
+	hi = std::min(hi, buf.Nrows());
+	if (lo >= hi)
+		return;
+	std::vector<SearchMatch> fresh;
+	scan_rows(buf.Content(), lo, hi, query_, search_, regex_ ? &rx_ : nullptr, fresh, block_);
+	auto first = std::lower_bound(matches_.begin(), matches_.end(), lo, row_less);
+	auto last  = std::lower_bound(first, matches_.end(), hi, row_less);
+	first      = matches_.erase(first, last);
+	matches_.insert(first, fresh.begin(), fresh.end());
+}
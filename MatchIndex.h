@@ -0,0 +1,131 @@
+// MatchIndex.h - per-buffer search matches kept current across edits
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "OptimizedSearch.h"
+#include "Regex.h"
+
+class Buffer;
+
+
+struct SearchMatch {
+	std::size_t y;
+	std::size_t x;
+	std::size_t len;
+};
+
+
+// The matches of the current find query in one buffer, in document order.
+// Literal queries follow the non-overlapping per-line semantics of
+// OptimizedSearch::find_all, under the SearchOptions given to SetOptions();
+// regex queries those of kte::Regex::FindAll.
+//
+// Update() does as little work as the change allows:
+// - Typing another character onto a literal query re-checks only the
+//   existing matches, and backspacing restores the previous result.
+// - Buffer edits are reported through Edited() by the Buffer's raw editing
+//   APIs. They drop and shift matches right away, and only the affected rows
+//   are rescanned on the next Update().
+// - A new query or a regex pattern change needs a full scan. Small buffers
+//   are scanned on the spot. In larger ones Update() scans forward from the
+//   given origin only until it finds the first match there, and a worker
+//   counts the whole buffer against a snapshot, splitting the rows among
+//   kte::WorkerPool::Shared(). Until Poll() adopts its result, Matches()
+//   holds just that window and Complete() is false.
+// - Either way, a full scan covers only the rows the buffer's TrigramIndex
+//   lets through for the query (or for the regex's required literals).
+class MatchIndex {
+public:
+	// Bring the matches up to date for query against buf, starting a full
+	// scan at row from_y, column from_x if one is needed. On a regex syntax
+	// error returns false, sets err and leaves no matches.
+	bool Update(const Buffer &buf, const std::string &query, bool regex, std::size_t from_y,
+	            std::size_t from_x, std::string &err);
+
+	[[nodiscard]] const std::vector<SearchMatch> &Matches() const
+	{
+		return matches_;
+	}
+
+
+	// False while a background count is running; Matches() then covers only
+	// the rows scanned from the origin
+	[[nodiscard]] bool Complete() const
+	{
+		return !job_;
+	}
+
+
+	[[nodiscard]] bool IsRegex() const
+	{
+		return regex_;
+	}
+
+
+	// Options for literal queries; changing them forgets the matches
+	void SetOptions(const SearchOptions &opts);
+
+	[[nodiscard]] const SearchOptions &Options() const
+	{
+		return opts_;
+	}
+
+
+	// Adopt a finished background count, returning true once when it does
+	bool Poll();
+
+	// Block until a running background count has finished (Poll still
+	// adopts it)
+	void Wait();
+
+	// Rows [row, row + old_rows) were replaced by rows [row, row + new_rows).
+	// An edit during a background count cancels it and forgets the query.
+	void Edited(std::size_t row, std::size_t old_rows, std::size_t new_rows);
+
+	// Forget everything, e.g. when the buffer's contents are replaced
+	void Clear();
+
+	// Threads a background count may use: 0 for the shared pool plus the
+	// count's own thread, 1 to count on that thread alone
+	void SetThreads(const std::size_t threads)
+	{
+		threads_ = threads;
+	}
+
+
+private:
+	struct ScanJob;
+
+	void full_scan(const Buffer &buf, std::size_t from_y, std::size_t from_x);
+
+	// Narrow matches_ for query_ + suffix; false if that is not exact
+	bool narrow(const Buffer &buf, const std::string &query);
+
+	// Replace the matches on rows [lo, hi) with a fresh scan of those rows
+	void rescan(const Buffer &buf, std::size_t lo, std::size_t hi);
+
+	bool active_ = false;
+	bool regex_  = false;
+	std::string query_;
+	kte::Regex rx_;
+	SearchOptions opts_;
+	OptimizedSearch search_; // literal scans on this thread
+	std::vector<SearchMatch> matches_;
+	// Row count the matches were computed against; a mismatch means an edit
+	// was not reported, and forces a full scan
+	std::size_t rows_ = 0;
+	// Rows edited since the last Update, as merged [lo, hi) ranges
+	std::vector<std::pair<std::size_t, std::size_t> > dirty_;
+	// Results for shorter literal queries, restored on backspace
+	std::vector<std::pair<std::string, std::vector<SearchMatch> > > history_;
+	// Background count in flight, if any
+	std::shared_ptr<ScanJob> job_;
+	std::size_t threads_ = 0;
+	std::string block_; // scratch for scanned rows
+};
@@ -1,79 +1,292 @@
 #include "OptimizedSearch.h"
 
 #include <algorithm>
+#include <string_view>
 
+#include "ByteScan.h"
+#include "PieceTable.h"
+#include "WorkerPool.h"
 
-void
-OptimizedSearch::build_bad_char(const std::string &pattern)
+
+namespace {
+// find_all(PieceTable) searches documents at least this large in parallel
+constexpr std::size_t kParallelBytes = 8u << 20;
+// Smallest range a parallel search hands to one thread
+constexpr std::size_t kMinRangeBytes = 1u << 20;
+
+
+// -1 stands for the start or end of the text
+bool
+is_word_byte(const int c)
 {
-	if (pattern == last_pat_)
-		return;
-	last_pat_ = pattern;
-	std::fill(bad_char_.begin(), bad_char_.end(), -1);
-	for (std::size_t i = 0; i < pattern.size(); ++i) {
-		bad_char_[static_cast<unsigned char>(pattern[i])] = static_cast<int>(i);
+	return c >= 0x80 || c == '_' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+
+// Whether a match of pattern between bytes before and after stands as a
+// whole word
+bool
+word_bounded(const std::string &pattern, const int before, const int after)
+{
+	return !(is_word_byte(static_cast<unsigned char>(pattern.front())) && is_word_byte(before)) &&
+	       !(is_word_byte(static_cast<unsigned char>(pattern.back())) && is_word_byte(after));
+}
+
+
+int
+byte_at(const PieceTable &text, const std::size_t off)
+{
+	int c = -1;
+	if (off < text.Size()) {
+		text.ForEachChunk(off, 1, [&c](const std::string_view chunk) {
+			c = static_cast<unsigned char>(chunk.front());
+			return false;
+		});
+	}
+	return c;
+}
+} // namespace
+
+
+const char *
+OptimizedSearch::find_raw(const char *data, const std::size_t len, const std::string &pattern)
+{
+	if (!opts_.ignore_case)
+		return kte::FindSubstring(data, len, pattern.data(), pattern.size());
+	if (pattern != folded_for_ || folded_.text.empty()) {
+		folded_for_ = pattern;
+		folded_     = kte::FoldNeedle(pattern);
 	}
+	return kte::FindSubstringFolded(data, len, folded_);
 }
 
 
 std::size_t
-OptimizedSearch::find_first(const std::string &text, const std::string &pattern, std::size_t start)
+OptimizedSearch::find_in(const std::string_view text, const std::string &pattern, std::size_t start)
 {
 	const std::size_t n = text.size();
 	const std::size_t m = pattern.size();
-	if (m == 0)
-		return start <= n ? start : std::string::npos;
-	if (m > n || start >= n)
-		return std::string::npos;
-	build_bad_char(pattern);
-	std::size_t s = start;
-	while (s <= n - m) {
-		std::size_t j = m;
-		while (j > 0 && pattern[j - 1] == text[s + j - 1]) {
-			--j;
-		}
-		if (j == 0) {
-			return s; // match found
-		}
-		unsigned char badc = static_cast<unsigned char>(text[s + j - 1]);
-		int bcidx          = bad_char_[badc];
-		std::size_t shift  = (j - 1 > static_cast<std::size_t>(bcidx))
-			                    ? (j - 1 - static_cast<std::size_t>(bcidx))
-			                    : 1;
-		s += shift;
+	while (m > 0 && start < n && m <= n - start) {
+		const char *hit = find_raw(text.data() + start, n - start, pattern);
+		if (!hit)
+			break;
+		const auto at = static_cast<std::size_t>(hit - text.data());
+		if (!opts_.whole_word ||
+		    word_bounded(pattern, at > 0 ? static_cast<unsigned char>(text[at - 1]) : -1,
+		                 at + m < n ? static_cast<unsigned char>(text[at + m]) : -1))
+			return at;
+		start = at + 1;
 	}
 	return std::string::npos;
 }
 
 
+std::size_t
+OptimizedSearch::find_first(const std::string &text, const std::string &pattern, std::size_t start)
+{
+	if (pattern.empty())
+		return start <= text.size() ? start : std::string::npos;
+	return find_in(text, pattern, start);
+}
+
+
 std::vector<std::size_t>
 OptimizedSearch::find_all(const std::string &text, const std::string &pattern, std::size_t start)
 {
 	std::vector<std::size_t> res;
-	const std::size_t n = text.size();
+	for (std::size_t at; (at = find_in(text, pattern, start)) != std::string::npos;) {
+		res.push_back(at);
+		start = at + pattern.size(); // non-overlapping
+	}
+	return res;
+}
+
+
+template<typename Emit>
+void
+OptimizedSearch::scan_chunks(const PieceTable &text, const std::string &pattern, std::size_t start,
+                             std::size_t end, Emit &&emit)
+{
 	const std::size_t m = pattern.size();
+	end                 = std::min(end, text.Size());
+	if (m == 0 || start >= end)
+		return;
+	const std::size_t keep = m - 1;
+	// Matches starting before end may run up to keep bytes past it
+	const std::size_t limit = std::min(text.Size(), end + keep);
+	std::size_t next       = start; // earliest offset the next match may start at
+	std::size_t chunk_off  = start;
+	std::size_t win_off    = start; // document offset of window_[0]
+	// Whether the match at view[at], document offset doc_at, stands as a
+	// whole word; neighbours outside view are read from text
+	auto whole = [&](const std::string_view view, const std::size_t at, const std::size_t doc_at) {
+		if (!opts_.whole_word)
+			return true;
+		const int before = at > 0 ? static_cast<unsigned char>(view[at - 1])
+		                   : doc_at > 0 ? byte_at(text, doc_at - 1) : -1;
+		const int after = at + m < view.size() ? static_cast<unsigned char>(view[at + m]) : byte_at(text, doc_at + m);
+		return word_bounded(pattern, before, after);
+	};
+	window_.clear();
+	text.ForEachChunk(start, limit - start, [&](std::string_view chunk) {
+		// Matches starting in the carried tail and ending in this chunk
+		if (!window_.empty()) {
+			const std::size_t tail = window_.size();
+			window_.append(chunk.substr(0, keep));
+			std::size_t from = next > win_off ? next - win_off : 0;
+			while (from < tail) {
+				const char *hit = find_raw(window_.data() + from, window_.size() - from, pattern);
+				if (!hit)
+					break;
+				const auto at = static_cast<std::size_t>(hit - window_.data());
+				if (at >= tail)
+					break; // lies within the chunk; found below
+				if (win_off + at >= end)
+					return false;
+				if (!whole(window_, at, win_off + at)) {
+					from = at + 1;
+					continue;
+				}
+				if (!emit(win_off + at))
+					return false;
+				next = win_off + at + m;
+				from = at + m;
+			}
+			window_.resize(tail);
+		}
+
+		std::size_t from = next > chunk_off ? next - chunk_off : 0;
+		while (from + m <= chunk.size()) {
+			const char *hit = find_raw(chunk.data() + from, chunk.size() - from, pattern);
+			if (!hit)
+				break;
+			const auto at = static_cast<std::size_t>(hit - chunk.data());
+			if (chunk_off + at >= end)
+				return false;
+			if (!whole(chunk, at, chunk_off + at)) {
+				from = at + 1;
+				continue;
+			}
+			if (!emit(chunk_off + at))
+				return false;
+			next = chunk_off + at + m;
+			from = at + m;
+		}
+
+		// Carry the last keep bytes of the document so far into the next chunk
+		if (chunk.size() >= keep) {
+			window_.assign(chunk.substr(chunk.size() - keep));
+		} else {
+			window_.append(chunk);
+			if (window_.size() > keep)
+				window_.erase(0, window_.size() - keep);
+		}
+		chunk_off += chunk.size();
+		win_off = chunk_off - window_.size();
+		return true;
+	});
+}
+
+
+std::size_t
+OptimizedSearch::find_first(const PieceTable &text, const std::string &pattern, std::size_t start)
+{
+	if (pattern.empty())
+		return start <= text.Size() ? start : std::string::npos;
+	std::size_t found = std::string::npos;
+	scan_chunks(text, pattern, start, text.Size(), [&found](std::size_t at) {
+		found = at;
+		return false;
+	});
+	return found;
+}
+
+
+std::vector<std::size_t>
+OptimizedSearch::find_all(const PieceTable &text, const std::string &pattern, std::size_t start)
+{
+	const std::size_t width = threads_ ? threads_ : kte::WorkerPool::Shared().Size() + 1;
+	if (width > 1 && start < text.Size() && text.Size() - start >= kParallelBytes)
+		return find_all_parallel(text, pattern, start, width);
+	std::vector<std::size_t> res;
+	scan_chunks(text, pattern, start, text.Size(), [&res](std::size_t at) {
+		res.push_back(at);
+		return true;
+	});
+	return res;
+}
+
+
+std::vector<std::size_t>
+OptimizedSearch::find_all_parallel(const PieceTable &text, const std::string &pattern, const std::size_t start,
+                                   const std::size_t width)
+{
+	std::vector<std::size_t> res;
+	const std::size_t size = text.Size();
+	const std::size_t m    = pattern.size();
 	if (m == 0)
 		return res;
-	if (m > n || start >= n)
-		return res;
-	build_bad_char(pattern);
-	std::size_t s = start;
-	while (s <= n - m) {
-		std::size_t j = m;
-		while (j > 0 && pattern[j - 1] == text[s + j - 1]) {
-			--j;
+
+	// Split [start, size) into ranges of about unit bytes, a few per thread
+	// so uneven match density evens out. A boundary moves up to the next
+	// piece boundary when one is close; a single large piece (a file just
+	// opened) is split at plain byte offsets.
+	const std::size_t unit = std::max(kMinRangeBytes, (size - start) / (width * 4));
+	std::vector<std::size_t> bounds{start};
+	std::size_t target = start + unit;
+	std::size_t off    = start; // end of the chunks visited so far
+	text.ForEachChunk(start, size - start, [&](std::string_view chunk) {
+		off += chunk.size();
+		while (target <= off && target < size) {
+			const std::size_t b = off - target < unit / 8 && off < size ? off : target;
+			bounds.push_back(b);
+			target = b + unit;
 		}
-		if (j == 0) {
-			res.push_back(s);
-			s += m; // non-overlapping
-			continue;
+		return target < size;
+	});
+	bounds.push_back(size);
+
+	// Search each range on its own; each instance keeps its own window_
+	const std::size_t n = bounds.size() - 1;
+	std::vector<std::vector<std::size_t> > parts(n);
+	kte::WorkerPool::Shared().Run(n, [&](const std::size_t i) {
+		OptimizedSearch local;
+		local.SetOptions(opts_);
+		local.scan_chunks(text, pattern, bounds[i], bounds[i + 1], [&parts, i](std::size_t at) {
+			parts[i].push_back(at);
+			return true;
+		});
+	}, width);
+
+	// Stitch the ranges in order. A range was searched as if no match came
+	// before it; when the previous match runs into it, redo the search from
+	// where that match ends until it meets a match the range also found.
+	// From there both scans make the same choices.
+	res = std::move(parts[0]);
+	for (std::size_t i = 1; i < n; ++i) {
+		const std::vector<std::size_t> &part = parts[i];
+		auto from                            = part.begin();
+		std::size_t next                     = res.empty() ? start : res.back() + m;
+		if (next > bounds[i]) {
+			from = part.end();
+			while (next < bounds[i + 1]) {
+				std::size_t at = std::string::npos;
+				scan_chunks(text, pattern, next, bounds[i + 1], [&at](std::size_t a) {
+					at = a;
+					return false;
+				});
+				if (at == std::string::npos)
+					break;
+				const auto same = std::lower_bound(part.begin(), part.end(), at);
+				if (same != part.end() && *same == at) {
+					from = same;
+					break;
+				}
+				res.push_back(at);
+				next = at + m;
+			}
 		}
-		unsigned char badc = static_cast<unsigned char>(text[s + j - 1]);
-		int bcidx          = bad_char_[badc];
-		std::size_t shift  = (j - 1 > static_cast<std::size_t>(bcidx))
-			                    ? (j - 1 - static_cast<std::size_t>(bcidx))
-			                    : 1;
-		s += shift;
+		res.insert(res.end(), from, part.end());
 	}
 	return res;
 }
@@ -1,23 +1,112 @@
-// OptimizedSearch.h - Boyer–Moore (bad character) based substring search
+// OptimizedSearch.h - vectorized substring search over strings and PieceTable chunks
 #pragma once
-#include <array>
 #include <cstddef>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "ByteScan.h"
+
+class PieceTable;
+
+
+// How a literal pattern matches
+struct SearchOptions {
+	bool ignore_case = false; // letters match in either case, as kte::FoldCase folds them
+	bool whole_word  = false; // a match does not continue a word on either side
+
+
+	bool operator==(const SearchOptions &other) const
+	{
+		return ignore_case == other.ignore_case && whole_word == other.whole_word;
+	}
+
+
+	bool operator!=(const SearchOptions &other) const
+	{
+		return !(*this == other);
+	}
+};
+
+
+// Literal substring search built on kte::FindSubstring (AVX2/SSE2 first/last
+// byte filter with a scalar fallback, chosen at runtime). The PieceTable
+// overloads stream the table's chunks without materializing it and find
+// matches that straddle piece boundaries. Offsets are byte offsets; npos is
+// std::string::npos.
+//
+// SetOptions() selects case-insensitive and whole-word matching. The former
+// uses kte::FindSubstringFolded, which keeps the vector filter and folds
+// through tables instead of going through a regex; folding never changes a
+// match's length, so a match is always pattern.size() bytes long. The
+// latter rejects a match whose first (last) byte is a word byte - ASCII
+// alphanumeric, '_' or any byte of a multibyte character - when the byte
+// before (after) it is one too, and resumes one byte further on.
+//
+// find_all over a large PieceTable splits it into piece-aligned ranges that
+// are searched on kte::WorkerPool::Shared(). The ranges are stitched back in
+// document order, so the result is the same as a sequential scan.
 class OptimizedSearch {
 public:
 	OptimizedSearch() = default;
 
+	// Threads find_all(PieceTable) may use: 0 for the shared pool plus the
+	// caller, 1 to always scan on the calling thread
+	void SetThreads(const std::size_t threads)
+	{
+		threads_ = threads;
+	}
+
+
+	void SetOptions(const SearchOptions &opts)
+	{
+		opts_ = opts;
+	}
+
+
+	[[nodiscard]] const SearchOptions &Options() const
+	{
+		return opts_;
+	}
+
+
 	// Find first occurrence at or after start. Returns npos if not found.
 	std::size_t find_first(const std::string &text, const std::string &pattern, std::size_t start = 0);
 
 	// Find all non-overlapping matches at or after start. Returns starting indices.
 	std::vector<std::size_t> find_all(const std::string &text, const std::string &pattern, std::size_t start = 0);
 
+	std::size_t find_first(const PieceTable &text, const std::string &pattern, std::size_t start = 0);
+
+	std::vector<std::size_t> find_all(const PieceTable &text, const std::string &pattern, std::size_t start = 0);
+
+	// First match in a line or other view at or after start, for callers
+	// that scan text piecewise. Returns npos if not found, or if pattern is
+	// empty.
+	std::size_t find_in(std::string_view text, const std::string &pattern, std::size_t start = 0);
+
 private:
-	std::array<int, 256> bad_char_{};
-	std::string last_pat_;
+	// First position in [data, data + len) where pattern matches, ignoring
+	// case if asked to but not whole_word
+	const char *find_raw(const char *data, std::size_t len, const std::string &pattern);
+
+	// Report matches in text that start in [start, end), in order, until emit
+	// returns false. Bytes up to end + pattern.size() - 1 are read.
+	template<typename Emit>
+	void scan_chunks(const PieceTable &text, const std::string &pattern, std::size_t start, std::size_t end,
+	                 Emit &&emit);
+
+	std::vector<std::size_t> find_all_parallel(const PieceTable &text, const std::string &pattern,
+	                                           std::size_t start, std::size_t width);
+
+	std::size_t threads_ = 0;
+	SearchOptions opts_;
+
+	// The last pattern searched for ignoring case, and its folded form
+	std::string folded_for_;
+	kte::FoldedNeedle folded_;
 
-	void build_bad_char(const std::string &pattern);
-};
\ No newline at end of file
+	// Last pattern.size() - 1 bytes seen before the current chunk, plus the
+	// head of the chunk, to find matches that cross a chunk boundary
+	std::string window_;
+};
@@ -3,6 +3,7 @@
 #include <limits>
 
 #include "PieceTable.h"
+#include "ByteScan.h"
 
 
 PieceTable::PieceTable() = default;
@@ -10,8 +11,7 @@ PieceTable::PieceTable() = default;
 
 PieceTable::PieceTable(const std::size_t initialCapacity)
 {
-	add_.reserve(initialCapacity);
-	materialized_.reserve(initialCapacity);
+	Reserve(initialCapacity);
 }
 
 
@@ -20,21 +20,23 @@ PieceTable::PieceTable(const std::size_t initialCapacity,
                        const std::size_t small_piece_threshold,
                        const std::size_t max_consolidation_bytes)
 {
-	add_.reserve(initialCapacity);
-	materialized_.reserve(initialCapacity);
+	Reserve(initialCapacity);
 	piece_limit_             = piece_limit;
 	small_piece_threshold_   = small_piece_threshold;
 	max_consolidation_bytes_ = max_consolidation_bytes;
 }
 
 
+// The materialized copy is not shared; a copy rebuilds it only if Data() is called.
 PieceTable::PieceTable(const PieceTable &other)
 	: original_(other.original_),
-	  add_(other.add_),
-	  pieces_(other.pieces_),
-	  materialized_(other.materialized_),
-	  dirty_(other.dirty_),
-	  total_size_(other.total_size_)
+	  add_tail_(other.add_tail_),
+	  add_block_size_(other.add_block_size_),
+	  root_(other.root_),
+	  total_size_(other.total_size_),
+	  piece_limit_(other.piece_limit_),
+	  small_piece_threshold_(other.small_piece_threshold_),
+	  max_consolidation_bytes_(other.max_consolidation_bytes_)
 {
 	version_ = other.version_;
 	// caches are per-instance, mark invalid
@@ -48,26 +50,34 @@ PieceTable::operator=(const PieceTable &other)
 {
 	if (this == &other)
 		return *this;
-	original_     = other.original_;
-	add_          = other.add_;
-	pieces_       = other.pieces_;
-	materialized_ = other.materialized_;
-	dirty_        = other.dirty_;
-	total_size_   = other.total_size_;
-	version_      = other.version_;
-	range_cache_  = {};
-	find_cache_   = {};
+	original_                = other.original_;
+	add_tail_                = other.add_tail_;
+	add_block_size_          = other.add_block_size_;
+	root_                    = other.root_;
+	materialized_.clear();
+	dirty_                   = true;
+	total_size_              = other.total_size_;
+	piece_limit_             = other.piece_limit_;
+	small_piece_threshold_   = other.small_piece_threshold_;
+	max_consolidation_bytes_ = other.max_consolidation_bytes_;
+	version_                 = other.version_;
+	range_cache_             = {};
+	find_cache_              = {};
 	return *this;
 }
 
 
 PieceTable::PieceTable(PieceTable &&other) noexcept
 	: original_(std::move(other.original_)),
-	  add_(std::move(other.add_)),
-	  pieces_(std::move(other.pieces_)),
+	  add_tail_(std::move(other.add_tail_)),
+	  add_block_size_(other.add_block_size_),
+	  root_(std::move(other.root_)),
 	  materialized_(std::move(other.materialized_)),
 	  dirty_(other.dirty_),
-	  total_size_(other.total_size_)
+	  total_size_(other.total_size_),
+	  piece_limit_(other.piece_limit_),
+	  small_piece_threshold_(other.small_piece_threshold_),
+	  max_consolidation_bytes_(other.max_consolidation_bytes_)
 {
 	other.dirty_      = true;
 	other.total_size_ = 0;
@@ -82,17 +92,21 @@ PieceTable::operator=(PieceTable &&other) noexcept
 {
 	if (this == &other)
 		return *this;
-	original_         = std::move(other.original_);
-	add_              = std::move(other.add_);
-	pieces_           = std::move(other.pieces_);
-	materialized_     = std::move(other.materialized_);
-	dirty_            = other.dirty_;
-	total_size_       = other.total_size_;
-	other.dirty_      = true;
-	other.total_size_ = 0;
-	version_          = other.version_;
-	range_cache_      = {};
-	find_cache_       = {};
+	original_                = std::move(other.original_);
+	add_tail_                = std::move(other.add_tail_);
+	add_block_size_          = other.add_block_size_;
+	root_                    = std::move(other.root_);
+	materialized_            = std::move(other.materialized_);
+	dirty_                   = other.dirty_;
+	total_size_              = other.total_size_;
+	piece_limit_             = other.piece_limit_;
+	small_piece_threshold_   = other.small_piece_threshold_;
+	max_consolidation_bytes_ = other.max_consolidation_bytes_;
+	other.dirty_             = true;
+	other.total_size_        = 0;
+	version_                 = other.version_;
+	range_cache_             = {};
+	find_cache_              = {};
 	return *this;
 }
 
@@ -100,14 +114,38 @@ PieceTable::operator=(PieceTable &&other) noexcept
 PieceTable::~PieceTable() = default;
 
 
+// Release the chain of earlier blocks iteratively; a long editing session
+// can build a chain deep enough to overflow the stack if each destructor
+// released its predecessor recursively.
+PieceTable::Block::~Block()
+{
+	std::shared_ptr<Block> p = std::move(prev);
+	while (p && p.use_count() == 1)
+		p = std::move(p->prev);
+}
+
+
+// Smallest and largest add block sizes. Blocks without a newline index are
+// scanned when a piece inside them is split, so they are kept modest.
+static constexpr std::size_t kMinAddBlock = 64 * 1024;
+static constexpr std::size_t kMaxAddBlock = 1024 * 1024;
+
+
 void
 PieceTable::Reserve(const std::size_t newCapacity)
 {
-	add_.reserve(newCapacity);
+	add_block_size_ = std::clamp(newCapacity, kMinAddBlock, kMaxAddBlock);
 	materialized_.reserve(newCapacity);
 }
 
 
+std::shared_ptr<const PieceTable>
+PieceTable::Snapshot() const
+{
+	return std::make_shared<const PieceTable>(*this);
+}
+
+
 // Setter to allow tuning consolidation heuristics
 void
 PieceTable::SetConsolidationParams(const std::size_t piece_limit,
@@ -123,13 +161,12 @@ PieceTable::SetConsolidationParams(const std::size_t piece_limit,
 // (removed helper) — we'll invalidate caches inline inside mutating methods
 
 
+
+
 void
 PieceTable::AppendChar(char c)
 {
-	const std::size_t start = add_.size();
-
-	add_.push_back(c);
-	addPieceBack(Source::Add, start, 1);
+	Append(&c, 1);
 }
 
 
@@ -140,9 +177,7 @@ PieceTable::Append(const char *s, const std::size_t len)
 		return;
 	}
 
-	const std::size_t start = add_.size();
-	add_.append(s, len);
-	addPieceBack(Source::Add, start, len);
+	insertPiece(total_size_, appendAdd(s, len));
 }
 
 
@@ -158,10 +193,7 @@ PieceTable::Append(const PieceTable &other)
 void
 PieceTable::PrependChar(const char c)
 {
-	const std::size_t start = add_.size();
-
-	add_.push_back(c);
-	addPieceFront(Source::Add, start, 1);
+	Prepend(&c, 1);
 }
 
 
@@ -172,10 +204,7 @@ PieceTable::Prepend(const char *s, const std::size_t len)
 		return;
 	}
 
-	const std::size_t start = add_.size();
-
-	add_.append(s, len);
-	addPieceFront(Source::Add, start, len);
+	insertPiece(0, appendAdd(s, len));
 }
 
 
@@ -190,13 +219,12 @@ PieceTable::Prepend(const PieceTable &other)
 void
 PieceTable::Clear()
 {
-	pieces_.clear();
-	add_.clear();
+	root_.reset();
+	original_.reset();
+	add_tail_.reset();
 	materialized_.clear();
 	total_size_ = 0;
 	dirty_      = true;
-	line_index_.clear();
-	line_index_dirty_ = true;
 	version_++;
 	range_cache_ = {};
 	find_cache_  = {};
@@ -204,173 +232,406 @@ PieceTable::Clear()
 
 
 void
-PieceTable::addPieceBack(const Source src, const std::size_t start, const std::size_t len)
+PieceTable::LoadOriginal(std::shared_ptr<const char> data, const std::size_t size)
 {
-	if (len == 0) {
+	Clear();
+	if (!data || size == 0)
 		return;
-	}
-
-	// Attempt to coalesce with last piece if contiguous and same source
-	if (!pieces_.empty()) {
-		Piece &last = pieces_.back();
-		if (last.src == src) {
-			std::size_t expectStart = last.start + last.len;
-
-			if (expectStart == start) {
-				last.len += len;
-				total_size_ += len;
-				dirty_ = true;
-				version_++;
-				range_cache_ = {};
-				find_cache_  = {};
-				return;
-			}
-		}
-	}
-
-	pieces_.push_back(Piece{src, start, len});
-	total_size_ += len;
-	dirty_ = true;
-	InvalidateLineIndex();
+	auto blk     = std::make_shared<Block>();
+	blk->data    = std::move(data);
+	blk->cap     = size;
+	blk->used    = size;
+	blk->indexed = true;
+	kte::FindNewlines(blk->data.get(), size, 0, blk->newlines);
+	original_ = blk;
+	root_     = makeNode(makePiece(blk.get(), 0, size), nullptr, nullptr);
+	total_size_ = size;
+	dirty_      = true;
 	version_++;
 	range_cache_ = {};
 	find_cache_  = {};
 }
 
 
-void
-PieceTable::addPieceFront(Source src, std::size_t start, std::size_t len)
+// ===== Piece tree primitives =====
+
+PieceTable::NodePtr
+PieceTable::makeNode(const Piece &p, NodePtr left, NodePtr right)
 {
-	if (len == 0) {
-		return;
+	auto n    = std::make_shared<Node>();
+	n->piece  = p;
+	n->bytes  = p.len;
+	n->lines  = p.lines;
+	n->pieces = 1;
+	int lh    = 0;
+	int rh    = 0;
+	if (left) {
+		n->bytes += left->bytes;
+		n->lines += left->lines;
+		n->pieces += left->pieces;
+		lh = left->height;
+	}
+	if (right) {
+		n->bytes += right->bytes;
+		n->lines += right->lines;
+		n->pieces += right->pieces;
+		rh = right->height;
 	}
+	n->height = 1 + std::max(lh, rh);
+	n->left   = std::move(left);
+	n->right  = std::move(right);
+	return n;
+}
 
-	// Attempt to coalesce with first piece if contiguous and same source
-	if (!pieces_.empty()) {
-		Piece &first = pieces_.front();
-		if (first.src == src && start + len == first.start) {
-			first.start = start;
-			first.len += len;
-			total_size_ += len;
-			dirty_ = true;
-			version_++;
-			range_cache_ = {};
-			find_cache_  = {};
-			return;
+
+// Build a node from p/left/right whose child heights differ by at most 2,
+// rotating as needed to restore the AVL invariant.
+PieceTable::NodePtr
+PieceTable::rebalance(const Piece &p, NodePtr left, NodePtr right)
+{
+	const int lh = left ? left->height : 0;
+	const int rh = right ? right->height : 0;
+	if (lh > rh + 1) {
+		const int llh = left->left ? left->left->height : 0;
+		const int lrh = left->right ? left->right->height : 0;
+		if (llh >= lrh) {
+			return makeNode(left->piece, left->left, makeNode(p, left->right, std::move(right)));
 		}
+		const Node &lr = *left->right;
+		return makeNode(lr.piece,
+		                makeNode(left->piece, left->left, lr.left),
+		                makeNode(p, lr.right, std::move(right)));
 	}
-	pieces_.insert(pieces_.begin(), Piece{src, start, len});
-	total_size_ += len;
-	dirty_ = true;
-	InvalidateLineIndex();
-	version_++;
-	range_cache_ = {};
-	find_cache_  = {};
+	if (rh > lh + 1) {
+		const int rlh = right->left ? right->left->height : 0;
+		const int rrh = right->right ? right->right->height : 0;
+		if (rrh >= rlh) {
+			return makeNode(right->piece, makeNode(p, std::move(left), right->left), right->right);
+		}
+		const Node &rl = *right->left;
+		return makeNode(rl.piece,
+		                makeNode(p, std::move(left), rl.left),
+		                makeNode(right->piece, rl.right, right->right));
+	}
+	return makeNode(p, std::move(left), std::move(right));
 }
 
 
-void
-PieceTable::materialize() const
+// Join two trees around p, where every piece in left precedes p and every
+// piece in right follows it. O(|height(left) - height(right)|).
+PieceTable::NodePtr
+PieceTable::join(NodePtr left, const Piece &p, NodePtr right)
 {
-	if (!dirty_) {
-		return;
+	const int lh = left ? left->height : 0;
+	const int rh = right ? right->height : 0;
+	if (lh > rh + 1) {
+		return rebalance(left->piece, left->left, join(left->right, p, std::move(right)));
 	}
-	materialized_.clear();
-	materialized_.reserve(total_size_ + 1);
-	for (const auto &p: pieces_) {
-		const std::string &src = p.src == Source::Original ? original_ : add_;
-		if (p.len == 0) {
-			continue;
-		}
+	if (rh > lh + 1) {
+		return rebalance(right->piece, join(std::move(left), p, right->left), right->right);
+	}
+	return makeNode(p, std::move(left), std::move(right));
+}
+
 
-		materialized_.append(src.data() + static_cast<std::ptrdiff_t>(p.start), p.len);
+PieceTable::NodePtr
+PieceTable::popFirst(const NodePtr &n, Piece &out)
+{
+	if (!n->left) {
+		out = n->piece;
+		return n->right;
 	}
-	// Ensure there is a null terminator present via std::string invariants
-	dirty_ = false;
+	return join(popFirst(n->left, out), n->piece, n->right);
 }
 
 
-// ===== New Phase 1 implementation =====
+PieceTable::NodePtr
+PieceTable::popLast(const NodePtr &n, Piece &out)
+{
+	if (!n->right) {
+		out = n->piece;
+		return n->left;
+	}
+	return join(n->left, n->piece, popLast(n->right, out));
+}
 
-std::pair<std::size_t, std::size_t>
-PieceTable::locate(const std::size_t byte_offset) const
+
+std::pair<PieceTable::NodePtr, PieceTable::NodePtr>
+PieceTable::split(const NodePtr &n, const std::size_t byte_offset) const
 {
-	if (byte_offset >= total_size_) {
-		return {pieces_.size(), 0};
+	if (!n)
+		return {nullptr, nullptr};
+	const std::size_t left_bytes = n->left ? n->left->bytes : 0;
+	const Piece &p               = n->piece;
+	if (byte_offset <= left_bytes) {
+		auto [a, b] = split(n->left, byte_offset);
+		return {std::move(a), join(std::move(b), p, n->right)};
+	}
+	if (byte_offset >= left_bytes + p.len) {
+		auto [a, b] = split(n->right, byte_offset - left_bytes - p.len);
+		return {join(n->left, p, std::move(a)), std::move(b)};
 	}
-	std::size_t off = byte_offset;
-	for (std::size_t i = 0; i < pieces_.size(); ++i) {
-		const auto &p = pieces_[i];
-		if (off < p.len) {
-			return {i, off};
+	// Offset falls strictly inside this piece: cut it in two
+	const std::size_t inner = byte_offset - left_bytes;
+	const Piece head        = makePiece(p.blk, p.start, inner);
+	const Piece tail{p.blk, p.start + inner, p.len - inner, p.lines - head.lines};
+	return {join(n->left, head, nullptr), join(nullptr, tail, n->right)};
+}
+
+
+PieceTable::NodePtr
+PieceTable::concat(NodePtr left, NodePtr right)
+{
+	if (!left)
+		return right;
+	if (!right)
+		return left;
+	Piece last{};
+	NodePtr rest_left = popLast(left, last);
+	const Node *first = right.get();
+	while (first->left)
+		first = first->left.get();
+	if (contiguous(last, first->piece)) {
+		Piece head{};
+		NodePtr rest_right = popFirst(right, head);
+		Piece merged{last.blk, last.start, last.len + head.len, last.lines + head.lines};
+		return join(std::move(rest_left), merged, std::move(rest_right));
+	}
+	return join(std::move(rest_left), last, std::move(right));
+}
+
+
+PieceTable::Piece
+PieceTable::makePiece(const Block *blk, const std::size_t start, const std::size_t len)
+{
+	return Piece{blk, start, len, countNewlines(blk, start, len)};
+}
+
+
+std::size_t
+PieceTable::countNewlines(const Block *blk, const std::size_t start, const std::size_t len)
+{
+	if (!blk->indexed)
+		return kte::CountNewlines(blk->data.get() + start, len);
+	const auto &nl = blk->newlines;
+	auto lo        = std::lower_bound(nl.begin(), nl.end(), start);
+	auto hi        = std::lower_bound(lo, nl.end(), start + len);
+	return static_cast<std::size_t>(hi - lo);
+}
+
+
+std::size_t
+PieceTable::nthNewline(const Block *blk, std::size_t start, std::size_t k)
+{
+	if (blk->indexed) {
+		auto it = std::lower_bound(blk->newlines.begin(), blk->newlines.end(), start);
+		return *(it + static_cast<std::ptrdiff_t>(k - 1));
+	}
+	const char *base = blk->data.get();
+	const char *p    = base + start;
+	for (;;) {
+		p = kte::FindByte(p, blk->cap - static_cast<std::size_t>(p - base), '\n');
+		if (--k == 0)
+			return static_cast<std::size_t>(p - base);
+		++p;
+	}
+}
+
+
+PieceTable::Piece
+PieceTable::appendAdd(const char *text, const std::size_t len)
+{
+	// Large inserts (pastes, consolidation of big runs) get a block of their
+	// own with a newline index, so later splits inside them stay O(log n).
+	if (len > add_block_size_ / 4) {
+		auto blk = std::make_shared<Block>();
+		char *buf = new char[len];
+		std::copy(text, text + len, buf);
+		blk->data    = std::shared_ptr<const char>(buf, std::default_delete<const char[]>());
+		blk->cap     = len;
+		blk->used    = len;
+		blk->indexed = true;
+		kte::FindNewlines(buf, len, 0, blk->newlines);
+		blk->prev = std::move(add_tail_);
+		add_tail_ = std::move(blk);
+		return makePiece(add_tail_.get(), 0, len);
+	}
+	std::size_t at = add_tail_ ? add_tail_->used.load(std::memory_order_relaxed) : 0;
+	for (;;) {
+		if (!add_tail_ || add_tail_->indexed || at + len > add_tail_->cap) {
+			auto blk  = std::make_shared<Block>();
+			blk->data = std::shared_ptr<const char>(new char[add_block_size_],
+			                                         std::default_delete<const char[]>());
+			blk->cap  = add_block_size_;
+			blk->prev = std::move(add_tail_);
+			add_tail_ = std::move(blk);
+			at        = 0;
 		}
-		off -= p.len;
+		// A copy of this table may append to the same block; claim the range
+		if (add_tail_->used.compare_exchange_weak(at, at + len, std::memory_order_relaxed))
+			break;
 	}
-	// Should not reach here unless inconsistency; return end
-	return {pieces_.size(), 0};
+	// Add blocks are allocated non-const above; only the claimed range is written
+	char *dst = const_cast<char *>(add_tail_->data.get()) + at;
+	std::copy(text, text + len, dst);
+	return makePiece(add_tail_.get(), at, len);
 }
 
 
-void
-PieceTable::coalesceNeighbors(std::size_t index)
+std::pair<std::size_t, PieceTable::Piece>
+PieceTable::pieceAt(std::size_t byte_offset) const
 {
-	if (pieces_.empty())
-		return;
-	if (index >= pieces_.size())
-		index = pieces_.size() - 1;
-	// Merge repeatedly with previous while contiguous and same source
-	while (index > 0) {
-		auto &prev = pieces_[index - 1];
-		auto &curr = pieces_[index];
-		if (prev.src == curr.src && prev.start + prev.len == curr.start) {
-			prev.len += curr.len;
-			pieces_.erase(pieces_.begin() + static_cast<std::ptrdiff_t>(index));
-			index -= 1;
+	const Node *n    = root_.get();
+	std::size_t base = 0;
+	while (n) {
+		const std::size_t left_bytes = n->left ? n->left->bytes : 0;
+		if (byte_offset < left_bytes) {
+			n = n->left.get();
+		} else if (byte_offset < left_bytes + n->piece.len) {
+			return {base + left_bytes, n->piece};
 		} else {
-			break;
+			byte_offset -= left_bytes + n->piece.len;
+			base += left_bytes + n->piece.len;
+			n = n->right.get();
 		}
 	}
-	// Merge repeatedly with next while contiguous and same source
-	while (index + 1 < pieces_.size()) {
-		auto &curr = pieces_[index];
-		auto &next = pieces_[index + 1];
-		if (curr.src == next.src && curr.start + curr.len == next.start) {
-			curr.len += next.len;
-			pieces_.erase(pieces_.begin() + static_cast<std::ptrdiff_t>(index + 1));
-		} else {
+	return {total_size_, Piece{nullptr, 0, 0, 0}};
+}
+
+
+template<typename Fn>
+void
+PieceTable::forEachPiece(std::size_t byte_offset, std::size_t len, Fn &&fn) const
+{
+	if (len == 0 || !root_)
+		return;
+	// Iterative in-order walk: descend to the first piece overlapping the
+	// range, remembering the ancestors still to be visited.
+	std::vector<const Node *> stack;
+	const Node *n = root_.get();
+	while (n) {
+		const std::size_t left_bytes = n->left ? n->left->bytes : 0;
+		if (byte_offset < left_bytes) {
+			stack.push_back(n);
+			n = n->left.get();
+		} else if (byte_offset < left_bytes + n->piece.len) {
+			stack.push_back(n);
+			byte_offset -= left_bytes;
 			break;
+		} else {
+			byte_offset -= left_bytes + n->piece.len;
+			n = n->right.get();
 		}
 	}
+	std::size_t inner = byte_offset;
+	while (len > 0 && !stack.empty()) {
+		const Node *cur = stack.back();
+		stack.pop_back();
+		const Piece &p         = cur->piece;
+		const std::size_t take = std::min(p.len - inner, len);
+		if (!fn(sourceOf(p) + static_cast<std::ptrdiff_t>(p.start + inner), take))
+			return;
+		len -= take;
+		inner = 0;
+		for (const Node *c = cur->right.get(); c; c = c->left.get())
+			stack.push_back(c);
+	}
 }
 
 
 void
-PieceTable::InvalidateLineIndex() const
+PieceTable::insertPiece(const std::size_t byte_offset, const Piece &p)
 {
-	line_index_dirty_ = true;
+	auto [left, right] = split(root_, byte_offset);
+	root_              = concat(concat(std::move(left), makeNode(p, nullptr, nullptr)), std::move(right));
+	total_size_ += p.len;
+	dirty_ = true;
+	version_++;
+	range_cache_ = {};
+	find_cache_  = {};
 }
 
 
 void
-PieceTable::RebuildLineIndex() const
+PieceTable::materialize() const
 {
-	if (!line_index_dirty_)
+	if (!dirty_) {
 		return;
-	line_index_.clear();
-	line_index_.push_back(0);
-	std::size_t pos = 0;
-	for (const auto &pc: pieces_) {
-		const std::string &src = pc.src == Source::Original ? original_ : add_;
-		const char *base       = src.data() + static_cast<std::ptrdiff_t>(pc.start);
-		for (std::size_t j = 0; j < pc.len; ++j) {
-			if (base[j] == '\n') {
-				// next line starts after the newline
-				line_index_.push_back(pos + j + 1);
-			}
+	}
+	materialized_.clear();
+	materialized_.reserve(total_size_ + 1);
+	forEachPiece(0, total_size_, [this](const char *data, std::size_t len) {
+		materialized_.append(data, len);
+		return true;
+	});
+	// Ensure there is a null terminator present via std::string invariants
+	dirty_ = false;
+}
+
+
+// Offset of the first byte of line_num, found by descending on subtree
+// newline counts to the (line_num)th newline. O(log n).
+std::size_t
+PieceTable::lineStart(std::size_t line_num) const
+{
+	if (line_num == 0)
+		return 0;
+	const Node *n    = root_.get();
+	std::size_t base = 0;
+	std::size_t k    = line_num; // 1-based index of the newline ending the previous line
+	while (n) {
+		const std::size_t left_lines = n->left ? n->left->lines : 0;
+		const std::size_t left_bytes = n->left ? n->left->bytes : 0;
+		if (k <= left_lines) {
+			n = n->left.get();
+			continue;
 		}
-		pos += pc.len;
+		k -= left_lines;
+		const Piece &p = n->piece;
+		if (k <= p.lines) {
+			// next line starts after the newline
+			return base + left_bytes + (nthNewline(p.blk, p.start, k) - p.start) + 1;
+		}
+		k -= p.lines;
+		base += left_bytes + p.len;
+		n = n->right.get();
 	}
-	line_index_dirty_ = false;
+	return total_size_;
+}
+
+
+// Number of newlines in [0, byte_offset), i.e. the row containing byte_offset.
+std::size_t
+PieceTable::newlinesBefore(std::size_t byte_offset) const
+{
+	std::size_t lines = 0;
+	const Node *n     = root_.get();
+	while (n) {
+		const std::size_t left_bytes = n->left ? n->left->bytes : 0;
+		if (byte_offset < left_bytes) {
+			n = n->left.get();
+			continue;
+		}
+		lines += n->left ? n->left->lines : 0;
+		byte_offset -= left_bytes;
+		const Piece &p = n->piece;
+		if (byte_offset < p.len)
+			return lines + countNewlines(p.blk, p.start, byte_offset);
+		lines += p.lines;
+		byte_offset -= p.len;
+		n = n->right.get();
+	}
+	return lines;
+}
+
+
+char
+PieceTable::byteAt(const std::size_t byte_offset) const
+{
+	auto [base, p] = pieceAt(byte_offset);
+	if (p.len == 0)
+		return '\0';
+	return sourceOf(p)[p.start + (byte_offset - base)];
 }
 
 
@@ -384,63 +645,8 @@ PieceTable::Insert(std::size_t byte_offset, const char *text, std::size_t len)
 		byte_offset = total_size_;
 	}
 
-	const std::size_t add_start = add_.size();
-	add_.append(text, len);
-
-	if (pieces_.empty()) {
-		pieces_.push_back(Piece{Source::Add, add_start, len});
-		total_size_ += len;
-		dirty_ = true;
-		InvalidateLineIndex();
-		maybeConsolidate();
-		version_++;
-		range_cache_ = {};
-		find_cache_  = {};
-		return;
-	}
-
-	auto [idx, inner] = locate(byte_offset);
-	if (idx == pieces_.size()) {
-		// insert at end
-		pieces_.push_back(Piece{Source::Add, add_start, len});
-		total_size_ += len;
-		dirty_ = true;
-		InvalidateLineIndex();
-		coalesceNeighbors(pieces_.size() - 1);
-		maybeConsolidate();
-		version_++;
-		range_cache_ = {};
-		find_cache_  = {};
-		return;
-	}
-
-	Piece target = pieces_[idx];
-	// Build replacement sequence: left, inserted, right
-	std::vector<Piece> repl;
-	repl.reserve(3);
-	if (inner > 0) {
-		repl.push_back(Piece{target.src, target.start, inner});
-	}
-	repl.push_back(Piece{Source::Add, add_start, len});
-	const std::size_t right_len = target.len - inner;
-	if (right_len > 0) {
-		repl.push_back(Piece{target.src, target.start + inner, right_len});
-	}
-
-	// Replace target with repl
-	pieces_.erase(pieces_.begin() + static_cast<std::ptrdiff_t>(idx));
-	pieces_.insert(pieces_.begin() + static_cast<std::ptrdiff_t>(idx), repl.begin(), repl.end());
-
-	total_size_ += len;
-	dirty_ = true;
-	InvalidateLineIndex();
-	// Try coalescing around the inserted position (the inserted piece is at idx + (inner>0 ? 1 : 0))
-	std::size_t ins_index = idx + (inner > 0 ? 1 : 0);
-	coalesceNeighbors(ins_index);
-	maybeConsolidate();
-	version_++;
-	range_cache_ = {};
-	find_cache_  = {};
+	insertPiece(byte_offset, appendAdd(text, len));
+	maybeConsolidate(byte_offset);
 }
 
 
@@ -457,105 +663,141 @@ PieceTable::Delete(std::size_t byte_offset, std::size_t len)
 		len = total_size_ - byte_offset;
 	}
 
-	auto [idx, inner]     = locate(byte_offset);
-	std::size_t remaining = len;
-
-	while (remaining > 0 && idx < pieces_.size()) {
-		Piece &pc             = pieces_[idx];
-		std::size_t available = pc.len - inner; // bytes we can remove from this piece starting at inner
-		std::size_t take      = std::min(available, remaining);
-
-		// Compute lengths for left and right remnants
-		std::size_t left_len  = inner;
-		std::size_t right_len = pc.len - inner - take;
-		Source src            = pc.src;
-		std::size_t start     = pc.start;
-
-		// Replace current piece with up to two remnants
-		if (left_len > 0 && right_len > 0) {
-			pc.len = left_len; // keep left in place
-			Piece right{src, start + inner + take, right_len};
-			pieces_.insert(pieces_.begin() + static_cast<std::ptrdiff_t>(idx + 1), right);
-			idx += 1; // move to right for next iteration decision
-		} else if (left_len > 0) {
-			pc.len = left_len;
-			// no insertion; idx now points to left; move to next piece
-		} else if (right_len > 0) {
-			pc.start = start + inner + take;
-			pc.len   = right_len;
-		} else {
-			// entire piece removed
-			pieces_.erase(pieces_.begin() + static_cast<std::ptrdiff_t>(idx));
-			// stay at same idx for next piece
-			inner = 0;
-			remaining -= take;
-			continue;
-		}
-
-		// After modifying current idx, next deletion continues at beginning of the next logical region
-		inner = 0;
-		remaining -= take;
-		if (remaining == 0)
-			break;
-		// Move to next piece
-		idx += 1;
-	}
+	auto [left, rest]     = split(root_, byte_offset);
+	auto [removed, right] = split(rest, len);
+	(void) removed;
+	root_ = concat(std::move(left), std::move(right));
 
 	total_size_ -= len;
 	dirty_ = true;
-	InvalidateLineIndex();
-	if (idx < pieces_.size())
-		coalesceNeighbors(idx);
-	if (idx > 0)
-		coalesceNeighbors(idx - 1);
-	maybeConsolidate();
+	maybeConsolidate(byte_offset);
 	version_++;
 	range_cache_ = {};
 	find_cache_  = {};
 }
 
 
-// ===== Consolidation implementation =====
+PieceTable::NodePtr
+PieceTable::build(const std::vector<Piece> &pieces, const std::size_t lo, const std::size_t hi)
+{
+	if (lo >= hi)
+		return nullptr;
+	const std::size_t mid = lo + (hi - lo) / 2;
+	return makeNode(pieces[mid], build(pieces, lo, mid), build(pieces, mid + 1, hi));
+}
+
 
 void
-PieceTable::appendPieceDataTo(std::string &out, const Piece &p) const
+PieceTable::ReplaceAll(const std::vector<Splice> &splices)
 {
-	if (p.len == 0)
+	if (splices.empty())
 		return;
-	const std::string &src = p.src == Source::Original ? original_ : add_;
-	out.append(src.data() + static_cast<std::ptrdiff_t>(p.start), p.len);
+
+	// The new piece sequence. Pieces without a block refer to fresh, the
+	// bytes that are copied into add storage once the walk is done.
+	std::vector<Piece> out;
+	std::string fresh;
+	auto copy = [&out, &fresh](const char *data, const std::size_t len) {
+		if (len == 0)
+			return;
+		if (!out.empty() && !out.back().blk)
+			out.back().len += len;
+		else
+			out.push_back(Piece{nullptr, fresh.size(), len, 0});
+		fresh.append(data, len);
+	};
+	auto keep = [&](const Piece &p) {
+		if (p.len < small_piece_threshold_) {
+			copy(sourceOf(p) + p.start, p.len);
+		} else if (!out.empty() && out.back().blk && contiguous(out.back(), p)) {
+			out.back().len += p.len;
+			out.back().lines += p.lines;
+		} else {
+			out.push_back(p);
+		}
+	};
+
+	// In-order cursor over the current pieces; cur covers [cur_pos, cur_end)
+	std::vector<const Node *> stack;
+	for (const Node *n = root_.get(); n; n = n->left.get())
+		stack.push_back(n);
+	const Piece *cur    = nullptr;
+	std::size_t cur_pos = 0;
+	std::size_t cur_end = 0;
+	auto keep_range     = [&](std::size_t from, const std::size_t to) {
+		while (from < to) {
+			while (cur_end <= from) {
+				const Node *n = stack.back();
+				stack.pop_back();
+				for (const Node *c = n->right.get(); c; c = c->left.get())
+					stack.push_back(c);
+				cur     = &n->piece;
+				cur_pos = cur_end;
+				cur_end += cur->len;
+			}
+			const std::size_t take = std::min(to, cur_end) - from;
+			if (take == cur->len)
+				keep(*cur);
+			else
+				keep(makePiece(cur->blk, cur->start + (from - cur_pos), take));
+			from += take;
+		}
+	};
+
+	std::size_t done = 0; // document bytes before this offset are handled
+	for (const Splice &sp: splices) {
+		const std::size_t at = std::min(std::max(sp.offset, done), total_size_);
+		keep_range(done, at);
+		copy(sp.text.data(), sp.text.size());
+		done = std::min(total_size_, std::max(at, sp.offset + sp.len));
+	}
+	keep_range(done, total_size_);
+
+	if (!fresh.empty()) {
+		const Piece added = appendAdd(fresh.data(), fresh.size());
+		for (Piece &p: out) {
+			if (!p.blk)
+				p = makePiece(added.blk, added.start + p.start, p.len);
+		}
+	}
+	std::size_t size = 0;
+	for (const Piece &p: out)
+		size += p.len;
+	root_       = build(out, 0, out.size());
+	total_size_ = size;
+	dirty_      = true;
+	version_++;
+	range_cache_ = {};
+	find_cache_  = {};
 }
 
 
+// ===== Consolidation implementation =====
+
+// Replace the pieces covering [byte_offset, byte_offset + len) with a single
+// Add piece holding a copy of their bytes.
 void
-PieceTable::consolidateRange(std::size_t start_idx, std::size_t end_idx)
+PieceTable::consolidateRange(const std::size_t byte_offset, const std::size_t len)
 {
-	if (start_idx >= end_idx || start_idx >= pieces_.size())
-		return;
-	end_idx           = std::min(end_idx, pieces_.size());
-	std::size_t total = 0;
-	for (std::size_t i = start_idx; i < end_idx; ++i)
-		total += pieces_[i].len;
-	if (total == 0)
+	if (len == 0)
 		return;
 
-	const std::size_t add_start = add_.size();
 	std::string tmp;
-	tmp.reserve(std::min<std::size_t>(total, max_consolidation_bytes_));
-	for (std::size_t i = start_idx; i < end_idx; ++i)
-		appendPieceDataTo(tmp, pieces_[i]);
-	add_.append(tmp);
-
-	// Replace [start_idx, end_idx) with single Add piece
-	Piece consolidated{Source::Add, add_start, tmp.size()};
-	pieces_.erase(pieces_.begin() + static_cast<std::ptrdiff_t>(start_idx),
-	              pieces_.begin() + static_cast<std::ptrdiff_t>(end_idx));
-	pieces_.insert(pieces_.begin() + static_cast<std::ptrdiff_t>(start_idx), consolidated);
+	tmp.reserve(len);
+	forEachPiece(byte_offset, len, [&tmp](const char *data, std::size_t n) {
+		tmp.append(data, n);
+		return true;
+	});
+	const Piece piece = appendAdd(tmp.data(), tmp.size());
+
+	auto [left, rest] = split(root_, byte_offset);
+	auto [old, right] = split(rest, len);
+	(void) old;
+	NodePtr consolidated = makeNode(piece, nullptr, nullptr);
+	root_                = concat(concat(std::move(left), std::move(consolidated)), std::move(right));
 
 	// total_size_ unchanged
 	dirty_ = true;
-	InvalidateLineIndex();
-	coalesceNeighbors(start_idx);
 	// Layout changed; invalidate caches/version
 	version_++;
 	range_cache_ = {};
@@ -564,43 +806,43 @@ PieceTable::consolidateRange(std::size_t start_idx, std::size_t end_idx)
 
 
 void
-PieceTable::maybeConsolidate()
+PieceTable::maybeConsolidate(const std::size_t byte_offset)
 {
-	if (pieces_.size() <= piece_limit_)
+	if (!root_ || root_->pieces <= piece_limit_)
 		return;
 
-	// Find the first run of small pieces to consolidate
-	std::size_t n          = pieces_.size();
-	std::size_t best_start = n, best_end = n;
-	std::size_t i          = 0;
-	while (i < n) {
-		// Skip large pieces quickly
-		if (pieces_[i].len > small_piece_threshold_) {
-			i++;
-			continue;
-		}
-		std::size_t j     = i;
-		std::size_t bytes = 0;
-		while (j < n) {
-			const auto &p = pieces_[j];
-			if (p.len > small_piece_threshold_)
-				break;
-			if (bytes + p.len > max_consolidation_bytes_)
-				break;
-			bytes += p.len;
-			j++;
-		}
-		if (j - i >= 2 && bytes > 0) {
-			// consolidate runs of at least 2 pieces
-			best_start = i;
-			best_end   = j;
-			break; // do one run per call; subsequent ops can repeat if still over limit
-		}
-		i = j + 1;
+	// Grow a run of small pieces outward from the edit position, bounded by
+	// max_consolidation_bytes_. Do one run per call; subsequent edits repeat
+	// while still over the limit.
+	auto small = [this](const Piece &p) {
+		return p.len > 0 && p.len <= small_piece_threshold_;
+	};
+	const std::size_t at = std::min(byte_offset, total_size_ - 1);
+	auto [begin, first]  = pieceAt(at);
+	if (!small(first))
+		return;
+	std::size_t end   = begin + first.len;
+	std::size_t bytes = first.len;
+	std::size_t count = 1;
+	while (begin > 0) {
+		auto [b, p] = pieceAt(begin - 1);
+		if (!small(p) || bytes + p.len > max_consolidation_bytes_)
+			break;
+		begin = b;
+		bytes += p.len;
+		count++;
 	}
-
-	if (best_start < best_end) {
-		consolidateRange(best_start, best_end);
+	while (end < total_size_) {
+		auto [b, p] = pieceAt(end);
+		if (!small(p) || bytes + p.len > max_consolidation_bytes_)
+			break;
+		end = b + p.len;
+		bytes += p.len;
+		count++;
+	}
+	// consolidate runs of at least 2 pieces
+	if (count >= 2) {
+		consolidateRange(begin, end - begin);
 	}
 }
 
@@ -608,25 +850,31 @@ PieceTable::maybeConsolidate()
 std::size_t
 PieceTable::LineCount() const
 {
-	RebuildLineIndex();
-	return line_index_.empty() ? 0 : line_index_.size();
+	return (root_ ? root_->lines : 0) + 1;
 }
 
 
 std::pair<std::size_t, std::size_t>
 PieceTable::GetLineRange(std::size_t line_num) const
 {
-	RebuildLineIndex();
-	if (line_index_.empty())
+	const std::size_t lines = LineCount();
+	if (line_num >= lines)
 		return {0, 0};
-	if (line_num >= line_index_.size())
-		return {0, 0};
-	std::size_t start = line_index_[line_num];
-	std::size_t end   = (line_num + 1 < line_index_.size()) ? line_index_[line_num + 1] : total_size_;
+	std::size_t start = lineStart(line_num);
+	std::size_t end   = (line_num + 1 < lines) ? lineStart(line_num + 1) : total_size_;
 	return {start, end};
 }
 
 
+char
+PieceTable::ByteAt(const std::size_t byte_offset) const
+{
+	if (byte_offset >= total_size_)
+		return '\0';
+	return byteAt(byte_offset);
+}
+
+
 std::string
 PieceTable::GetLine(std::size_t line_num) const
 {
@@ -634,12 +882,8 @@ PieceTable::GetLine(std::size_t line_num) const
 	if (end < start)
 		return std::string();
 	// Trim trailing '\n'
-	if (end > start) {
-		// To check last char, we can get it via GetRange of len 1 at end-1 without materializing whole
-		std::string last = GetRange(end - 1, 1);
-		if (!last.empty() && last[0] == '\n') {
-			end -= 1;
-		}
+	if (end > start && byteAt(end - 1) == '\n') {
+		end -= 1;
 	}
 	return GetRange(start, end - start);
 }
@@ -650,12 +894,8 @@ PieceTable::ByteOffsetToLineCol(std::size_t byte_offset) const
 {
 	if (byte_offset > total_size_)
 		byte_offset = total_size_;
-	RebuildLineIndex();
-	if (line_index_.empty())
-		return {0, 0};
-	auto it         = std::upper_bound(line_index_.begin(), line_index_.end(), byte_offset);
-	std::size_t row = (it == line_index_.begin()) ? 0 : static_cast<std::size_t>((it - line_index_.begin()) - 1);
-	std::size_t col = byte_offset - line_index_[row];
+	const std::size_t row = newlinesBefore(byte_offset);
+	const std::size_t col = byte_offset - lineStart(row);
 	return {row, col};
 }
 
@@ -663,19 +903,12 @@ PieceTable::ByteOffsetToLineCol(std::size_t byte_offset) const
 std::size_t
 PieceTable::LineColToByteOffset(std::size_t row, std::size_t col) const
 {
-	RebuildLineIndex();
-	if (line_index_.empty())
-		return 0;
-	if (row >= line_index_.size())
+	if (row >= LineCount())
 		return total_size_;
-	std::size_t start = line_index_[row];
-	std::size_t end   = (row + 1 < line_index_.size()) ? line_index_[row + 1] : total_size_;
+	auto [start, end] = GetLineRange(row);
 	// Clamp col to line length excluding trailing newline
-	if (end > start) {
-		std::string last = GetRange(end - 1, 1);
-		if (!last.empty() && last[0] == '\n') {
-			end -= 1;
-		}
+	if (end > start && byteAt(end - 1) == '\n') {
+		end -= 1;
 	}
 	std::size_t target = start + std::min(col, end - start);
 	return target;
@@ -703,22 +936,10 @@ PieceTable::GetRange(std::size_t byte_offset, std::size_t len) const
 		out.assign(materialized_.data() + static_cast<std::ptrdiff_t>(byte_offset), len);
 	} else {
 		// Assemble substring directly from pieces without full materialization
-		auto [idx, inner]     = locate(byte_offset);
-		std::size_t remaining = len;
-		while (remaining > 0 && idx < pieces_.size()) {
-			const auto &p          = pieces_[idx];
-			const std::string &src = (p.src == Source::Original) ? original_ : add_;
-			std::size_t take       = std::min<std::size_t>(p.len - inner, remaining);
-			if (take > 0) {
-				const char *base = src.data() + static_cast<std::ptrdiff_t>(p.start + inner);
-				out.append(base, take);
-				remaining -= take;
-				inner = 0;
-				idx += 1;
-			} else {
-				break;
-			}
-		}
+		forEachPiece(byte_offset, len, [&out](const char *data, std::size_t n) {
+			out.append(data, n);
+			return true;
+		});
 	}
 
 	// Update cache
@@ -731,6 +952,19 @@ PieceTable::GetRange(std::size_t byte_offset, std::size_t len) const
 }
 
 
+void
+PieceTable::ForEachChunk(std::size_t byte_offset, std::size_t len,
+                         const std::function<bool(std::string_view)> &fn) const
+{
+	if (byte_offset >= total_size_)
+		return;
+	len = std::min(len, total_size_ - byte_offset);
+	forEachPiece(byte_offset, len, [&fn](const char *data, std::size_t n) {
+		return fn(std::string_view(data, n));
+	});
+}
+
+
 std::size_t
 PieceTable::Find(const std::string &needle, std::size_t start) const
 {
@@ -745,10 +979,38 @@ PieceTable::Find(const std::string &needle, std::size_t start) const
 		return find_cache_.result;
 	}
 
-	materialize();
-	auto pos = materialized_.find(needle, start);
-	if (pos == std::string::npos)
-		pos = std::numeric_limits<std::size_t>::max();
+	// Stream over the pieces instead of materializing. `carry` holds the last
+	// needle.size() - 1 bytes before the current chunk so matches that straddle
+	// a piece boundary are still found.
+	const std::size_t keep = needle.size() - 1;
+	std::size_t pos        = std::numeric_limits<std::size_t>::max();
+	std::size_t chunk_off  = start;
+	std::string carry;
+	forEachPiece(start, total_size_ - start, [&](const char *data, std::size_t n) {
+		const std::string_view chunk(data, n);
+		if (!carry.empty()) {
+			std::string joined = carry;
+			joined.append(chunk.substr(0, keep));
+			const char *hit = kte::FindSubstring(joined.data(), joined.size(), needle.data(), needle.size());
+			if (hit) {
+				pos = chunk_off - carry.size() + static_cast<std::size_t>(hit - joined.data());
+				return false;
+			}
+		}
+		if (const char *hit = kte::FindSubstring(data, n, needle.data(), needle.size())) {
+			pos = chunk_off + static_cast<std::size_t>(hit - data);
+			return false;
+		}
+		if (chunk.size() >= keep) {
+			carry.assign(chunk.substr(chunk.size() - keep));
+		} else {
+			carry.append(chunk);
+			if (carry.size() > keep)
+				carry.erase(0, carry.size() - keep);
+		}
+		chunk_off += n;
+		return true;
+	});
 	// Update cache
 	find_cache_.valid   = true;
 	find_cache_.version = version_;
@@ -2,9 +2,13 @@
  * PieceTable.h - Alternative to GapBuffer using a piece table representation
  */
 #pragma once
+#include <atomic>
 #include <cstddef>
 #include <cstdint>
+#include <functional>
+#include <memory>
 #include <string>
+#include <string_view>
 #include <vector>
 #include <limits>
 
@@ -21,6 +25,8 @@ public:
 	           std::size_t small_piece_threshold,
 	           std::size_t max_consolidation_bytes);
 
+	// Copies are O(1): they share the piece tree and every storage block, and
+	// later edits to either side never touch bytes the other can see.
 	PieceTable(const PieceTable &other);
 
 	PieceTable &operator=(const PieceTable &other);
@@ -49,6 +55,13 @@ public:
 	// Content management
 	void Clear();
 
+	// Replace the contents with an immutable Original source of size bytes.
+	// The table keeps `data` alive for as long as any piece (or copy) refers to
+	// it, so it can point into a read-only file mapping: the document then
+	// starts as a single Original piece with no copy, and edits go to the add
+	// buffer.
+	void LoadOriginal(std::shared_ptr<const char> data, std::size_t size);
+
 	// Accessors
 	char *Data()
 	{
@@ -94,54 +107,181 @@ public:
 
 	[[nodiscard]] std::size_t LineColToByteOffset(std::size_t row, std::size_t col) const;
 
+	// One replacement for ReplaceAll(): bytes [offset, offset + len) become
+	// text
+	struct Splice {
+		std::size_t offset;
+		std::size_t len;
+		std::string_view text;
+	};
+
+	// Apply many replacements at once, as replace-all does. Splices must be
+	// ascending and must not overlap. The document is walked once and the
+	// tree rebuilt from the new piece sequence: unchanged spans are kept as
+	// pieces, while the new text and unchanged spans too short to be worth a
+	// piece are copied together into add storage, so dense replacements do
+	// not leave the table fragmented.
+	void ReplaceAll(const std::vector<Splice> &splices);
+
 	// Substring extraction
 	[[nodiscard]] std::string GetRange(std::size_t byte_offset, std::size_t len) const;
 
+	// Single byte at byte_offset, or '\0' past the end; O(log n)
+	[[nodiscard]] char ByteAt(std::size_t byte_offset) const;
+
+	// Piece-aware read access: visit [byte_offset, byte_offset + len) as
+	// contiguous chunks in document order without materializing the document.
+	// Return false from fn to stop early. Chunks point into the table's
+	// storage and are invalidated by the next edit.
+	void ForEachChunk(std::size_t byte_offset, std::size_t len,
+	                  const std::function<bool(std::string_view)> &fn) const;
+
 	// Simple search utility; returns byte offset or npos
 	[[nodiscard]] std::size_t Find(const std::string &needle, std::size_t start = 0) const;
 
+	// Monotonic content version, bumped by every mutation. Copies and
+	// snapshots carry the version they were taken at.
+	[[nodiscard]] std::uint64_t Version() const
+	{
+		return version_;
+	}
+
+
+	// Immutable O(1) copy of the current contents for a reader on another
+	// thread (highlighting, search, save). The live table may keep editing
+	// without locks. Const member functions are safe on the snapshot from one
+	// thread at a time; Data(), GetRange() and Find() fill per-table caches,
+	// so threads that share one snapshot should restrict themselves to
+	// ForEachChunk() and the line/offset queries that do not call them.
+	[[nodiscard]] std::shared_ptr<const PieceTable> Snapshot() const;
+
 	// Heuristic configuration
 	void SetConsolidationParams(std::size_t piece_limit,
 	                            std::size_t small_piece_threshold,
 	                            std::size_t max_consolidation_bytes);
 
 private:
-	enum class Source : unsigned char { Original, Add };
+	// Storage referenced by pieces. The Original source is one block; inserted
+	// text is appended to add blocks that never move or reallocate once
+	// allocated. Appends reserve their bytes atomically, so tables sharing a
+	// block (a table and its copies) never write the same bytes, and bytes a
+	// piece refers to are never written again. Each add block links to the
+	// previous one, so holding the newest block keeps all earlier ones alive.
+	struct Block {
+		std::shared_ptr<const char> data;
+		std::size_t cap = 0;
+		std::atomic<std::size_t> used{0}; // bytes reserved by appends
+		// Positions of every '\n', ascending; only for blocks filled when they
+		// were created (the Original source and large inserts). Pieces in
+		// other add blocks are small and are scanned instead.
+		std::vector<std::size_t> newlines;
+		bool indexed = false;
+		std::shared_ptr<Block> prev;
+
+		~Block();
+	};
 
 	struct Piece {
-		Source src;
+		const Block *blk;
 		std::size_t start;
 		std::size_t len;
+		std::size_t lines; // number of '\n' bytes inside this piece
 	};
 
-	void addPieceBack(Source src, std::size_t start, std::size_t len);
+	// Pieces are kept in a height-balanced (AVL) tree ordered by document
+	// position. Every node caches the byte length, newline count and piece
+	// count of its subtree, so offset lookup, split and join are O(log n).
+	// Nodes are immutable once built: edits path-copy, and copies of the
+	// table share structure.
+	struct Node;
+	using NodePtr = std::shared_ptr<const Node>;
+
+	struct Node {
+		Piece piece;
+		NodePtr left;
+		NodePtr right;
+		std::size_t bytes  = 0; // subtree byte length
+		std::size_t lines  = 0; // subtree newline count
+		std::size_t pieces = 0; // subtree piece count
+		int height         = 0;
+	};
 
-	void addPieceFront(Source src, std::size_t start, std::size_t len);
+	// Tree primitives
+	static NodePtr makeNode(const Piece &p, NodePtr left, NodePtr right);
 
-	void materialize() const;
+	static NodePtr rebalance(const Piece &p, NodePtr left, NodePtr right);
+
+	static NodePtr join(NodePtr left, const Piece &p, NodePtr right);
+
+	static NodePtr popFirst(const NodePtr &n, Piece &out);
+
+	static NodePtr popLast(const NodePtr &n, Piece &out);
+
+	// Split into [0, byte_offset) and [byte_offset, end); a piece straddling
+	// the offset is cut in two.
+	[[nodiscard]] std::pair<NodePtr, NodePtr> split(const NodePtr &n, std::size_t byte_offset) const;
 
-	// Helper: locate piece index and inner offset for a global byte offset
-	[[nodiscard]] std::pair<std::size_t, std::size_t> locate(std::size_t byte_offset) const;
+	// Concatenate two trees, merging the pieces at the seam when they are contiguous.
+	static NodePtr concat(NodePtr left, NodePtr right);
+
+	static bool contiguous(const Piece &a, const Piece &b)
+	{
+		return a.blk == b.blk && a.start + a.len == b.start;
+	}
+
+
+	static Piece makePiece(const Block *blk, std::size_t start, std::size_t len);
+
+	static std::size_t countNewlines(const Block *blk, std::size_t start, std::size_t len);
+
+	// Offset within blk of the k-th (1-based) newline at or after start
+	static std::size_t nthNewline(const Block *blk, std::size_t start, std::size_t k);
+
+	static const char *sourceOf(const Piece &p)
+	{
+		return p.blk->data.get();
+	}
 
-	// Helper: try to coalesce neighboring pieces around index
-	void coalesceNeighbors(std::size_t index);
+
+	// Copy text into add storage and return a piece covering it. Text that
+	// does not fit the current add block gets a fresh block.
+	Piece appendAdd(const char *text, std::size_t len);
+
+
+	// Piece containing byte_offset and the document offset at which it starts
+	[[nodiscard]] std::pair<std::size_t, Piece> pieceAt(std::size_t byte_offset) const;
+
+	// Visit the bytes in [byte_offset, byte_offset + len) piece by piece, in
+	// order, until fn(data, len) returns false.
+	template<typename Fn>
+	void forEachPiece(std::size_t byte_offset, std::size_t len, Fn &&fn) const;
+
+	void insertPiece(std::size_t byte_offset, const Piece &p);
+
+	// Balanced tree over pieces [lo, hi), in order
+	static NodePtr build(const std::vector<Piece> &pieces, std::size_t lo, std::size_t hi);
+
+	void materialize() const;
 
 	// Consolidation helpers and heuristics
-	void maybeConsolidate();
+	void maybeConsolidate(std::size_t byte_offset);
 
-	void consolidateRange(std::size_t start_idx, std::size_t end_idx);
+	void consolidateRange(std::size_t byte_offset, std::size_t len);
 
-	void appendPieceDataTo(std::string &out, const Piece &p) const;
+	// Line index support. The tree's per-node newline counts are the line
+	// index: they are maintained by every split/join, so line queries descend
+	// the tree instead of rescanning the document after an edit.
+	[[nodiscard]] std::size_t lineStart(std::size_t line_num) const; // byte offset where line_num begins
 
-	// Line index support (rebuilt lazily on demand)
-	void InvalidateLineIndex() const;
+	[[nodiscard]] std::size_t newlinesBefore(std::size_t byte_offset) const;
 
-	void RebuildLineIndex() const;
+	[[nodiscard]] char byteAt(std::size_t byte_offset) const;
 
 	// Underlying storages
-	std::string original_; // unused for builder use-case, but kept for API symmetry
-	std::string add_;
-	std::vector<Piece> pieces_;
+	std::shared_ptr<const Block> original_; // may point into a file mapping
+	std::shared_ptr<Block> add_tail_; // newest add block
+	std::size_t add_block_size_ = 64 * 1024;
+	NodePtr root_;
 
 	mutable std::string materialized_;
 	mutable bool dirty_ = true;
@@ -149,10 +289,6 @@ private:
 	mutable std::uint64_t version_ = 0;
 	std::size_t total_size_        = 0;
 
-	// Cached line index: starting byte offset of each line (always contains at least 1 entry: 0)
-	mutable std::vector<std::size_t> line_index_;
-	mutable bool line_index_dirty_ = true;
-
 	// Heuristic knobs
 	std::size_t piece_limit_             = 4096; // trigger consolidation when exceeded
 	std::size_t small_piece_threshold_   = 64; // bytes
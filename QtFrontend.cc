@@ -13,7 +13,6 @@
 #include <QPainter>
 #include <QPaintEvent>
 #include <QWheelEvent>
-#include <regex>
 
 #include "Editor.h"
 #include "Command.h"
@@ -123,8 +122,7 @@ protected:
 		if (ed_ && viewport.height() > 0 && viewport.width() > 0) {
 			const Buffer *buf = ed_->CurrentBuffer();
 			if (buf) {
-				const auto &lines         = buf->Rows();
-				const std::size_t nrows   = lines.size();
+				const std::size_t nrows   = buf->Nrows();
 				const std::size_t rowoffs = buf->Rowoffs();
 				const std::size_t coloffs = buf->Coloffs();
 				const std::size_t cy      = buf->Cury();
@@ -142,11 +140,21 @@ protected:
 				p.save();
 				p.setClipRect(viewport);
 
+				// Search hits for the visible rows
+				if (ed_->SearchActive() && !ed_->SearchQuery().empty()) {
+					const bool regex = ed_->PromptActive() &&
+					                   (ed_->CurrentPromptKind() == Editor::PromptKind::RegexSearch ||
+					                    ed_->CurrentPromptKind() == Editor::PromptKind::RegexReplaceFind);
+					buf->SearchHighlights().PrefetchViewport(*buf, rowoffs, last_row - std::min(last_row, rowoffs),
+					                                         buf->Version(), ed_->SearchQuery(), regex,
+					                                         ed_->FindOptions());
+				}
+
     // Iterate visible lines
     for (std::size_t i = rowoffs, vis_idx = 0; i < last_row; ++i, ++vis_idx) {
-        // Materialize the Buffer::Line into a std::string for
+        // Fetch just this line as a std::string for
         // regex/iterator usage and general string ops.
-        const std::string line = static_cast<std::string>(lines[i]);
+        const std::string line = buf->GetLineString(i);
 					const int y        = viewport.y() + static_cast<int>(vis_idx) * line_h;
 					const int baseline = y + fm.ascent();
 
@@ -161,39 +169,7 @@ protected:
 
 					// Search-match background highlights first (under text)
 					if (ed_->SearchActive() && !ed_->SearchQuery().empty()) {
-						std::vector<std::pair<std::size_t, std::size_t> > hl_src_ranges;
-						// Compute ranges per line (source indices)
-						if (ed_->PromptActive() &&
-						    (ed_->CurrentPromptKind() == Editor::PromptKind::RegexSearch ||
-						     ed_->CurrentPromptKind() ==
-						     Editor::PromptKind::RegexReplaceFind)) {
-							try {
-								std::regex rx(ed_->SearchQuery());
-								for (auto it = std::sregex_iterator(
-									     line.begin(), line.end(), rx);
-								     it != std::sregex_iterator(); ++it) {
-									const auto &m  = *it;
-									std::size_t sx = static_cast<std::size_t>(m.
-										position());
-									std::size_t ex =
-										sx + static_cast<std::size_t>(m.
-											length());
-									hl_src_ranges.emplace_back(sx, ex);
-								}
-							} catch (const std::regex_error &) {
-								// Invalid regex: ignore, status line already shows errors
-							}
-						} else {
-							const std::string &q = ed_->SearchQuery();
-							if (!q.empty()) {
-								std::size_t pos = 0;
-								while ((pos = line.find(q, pos)) != std::string::npos) {
-									hl_src_ranges.emplace_back(pos, pos + q.size());
-									pos += q.size();
-								}
-							}
-						}
-
+						const auto &hl_src_ranges = buf->SearchHighlights().Hits(*buf, i);
 						if (!hl_src_ranges.empty()) {
 							const bool has_current =
 								ed_->SearchMatchLen() > 0 && ed_->SearchMatchY() == i;
@@ -276,28 +252,30 @@ protected:
 					// Syntax highlighting spans or plain text
 					if (buf->SyntaxEnabled() && buf->Highlighter() && buf->Highlighter()->
 					    HasHighlighter()) {
-						kte::LineHighlight lh = buf->Highlighter()->GetLine(
-							*buf, static_cast<int>(i), buf->Version());
 						struct SSpan {
 							std::size_t s;
 							std::size_t e;
 							kte::TokenKind k;
 						};
 						std::vector<SSpan> spans;
-						spans.reserve(lh.spans.size());
 						const std::size_t line_len = line.size();
-						for (const auto &sp: lh.spans) {
-							int s_raw = sp.col_start;
-							int e_raw = sp.col_end;
-							if (e_raw < s_raw)
-								std::swap(e_raw, s_raw);
-							std::size_t s = static_cast<std::size_t>(std::max(
-								0, std::min(s_raw, (int) line_len)));
-							std::size_t e = static_cast<std::size_t>(std::max(
-								(int) s, std::min(e_raw, (int) line_len)));
-							if (s < e)
-								spans.push_back({s, e, sp.kind});
-						}
+						buf->Highlighter()->WithLine(
+							*buf, static_cast<int>(i), buf->Version(),
+							[&](const std::vector<kte::HighlightSpan> &line_spans) {
+								spans.reserve(line_spans.size());
+								for (const auto &sp: line_spans) {
+									int s_raw = sp.col_start;
+									int e_raw = sp.col_end;
+									if (e_raw < s_raw)
+										std::swap(e_raw, s_raw);
+									std::size_t s = static_cast<std::size_t>(std::max(
+										0, std::min(s_raw, (int) line_len)));
+									std::size_t e = static_cast<std::size_t>(std::max(
+										(int) s, std::min(e_raw, (int) line_len)));
+									if (s < e)
+										spans.push_back({s, e, sp.kind});
+								}
+							});
 						std::sort(spans.begin(), spans.end(),
 						          [](const SSpan &a, const SSpan &b) {
 							          return a.s < b.s;
@@ -476,7 +454,7 @@ protected:
 						left += QStringLiteral(" *");
 
 					// total lines suffix " <n>L"
-					unsigned long lcount = static_cast<unsigned long>(buf->Rows().size());
+					unsigned long lcount = static_cast<unsigned long>(buf->Nrows());
 					left += QStringLiteral(" ");
 					left += QString::number(static_cast<qlonglong>(lcount));
 					left += QStringLiteral("L");
@@ -619,7 +597,7 @@ protected:
 				long nr = static_cast<long>(new_rowoffs) + d_rows;
 				if (nr < 0)
 					nr = 0;
-				const auto nrows = static_cast<long>(buf->Rows().size());
+				const auto nrows = static_cast<long>(buf->Nrows());
 				if (nr > std::max(0L, nrows - 1))
 					nr = std::max(0L, nrows - 1);
 				new_rowoffs = static_cast<std::size_t>(nr);
@@ -787,6 +765,12 @@ GUIFrontend::Step(Editor &ed, bool &running)
 		}
 	}
 
+	// Report background saves and match counts that finished since the last
+	// step, and mapped files changed on disk
+	ed.PollSaves();
+	ed.PollFiles();
+	PollSearch(ed);
+
 	if (ed.QuitRequested()) {
 		running = false;
 	}
@@ -0,0 +1,1348 @@
+#include "Regex.h"
+
+#include <algorithm>
+#include <bitset>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+
+namespace kte {
+namespace {
+constexpr std::size_t npos = std::numeric_limits<std::size_t>::max();
+
+// Limits that keep hostile patterns from exhausting memory or the stack
+constexpr int kMaxNesting     = 256;
+constexpr int kMaxRepeat      = 1000;
+constexpr std::size_t kMaxPc  = 100000;
+constexpr int kMaxGroups      = 99;
+constexpr std::size_t kMaxDfa = 4096; // states kept before the DFA cache is flushed
+
+using ByteSet = std::bitset<256>;
+
+enum class Op : std::uint8_t {
+	Byte, // consume one byte in classes[x]
+	Split, // fork: x preferred, y alternative
+	Jmp, // goto x
+	Save, // record position in slot x
+	Match,
+	Bol, // assert start of text
+	Eol, // assert end of text
+	WordB, // assert \b
+	NotWordB, // assert \B
+};
+
+struct Inst {
+	Op op;
+	int x = 0;
+	int y = 0;
+};
+
+
+struct SyntaxError : std::runtime_error {
+	using std::runtime_error::runtime_error;
+};
+
+
+bool
+is_word(const unsigned char c)
+{
+	return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+
+ByteSet
+set_of(bool (*pred)(unsigned char))
+{
+	ByteSet s;
+	for (int c = 0; c < 256; ++c)
+		s[c] = pred(static_cast<unsigned char>(c));
+	return s;
+}
+
+
+bool
+is_digit(const unsigned char c)
+{
+	return c >= '0' && c <= '9';
+}
+
+
+bool
+is_space(const unsigned char c)
+{
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+
+// ===== Parser: pattern text -> syntax tree =====
+
+struct Node {
+	enum Kind { Empty, Class, Concat, Alt, Repeat, Group, Bol, Eol, WordB, NotWordB } kind = Empty;
+
+	int cls    = -1; // Class: index into Program::classes
+	int min    = 0; // Repeat bounds; max < 0 means unbounded
+	int max    = 0;
+	bool lazy  = false;
+	int group  = -1; // Group: capture index, or -1 for (?:...)
+	std::vector<std::unique_ptr<Node> > kids;
+};
+
+using NodePtr = std::unique_ptr<Node>;
+
+
+NodePtr
+make_node(const Node::Kind k)
+{
+	auto n  = std::make_unique<Node>();
+	n->kind = k;
+	return n;
+}
+} // namespace
+
+
+struct Regex::Program {
+	std::string pattern;
+	std::vector<Inst> insts;
+	std::vector<ByteSet> classes;
+	int groups            = 0;
+	bool word_assertions  = false; // \b or \B present; the DFA does not model them
+	int nbyte_classes     = 0;
+	std::uint8_t byte_class[256]{}; // bytes no instruction tells apart share a class
+	bool has_first        = false; // every match starts with a byte in first
+	ByteSet first;
+	std::vector<std::string> required; // see Regex::RequiredLiterals
+};
+
+
+namespace {
+class Parser {
+public:
+	Parser(std::string_view pattern, Regex::Program &prog)
+		: p_(pattern), prog_(prog) {}
+
+
+	NodePtr Parse()
+	{
+		NodePtr n = alternation(0);
+		if (i_ < p_.size())
+			fail("unmatched ')'");
+		return n;
+	}
+
+private:
+	[[noreturn]] void fail(const std::string &what) const
+	{
+		throw SyntaxError(what + " at offset " + std::to_string(i_));
+	}
+
+
+	bool eof() const
+	{
+		return i_ >= p_.size();
+	}
+
+
+	char peek() const
+	{
+		return p_[i_];
+	}
+
+
+	NodePtr class_node(const ByteSet &s)
+	{
+		auto n = make_node(Node::Class);
+		n->cls = static_cast<int>(prog_.classes.size());
+		prog_.classes.push_back(s);
+		return n;
+	}
+
+
+	NodePtr alternation(const int depth)
+	{
+		if (depth > kMaxNesting)
+			fail("pattern nested too deeply");
+		NodePtr first = concatenation(depth);
+		if (eof() || peek() != '|')
+			return first;
+		auto alt = make_node(Node::Alt);
+		alt->kids.push_back(std::move(first));
+		while (!eof() && peek() == '|') {
+			++i_;
+			alt->kids.push_back(concatenation(depth));
+		}
+		return alt;
+	}
+
+
+	NodePtr concatenation(const int depth)
+	{
+		auto cat = make_node(Node::Concat);
+		while (!eof() && peek() != '|' && peek() != ')')
+			cat->kids.push_back(repetition(depth));
+		if (cat->kids.size() == 1)
+			return std::move(cat->kids.front());
+		return cat;
+	}
+
+
+	// Parse {n}, {n,} or {n,m} at i_; false (i_ unchanged) if it is not one,
+	// in which case '{' is an ordinary character.
+	bool braces(int &min, int &max)
+	{
+		std::size_t j = i_ + 1;
+		auto number   = [&](int &out) {
+			const std::size_t s = j;
+			long v              = 0;
+			while (j < p_.size() && p_[j] >= '0' && p_[j] <= '9') {
+				v = std::min<long>(v * 10 + (p_[j] - '0'), kMaxRepeat + 1);
+				++j;
+			}
+			out = static_cast<int>(v);
+			return j > s;
+		};
+		if (!number(min))
+			return false;
+		max = min;
+		if (j < p_.size() && p_[j] == ',') {
+			++j;
+			max = -1;
+			if (j < p_.size() && p_[j] != '}' && !number(max))
+				return false;
+		}
+		if (j >= p_.size() || p_[j] != '}')
+			return false;
+		if (min > kMaxRepeat || max > kMaxRepeat)
+			fail("repetition count too large");
+		if (max >= 0 && max < min)
+			fail("invalid repetition range");
+		i_ = j + 1;
+		return true;
+	}
+
+
+	bool quantifier(int &min, int &max)
+	{
+		if (eof())
+			return false;
+		switch (peek()) {
+		case '*':
+			min = 0, max = -1, ++i_;
+			return true;
+		case '+':
+			min = 1, max = -1, ++i_;
+			return true;
+		case '?':
+			min = 0, max = 1, ++i_;
+			return true;
+		case '{':
+			return braces(min, max);
+		default:
+			return false;
+		}
+	}
+
+
+	NodePtr repetition(const int depth)
+	{
+		const bool assertion = !eof() && (peek() == '^' || peek() == '$');
+		NodePtr atom_node    = atom(depth);
+		int min              = 0;
+		int max              = 0;
+		if (!quantifier(min, max))
+			return atom_node;
+		if (assertion || atom_node->kind == Node::WordB || atom_node->kind == Node::NotWordB)
+			fail("nothing to repeat");
+		auto rep  = make_node(Node::Repeat);
+		rep->min  = min;
+		rep->max  = max;
+		rep->lazy = !eof() && peek() == '?';
+		if (rep->lazy)
+			++i_;
+		int dummy_min = 0;
+		int dummy_max = 0;
+		if (quantifier(dummy_min, dummy_max))
+			fail("nothing to repeat");
+		rep->kids.push_back(std::move(atom_node));
+		return rep;
+	}
+
+
+	NodePtr atom(const int depth)
+	{
+		const char c = peek();
+		switch (c) {
+		case '(': {
+			++i_;
+			auto g = make_node(Node::Group);
+			if (i_ + 1 < p_.size() && peek() == '?') {
+				if (p_[i_ + 1] != ':')
+					fail("lookaround and inline flags are not supported");
+				i_ += 2;
+			} else {
+				if (prog_.groups >= kMaxGroups)
+					fail("too many capture groups");
+				g->group = ++prog_.groups;
+			}
+			g->kids.push_back(alternation(depth + 1));
+			if (eof() || peek() != ')')
+				fail("missing ')'");
+			++i_;
+			return g;
+		}
+		case '[':
+			++i_;
+			return class_node(bracket());
+		case '.': {
+			++i_;
+			ByteSet s;
+			s.set();
+			s['\n'] = false;
+			s['\r'] = false;
+			return class_node(s);
+		}
+		case '^':
+			++i_;
+			return make_node(Node::Bol);
+		case '$':
+			++i_;
+			return make_node(Node::Eol);
+		case '\\':
+			++i_;
+			return escape();
+		case '*':
+		case '+':
+		case '?':
+			fail("nothing to repeat");
+		case '{': {
+			int min = 0;
+			int max = 0;
+			if (braces(min, max))
+				fail("nothing to repeat");
+			break;
+		}
+		default:
+			break;
+		}
+		++i_;
+		ByteSet s;
+		s[static_cast<unsigned char>(c)] = true;
+		return class_node(s);
+	}
+
+
+	// Add the bytes an escape (after the backslash) stands for to s
+	void escape_set(ByteSet &s, const bool in_class)
+	{
+		if (eof())
+			fail("trailing backslash");
+		const char c = p_[i_++];
+		switch (c) {
+		case 'd':
+			s |= set_of(is_digit);
+			return;
+		case 'D':
+			s |= ~set_of(is_digit);
+			return;
+		case 'w':
+			s |= set_of(is_word);
+			return;
+		case 'W':
+			s |= ~set_of(is_word);
+			return;
+		case 's':
+			s |= set_of(is_space);
+			return;
+		case 'S':
+			s |= ~set_of(is_space);
+			return;
+		default:
+			break;
+		}
+		s[static_cast<unsigned char>(escape_byte(c, in_class))] = true;
+	}
+
+
+	char escape_byte(const char c, const bool in_class)
+	{
+		switch (c) {
+		case 'n':
+			return '\n';
+		case 't':
+			return '\t';
+		case 'r':
+			return '\r';
+		case 'f':
+			return '\f';
+		case 'v':
+			return '\v';
+		case '0':
+			return '\0';
+		case 'b':
+			if (in_class)
+				return '\b';
+			break;
+		case 'x': {
+			auto hex = [this](char h) -> int {
+				if (h >= '0' && h <= '9')
+					return h - '0';
+				if (h >= 'a' && h <= 'f')
+					return h - 'a' + 10;
+				if (h >= 'A' && h <= 'F')
+					return h - 'A' + 10;
+				fail("invalid \\x escape");
+			};
+			if (i_ + 2 > p_.size())
+				fail("invalid \\x escape");
+			const int v = hex(p_[i_]) * 16 + hex(p_[i_ + 1]);
+			i_ += 2;
+			return static_cast<char>(v);
+		}
+		default:
+			break;
+		}
+		if (c >= '1' && c <= '9')
+			fail("backreferences are not supported");
+		if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+			fail(std::string("unsupported escape \\") + c);
+		return c; // escaped punctuation stands for itself
+	}
+
+
+	NodePtr escape()
+	{
+		if (!eof() && (peek() == 'b' || peek() == 'B')) {
+			prog_.word_assertions = true;
+			return make_node(p_[i_++] == 'b' ? Node::WordB : Node::NotWordB);
+		}
+		ByteSet s;
+		escape_set(s, false);
+		return class_node(s);
+	}
+
+
+	// Body of [...] after the '['. ECMAScript: "[]" matches nothing and
+	// "[^]" matches any byte.
+	ByteSet bracket()
+	{
+		ByteSet s;
+		const bool negate = !eof() && peek() == '^';
+		if (negate)
+			++i_;
+		while (true) {
+			if (eof())
+				fail("missing ']'");
+			if (peek() == ']') {
+				++i_;
+				break;
+			}
+			// One class item: a byte (possibly the start of a range) or a class escape
+			int lo = -1;
+			if (peek() == '\\') {
+				++i_;
+				if (eof())
+					fail("trailing backslash");
+				const char e = peek();
+				if (e == 'd' || e == 'D' || e == 'w' || e == 'W' || e == 's' || e == 'S') {
+					escape_set(s, true);
+					continue;
+				}
+				++i_;
+				lo = static_cast<unsigned char>(escape_byte(e, true));
+			} else {
+				lo = static_cast<unsigned char>(p_[i_++]);
+			}
+			if (i_ + 1 < p_.size() && peek() == '-' && p_[i_ + 1] != ']') {
+				++i_;
+				int hi = -1;
+				if (peek() == '\\') {
+					++i_;
+					if (eof())
+						fail("trailing backslash");
+					hi = static_cast<unsigned char>(escape_byte(p_[i_++], true));
+				} else {
+					hi = static_cast<unsigned char>(p_[i_++]);
+				}
+				if (hi < lo)
+					fail("invalid range in character class");
+				for (int b = lo; b <= hi; ++b)
+					s[b] = true;
+			} else {
+				s[lo] = true;
+			}
+		}
+		return negate ? ~s : s;
+	}
+
+
+	std::string_view p_;
+	std::size_t i_ = 0;
+	Regex::Program &prog_;
+};
+
+
+// ===== Code generation: syntax tree -> NFA program =====
+
+class Emitter {
+public:
+	explicit Emitter(Regex::Program &prog)
+		: prog_(prog) {}
+
+
+	void Emit(const Node &n)
+	{
+		switch (n.kind) {
+		case Node::Empty:
+			break;
+		case Node::Class:
+			push(Inst{Op::Byte, n.cls, 0});
+			break;
+		case Node::Concat:
+			for (const auto &k: n.kids)
+				Emit(*k);
+			break;
+		case Node::Alt: {
+			// split L1, next; L1: a; jmp end; next: split L2, ... ; last alternative
+			std::vector<std::size_t> jumps;
+			for (std::size_t i = 0; i + 1 < n.kids.size(); ++i) {
+				const std::size_t split = push(Inst{Op::Split, 0, 0});
+				at(split).x             = pc();
+				Emit(*n.kids[i]);
+				jumps.push_back(push(Inst{Op::Jmp, 0, 0}));
+				at(split).y = pc();
+			}
+			Emit(*n.kids.back());
+			for (std::size_t j: jumps)
+				at(j).x = pc();
+			break;
+		}
+		case Node::Repeat:
+			repeat(n);
+			break;
+		case Node::Group:
+			if (n.group >= 0)
+				push(Inst{Op::Save, 2 * n.group, 0});
+			Emit(*n.kids.front());
+			if (n.group >= 0)
+				push(Inst{Op::Save, 2 * n.group + 1, 0});
+			break;
+		case Node::Bol:
+			push(Inst{Op::Bol, 0, 0});
+			break;
+		case Node::Eol:
+			push(Inst{Op::Eol, 0, 0});
+			break;
+		case Node::WordB:
+			push(Inst{Op::WordB, 0, 0});
+			break;
+		case Node::NotWordB:
+			push(Inst{Op::NotWordB, 0, 0});
+			break;
+		}
+	}
+
+private:
+	int pc() const
+	{
+		return static_cast<int>(prog_.insts.size());
+	}
+
+
+	Inst &at(const std::size_t i)
+	{
+		return prog_.insts[i];
+	}
+
+
+	std::size_t push(const Inst &in)
+	{
+		if (prog_.insts.size() >= kMaxPc)
+			throw SyntaxError("pattern too large");
+		prog_.insts.push_back(in);
+		return prog_.insts.size() - 1;
+	}
+
+
+	// Point a split at the loop body and the exit, preferring the body
+	// unless the repetition is lazy
+	void set_fork(const std::size_t split, const int body, const int out, const bool lazy)
+	{
+		at(split).x = lazy ? out : body;
+		at(split).y = lazy ? body : out;
+	}
+
+
+	void repeat(const Node &n)
+	{
+		const Node &body = *n.kids.front();
+		for (int i = 0; i < n.min; ++i)
+			Emit(body);
+		if (n.max < 0) {
+			// L: split body, out; body; jmp L
+			const std::size_t split = push(Inst{Op::Split, 0, 0});
+			const int body_pc       = pc();
+			Emit(body);
+			push(Inst{Op::Jmp, static_cast<int>(split), 0});
+			set_fork(split, body_pc, pc(), n.lazy);
+			return;
+		}
+		// Optional copies: split body, out; body; split body, out; body ...
+		std::vector<std::size_t> splits;
+		for (int i = n.min; i < n.max; ++i) {
+			splits.push_back(push(Inst{Op::Split, 0, 0}));
+			Emit(body);
+		}
+		for (std::size_t s: splits)
+			set_fork(s, static_cast<int>(s) + 1, pc(), n.lazy);
+	}
+
+
+	Regex::Program &prog_;
+};
+
+
+// Partition the bytes into classes that every Byte instruction treats alike,
+// so the DFA needs one transition per class rather than per byte.
+void
+compute_byte_classes(Regex::Program &prog)
+{
+	std::vector<std::string> sig(256);
+	for (const auto &cls: prog.classes) {
+		for (int b = 0; b < 256; ++b)
+			sig[b].push_back(cls[b] ? '1' : '0');
+	}
+	std::unordered_map<std::string, int> ids;
+	for (int b = 0; b < 256; ++b) {
+		auto it = ids.emplace(sig[b], static_cast<int>(ids.size())).first;
+		prog.byte_class[b] = static_cast<std::uint8_t>(it->second);
+	}
+	prog.nbyte_classes = static_cast<int>(ids.size());
+}
+
+
+// Collect the bytes a match can start with, treating assertions as always
+// true. A pattern that can match the empty string has no such set.
+void
+compute_first_bytes(Regex::Program &prog)
+{
+	std::vector<char> seen(prog.insts.size(), 0);
+	std::vector<int> stack{0};
+	while (!stack.empty()) {
+		const int pc = stack.back();
+		stack.pop_back();
+		if (seen[static_cast<std::size_t>(pc)])
+			continue;
+		seen[static_cast<std::size_t>(pc)] = 1;
+		const Inst &in                     = prog.insts[static_cast<std::size_t>(pc)];
+		switch (in.op) {
+		case Op::Byte:
+			prog.first |= prog.classes[static_cast<std::size_t>(in.x)];
+			break;
+		case Op::Match:
+			prog.has_first = false;
+			return;
+		case Op::Jmp:
+			stack.push_back(in.x);
+			break;
+		case Op::Split:
+			stack.push_back(in.y);
+			stack.push_back(in.x);
+			break;
+		default:
+			stack.push_back(pc + 1);
+			break;
+		}
+	}
+	prog.has_first = true;
+}
+
+
+// What a subpattern is known to match: exactly text when exact, else
+// something containing every string in required. Letters are lower-cased,
+// since the callers (index lookups) ignore ASCII case.
+struct Literals {
+	bool exact = true;
+	std::string text;
+	std::vector<std::string> required;
+};
+
+
+// The byte a class stands for, up to ASCII case, or -1
+int
+class_byte(const ByteSet &s)
+{
+	const std::size_t n = s.count();
+	if (n == 0 || n > 2)
+		return -1;
+	int b = 0;
+	while (!s[static_cast<std::size_t>(b)])
+		++b;
+	const int lower = b >= 'A' && b <= 'Z' ? b + ('a' - 'A') : b;
+	if (n == 1)
+		return lower;
+	// Two bytes: only a letter in both cases
+	return b >= 'A' && b <= 'Z' && s[static_cast<std::size_t>(lower)] ? lower : -1;
+}
+
+
+Literals
+literals(const Node &n, const Regex::Program &prog)
+{
+	Literals out;
+	switch (n.kind) {
+	case Node::Class: {
+		const int b = class_byte(prog.classes[static_cast<std::size_t>(n.cls)]);
+		if (b < 0)
+			out.exact = false;
+		else
+			out.text.push_back(static_cast<char>(b));
+		return out;
+	}
+	case Node::Group:
+		return literals(*n.kids.front(), prog);
+	case Node::Concat: {
+		std::string run; // adjacent exact kids
+		for (const auto &kid: n.kids) {
+			Literals k = literals(*kid, prog);
+			if (k.exact) {
+				run += k.text;
+				continue;
+			}
+			out.exact = false;
+			if (!run.empty())
+				out.required.push_back(std::move(run));
+			run.clear();
+			for (auto &r: k.required)
+				out.required.push_back(std::move(r));
+		}
+		if (out.exact)
+			out.text = std::move(run);
+		else if (!run.empty())
+			out.required.push_back(std::move(run));
+		return out;
+	}
+	case Node::Repeat: {
+		Literals k = literals(*n.kids.front(), prog);
+		if (k.exact && n.min == n.max && k.text.size() * static_cast<std::size_t>(n.min) <= 256) {
+			for (int i = 0; i < n.min; ++i)
+				out.text += k.text;
+			return out;
+		}
+		out.exact = false;
+		if (n.min >= 1) {
+			if (!k.exact)
+				out.required = std::move(k.required);
+			else if (!k.text.empty())
+				out.required.push_back(std::move(k.text));
+		}
+		return out;
+	}
+	case Node::Alt:
+		out.exact = false;
+		return out;
+	default:
+		return out; // empty, or an assertion: matches no bytes
+	}
+}
+
+
+std::shared_ptr<const Regex::Program>
+compile_program(const std::string &pattern)
+{
+	auto prog     = std::make_shared<Regex::Program>();
+	prog->pattern = pattern;
+	Parser parser(pattern, *prog);
+	NodePtr tree = parser.Parse();
+	Emitter em(*prog);
+	prog->insts.push_back(Inst{Op::Save, 0, 0});
+	em.Emit(*tree);
+	prog->insts.push_back(Inst{Op::Save, 1, 0});
+	prog->insts.push_back(Inst{Op::Match, 0, 0});
+	compute_byte_classes(*prog);
+	compute_first_bytes(*prog);
+	Literals lits = literals(*tree, *prog);
+	if (!lits.exact)
+		prog->required = std::move(lits.required);
+	else if (!lits.text.empty())
+		prog->required.push_back(std::move(lits.text));
+	return prog;
+}
+
+
+// Process-wide cache of compiled programs keyed by pattern text. Renderers
+// and commands recompile the same pattern on every frame or keystroke.
+std::shared_ptr<const Regex::Program>
+cached_program(const std::string &pattern)
+{
+	static std::mutex mtx;
+	static std::unordered_map<std::string, std::shared_ptr<const Regex::Program> > cache;
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		auto it = cache.find(pattern);
+		if (it != cache.end())
+			return it->second;
+	}
+	auto prog = compile_program(pattern); // throws SyntaxError
+	std::lock_guard<std::mutex> lock(mtx);
+	if (cache.size() >= 64)
+		cache.clear();
+	cache.emplace(pattern, prog);
+	return prog;
+}
+
+
+// Sparse set of instruction indices with insertion order (Briggs & Torczon)
+class PcSet {
+public:
+	void Resize(std::size_t n)
+	{
+		sparse_.assign(n, 0);
+		dense_.resize(n);
+		size_ = 0;
+	}
+
+
+	bool Contains(const int pc) const
+	{
+		const std::size_t i = sparse_[static_cast<std::size_t>(pc)];
+		return i < size_ && dense_[i] == pc;
+	}
+
+
+	void Insert(const int pc)
+	{
+		sparse_[static_cast<std::size_t>(pc)] = size_;
+		dense_[size_++]                       = pc;
+	}
+
+
+	void Clear()
+	{
+		size_ = 0;
+	}
+
+private:
+	std::vector<std::size_t> sparse_;
+	std::vector<int> dense_;
+	std::size_t size_ = 0;
+};
+
+
+bool
+at_word_boundary(const std::string_view text, const std::size_t pos)
+{
+	const bool before = pos > 0 && is_word(static_cast<unsigned char>(text[pos - 1]));
+	const bool after  = pos < text.size() && is_word(static_cast<unsigned char>(text[pos]));
+	return before != after;
+}
+} // namespace
+
+
+// ===== Lazy DFA: "does text contain a match?" =====
+
+// Each DFA state is the set of NFA instructions (Byte, Match, and Eol
+// assertions waiting for the end of text) live after some prefix of the
+// text, with a new thread started at every position. States and transitions
+// are built on first use; the cache is flushed when it grows past kMaxDfa.
+class Regex::Dfa {
+public:
+	explicit Dfa(const Program &prog)
+		: prog_(prog)
+	{
+		seen_.Resize(prog.insts.size());
+		reset();
+	}
+
+
+	bool AnyMatch(const std::string_view text, const std::size_t start)
+	{
+		if (start >= text.size())
+			return true; // ^ and $ can both hold here; leave it to the Pike VM
+		int s = start == 0 ? start_bol_ : start_mid_;
+		for (std::size_t i = start; i < text.size(); ++i) {
+			if (states_[static_cast<std::size_t>(s)].match)
+				return true;
+			const int cls = prog_.byte_class[static_cast<unsigned char>(text[i])];
+			int next      = trans_[static_cast<std::size_t>(s) * ncls_ + static_cast<std::size_t>(cls)];
+			if (next < 0)
+				next = transition(s, static_cast<unsigned char>(text[i]));
+			s = next;
+		}
+		return states_[static_cast<std::size_t>(s)].match || eol_match(s);
+	}
+
+private:
+	struct State {
+		std::vector<int> pcs;
+		bool match   = false;
+		int eol      = -1; // does reaching the end of text here match? -1 unknown
+	};
+
+
+	void reset()
+	{
+		states_.clear();
+		index_.clear();
+		trans_.clear();
+		ncls_ = static_cast<std::size_t>(prog_.nbyte_classes);
+		std::vector<int> seed{0};
+		mid_       = closure(seed, false, false);
+		start_bol_ = intern(closure(seed, true, false));
+		start_mid_ = intern(mid_);
+	}
+
+
+	// Follow epsilon edges from seeds; keep the instructions that consume a
+	// byte, Match, and (unless at_eol) unresolved Eol assertions.
+	std::vector<int> closure(const std::vector<int> &seeds, const bool at_bol, const bool at_eol)
+	{
+		seen_.Clear();
+		std::vector<int> out;
+		stack_.assign(seeds.rbegin(), seeds.rend());
+		while (!stack_.empty()) {
+			int pc = stack_.back();
+			stack_.pop_back();
+			while (!seen_.Contains(pc)) {
+				seen_.Insert(pc);
+				const Inst &in = prog_.insts[static_cast<std::size_t>(pc)];
+				switch (in.op) {
+				case Op::Jmp:
+					pc = in.x;
+					continue;
+				case Op::Split:
+					stack_.push_back(in.y);
+					pc = in.x;
+					continue;
+				case Op::Save:
+					++pc;
+					continue;
+				case Op::Bol:
+					if (!at_bol)
+						break;
+					++pc;
+					continue;
+				case Op::Eol:
+					if (at_eol) {
+						++pc;
+						continue;
+					}
+					out.push_back(pc);
+					break;
+				case Op::Byte:
+				case Op::Match:
+					out.push_back(pc);
+					break;
+				case Op::WordB:
+				case Op::NotWordB:
+					break; // programs with word assertions do not use the DFA
+				}
+				break;
+			}
+		}
+		std::sort(out.begin(), out.end());
+		return out;
+	}
+
+
+	int intern(std::vector<int> pcs)
+	{
+		std::string key(reinterpret_cast<const char *>(pcs.data()), pcs.size() * sizeof(int));
+		auto it = index_.find(key);
+		if (it != index_.end())
+			return it->second;
+		State st;
+		for (int pc: pcs)
+			st.match = st.match || prog_.insts[static_cast<std::size_t>(pc)].op == Op::Match;
+		st.pcs   = std::move(pcs);
+		const int id = static_cast<int>(states_.size());
+		states_.push_back(std::move(st));
+		trans_.resize(states_.size() * ncls_, -1);
+		index_.emplace(std::move(key), id);
+		return id;
+	}
+
+
+	int transition(int s, const unsigned char byte)
+	{
+		if (states_.size() >= kMaxDfa) {
+			std::vector<int> keep = states_[static_cast<std::size_t>(s)].pcs;
+			reset();
+			s = intern(std::move(keep));
+		}
+		std::vector<int> seeds;
+		for (int pc: states_[static_cast<std::size_t>(s)].pcs) {
+			const Inst &in = prog_.insts[static_cast<std::size_t>(pc)];
+			if (in.op == Op::Byte && prog_.classes[static_cast<std::size_t>(in.x)][byte])
+				seeds.push_back(pc + 1);
+		}
+		std::vector<int> next = closure(seeds, false, false);
+		// Unanchored: a new thread starts at every position
+		std::vector<int> merged;
+		merged.reserve(next.size() + mid_.size());
+		std::set_union(next.begin(), next.end(), mid_.begin(), mid_.end(), std::back_inserter(merged));
+		const int id = intern(std::move(merged));
+		trans_[static_cast<std::size_t>(s) * ncls_ + prog_.byte_class[byte]] = id;
+		return id;
+	}
+
+
+	bool eol_match(const int s)
+	{
+		State &st = states_[static_cast<std::size_t>(s)];
+		if (st.eol < 0) {
+			std::vector<int> seeds;
+			for (int pc: st.pcs)
+				if (prog_.insts[static_cast<std::size_t>(pc)].op == Op::Eol)
+					seeds.push_back(pc);
+			bool m = false;
+			for (int pc: closure(seeds, false, true))
+				m = m || prog_.insts[static_cast<std::size_t>(pc)].op == Op::Match;
+			states_[static_cast<std::size_t>(s)].eol = m ? 1 : 0;
+		}
+		return states_[static_cast<std::size_t>(s)].eol == 1;
+	}
+
+
+	const Program &prog_;
+	std::size_t ncls_ = 0;
+	std::vector<State> states_;
+	std::unordered_map<std::string, int> index_;
+	std::vector<int> trans_; // states_.size() * ncls_, -1 = not built yet
+	std::vector<int> mid_; // closure of a thread started mid-text
+	int start_bol_ = 0;
+	int start_mid_ = 0;
+	PcSet seen_;
+	std::vector<int> stack_;
+};
+
+
+// Pike VM thread lists and capture scratch, kept between searches so that
+// iterating over many matches does not reallocate them
+struct Regex::Vm {
+	struct List {
+		PcSet seen;
+		std::vector<int> pcs; // threads in priority order
+		std::vector<std::size_t> caps; // nslots per thread
+	};
+
+	struct Frame {
+		int pc;
+		int slot; // >= 0: restore caps[slot] = old instead of visiting pc
+		std::size_t old;
+	};
+
+
+	explicit Vm(const Program &prog)
+	{
+		clist.seen.Resize(prog.insts.size());
+		nlist.seen.Resize(prog.insts.size());
+	}
+
+
+	List clist;
+	List nlist;
+	std::vector<Frame> stack;
+	std::vector<std::size_t> caps;
+	std::vector<std::size_t> best;
+};
+
+
+// ===== Regex =====
+
+Regex::Regex() = default;
+
+Regex::~Regex() = default;
+
+
+Regex::Regex(const Regex &other)
+	: prog_(other.prog_) {}
+
+
+Regex &
+Regex::operator=(const Regex &other)
+{
+	if (this != &other) {
+		prog_ = other.prog_;
+		dfa_.reset();
+		vm_.reset();
+	}
+	return *this;
+}
+
+
+Regex::Regex(Regex &&other) noexcept = default;
+
+Regex &Regex::operator=(Regex &&other) noexcept = default;
+
+
+bool
+Regex::Compile(const std::string &pattern, std::string &err)
+{
+	dfa_.reset();
+	vm_.reset();
+	prog_.reset();
+	try {
+		prog_ = cached_program(pattern);
+	} catch (const SyntaxError &e) {
+		err = e.what();
+		return false;
+	}
+	return true;
+}
+
+
+const std::string &
+Regex::Pattern() const
+{
+	static const std::string empty;
+	return prog_ ? prog_->pattern : empty;
+}
+
+
+const std::vector<std::string> &
+Regex::RequiredLiterals() const
+{
+	static const std::vector<std::string> none;
+	return prog_ ? prog_->required : none;
+}
+
+
+std::size_t
+Regex::Groups() const
+{
+	return prog_ ? static_cast<std::size_t>(prog_->groups) : 0;
+}
+
+
+// Pike VM: run every NFA thread in lock step over the text, in priority
+// order, so the first thread to reach Match is the leftmost-first match
+// a backtracking matcher would report. Threads carry their own capture
+// slots; epsilon closures use an explicit stack.
+bool
+Regex::search(const std::string_view text, const std::size_t start, const bool anchored, const bool not_null,
+              std::vector<Span> &groups)
+{
+	if (!prog_ || start > text.size())
+		return false;
+	const Program &prog = *prog_;
+	if (!prog.word_assertions && !anchored) {
+		if (!dfa_)
+			dfa_ = std::make_unique<Dfa>(prog);
+		if (!dfa_->AnyMatch(text, start))
+			return false;
+	}
+
+	if (!vm_)
+		vm_ = std::make_unique<Vm>(prog);
+	const std::size_t nslots = 2 * static_cast<std::size_t>(prog.groups + 1);
+	Vm::List &clist          = vm_->clist;
+	Vm::List &nlist          = vm_->nlist;
+	auto &stack              = vm_->stack;
+	auto &caps               = vm_->caps;
+	auto &best               = vm_->best;
+	caps.assign(nslots, npos);
+
+	// Add the thread at pc with captures caps (restored before returning)
+	auto add = [&](Vm::List &l, const int pc0, const std::size_t pos) {
+		stack.push_back(Vm::Frame{pc0, -1, 0});
+		while (!stack.empty()) {
+			const Vm::Frame f = stack.back();
+			stack.pop_back();
+			if (f.slot >= 0) {
+				caps[static_cast<std::size_t>(f.slot)] = f.old;
+				continue;
+			}
+			int pc = f.pc;
+			while (!l.seen.Contains(pc)) {
+				l.seen.Insert(pc);
+				const Inst &in = prog.insts[static_cast<std::size_t>(pc)];
+				bool follow    = false;
+				switch (in.op) {
+				case Op::Jmp:
+					pc     = in.x;
+					follow = true;
+					break;
+				case Op::Split:
+					stack.push_back(Vm::Frame{in.y, -1, 0});
+					pc     = in.x;
+					follow = true;
+					break;
+				case Op::Save:
+					stack.push_back(Vm::Frame{0, in.x, caps[static_cast<std::size_t>(in.x)]});
+					caps[static_cast<std::size_t>(in.x)] = pos;
+					++pc;
+					follow = true;
+					break;
+				case Op::Bol:
+					follow = pos == 0;
+					++pc;
+					break;
+				case Op::Eol:
+					follow = pos == text.size();
+					++pc;
+					break;
+				case Op::WordB:
+					follow = at_word_boundary(text, pos);
+					++pc;
+					break;
+				case Op::NotWordB:
+					follow = !at_word_boundary(text, pos);
+					++pc;
+					break;
+				case Op::Byte:
+				case Op::Match:
+					l.pcs.push_back(pc);
+					l.caps.insert(l.caps.end(), caps.begin(), caps.end());
+					break;
+				}
+				if (!follow)
+					break;
+			}
+		}
+	};
+	auto clear = [](Vm::List &l) {
+		l.seen.Clear();
+		l.pcs.clear();
+		l.caps.clear();
+	};
+
+	clear(clist);
+	bool matched = false;
+	for (std::size_t pos = start;; ++pos) {
+		if (!matched && !anchored && clist.pcs.empty() && prog.has_first) {
+			// No live threads: skip to the next byte a match can start with
+			while (pos < text.size() && !prog.first[static_cast<unsigned char>(text[pos])])
+				++pos;
+			if (pos >= text.size())
+				break;
+		}
+		if (!matched && (!anchored || pos == start)) {
+			std::fill(caps.begin(), caps.end(), npos);
+			add(clist, 0, pos);
+		}
+		if (clist.pcs.empty() && (matched || anchored))
+			break;
+		clear(nlist);
+		const int c = pos < text.size() ? static_cast<unsigned char>(text[pos]) : -1;
+		for (std::size_t t = 0; t < clist.pcs.size(); ++t) {
+			const Inst &in         = prog.insts[static_cast<std::size_t>(clist.pcs[t])];
+			const std::size_t *tcp = clist.caps.data() + t * nslots;
+			if (in.op == Op::Match) {
+				if (not_null && tcp[0] == pos)
+					continue;
+				matched = true;
+				best.assign(tcp, tcp + nslots);
+				break; // lower-priority threads lose to this match
+			}
+			if (c >= 0 && prog.classes[static_cast<std::size_t>(in.x)][static_cast<std::size_t>(c)]) {
+				std::copy(tcp, tcp + nslots, caps.begin());
+				add(nlist, clist.pcs[t] + 1, pos + 1);
+			}
+		}
+		std::swap(clist, nlist);
+		if (pos >= text.size())
+			break;
+	}
+	if (!matched)
+		return false;
+	groups.assign(static_cast<std::size_t>(prog.groups + 1), Span{npos, npos});
+	for (std::size_t g = 0; g < groups.size(); ++g) {
+		if (best[2 * g] != npos && best[2 * g + 1] != npos)
+			groups[g] = Span{best[2 * g], best[2 * g + 1]};
+	}
+	return true;
+}
+
+
+bool
+Regex::Search(const std::string_view text, const std::size_t start, std::vector<Span> &groups)
+{
+	return search(text, start, false, false, groups);
+}
+
+
+bool
+Regex::next_match(const std::string_view text, std::vector<Span> &m)
+{
+	const std::size_t b = m[0].first;
+	const std::size_t e = m[0].second;
+	if (b == e) {
+		if (e >= text.size())
+			return false;
+		if (search(text, e, true, true, m))
+			return true;
+		return search(text, e + 1, false, false, m);
+	}
+	return search(text, e, false, false, m);
+}
+
+
+void
+Regex::FindAll(const std::string_view text, std::vector<Span> &out)
+{
+	std::vector<Span> m;
+	if (!search(text, 0, false, false, m))
+		return;
+	do {
+		out.push_back(m[0]);
+	} while (next_match(text, m));
+}
+
+
+std::size_t
+Regex::Replace(const std::string_view text, const std::string_view fmt, std::string &out)
+{
+	out.clear();
+	std::vector<Span> m;
+	std::size_t count = 0;
+	std::size_t copied = 0; // text before this offset is already in out
+	for (bool found = search(text, 0, false, false, m); found; found = next_match(text, m)) {
+		out.append(text.substr(copied, m[0].first - copied));
+		for (std::size_t i = 0; i < fmt.size(); ++i) {
+			if (fmt[i] != '$' || i + 1 >= fmt.size()) {
+				out.push_back(fmt[i]);
+				continue;
+			}
+			const char c = fmt[i + 1];
+			if (c == '$') {
+				out.push_back('$');
+				++i;
+			} else if (c == '&') {
+				out.append(text.substr(m[0].first, m[0].second - m[0].first));
+				++i;
+			} else if (c == '`') {
+				out.append(text.substr(0, m[0].first));
+				++i;
+			} else if (c == '\'') {
+				out.append(text.substr(m[0].second));
+				++i;
+			} else if (c >= '0' && c <= '9') {
+				// $n or $nn, preferring the two-digit group when it exists
+				std::size_t g   = static_cast<std::size_t>(c - '0');
+				std::size_t len = 1;
+				if (i + 2 < fmt.size() && fmt[i + 2] >= '0' && fmt[i + 2] <= '9') {
+					const std::size_t g2 = g * 10 + static_cast<std::size_t>(fmt[i + 2] - '0');
+					if (g2 < m.size()) {
+						g   = g2;
+						len = 2;
+					}
+				}
+				if (g < m.size()) {
+					if (m[g].first != npos)
+						out.append(text.substr(m[g].first, m[g].second - m[g].first));
+				}
+				i += len;
+			} else {
+				out.push_back('$');
+			}
+		}
+		copied = m[0].second;
+		++count;
+	}
+	out.append(text.substr(copied));
+	return count;
+}
+} // namespace kte
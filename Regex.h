@@ -0,0 +1,93 @@
+// Regex.h - linear-time regular expressions (Thompson NFA + lazy DFA)
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace kte {
+// Byte-oriented regular expressions covering the ECMAScript subset an editor
+// search needs: literals and escapes, '.', [classes] with ranges and \d \w \s
+// (and negations), groups (capturing and (?:...)), '|', greedy and lazy
+// * + ? {n} {n,} {n,m}, and the assertions ^ $ \b \B. Backreferences and
+// lookaround are rejected, since they cannot be matched in linear time.
+// Leftmost-first semantics and match iteration follow std::regex
+// (ECMAScript), so results match what std::regex would report.
+//
+// Matching never recurses and runs in O(text * pattern) time. A lazily
+// built DFA answers "is there any match" for each text, one table lookup per
+// byte, and a Pike VM over the NFA extracts match bounds and groups only for
+// texts that do match. Compiled programs are shared through a process-wide
+// cache keyed by pattern text; the DFA cache and VM scratch belong to each
+// Regex, so a Regex must not be used from two threads at once (copy it
+// instead).
+class Regex {
+public:
+	using Span = std::pair<std::size_t, std::size_t>; // [begin, end)
+
+	Regex();
+
+	~Regex();
+
+	Regex(const Regex &other);
+
+	Regex &operator=(const Regex &other);
+
+	Regex(Regex &&other) noexcept;
+
+	Regex &operator=(Regex &&other) noexcept;
+
+	// Compile pattern. On a syntax error returns false, sets err and leaves
+	// the Regex invalid.
+	bool Compile(const std::string &pattern, std::string &err);
+
+	[[nodiscard]] bool Valid() const
+	{
+		return static_cast<bool>(prog_);
+	}
+
+
+	[[nodiscard]] const std::string &Pattern() const;
+
+	// Strings every match contains, with ASCII letters lower-cased: the
+	// literal runs a match cannot avoid. Empty when there are none, e.g. for
+	// a top-level '|'.
+	[[nodiscard]] const std::vector<std::string> &RequiredLiterals() const;
+
+	// Number of capturing groups, not counting the whole match
+	[[nodiscard]] std::size_t Groups() const;
+
+	// Leftmost match starting at or after start. groups[0] is the whole
+	// match, groups[i] capture group i, or {npos, npos} if it did not take
+	// part. ^ and \b treat text[0] as the start of input even when start > 0.
+	bool Search(std::string_view text, std::size_t start, std::vector<Span> &groups);
+
+	// Every match, iterated the way std::sregex_iterator does
+	void FindAll(std::string_view text, std::vector<Span> &out);
+
+	// Replace every match with fmt, which may refer to $& (the match), $1..$99
+	// (groups), $` and $' (text before/after the match) and $$ (a '$'), as
+	// std::regex_replace does. Returns the number of replacements.
+	std::size_t Replace(std::string_view text, std::string_view fmt, std::string &out);
+
+	struct Program;
+	class Dfa;
+	struct Vm;
+
+private:
+	// Search with std::regex_iterator's retry rules: anchored at start and
+	// refusing an empty match when not_null is set
+	bool search(std::string_view text, std::size_t start, bool anchored, bool not_null, std::vector<Span> &groups);
+
+	// Advance an iteration past match m the way std::regex_iterator does;
+	// returns false at the end
+	bool next_match(std::string_view text, std::vector<Span> &m);
+
+	std::shared_ptr<const Program> prog_;
+	std::unique_ptr<Dfa> dfa_;
+	std::unique_ptr<Vm> vm_;
+};
+} // namespace kte
@@ -0,0 +1,108 @@
+#include "SearchOverlay.h"
+
+#include <algorithm>
+#include <string_view>
+
+#include "Buffer.h"
+
+
+namespace {
+const std::vector<SearchOverlay::Range> kNoHits;
+} // namespace
+
+
+void
+SearchOverlay::PrefetchViewport(const Buffer &buf, const std::size_t first_row, const std::size_t row_count,
+                                const std::uint64_t version, const std::string &query, const bool regex,
+                                const SearchOptions &opts)
+{
+	if (query != query_ || regex != regex_ || (!regex && opts != opts_)) {
+		Clear();
+		query_ = query;
+		regex_ = regex;
+		opts_  = opts;
+		search_.SetOptions(opts);
+		std::string err;
+		rx_ok_ = regex_ && rx_.Compile(query_, err);
+	}
+	version_                = version;
+	const std::size_t nrows = buf.Nrows();
+	if (row_count == 0 || first_row >= nrows)
+		return;
+	const std::size_t last = std::min(nrows, first_row + row_count);
+	if (first_row < base_ || last > base_ + rows_.size())
+		frame(first_row, last - first_row, nrows);
+	for (std::size_t row = first_row; row < last; ++row) {
+		Row &r = rows_[row - base_];
+		if (!r.valid || r.version != version_)
+			compute(buf, row, r);
+	}
+}
+
+
+const std::vector<SearchOverlay::Range> &
+SearchOverlay::Hits(const Buffer &buf, const std::size_t row)
+{
+	const std::size_t nrows = buf.Nrows();
+	if (query_.empty() || row >= nrows)
+		return kNoHits;
+	if (row < base_ || row >= base_ + rows_.size())
+		frame(row, std::max<std::size_t>(1, rows_.size() / 3), nrows);
+	Row &r = rows_[row - base_];
+	if (!r.valid || r.version != version_)
+		compute(buf, row, r);
+	return r.hits;
+}
+
+
+void
+SearchOverlay::Clear()
+{
+	query_.clear();
+	rx_ok_ = false;
+	base_  = 0;
+	rows_.clear();
+	rows_.shrink_to_fit();
+}
+
+
+void
+SearchOverlay::reframe(const std::size_t lo, const std::size_t hi)
+{
+	std::vector<Row> rows(hi - lo);
+	const std::size_t from = std::max(lo, base_);
+	const std::size_t to   = std::min(hi, base_ + rows_.size());
+	for (std::size_t row = from; row < to; ++row)
+		rows[row - lo] = std::move(rows_[row - base_]);
+	base_ = lo;
+	rows_ = std::move(rows);
+}
+
+
+void
+SearchOverlay::frame(const std::size_t first_row, const std::size_t row_count, const std::size_t nrows)
+{
+	const std::size_t lo = first_row > row_count ? first_row - row_count : 0;
+	reframe(lo, std::min(nrows, first_row + 2 * row_count));
+}
+
+
+void
+SearchOverlay::compute(const Buffer &buf, const std::size_t row, Row &out)
+{
+	out.valid   = true;
+	out.version = version_;
+	out.hits.clear();
+	std::string_view line = buf.GetLineView(row);
+	if (!line.empty() && line.back() == '\n')
+		line.remove_suffix(1);
+	if (regex_) {
+		if (rx_ok_)
+			rx_.FindAll(line, out.hits);
+		return;
+	}
+	for (std::size_t pos = 0; (pos = search_.find_in(line, query_, pos)) != std::string::npos;) {
+		out.hits.emplace_back(pos, pos + query_.size());
+		pos += query_.size();
+	}
+}
@@ -0,0 +1,75 @@
+// SearchOverlay.h - search-hit highlights for the rows on screen
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "OptimizedSearch.h"
+#include "Regex.h"
+
+class Buffer;
+
+
+// The search hits a renderer highlights, computed only for the rows it
+// draws, so the cost of an active search follows the viewport rather than
+// the size of the buffer. As HighlighterEngine does for syntax,
+// PrefetchViewport() computes the visible rows up front and each row is
+// cached with the buffer Version() it was computed for; Hits() then finds
+// them ready. Rows are kept for a window of about three screens around the
+// viewport, so scrolling back and forth reuses them and memory stays bounded
+// however large the buffer is. A new query, mode or SearchOptions drops the
+// cache, and a regex is compiled once per pattern rather than once per row.
+//
+// Literal hits follow OptimizedSearch::find_in under the given options,
+// regex hits kte::Regex::FindAll; an invalid pattern highlights nothing.
+class SearchOverlay {
+public:
+	using Range = std::pair<std::size_t, std::size_t>; // [start, end) source columns
+
+	// Compute the hits on rows [first_row, first_row + row_count) for query,
+	// reusing the rows already cached for this version
+	void PrefetchViewport(const Buffer &buf, std::size_t first_row, std::size_t row_count, std::uint64_t version,
+	                      const std::string &query, bool regex, const SearchOptions &opts);
+
+	// Hits on row for the query and version of the last PrefetchViewport(),
+	// in order; computed now if the row was not prefetched
+	const std::vector<Range> &Hits(const Buffer &buf, std::size_t row);
+
+	// Forget the cached rows, e.g. when the buffer's contents are replaced
+	void Clear();
+
+	// Rows currently cached
+	[[nodiscard]] std::size_t CachedRows() const
+	{
+		return rows_.size();
+	}
+
+private:
+	struct Row {
+		bool valid            = false;
+		std::uint64_t version = 0;
+		std::vector<Range> hits;
+	};
+
+	// Keep rows [lo, hi), carrying over the cached rows that overlap
+	void reframe(std::size_t lo, std::size_t hi);
+
+	// Frame rows [first_row, first_row + row_count) with a screen on either side
+	void frame(std::size_t first_row, std::size_t row_count, std::size_t nrows);
+
+	void compute(const Buffer &buf, std::size_t row, Row &out);
+
+	std::string query_;
+	bool regex_ = false;
+	SearchOptions opts_;
+	kte::Regex rx_;
+	bool rx_ok_ = false;
+	OptimizedSearch search_;
+	std::uint64_t version_ = 0;
+	// Cached rows [base_, base_ + rows_.size())
+	std::size_t base_ = 0;
+	std::vector<Row> rows_;
+};
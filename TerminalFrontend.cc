@@ -98,6 +98,12 @@ TerminalFrontend::Step(Editor &ed, bool &running)
 		}
 	}
 
+	// Report background saves and match counts that finished since the last
+	// step, and mapped files changed on disk
+	ed.PollSaves();
+	ed.PollFiles();
+	PollSearch(ed);
+
 	if (ed.QuitRequested()) {
 		running = false;
 	}
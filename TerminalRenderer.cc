@@ -3,7 +3,6 @@
 #include <filesystem>
 #include <cstdlib>
 #include <ncurses.h>
-#include <regex>
 #include <string>
 
 #include "TerminalRenderer.h"
@@ -39,9 +38,9 @@ TerminalRenderer::Draw(Editor &ed)
 
 	int saved_cur_y = -1, saved_cur_x = -1; // logical cursor position within content area
 	if (buf) {
-		const auto &lines   = buf->Rows();
-		std::size_t rowoffs = buf->Rowoffs();
-		std::size_t coloffs = buf->Coloffs();
+		const std::size_t nrows = buf->Nrows();
+		std::size_t rowoffs     = buf->Rowoffs();
+		std::size_t coloffs     = buf->Coloffs();
 
 		const int tabw = 8;
 		// Phase 3: prefetch visible viewport highlights (current terminal area)
@@ -50,42 +49,27 @@ TerminalRenderer::Draw(Editor &ed)
 			int rc = std::max(0, content_rows);
 			buf->Highlighter()->PrefetchViewport(*buf, fr, rc, buf->Version());
 		}
+		// Search hits for the same rows
+		const bool search_mode = ed.SearchActive() && !ed.SearchQuery().empty();
+		if (search_mode) {
+			const bool regex = ed.PromptActive() && (
+				                   ed.CurrentPromptKind() == Editor::PromptKind::RegexSearch ||
+				                   ed.CurrentPromptKind() == Editor::PromptKind::RegexReplaceFind);
+			const auto rc    = static_cast<std::size_t>(std::max(0, content_rows));
+			buf->SearchHighlights().PrefetchViewport(*buf, rowoffs, rc, buf->Version(), ed.SearchQuery(), regex,
+			                                         ed.FindOptions());
+		}
 
 		for (int r = 0; r < content_rows; ++r) {
 			move(r, 0);
 			std::size_t li         = rowoffs + static_cast<std::size_t>(r);
 			std::size_t render_col = 0;
 			std::size_t src_i      = 0;
-			// Compute matches for this line if search highlighting is active
-			bool search_mode = ed.SearchActive() && !ed.SearchQuery().empty();
-			std::vector<std::pair<std::size_t, std::size_t> > ranges; // [start, end)
-			if (search_mode && li < lines.size()) {
-				std::string sline = static_cast<std::string>(lines[li]);
-				// If regex search prompt is active (RegexSearch or RegexReplaceFind), use regex to compute highlight ranges
-				if (ed.PromptActive() && (
-					    ed.CurrentPromptKind() == Editor::PromptKind::RegexSearch || ed.
-					    CurrentPromptKind() == Editor::PromptKind::RegexReplaceFind)) {
-					try {
-						std::regex rx(ed.SearchQuery());
-						for (auto it = std::sregex_iterator(sline.begin(), sline.end(), rx);
-						     it != std::sregex_iterator(); ++it) {
-							const auto &m  = *it;
-							std::size_t sx = static_cast<std::size_t>(m.position());
-							std::size_t ex = sx + static_cast<std::size_t>(m.length());
-							ranges.emplace_back(sx, ex);
-						}
-					} catch (const std::regex_error &) {
-						// ignore invalid patterns here; status shows error
-					}
-				} else {
-					const std::string &q = ed.SearchQuery();
-					std::size_t pos      = 0;
-					while (!q.empty() && (pos = sline.find(q, pos)) != std::string::npos) {
-						ranges.emplace_back(pos, pos + q.size());
-						pos += q.size();
-					}
-				}
-			}
+			// Search hits on this line, [start, end) in source columns
+			static const std::vector<std::pair<std::size_t, std::size_t> > no_hits;
+			const auto &ranges = search_mode && li < nrows
+				                     ? buf->SearchHighlights().Hits(*buf, li)
+				                     : no_hits;
 			auto is_src_in_hl = [&](std::size_t si) -> bool {
 				if (ranges.empty())
 					return false;
@@ -107,35 +91,37 @@ TerminalRenderer::Draw(Editor &ed)
 			bool hl_on                 = false;
 			bool cur_on                = false;
 			int written                = 0;
-			if (li < lines.size()) {
-				std::string line = static_cast<std::string>(lines[li]);
+			if (li < nrows) {
+				std::string line = buf->GetLineString(li);
 				src_i            = 0;
 				render_col       = 0;
 				// Syntax highlighting: fetch per-line spans (sanitized copy)
 				std::vector<kte::HighlightSpan> sane_spans;
 				if (buf->SyntaxEnabled() && buf->Highlighter() && buf->Highlighter()->
 				    HasHighlighter()) {
-					kte::LineHighlight lh_val = buf->Highlighter()->GetLine(
-						*buf, static_cast<int>(li), buf->Version());
 					// Sanitize defensively: clamp to [0, line.size()], ensure end>=start, drop empties
 					const std::size_t line_len = line.size();
-					sane_spans.reserve(lh_val.spans.size());
-					for (const auto &sp: lh_val.spans) {
-						int s_raw = sp.col_start;
-						int e_raw = sp.col_end;
-						if (e_raw < s_raw)
-							std::swap(e_raw, s_raw);
-						std::size_t s = static_cast<std::size_t>(std::max(
-							0, std::min(s_raw, static_cast<int>(line_len))));
-						std::size_t e = static_cast<std::size_t>(std::max(
-							static_cast<int>(s),
-							std::min(e_raw, static_cast<int>(line_len))));
-						if (e <= s)
-							continue;
-						sane_spans.push_back(kte::HighlightSpan{
-							static_cast<int>(s), static_cast<int>(e), sp.kind
+					buf->Highlighter()->WithLine(
+						*buf, static_cast<int>(li), buf->Version(),
+						[&](const std::vector<kte::HighlightSpan> &line_spans) {
+							sane_spans.reserve(line_spans.size());
+							for (const auto &sp: line_spans) {
+								int s_raw = sp.col_start;
+								int e_raw = sp.col_end;
+								if (e_raw < s_raw)
+									std::swap(e_raw, s_raw);
+								std::size_t s = static_cast<std::size_t>(std::max(
+									0, std::min(s_raw, static_cast<int>(line_len))));
+								std::size_t e = static_cast<std::size_t>(std::max(
+									static_cast<int>(s),
+									std::min(e_raw, static_cast<int>(line_len))));
+								if (e <= s)
+									continue;
+								sane_spans.push_back(kte::HighlightSpan{
+									static_cast<int>(s), static_cast<int>(e), sp.kind
+								});
+							}
 						});
-					}
 					std::sort(sane_spans.begin(), sane_spans.end(),
 					          [](const kte::HighlightSpan &a, const kte::HighlightSpan &b) {
 						          return a.col_start < b.col_start;
@@ -301,8 +287,8 @@ TerminalRenderer::Draw(Editor &ed)
 		std::size_t cx = buf->Curx();
 		int cur_y = static_cast<int>(cy) - static_cast<int>(buf->Rowoffs());
 		std::size_t rx_recomputed = 0;
-		if (cy < lines.size()) {
-			const std::string line_for_cursor = static_cast<std::string>(lines[cy]);
+		if (cy < nrows) {
+			const std::string line_for_cursor = buf->GetLineString(cy);
 			std::size_t src_i_cur = 0;
 			std::size_t render_col_cur = 0;
 			while (src_i_cur < line_for_cursor.size() && src_i_cur < cx) {
@@ -441,7 +427,7 @@ TerminalRenderer::Draw(Editor &ed)
 			left += " [RO]";
 		// Append total line count as "<n>L"
 		if (b) {
-			unsigned long lcount = static_cast<unsigned long>(b->Rows().size());
+			unsigned long lcount = static_cast<unsigned long>(b->Nrows());
 			left += " ";
 			left += std::to_string(lcount);
 			left += "L";
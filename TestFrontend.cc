@@ -21,6 +21,12 @@ TestFrontend::Step(Editor &ed, bool &running)
 		}
 	}
 
+	// Report background saves and match counts that finished since the last
+	// step, and mapped files changed on disk
+	ed.PollSaves();
+	ed.PollFiles();
+	PollSearch(ed);
+
 	if (ed.QuitRequested()) {
 		running = false;
 	}
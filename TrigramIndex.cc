@@ -0,0 +1,346 @@
+#include "TrigramIndex.h"
+
+#include <algorithm>
+#include <string_view>
+
+#include "BackgroundJob.h"
+#include "PieceTable.h"
+#include "WorkerPool.h"
+
+
+namespace {
+// Bits in each block's bitmap: 64 Ki bits, 8 KiB
+constexpr unsigned kBitsLog2 = 16;
+constexpr std::size_t kWords = (std::size_t{1} << kBitsLog2) / 64;
+// Smallest block; an index that would not fit its limit gets larger ones
+constexpr std::size_t kMinBlockBytes = 64u << 10;
+// Memory one block takes: its bitmap plus bookkeeping
+constexpr std::size_t kBlockCost = kWords * sizeof(std::uint64_t) + 64;
+
+
+unsigned char
+fold(const unsigned char c)
+{
+	return c >= 'A' && c <= 'Z' ? static_cast<unsigned char>(c + ('a' - 'A')) : c;
+}
+
+
+// Bitmap slot of a trigram packed into the low three bytes
+std::uint32_t
+slot(const std::uint32_t trigram)
+{
+	return (trigram * 0x9E3779B1u) >> (32 - kBitsLog2);
+}
+
+
+// Feeds bytes through a three-byte window that restarts at each newline,
+// calling fn(slot) for every trigram
+class Trigrams {
+public:
+	template<typename Fn>
+	void Feed(const std::string_view bytes, Fn &&fn)
+	{
+		for (const char ch: bytes) {
+			const auto c = static_cast<unsigned char>(ch);
+			if (c == '\n') {
+				have_ = 0;
+				continue;
+			}
+			window_ = (window_ << 8 | fold(c)) & 0xFFFFFFu;
+			if (have_ < 2) {
+				++have_;
+				continue;
+			}
+			fn(slot(window_));
+		}
+	}
+
+private:
+	std::uint32_t window_ = 0;
+	unsigned have_        = 0;
+};
+
+
+std::size_t
+range_bytes(const PieceTable &text, const std::size_t lo, const std::size_t hi)
+{
+	return lo < hi ? text.GetLineRange(hi - 1).second - text.GetLineRange(lo).first : 0;
+}
+
+
+// Set the bit of every trigram on rows [lo, hi) of text
+void
+fill(const PieceTable &text, const std::size_t lo, const std::size_t hi, std::uint64_t *bits)
+{
+	const std::size_t bytes = range_bytes(text, lo, hi);
+	if (bytes == 0)
+		return;
+	Trigrams tri;
+	text.ForEachChunk(text.GetLineRange(lo).first, bytes, [&](const std::string_view chunk) {
+		tri.Feed(chunk, [bits](const std::uint32_t s) {
+			bits[s >> 6] |= std::uint64_t{1} << (s & 63);
+		});
+		return true;
+	});
+}
+
+
+// End of a block of rows starting at lo that spans about bytes bytes
+std::size_t
+block_end(const PieceTable &text, const std::size_t lo, const std::size_t bytes)
+{
+	const std::size_t start  = text.GetLineRange(lo).first;
+	const std::size_t target = std::min(text.Size(), start + bytes);
+	const std::size_t hi     = text.ByteOffsetToLineCol(target).first + 1;
+	return std::min(std::max(hi, lo + 1), text.LineCount());
+}
+} // namespace
+
+
+// A background build: the worker reads its own snapshot and fills blocks
+struct TrigramIndex::BuildJob {
+	std::shared_ptr<const PieceTable> snapshot;
+	std::size_t block_bytes = 0;
+	std::vector<Block> blocks;
+	kte::BackgroundJob worker;
+
+
+	void run()
+	{
+		const PieceTable &text = *snapshot;
+		const std::size_t n    = text.LineCount();
+		std::vector<std::size_t> bounds{0};
+		while (bounds.back() < n)
+			bounds.push_back(block_end(text, bounds.back(), block_bytes));
+		blocks.resize(bounds.size() - 1);
+		kte::WorkerPool::Shared().Run(blocks.size(), [this, &text, &bounds](const std::size_t i) {
+			if (worker.Cancelled())
+				return;
+			blocks[i].rows = bounds[i + 1] - bounds[i];
+			blocks[i].bits.assign(kWords, 0);
+			fill(text, bounds[i], bounds[i + 1], blocks[i].bits.data());
+		});
+	}
+};
+
+
+void
+TrigramIndex::Refresh(const PieceTable &text)
+{
+	if (built_ || job_ || !wanted(text))
+		return;
+	// Leave room for the one block past size / block_bytes that
+	// block_end's rounding can add
+	const std::size_t blocks = limit_ / kBlockCost - 1;
+	auto job                 = std::make_shared<BuildJob>();
+	job->snapshot            = text.Snapshot();
+	job->block_bytes         = std::max(kMinBlockBytes, (text.Size() + blocks - 1) / blocks);
+	BuildJob *j              = job.get();
+	job->worker.Start([j] {
+		j->run();
+	});
+	job_ = std::move(job);
+	pending_.clear();
+}
+
+
+bool
+TrigramIndex::Candidates(const PieceTable &text, const std::vector<std::string> &needles,
+                         std::vector<std::pair<std::size_t, std::size_t> > &rows)
+{
+	rows.clear();
+	Poll();
+	Refresh(text);
+	if (!built_)
+		return false;
+
+	std::vector<std::uint32_t> slots;
+	for (const std::string &needle: needles) {
+		Trigrams tri;
+		tri.Feed(needle, [&slots](const std::uint32_t s) {
+			slots.push_back(s);
+		});
+	}
+	if (slots.empty())
+		return false;
+	std::sort(slots.begin(), slots.end());
+	slots.erase(std::unique(slots.begin(), slots.end()), slots.end());
+
+	std::size_t total = 0;
+	for (const Block &b: blocks_)
+		total += b.rows;
+	if (total != text.LineCount()) {
+		// An edit was not reported; start over
+		Clear();
+		Refresh(text);
+		return false;
+	}
+
+	std::size_t lo = 0;
+	for (std::size_t i = 0; i < blocks_.size();) {
+		if (blocks_[i].stale) {
+			rebuild(text, i, lo);
+			continue;
+		}
+		const Block &b = blocks_[i];
+		const bool hit = std::all_of(slots.begin(), slots.end(), [&b](const std::uint32_t s) {
+			return (b.bits[s >> 6] >> (s & 63) & 1) != 0;
+		});
+		if (hit) {
+			if (!rows.empty() && rows.back().second == lo)
+				rows.back().second = lo + b.rows;
+			else
+				rows.emplace_back(lo, lo + b.rows);
+		}
+		lo += b.rows;
+		++i;
+	}
+	return true;
+}
+
+
+bool
+TrigramIndex::Poll()
+{
+	if (!job_ || !job_->worker.Done())
+		return false;
+	job_->worker.Wait();
+	block_bytes_ = job_->block_bytes;
+	blocks_      = std::move(job_->blocks);
+	job_.reset();
+	built_                        = true;
+	const std::vector<Edit> edits = std::move(pending_);
+	pending_.clear();
+	for (const Edit &e: edits) {
+		if (!built_)
+			break; // an edit it could not follow dropped the index
+		apply_edit(e.row, e.old_rows, e.new_rows);
+	}
+	return true;
+}
+
+
+void
+TrigramIndex::Wait()
+{
+	if (job_)
+		job_->worker.Wait();
+}
+
+
+void
+TrigramIndex::Edited(const std::size_t row, const std::size_t old_rows, const std::size_t new_rows)
+{
+	if (job_)
+		pending_.push_back(Edit{row, old_rows, new_rows});
+	else if (built_)
+		apply_edit(row, old_rows, new_rows);
+}
+
+
+void
+TrigramIndex::Clear()
+{
+	job_.reset();
+	pending_.clear();
+	blocks_.clear();
+	blocks_.shrink_to_fit();
+	built_       = false;
+	block_bytes_ = 0;
+}
+
+
+void
+TrigramIndex::SetMode(const Mode mode)
+{
+	if (mode == mode_)
+		return;
+	mode_ = mode;
+	Clear();
+}
+
+
+void
+TrigramIndex::SetLimit(const std::size_t bytes)
+{
+	limit_ = std::max(bytes, 2 * kBlockCost);
+	if (Bytes() > limit_)
+		Clear();
+}
+
+
+std::size_t
+TrigramIndex::Bytes() const
+{
+	std::size_t bytes = blocks_.capacity() * sizeof(Block);
+	for (const Block &b: blocks_)
+		bytes += b.bits.capacity() * sizeof(std::uint64_t);
+	return bytes;
+}
+
+
+bool
+TrigramIndex::wanted(const PieceTable &text) const
+{
+	return mode_ == Mode::On || (mode_ == Mode::Auto && text.Size() >= kAutoBytes);
+}
+
+
+void
+TrigramIndex::rebuild(const PieceTable &text, const std::size_t i, const std::size_t lo)
+{
+	const std::size_t hi = lo + blocks_[i].rows;
+	std::vector<std::size_t> bounds{lo};
+	if (range_bytes(text, lo, hi) > 2 * block_bytes_) {
+		while (bounds.back() < hi)
+			bounds.push_back(std::min(block_end(text, bounds.back(), block_bytes_), hi));
+	} else {
+		bounds.push_back(hi);
+	}
+	if (bounds.size() > 2 && Bytes() + (bounds.size() - 2) * kBlockCost > limit_)
+		bounds = {lo, hi}; // no room to split: the block just grows
+
+	std::vector<Block> parts(bounds.size() - 1);
+	for (std::size_t k = 0; k < parts.size(); ++k) {
+		parts[k].rows = bounds[k + 1] - bounds[k];
+		parts[k].bits.assign(kWords, 0);
+		fill(text, bounds[k], bounds[k + 1], parts[k].bits.data());
+	}
+	blocks_.erase(blocks_.begin() + static_cast<std::ptrdiff_t>(i));
+	blocks_.insert(blocks_.begin() + static_cast<std::ptrdiff_t>(i), std::make_move_iterator(parts.begin()),
+	               std::make_move_iterator(parts.end()));
+}
+
+
+void
+TrigramIndex::apply_edit(const std::size_t row, const std::size_t old_rows, const std::size_t new_rows)
+{
+	// Find blocks [i, j] holding rows [row, row + old_rows); rows appended
+	// past the end go to the last block
+	if (blocks_.empty()) {
+		Clear();
+		return;
+	}
+	std::size_t i  = 0;
+	std::size_t lo = 0;
+	while (i + 1 < blocks_.size() && lo + blocks_[i].rows <= row) {
+		lo += blocks_[i].rows;
+		++i;
+	}
+	std::size_t j   = i;
+	std::size_t end = lo + blocks_[i].rows;
+	while (end < row + old_rows && j + 1 < blocks_.size())
+		end += blocks_[++j].rows;
+	if (end < row + old_rows || row > end) {
+		Clear(); // past the end: not an edit we can follow
+		return;
+	}
+
+	// Merge them into one stale block
+	blocks_[i].rows  = end - lo - old_rows + new_rows;
+	blocks_[i].stale = true;
+	blocks_.erase(blocks_.begin() + static_cast<std::ptrdiff_t>(i + 1),
+	              blocks_.begin() + static_cast<std::ptrdiff_t>(j + 1));
+	if (blocks_[i].rows == 0)
+		blocks_.erase(blocks_.begin() + static_cast<std::ptrdiff_t>(i));
+}
@@ -0,0 +1,139 @@
+// TrigramIndex.h - per-buffer trigram index that narrows full-buffer searches
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+class PieceTable;
+
+
+// Which lines of a large buffer could contain a string, so a search only
+// has to verify those. The rows are split into blocks of about BlockBytes()
+// bytes, and each block keeps a bitmap of the hashed trigrams (three-byte
+// substrings, ASCII case folded) found on its lines. A block can only hold
+// a match if every trigram of the query is in its bitmap; hash collisions
+// let through extra blocks, never drop one.
+//
+// The index is built in the background from a snapshot, its blocks
+// bitmapped in parallel on kte::WorkerPool::Shared(). Edits reported
+// through Edited() (by the Buffer's raw editing APIs, as for MatchIndex)
+// mark only the touched blocks stale; those are rebuilt from the current
+// text by the next Candidates() call, and split once they have grown.
+//
+// Memory is capped at Limit(): a larger buffer gets larger blocks, which
+// narrow less. Bytes() reports what the index holds.
+class TrigramIndex {
+public:
+	enum class Mode {
+		Auto, // index buffers of at least kAutoBytes
+		On,
+		Off,
+	};
+
+	static constexpr std::size_t kAutoBytes    = 8u << 20;
+	static constexpr std::size_t kDefaultLimit = 64u << 20;
+
+	// Start building an index of text if the mode asks for one and there is
+	// none yet
+	void Refresh(const PieceTable &text);
+
+	// Row ranges [lo, hi), in order, outside which no line contains all of
+	// needles (letters lower-cased, as Regex::RequiredLiterals gives them).
+	// Returns false when the index cannot narrow the search: it is not built
+	// yet, or no needle is three bytes long. Starts a build if one is due.
+	bool Candidates(const PieceTable &text, const std::vector<std::string> &needles,
+	                std::vector<std::pair<std::size_t, std::size_t> > &rows);
+
+	// Adopt a finished background build, returning true once when it does
+	bool Poll();
+
+	// Block until a running build has finished (Poll still adopts it)
+	void Wait();
+
+	// Rows [row, row + old_rows) were replaced by rows [row, row + new_rows)
+	void Edited(std::size_t row, std::size_t old_rows, std::size_t new_rows);
+
+	// Drop the index, e.g. when the buffer's contents are replaced; the next
+	// Refresh() or Candidates() builds it again
+	void Clear();
+
+	void SetMode(Mode mode);
+
+	[[nodiscard]] Mode GetMode() const
+	{
+		return mode_;
+	}
+
+
+	// Cap on Bytes(); an index already over it is dropped, to be rebuilt
+	// within it
+	void SetLimit(std::size_t bytes);
+
+	[[nodiscard]] std::size_t Limit() const
+	{
+		return limit_;
+	}
+
+
+	[[nodiscard]] bool Ready() const
+	{
+		return built_;
+	}
+
+
+	[[nodiscard]] bool Building() const
+	{
+		return static_cast<bool>(job_);
+	}
+
+
+	[[nodiscard]] std::size_t Bytes() const;
+
+	[[nodiscard]] std::size_t Blocks() const
+	{
+		return blocks_.size();
+	}
+
+
+	[[nodiscard]] std::size_t BlockBytes() const
+	{
+		return block_bytes_;
+	}
+
+private:
+	struct Block {
+		std::size_t rows = 0;
+		bool stale       = false; // edited since its bitmap was built
+		std::vector<std::uint64_t> bits;
+	};
+
+	struct Edit {
+		std::size_t row;
+		std::size_t old_rows;
+		std::size_t new_rows;
+	};
+
+	struct BuildJob;
+
+	// Whether the mode asks for an index of text
+	[[nodiscard]] bool wanted(const PieceTable &text) const;
+
+	// Rebuild stale block i, which starts at row lo, splitting it if it has
+	// grown and the limit allows
+	void rebuild(const PieceTable &text, std::size_t i, std::size_t lo);
+
+	void apply_edit(std::size_t row, std::size_t old_rows, std::size_t new_rows);
+
+	Mode mode_               = Mode::Auto;
+	std::size_t limit_       = kDefaultLimit;
+	bool built_              = false;
+	std::size_t block_bytes_ = 0;
+	std::vector<Block> blocks_;
+	// Build in flight, if any, and the edits made since its snapshot
+	std::shared_ptr<BuildJob> job_;
+	std::vector<Edit> pending_;
+};
@@ -0,0 +1,136 @@
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include <memory>
+
+
+namespace kte {
+namespace {
+// Priority of a Run() helper, ahead of every posted task
+constexpr long kLoopPriority = std::numeric_limits<long>::min();
+} // namespace
+
+
+WorkerPool::WorkerPool(const std::size_t threads)
+{
+	for (std::size_t i = 0; i < threads; ++i) {
+		threads_.emplace_back([this] {
+			for (;;) {
+				std::function<void()> task;
+				{
+					std::unique_lock<std::mutex> lock(mtx_);
+					cv_.wait(lock, [this] {
+						return stop_ || !tasks_.empty();
+					});
+					if (stop_)
+						return;
+					std::pop_heap(tasks_.begin(), tasks_.end(), later);
+					task = std::move(tasks_.back().fn);
+					tasks_.pop_back();
+				}
+				task();
+			}
+		});
+	}
+}
+
+
+WorkerPool::~WorkerPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx_);
+		stop_ = true;
+	}
+	cv_.notify_all();
+	for (auto &t: threads_)
+		t.join();
+}
+
+
+void
+WorkerPool::Run(const std::size_t n, const std::function<void(std::size_t)> &fn, std::size_t width)
+{
+	if (n == 0)
+		return;
+	if (width == 0)
+		width = threads_.size() + 1;
+	const std::size_t helpers = std::min({width - 1, threads_.size(), n - 1});
+	if (helpers == 0) {
+		for (std::size_t i = 0; i < n; ++i)
+			fn(i);
+		return;
+	}
+
+	// Shared with helpers, which may only get to run after Run has returned
+	struct Batch {
+		const std::function<void(std::size_t)> *fn = nullptr;
+		std::size_t n = 0;
+		std::atomic<std::size_t> next{0};
+		std::size_t finished = 0;
+		std::mutex mtx;
+		std::condition_variable cv;
+	};
+	auto batch = std::make_shared<Batch>();
+	batch->fn  = &fn;
+	batch->n   = n;
+	// Claim indices until none are left; fn is only touched for claimed
+	// indices, all of which finish before Run returns
+	auto work = [](Batch &b) {
+		std::size_t done = 0;
+		for (std::size_t i; (i = b.next.fetch_add(1)) < b.n; ++done)
+			(*b.fn)(i);
+		if (done > 0) {
+			std::lock_guard<std::mutex> lock(b.mtx);
+			b.finished += done;
+			if (b.finished == b.n)
+				b.cv.notify_all();
+		}
+	};
+	{
+		std::lock_guard<std::mutex> lock(mtx_);
+		for (std::size_t i = 0; i < helpers; ++i) {
+			tasks_.push_back(Task{kLoopPriority, ++seq_, [batch, work] {
+				work(*batch);
+			}});
+			std::push_heap(tasks_.begin(), tasks_.end(), later);
+		}
+	}
+	cv_.notify_all();
+	work(*batch);
+	std::unique_lock<std::mutex> lock(batch->mtx);
+	batch->cv.wait(lock, [&batch] {
+		return batch->finished == batch->n;
+	});
+}
+
+
+bool
+WorkerPool::later(const Task &a, const Task &b)
+{
+	if (a.priority != b.priority)
+		return a.priority > b.priority;
+	return a.seq < b.seq;
+}
+
+
+void
+WorkerPool::Post(const long priority, std::function<void()> fn)
+{
+	{
+		std::lock_guard<std::mutex> lock(mtx_);
+		tasks_.push_back(Task{priority, ++seq_, std::move(fn)});
+		std::push_heap(tasks_.begin(), tasks_.end(), later);
+	}
+	cv_.notify_one();
+}
+
+
+WorkerPool &
+WorkerPool::Shared()
+{
+	static WorkerPool pool(std::max(2u, std::thread::hardware_concurrency()) - 1);
+	return pool;
+}
+} // namespace kte
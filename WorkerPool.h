@@ -0,0 +1,67 @@
+// WorkerPool.h - fixed set of worker threads for data-parallel loops and queued work
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace kte {
+// Threads that run the iterations of a parallel loop. Run() hands out loop
+// indices to the workers and to the calling thread alike, so it finishes
+// even when every worker is busy, and may be called from any thread
+// (including from inside another Run()). Post() queues a single task by
+// priority, such as a piece of the highlighters' background warming; a
+// loop's work goes ahead of any posted task, so Run() stays prompt while
+// the queue is long. Tasks still queued when the pool is destroyed are
+// dropped.
+class WorkerPool {
+public:
+	explicit WorkerPool(std::size_t threads);
+
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool &) = delete;
+
+	WorkerPool &operator=(const WorkerPool &) = delete;
+
+	[[nodiscard]] std::size_t Size() const
+	{
+		return threads_.size();
+	}
+
+
+	// Call fn(i) for every i in [0, n) and return once all calls have
+	// finished. At most width calls run at once (0: the pool plus the
+	// caller); width 1 runs them in order on the calling thread.
+	void Run(std::size_t n, const std::function<void(std::size_t)> &fn, std::size_t width = 0);
+
+	// Queue fn to run on a pool thread; lower priorities run first, and
+	// among equal ones the most recently posted
+	void Post(long priority, std::function<void()> fn);
+
+	// Process-wide pool with one thread per core besides the caller's, and
+	// at least one
+	static WorkerPool &Shared();
+
+private:
+	struct Task {
+		long priority = 0;
+		std::uint64_t seq = 0;
+		std::function<void()> fn;
+	};
+
+	// Heap order: the task to run next compares greatest
+	static bool later(const Task &a, const Task &b);
+
+	std::mutex mtx_;
+	std::condition_variable cv_;
+	std::vector<Task> tasks_; // heap by later()
+	std::uint64_t seq_ = 0;
+	bool stop_ = false;
+	std::vector<std::thread> threads_;
+};
+} // namespace kte
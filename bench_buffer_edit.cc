@@ -0,0 +1,94 @@
+// Benchmark per-keystroke cost of editing commands on a large buffer
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <new>
+#include <string>
+
+#include "Buffer.h"
+#include "Command.h"
+#include "Editor.h"
+
+
+static std::atomic<std::size_t> g_allocs{0};
+
+
+void *
+operator new(std::size_t n)
+{
+	g_allocs.fetch_add(1, std::memory_order_relaxed);
+	if (void *p = std::malloc(n ? n : 1))
+		return p;
+	throw std::bad_alloc();
+}
+
+
+void
+operator delete(void *p) noexcept
+{
+	std::free(p);
+}
+
+
+void
+operator delete(void *p, std::size_t) noexcept
+{
+	std::free(p);
+}
+
+
+// Type `keys` characters mid-file, redrawing a 50-row viewport after each as
+// a renderer would. With rebuild_rows, also touch Buffer::Rows() per keystroke
+// to show what the full row cache used to cost.
+static void
+bench_typing(Editor &ed, int keys, bool rebuild_rows)
+{
+	Buffer &buf = *ed.CurrentBuffer();
+	buf.SetCursor(0, buf.Nrows() / 2);
+	const std::size_t a0 = g_allocs.load();
+	const auto t0        = std::chrono::steady_clock::now();
+	std::size_t sink     = 0;
+	for (int i = 0; i < keys; ++i) {
+		Execute(ed, CommandId::InsertText, "x");
+		for (std::size_t r = buf.Rowoffs(); r < buf.Rowoffs() + 50 && r < buf.Nrows(); ++r)
+			sink += buf.GetLineString(r).size();
+		if (rebuild_rows)
+			sink += buf.Rows().size();
+	}
+	const auto t1        = std::chrono::steady_clock::now();
+	const std::size_t a1 = g_allocs.load();
+	const double us      = std::chrono::duration<double, std::micro>(t1 - t0).count() / keys;
+	std::printf("%-22s %10.1f allocs/key  %10.1f us/key  (%zu)\n",
+	            rebuild_rows ? "with Rows() rebuild" : "lazy row access",
+	            static_cast<double>(a1 - a0) / keys, us, sink % 10);
+}
+
+
+int
+main(int argc, char **argv)
+{
+	const std::size_t lines = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+	const std::string path  = "/tmp/kte_bench_buffer_edit.txt";
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		for (std::size_t i = 0; i < lines; ++i)
+			out << "line " << i << " of the benchmark file\n";
+	}
+
+	InstallDefaultCommands();
+	Editor ed;
+	ed.SetDimensions(52, 120);
+	std::string err;
+	if (!ed.OpenFile(path, err)) {
+		std::fprintf(stderr, "open failed: %s\n", err.c_str());
+		return 1;
+	}
+	std::printf("Typing into a %zu-line buffer\n", ed.CurrentBuffer()->Nrows());
+	bench_typing(ed, 2000, false);
+	bench_typing(ed, 20, true);
+	std::remove(path.c_str());
+	return 0;
+}
@@ -0,0 +1,109 @@
+// Benchmark ByteScan newline kernels in GB/s over a large synthetic input,
+// then substring search throughput per kernel (args: newline input size in
+// MiB, default 2048; search input size in MiB, default 64, 0 skips it)
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "ByteScan.h"
+#include "OptimizedSearch.h"
+#include "PieceTable.h"
+
+
+static double
+gbps(std::size_t bytes, std::chrono::steady_clock::duration d)
+{
+	return static_cast<double>(bytes) / std::chrono::duration<double>(d).count() / 1e9;
+}
+
+
+static double
+mbps(std::size_t bytes, std::chrono::steady_clock::duration d)
+{
+	return static_cast<double>(bytes) / std::chrono::duration<double>(d).count() / (1024.0 * 1024.0);
+}
+
+
+// Search a log-like document for a rare pattern with OptimizedSearch, as a
+// string and as a PieceTable built from 4 KiB inserts, per kernel
+static void
+search_throughput(std::size_t mib)
+{
+	const std::size_t size       = mib << 20;
+	std::string text;
+	text.reserve(size + 128);
+	for (std::size_t i = 0; text.size() < size; ++i)
+		text += "2024-01-01 12:00:00 INFO request " + std::to_string(i) + " served in 12ms\n";
+	const std::string pat = "request 7777777 served";
+	PieceTable pt;
+	for (std::size_t off = 0; off < text.size(); off += 4096)
+		pt.Insert(off, text.data() + off, std::min<std::size_t>(4096, text.size() - off));
+
+	auto t0             = std::chrono::steady_clock::now();
+	const std::size_t r = text.find(pat);
+	auto t1             = std::chrono::steady_clock::now();
+	std::printf("%-22s %8.0f MiB/s   (match at %zu)\n", "std::string::find", mbps(text.size(), t1 - t0), r);
+
+	OptimizedSearch os;
+	for (auto k: {kte::ScanKernel::Scalar, kte::ScanKernel::SSE2, kte::ScanKernel::AVX2}) {
+		if (!kte::SetScanKernel(k))
+			continue;
+		t0                  = std::chrono::steady_clock::now();
+		const std::size_t a = os.find_first(text, pat);
+		t1                  = std::chrono::steady_clock::now();
+		const std::size_t b = os.find_first(pt, pat);
+		auto t2             = std::chrono::steady_clock::now();
+		std::printf("%-8s string %8.0f MiB/s   piece table %8.0f MiB/s%s\n", kte::ScanKernelName(k),
+		            mbps(text.size(), t1 - t0), mbps(text.size(), t2 - t1),
+		            a == r && b == r ? "" : "  (wrong match)");
+	}
+}
+
+
+int
+main(int argc, char **argv)
+{
+	// Input sizes in MiB; newline scan defaults to 2 GiB
+	std::size_t mib = 2048;
+	if (argc > 1)
+		mib = std::strtoull(argv[1], nullptr, 10);
+	const std::size_t search_mib = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 64;
+	const std::size_t size       = mib << 20;
+
+	std::string text(size, 'x');
+	// Log-like content: roughly one newline every 80 bytes
+	for (std::size_t i = 79; i < size; i += 80)
+		text[i] = '\n';
+
+	std::printf("ByteScan over %zu MiB (dispatch picks %s)\n", mib,
+	            kte::ScanKernelName(kte::ActiveScanKernel()));
+	for (auto k: {kte::ScanKernel::Scalar, kte::ScanKernel::SSE2, kte::ScanKernel::AVX2}) {
+		if (!kte::SetScanKernel(k))
+			continue;
+
+		auto t0             = std::chrono::steady_clock::now();
+		const std::size_t n = kte::CountNewlines(text.data(), text.size());
+		auto t1             = std::chrono::steady_clock::now();
+
+		std::vector<std::size_t> pos;
+		pos.reserve(n);
+		auto t2 = std::chrono::steady_clock::now();
+		kte::FindNewlines(text.data(), text.size(), 0, pos);
+		auto t3 = std::chrono::steady_clock::now();
+
+		auto t4         = std::chrono::steady_clock::now();
+		const char *hit = kte::FindByte(text.data(), text.size(), '#');
+		auto t5         = std::chrono::steady_clock::now();
+
+		std::printf("%-7s count %6.2f GB/s   locate %6.2f GB/s   find-byte %6.2f GB/s  (%zu lines%s)\n",
+		            kte::ScanKernelName(k), gbps(size, t1 - t0), gbps(size, t3 - t2), gbps(size, t5 - t4), n,
+		            hit ? ", unexpected hit" : "");
+	}
+	if (search_mib > 0)
+		search_throughput(search_mib);
+	return 0;
+}
@@ -0,0 +1,135 @@
+// Benchmark the syntax-highlight cost of drawing a 200-row viewport: frame
+// time while scrolling a line at a time, paging, and editing as a renderer
+// sees it through HighlighterEngine (arg: line count, default 200000)
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "Buffer.h"
+#include "syntax/HighlighterEngine.h"
+#include "syntax/HighlighterRegistry.h"
+
+
+static constexpr int kRows = 200;
+
+
+static double
+micros(std::chrono::steady_clock::duration d)
+{
+	return std::chrono::duration<double, std::micro>(d).count();
+}
+
+
+// Prefetch the viewport at top and read every visible row's spans, as the
+// renderers do; returns the frame time in microseconds
+static double
+frame(const Buffer &buf, const int top, std::size_t &sink)
+{
+	const kte::HighlighterEngine &eng = *buf.Highlighter();
+	const auto t0                     = std::chrono::steady_clock::now();
+	eng.PrefetchViewport(buf, top, kRows, buf.Version());
+	for (int r = top; r < top + kRows && r < static_cast<int>(buf.Nrows()); ++r) {
+		eng.WithLine(buf, r, buf.Version(), [&sink](const std::vector<kte::HighlightSpan> &spans) {
+			for (const auto &sp: spans)
+				sink += static_cast<std::size_t>(sp.col_end - sp.col_start);
+		});
+	}
+	return micros(std::chrono::steady_clock::now() - t0);
+}
+
+
+static void
+report(const char *name, std::vector<double> &times)
+{
+	std::sort(times.begin(), times.end());
+	double sum = 0;
+	for (const double t: times)
+		sum += t;
+	std::printf("%-22s %10.1f %10.1f %10.1f\n", name, sum / static_cast<double>(times.size()),
+	            times[times.size() / 2], times[times.size() * 99 / 100]);
+}
+
+
+int
+main(int argc, char **argv)
+{
+	int lines = 200000;
+	if (argc > 1)
+		lines = std::atoi(argv[1]);
+	lines = std::max(lines, 4 * kRows);
+
+	std::string text;
+	for (int i = 0; i < lines; ++i) {
+		if (i % 40 == 0)
+			text += "/* block comment " + std::to_string(i) + "\n";
+		else if (i % 40 == 2)
+			text += "   ends here */\n";
+		else
+			text += "static int v" + std::to_string(i) + " = compute(\"s\", " + std::to_string(i) +
+				" * 0x1F); // trailing\n";
+	}
+	Buffer buf;
+	buf.insert_text(0, 0, text);
+	buf.SetFiletype("cpp");
+	buf.SetSyntaxEnabled(true);
+	buf.EnsureHighlighter();
+	buf.Highlighter()->SetHighlighter(kte::HighlighterRegistry::CreateFor("cpp"));
+
+	std::size_t sink = 0;
+	std::printf("%d lines, %d visible rows\n", lines, kRows);
+	std::printf("%-22s %10s %10s %10s\n", "frame (us)", "mean", "median", "p99");
+
+	// Page down the whole buffer once, leaving it cached
+	std::vector<double> times;
+	for (int top = 0; top + kRows <= lines; top += kRows)
+		times.push_back(frame(buf, top, sink));
+	report("page down (cold)", times);
+
+	times.clear();
+	for (int top = lines / 2; top < lines / 2 + 2000; ++top)
+		times.push_back(frame(buf, top, sink));
+	report("scroll by line", times);
+
+	// Invalidate from the middle of the viewport, as an edit there would
+	times.clear();
+	const int mid = lines / 2;
+	for (int i = 0; i < 500; ++i) {
+		buf.Highlighter()->InvalidateFrom(mid + kRows / 2);
+		times.push_back(frame(buf, mid, sink));
+	}
+	report("invalidate mid-view", times);
+
+	// Edit a line near the top in place and draw the end of the buffer
+	times.clear();
+	for (int i = 0; i < 200; ++i) {
+		buf.insert_text(10, 0, "x");
+		buf.SetDirty(true);
+		times.push_back(frame(buf, lines - kRows, sink));
+	}
+	report("top edit, draw end", times);
+
+	// Break a line near the top, moving every row below it
+	times.clear();
+	for (int i = 0; i < 200; ++i) {
+		buf.split_line(10, 2);
+		buf.SetDirty(true);
+		times.push_back(frame(buf, lines - kRows, sink));
+	}
+	report("top newline, draw end", times);
+
+	// Type in the middle of the viewport
+	times.clear();
+	for (int i = 0; i < 200; ++i) {
+		buf.insert_text(mid + kRows / 2, 0, "x");
+		buf.SetDirty(true);
+		times.push_back(frame(buf, mid, sink));
+	}
+	report("edit + redraw", times);
+
+	std::printf("(checksum %zu)\n", sink);
+	return 0;
+}
@@ -0,0 +1,161 @@
+// Benchmark each built-in highlighter on its own, without the engine or a
+// buffer: throughput in MB/s over a few MB of typical lines per language
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "syntax/HighlighterRegistry.h"
+#include "syntax/LanguageHighlighter.h"
+
+
+// A few typical lines for each built-in highlighter, repeated to make the input
+static const struct {
+	const char *filetype;
+	const char *sample;
+} kHighlighterSamples[] = {
+	{
+		"cpp",
+		"#include <vector>\n"
+		"/* Sum the values,\n"
+		"   skipping negatives */\n"
+		"static std::size_t sum(const std::vector<int> &v) {\n"
+		"\tstd::size_t total = 0; // running total\n"
+		"\tfor (const int x: v) if (x > 0) total += static_cast<std::size_t>(x) * 0x1F;\n"
+		"\treturn total + sizeof(char) + 'a' + R\"(raw)\"[0];\n"
+		"}\n"
+	},
+	{
+		"go",
+		"package main\n"
+		"import \"fmt\"\n"
+		"// Sum the values, skipping negatives\n"
+		"func sum(v []int) (total int64) {\n"
+		"\tfor _, x := range v { if x > 0 { total += int64(x) * 0x1F } }\n"
+		"\tfmt.Println(`raw`, total); return\n"
+		"}\n"
+	},
+	{
+		"rust",
+		"use std::collections::HashMap;\n"
+		"/// Sum the values, skipping negatives\n"
+		"pub fn sum(v: &[i32]) -> u64 {\n"
+		"\tlet mut total: u64 = 0; // running total\n"
+		"\tfor &x in v.iter() { if x > 0 { total += x as u64 * 0x1F; } }\n"
+		"\tprintln!(\"{}\", total); total\n"
+		"}\n"
+	},
+	{
+		"python",
+		"import sys\n"
+		"def total(values, scale=1.5):\n"
+		"    \"\"\"Sum the values,\n"
+		"    skipping negatives.\"\"\"\n"
+		"    result = 0  # running total\n"
+		"    for x in values:\n"
+		"        if x > 0 and not x is None: result += x * scale\n"
+		"    return result, 'done', sys.argv\n"
+	},
+	{
+		"sql",
+		"-- Orders per customer\n"
+		"SELECT c.name, COUNT(o.id) AS orders FROM customers c\n"
+		"LEFT JOIN orders o ON o.customer_id = c.id WHERE c.active = 1\n"
+		"GROUP BY c.name ORDER BY orders DESC LIMIT 10;\n"
+		"create table t (id integer primary key, name text not null);\n"
+	},
+	{
+		"erlang",
+		"-module(sum).\n"
+		"-export([total/1]).\n"
+		"% Sum the values, skipping negatives\n"
+		"total(Values) -> lists:foldl(fun(X, Acc) when X > 0 -> Acc + X * 16#1F;\n"
+		"\t(_, Acc) -> Acc end, 0, Values), io:format(\"~p~n\", ['done', $a]).\n"
+	},
+	{
+		"forth",
+		"\\ Sum the values, skipping negatives\n"
+		": total ( addr n -- sum ) 0 -rot 0 do dup i cells + @ dup 0> if rot + swap else drop then loop drop ;\n"
+		"variable count 10 count ! .\" done\" cr\n"
+	},
+	{
+		"lisp",
+		"; Sum the values, skipping negatives\n"
+		"(defun total (values &optional (scale 1.5))\n"
+		"  (let ((result 0))\n"
+		"    (dolist (x values result) (if (and (> x 0) (not (null x))) (setq result (+ result (* x scale)))))))\n"
+		"(format t \"~a~%\" (total '(1 -2 3)))\n"
+	},
+	{
+		"shell",
+		"#!/bin/sh\n"
+		"# Sum the arguments, skipping negatives\n"
+		"total=0\n"
+		"for x in \"$@\"; do if [ \"$x\" -gt 0 ]; then total=$((total + x)); fi; done\n"
+		"echo 'done' \"$total\" > /dev/null\n"
+	},
+	{
+		"json",
+		"{\n"
+		"  \"name\": \"kte\", \"version\": 1.5, \"enabled\": true,\n"
+		"  \"values\": [1, -2, 3e10, null, false], \"nested\": {\"key\": \"value\"}\n"
+		"}\n"
+	},
+	{
+		"markdown",
+		"# Heading\n"
+		"Some *emphasis*, **strong** text and `inline code`.\n"
+		"- a list item with a [link](https://example.com)\n"
+		"```\n"
+		"fenced code\n"
+		"```\n"
+	},
+};
+
+
+// Highlight about 4 MB of each language's sample for at least half a second,
+// with a stateful highlighter's state carried from line to line, and print
+// the rate
+int
+main()
+{
+	std::printf("%-10s %10s\n", "filetype", "MB/s");
+	for (const auto &s: kHighlighterSamples) {
+		const std::unique_ptr<kte::LanguageHighlighter> hl = kte::HighlighterRegistry::CreateFor(s.filetype);
+		if (!hl)
+			continue;
+		std::string text;
+		while (text.size() < (4u << 20))
+			text += s.sample;
+		std::vector<std::string_view> lines;
+		for (std::size_t pos = 0, nl; pos < text.size(); pos = nl + 1) {
+			nl = text.find('\n', pos);
+			lines.emplace_back(text.data() + pos, nl - pos);
+		}
+
+		const auto *stateful = hl->Stateful() ? static_cast<const kte::StatefulHighlighter *>(hl.get()) : nullptr;
+		std::vector<kte::HighlightSpan> spans;
+		std::size_t sink = 0;
+		double bytes     = 0;
+		double seconds   = 0;
+		const auto start = std::chrono::steady_clock::now();
+		while (seconds < 0.5) {
+			kte::StatefulHighlighter::LineState state;
+			for (const std::string_view line: lines) {
+				spans.clear();
+				if (stateful)
+					state = stateful->HighlightLineStateful(line, state, spans);
+				else
+					hl->HighlightLine(line, spans);
+				sink += spans.size();
+			}
+			bytes += static_cast<double>(text.size());
+			seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+		std::printf("%-10s %10.1f  (%zu spans)\n", s.filetype, bytes / seconds / 1e6, sink);
+	}
+	return 0;
+}
@@ -0,0 +1,95 @@
+// Benchmark search scaling with thread count: OptimizedSearch::find_all over
+// a PieceTable and MatchIndex's background count, literal and regex, from one
+// thread up to one per core (arg: size in MiB, default 256)
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Buffer.h"
+#include "MatchIndex.h"
+#include "OptimizedSearch.h"
+#include "PieceTable.h"
+
+
+static double
+seconds(std::chrono::steady_clock::duration d)
+{
+	return std::chrono::duration<double>(d).count();
+}
+
+
+int
+main(int argc, char **argv)
+{
+	std::size_t mib = 256;
+	if (argc > 1)
+		mib = std::strtoull(argv[1], nullptr, 10);
+	const std::size_t size = mib << 20;
+
+	std::string text;
+	text.reserve(size + 128);
+	static const char *const levels[] = {"INFO", "DEBUG", "WARN", "ERROR"};
+	for (std::size_t i = 0; text.size() < size; ++i) {
+		text += "2024-01-01 12:" + std::to_string(i % 60) + ":00 " + levels[i % 4] + " request " +
+			std::to_string(i) + " served in " + std::to_string(i % 997) + "ms\n";
+	}
+	PieceTable pt;
+	pt.Insert(0, text.data(), text.size());
+	Buffer buf;
+	buf.insert_text(0, 0, text);
+
+	const std::size_t cores = std::max(1u, std::thread::hardware_concurrency());
+	std::vector<std::size_t> counts;
+	for (std::size_t t = 1; t < cores; t *= 2)
+		counts.push_back(t);
+	counts.push_back(cores);
+
+	struct Case {
+		const char *name;
+		const char *query;
+		bool regex;
+	};
+	static const Case cases[] = {
+		{"find_all literal", "ERROR", false},
+		{"count literal", "ERROR", false},
+		{"count regex", "(WARN|ERROR) request \\d+7 ", true},
+	};
+	std::printf("search over %zu MiB, %zu cores: seconds (speedup)\n", mib, cores);
+	for (const Case &c: cases) {
+		std::printf("%-18s", c.name);
+		double base          = 0;
+		std::size_t expected = 0;
+		for (const std::size_t threads: counts) {
+			std::size_t found = 0;
+			const auto t0     = std::chrono::steady_clock::now();
+			if (c.name[0] == 'f') {
+				OptimizedSearch os;
+				os.SetThreads(threads);
+				found = os.find_all(pt, c.query).size();
+			} else {
+				MatchIndex index;
+				index.SetThreads(threads);
+				std::string err;
+				index.Update(buf, c.query, c.regex, 0, 0, err);
+				index.Wait();
+				index.Poll();
+				found = index.Matches().size();
+			}
+			const double s = seconds(std::chrono::steady_clock::now() - t0);
+			if (threads == 1) {
+				base     = s;
+				expected = found;
+			} else if (found != expected) {
+				std::printf("\nmismatch: %zu threads found %zu, expected %zu\n", threads, found, expected);
+				return 1;
+			}
+			std::printf("  %zut %.3f (%.1fx)", threads, s, base / s);
+		}
+		std::printf("  [%zu matches]\n", expected);
+	}
+	return 0;
+}
@@ -0,0 +1,57 @@
+// Benchmark PieceTable edit latency as the piece count grows
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <limits>
+#include <random>
+#include <string>
+
+#include "PieceTable.h"
+
+
+// Fragment a table into roughly `pieces` pieces by inserting short runs at random offsets.
+static void
+fragment(PieceTable &pt, std::size_t pieces, std::mt19937 &rng)
+{
+	const std::string seed(4096, 'x');
+	pt.Append(seed.data(), seed.size());
+	const char text[] = "piece\n";
+	for (std::size_t i = 0; i < pieces / 2; ++i) {
+		std::uniform_int_distribution<std::size_t> pos_d(0, pt.Size());
+		pt.Insert(pos_d(rng), text, sizeof(text) - 1);
+	}
+}
+
+
+static void
+bench_edits(std::size_t pieces)
+{
+	std::mt19937 rng(42);
+	// Disable consolidation so the piece count stays what we asked for
+	PieceTable pt(0, std::numeric_limits<std::size_t>::max(), 64, 4096);
+	fragment(pt, pieces, rng);
+
+	const int ops = 20000;
+	std::uniform_int_distribution<std::size_t> pos_d(0, pt.Size() - 1);
+	const auto t0 = std::chrono::steady_clock::now();
+	for (int i = 0; i < ops; ++i) {
+		const std::size_t pos = pos_d(rng);
+		if (i % 2 == 0)
+			pt.Insert(pos, "k", 1);
+		else
+			pt.Delete(pos, 1);
+	}
+	const auto t1 = std::chrono::steady_clock::now();
+	const double ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / ops;
+	std::printf("%10zu pieces  %10zu bytes  %8.0f ns/edit\n", pieces, pt.Size(), ns);
+}
+
+
+int
+main()
+{
+	std::printf("PieceTable edit latency vs piece count\n");
+	for (std::size_t pieces = 1000; pieces <= 1000000; pieces *= 10)
+		bench_edits(pieces);
+	return 0;
+}
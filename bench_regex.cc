@@ -0,0 +1,81 @@
+// Benchmark kte::Regex against std::regex, matching line by line over a
+// log-like document as the editor's regex search does (arg: size in MiB,
+// default 16)
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <regex>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Regex.h"
+
+
+static double
+mbps(std::size_t bytes, std::chrono::steady_clock::duration d)
+{
+	return static_cast<double>(bytes) / std::chrono::duration<double>(d).count() / (1024.0 * 1024.0);
+}
+
+
+int
+main(int argc, char **argv)
+{
+	std::size_t mib = 16;
+	if (argc > 1)
+		mib = std::strtoull(argv[1], nullptr, 10);
+	const std::size_t size = mib << 20;
+
+	std::string text;
+	text.reserve(size + 128);
+	static const char *const levels[] = {"INFO", "DEBUG", "WARN", "ERROR"};
+	for (std::size_t i = 0; text.size() < size; ++i) {
+		text += "2024-01-01 12:" + std::to_string(i % 60) + ":00 " + levels[i % 4] + " request " +
+			std::to_string(i) + " from 10.0." + std::to_string(i % 256) + ".1 served in " +
+			std::to_string(i % 997) + "ms\n";
+	}
+	std::vector<std::string_view> lines;
+	for (std::size_t b = 0, e; b < text.size(); b = e + 1) {
+		e = text.find('\n', b);
+		lines.emplace_back(text.data() + b, e - b);
+	}
+
+	static const char *const patterns[] = {
+		"request 7777777 ", // rare literal
+		"ERROR", // common literal
+		"\\d+ms$", // class loop anchored at the end
+		"[0-9]+\\.[0-9]+\\.[0-9]+\\.[0-9]+", // IP addresses, a match on every line
+		"(WARN|ERROR) request (\\d+)", // alternation with groups
+		"served in 9\\d\\dms", // rare with classes
+	};
+	std::printf("regex over %zu MiB, %zu lines\n", mib, lines.size());
+	for (const char *pat: patterns) {
+		const std::regex ref(pat);
+		auto t0 = std::chrono::steady_clock::now();
+		std::size_t want = 0;
+		for (std::string_view line: lines) {
+			for (auto it = std::cregex_iterator(line.data(), line.data() + line.size(), ref);
+			     it != std::cregex_iterator(); ++it)
+				++want;
+		}
+		auto t1 = std::chrono::steady_clock::now();
+
+		kte::Regex rx;
+		std::string err;
+		rx.Compile(pat, err);
+		std::vector<kte::Regex::Span> spans;
+		std::size_t got = 0;
+		for (std::string_view line: lines) {
+			spans.clear();
+			rx.FindAll(line, spans);
+			got += spans.size();
+		}
+		auto t2 = std::chrono::steady_clock::now();
+		std::printf("%-38s std::regex %8.1f MiB/s   kte::Regex %8.1f MiB/s   %zu matches%s\n", pat,
+		            mbps(text.size(), t1 - t0), mbps(text.size(), t2 - t1), got,
+		            got == want ? "" : "  MISMATCH");
+	}
+	return 0;
+}
@@ -0,0 +1,85 @@
+// Benchmark saving a large, lightly edited buffer: throughput and peak RSS
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include <sys/resource.h>
+
+#include "Buffer.h"
+
+
+static long
+peak_rss_mib()
+{
+	struct rusage ru{};
+	getrusage(RUSAGE_SELF, &ru);
+	return ru.ru_maxrss / 1024;
+}
+
+
+int
+main(int argc, char **argv)
+{
+	// Usage: bench_save [GiB] [--materialize]
+	double gib       = 2.0;
+	bool materialize = false;
+	for (int i = 1; i < argc; ++i) {
+		if (std::strcmp(argv[i], "--materialize") == 0)
+			materialize = true;
+		else
+			gib = std::atof(argv[i]);
+	}
+	const auto bytes       = static_cast<std::size_t>(gib * 1024.0 * 1024.0 * 1024.0);
+	const std::string src  = "/tmp/kte_bench_save_src.txt";
+	const std::string dest = "/tmp/kte_bench_save_dst.txt";
+	{
+		std::string block;
+		for (int i = 0; block.size() < (1 << 20); ++i)
+			block += "line " + std::to_string(i) + " of a large file being saved\n";
+		std::ofstream out(src, std::ios::binary | std::ios::trunc);
+		for (std::size_t done = 0; done < bytes; done += block.size())
+			out.write(block.data(), static_cast<std::streamsize>(block.size()));
+	}
+
+	Buffer buf;
+	std::string err;
+	if (!buf.OpenFromFile(src, err)) {
+		std::fprintf(stderr, "open failed: %s\n", err.c_str());
+		return 1;
+	}
+	// Scatter edits so the save walks many pieces
+	const std::size_t rows = buf.Nrows();
+	for (std::size_t i = 0; i < 10000; ++i)
+		buf.insert_text(static_cast<int>((i * 7919) % rows), 0, "edit ");
+	const std::size_t size = buf.Content().Size();
+	std::printf("Saving %.2f GiB (%zu lines), rss before save %ld MiB\n",
+	            static_cast<double>(size) / (1024.0 * 1024.0 * 1024.0), rows, peak_rss_mib());
+
+	const auto t0 = std::chrono::steady_clock::now();
+	bool ok;
+	if (materialize) {
+		// The old path: flatten the document, then write it in one go
+		std::ofstream out(dest, std::ios::binary | std::ios::trunc);
+		out.write(buf.Content().Data(), static_cast<std::streamsize>(size));
+		out.flush();
+		ok = out.good();
+	} else {
+		ok = buf.SaveAs(dest, err);
+	}
+	const auto t1   = std::chrono::steady_clock::now();
+	const double s  = std::chrono::duration<double>(t1 - t0).count();
+	const double mb = static_cast<double>(size) / (1024.0 * 1024.0);
+	if (!ok) {
+		std::fprintf(stderr, "save failed: %s\n", err.c_str());
+		return 1;
+	}
+	std::printf("%-22s %8.0f MiB/s  %6.2f s  peak rss %ld MiB\n",
+	            materialize ? "materialize + write" : "streaming save", mb / s, s, peak_rss_mib());
+	std::remove(src.c_str());
+	std::remove(dest.c_str());
+	return 0;
+}
@@ -0,0 +1,94 @@
+// Benchmark full-buffer search with and without a trigram index: index build
+// time and memory, then MatchIndex's count for rare and common queries
+// (arg: size in MiB, default 256)
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+
+#include "Buffer.h"
+#include "MatchIndex.h"
+#include "TrigramIndex.h"
+
+
+static double
+seconds(std::chrono::steady_clock::duration d)
+{
+	return std::chrono::duration<double>(d).count();
+}
+
+
+static double
+count(const Buffer &buf, const char *query, const bool regex, std::size_t &found)
+{
+	const auto t0 = std::chrono::steady_clock::now();
+	MatchIndex index;
+	std::string err;
+	index.Update(buf, query, regex, 0, 0, err);
+	index.Wait();
+	index.Poll();
+	found = index.Matches().size();
+	return seconds(std::chrono::steady_clock::now() - t0);
+}
+
+
+int
+main(int argc, char **argv)
+{
+	std::size_t mib = 256;
+	if (argc > 1)
+		mib = std::strtoull(argv[1], nullptr, 10);
+	const std::size_t size = mib << 20;
+
+	std::string text;
+	text.reserve(size + 128);
+	static const char *const levels[] = {"INFO", "DEBUG", "WARN", "ERROR"};
+	for (std::size_t i = 0; text.size() < size; ++i) {
+		text += "2024-01-01 12:" + std::to_string(i % 60) + ":00 " + levels[i % 4] + " request " +
+			std::to_string(i) + " served in " + std::to_string(i % 997) + "ms";
+		if (i % 100003 == 0)
+			text += " panic: disk quota exceeded";
+		text += '\n';
+	}
+	Buffer plain;
+	plain.Trigrams().SetMode(TrigramIndex::Mode::Off);
+	plain.insert_text(0, 0, text);
+	Buffer indexed;
+	indexed.Trigrams().SetMode(TrigramIndex::Mode::On);
+	indexed.insert_text(0, 0, text);
+	text.clear();
+	text.shrink_to_fit();
+
+	const auto t0 = std::chrono::steady_clock::now();
+	indexed.Trigrams().Refresh(indexed.Content());
+	indexed.Trigrams().Wait();
+	indexed.Trigrams().Poll();
+	std::printf("index over %zu MiB: %.3f s, %zu KiB in %zu blocks of %zu KiB\n", mib,
+	            seconds(std::chrono::steady_clock::now() - t0), indexed.Trigrams().Bytes() >> 10,
+	            indexed.Trigrams().Blocks(), indexed.Trigrams().BlockBytes() >> 10);
+
+	struct Case {
+		const char *query;
+		bool regex;
+	};
+	static const Case cases[] = {
+		{"quota exceeded", false},
+		{"panic: \\w+ quota", true},
+		{"request 4242424 ", false},
+		{"ERROR", false},
+	};
+	std::printf("%-20s %10s %10s %8s\n", "query", "scan s", "indexed s", "matches");
+	for (const Case &c: cases) {
+		std::size_t expected = 0;
+		std::size_t found    = 0;
+		const double full    = count(plain, c.query, c.regex, expected);
+		const double fast    = count(indexed, c.query, c.regex, found);
+		if (found != expected) {
+			std::printf("mismatch for '%s': %zu vs %zu\n", c.query, found, expected);
+			return 1;
+		}
+		std::printf("%-20s %10.3f %10.3f %8zu\n", c.query, full, fast, found);
+	}
+	return 0;
+}
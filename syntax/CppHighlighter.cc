@@ -1,88 +1,57 @@
 #include "CppHighlighter.h"
-#include "../Buffer.h"
-#include <cctype>
+#include "LexTables.h"
 
 namespace kte {
-static bool
-is_digit(char c)
-{
-	return c >= '0' && c <= '9';
-}
+static constexpr std::string_view kKeywords[] = {
+	"if", "else", "for", "while", "do", "switch", "case", "default", "break", "continue",
+	"return", "goto", "struct", "class", "namespace", "using", "template", "typename",
+	"public", "private", "protected", "virtual", "override", "const", "constexpr", "auto",
+	"static", "inline", "operator", "new", "delete", "try", "catch", "throw", "friend",
+	"enum", "union", "extern", "volatile", "mutable", "noexcept", "sizeof", "this"
+};
 
+static constexpr std::string_view kTypes[] = {
+	"int", "long", "short", "char", "signed", "unsigned", "float", "double", "void",
+	"bool", "wchar_t", "size_t", "ptrdiff_t", "uint8_t", "uint16_t", "uint32_t", "uint64_t",
+	"int8_t", "int16_t", "int32_t", "int64_t"
+};
 
-CppHighlighter::CppHighlighter()
-{
-	const char *kw[] = {
-		"if", "else", "for", "while", "do", "switch", "case", "default", "break", "continue",
-		"return", "goto", "struct", "class", "namespace", "using", "template", "typename",
-		"public", "private", "protected", "virtual", "override", "const", "constexpr", "auto",
-		"static", "inline", "operator", "new", "delete", "try", "catch", "throw", "friend",
-		"enum", "union", "extern", "volatile", "mutable", "noexcept", "sizeof", "this"
-	};
-	for (auto s: kw)
-		keywords_.insert(s);
-	const char *types[] = {
-		"int", "long", "short", "char", "signed", "unsigned", "float", "double", "void",
-		"bool", "wchar_t", "size_t", "ptrdiff_t", "uint8_t", "uint16_t", "uint32_t", "uint64_t",
-		"int8_t", "int16_t", "int32_t", "int64_t"
-	};
-	for (auto s: types)
-		types_.insert(s);
-}
-
-
-bool
-CppHighlighter::is_ident_start(char c)
-{
-	return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
-}
-
-
-bool
-CppHighlighter::is_ident_char(char c)
-{
-	return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
-}
+static constexpr KeywordTable kWords(kKeywords, kTypes);
 
 
 void
-CppHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const
+CppHighlighter::HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const
 {
 	// Stateless entry simply delegates to stateful with a clean previous state
 	StatefulHighlighter::LineState prev;
-	(void) HighlightLineStateful(buf, row, prev, out);
+	(void) HighlightLineStateful(line, prev, out);
 }
 
 
 StatefulHighlighter::LineState
-CppHighlighter::HighlightLineStateful(const Buffer &buf,
-                                      int row,
+CppHighlighter::HighlightLineStateful(std::string_view line,
                                       const LineState &prev,
                                       std::vector<HighlightSpan> &out) const
 {
-	const auto &rows                     = buf.Rows();
 	StatefulHighlighter::LineState state = prev;
-	if (row < 0 || static_cast<std::size_t>(row) >= rows.size())
-		return state;
-	std::string s = static_cast<std::string>(rows[static_cast<std::size_t>(row)]);
-	if (s.empty())
+	if (line.empty())
 		return state;
 
 	auto push = [&](int a, int b, TokenKind k) {
 		if (b > a)
 			out.push_back({a, b, k});
 	};
-	int n   = static_cast<int>(s.size());
+	int n   = static_cast<int>(line.size());
 	int bol = 0;
-	while (bol < n && (s[bol] == ' ' || s[bol] == '\t'))
+	while (bol < n && (line[bol] == ' ' || line[bol] == '\t'))
 		++bol;
 	int i = 0;
 
 	// Continue multi-line raw string from previous line
 	if (state.in_raw_string) {
 		std::string needle = ")" + state.raw_delim + "\"";
-		auto pos           = s.find(needle);
-		if (pos == std::string::npos) {
+		auto pos           = line.find(needle);
+		if (pos == std::string_view::npos) {
 			push(0, n, TokenKind::String);
 			state.in_raw_string = true;
 			return state;
@@ -99,7 +68,7 @@ CppHighlighter::HighlightLineStateful(const Buffer &buf,
 	if (state.in_block_comment) {
 		int j = i;
 		while (i + 1 < n) {
-			if (s[i] == '*' && s[i + 1] == '/') {
+			if (line[i] == '*' && line[i + 1] == '/') {
 				i += 2;
 				push(j, i, TokenKind::Comment);
 				state.in_block_comment = false;
@@ -114,7 +83,7 @@ CppHighlighter::HighlightLineStateful(const Buffer &buf,
 	}
 
 	while (i < n) {
-		char c = s[i];
+		char c = line[i];
 		// Preprocessor at beginning of line (after leading whitespace)
 		if (i == bol && c == '#') {
 			push(0, n, TokenKind::Preproc);
@@ -124,7 +93,7 @@ CppHighlighter::HighlightLineStateful(const Buffer &buf,
 		// Whitespace
 		if (c == ' ' || c == '\t') {
 			int j = i + 1;
-			while (j < n && (s[j] == ' ' || s[j] == '\t'))
+			while (j < n && (line[j] == ' ' || line[j] == '\t'))
 				++j;
 			push(i, j, TokenKind::Whitespace);
 			i = j;
@@ -132,17 +101,17 @@ CppHighlighter::HighlightLineStateful(const Buffer &buf,
 		}
 
 		// Line comment
-		if (c == '/' && i + 1 < n && s[i + 1] == '/') {
+		if (c == '/' && i + 1 < n && line[i + 1] == '/') {
 			push(i, n, TokenKind::Comment);
 			break;
 		}
 
 		// Block comment
-		if (c == '/' && i + 1 < n && s[i + 1] == '*') {
+		if (c == '/' && i + 1 < n && line[i + 1] == '*') {
 			int j       = i + 2;
 			bool closed = false;
 			while (j + 1 <= n) {
-				if (j + 1 < n && s[j] == '*' && s[j + 1] == '/') {
+				if (j + 1 < n && line[j] == '*' && line[j + 1] == '/') {
 					j += 2;
 					closed = true;
 					break;
@@ -161,18 +130,18 @@ CppHighlighter::HighlightLineStateful(const Buffer &buf,
 		}
 
 		// Raw string start: very simple detection: R"delim(
-		if (c == 'R' && i + 1 < n && s[i + 1] == '"') {
+		if (c == 'R' && i + 1 < n && line[i + 1] == '"') {
 			int k = i + 2;
 			std::string delim;
-			while (k < n && s[k] != '(') {
-				delim.push_back(s[k]);
+			while (k < n && line[k] != '(') {
+				delim.push_back(line[k]);
 				++k;
 			}
-			if (k < n && s[k] == '(') {
+			if (k < n && line[k] == '(') {
 				int body_start     = k + 1;
 				std::string needle = ")" + delim + "\"";
-				auto pos           = s.find(needle, static_cast<std::size_t>(body_start));
-				if (pos == std::string::npos) {
+				auto pos           = line.find(needle, static_cast<std::size_t>(body_start));
+				if (pos == std::string_view::npos) {
 					push(i, n, TokenKind::String);
 					state.in_raw_string = true;
 					state.raw_delim     = delim;
@@ -192,7 +161,7 @@ CppHighlighter::HighlightLineStateful(const Buffer &buf,
 			int j    = i + 1;
 			bool esc = false;
 			while (j < n) {
-				char d = s[j++];
+				char d = line[j++];
 				if (esc) {
 					esc = false;
 					continue;
@@ -214,7 +183,7 @@ CppHighlighter::HighlightLineStateful(const Buffer &buf,
 			int j    = i + 1;
 			bool esc = false;
 			while (j < n) {
-				char d = s[j++];
+				char d = line[j++];
 				if (esc) {
 					esc = false;
 					continue;
@@ -232,10 +201,10 @@ CppHighlighter::HighlightLineStateful(const Buffer &buf,
 		}
 
 		// Number literal (simple)
-		if (is_digit(c) || (c == '.' && i + 1 < n && is_digit(s[i + 1]))) {
+		if (is_digit(c) || (c == '.' && i + 1 < n && is_digit(line[i + 1]))) {
 			int j = i + 1;
-			while (j < n && (std::isalnum(static_cast<unsigned char>(s[j])) || s[j] == '.' || s[j] == 'x' ||
-			                 s[j] == 'X' || s[j] == 'b' || s[j] == 'B' || s[j] == '_'))
+			while (j < n && (is_alnum(line[j]) || line[j] == '.' || line[j] == 'x' ||
+			                 line[j] == 'X' || line[j] == 'b' || line[j] == 'B' || line[j] == '_'))
 				++j;
 			push(i, j, TokenKind::Number);
 			i = j;
@@ -243,24 +212,18 @@ CppHighlighter::HighlightLineStateful(const Buffer &buf,
 		}
 
 		// Identifier / keyword / type
-		if (is_ident_start(c)) {
+		if (kCharClasses.Is(c, kIdentStart)) {
 			int j = i + 1;
-			while (j < n && is_ident_char(s[j]))
+			while (j < n && kCharClasses.Is(line[j], kIdentChar))
 				++j;
-			std::string id = s.substr(i, j - i);
-			TokenKind k    = TokenKind::Identifier;
-			if (keywords_.count(id))
-				k = TokenKind::Keyword;
-			else if (types_.count(id))
-				k = TokenKind::Type;
-			push(i, j, k);
+			push(i, j, kWords.Lookup(line.substr(i, j - i), TokenKind::Identifier));
 			i = j;
 			continue;
 		}
 
 		// Operators and punctuation (single char for now)
 		TokenKind kind = TokenKind::Operator;
-		if (std::ispunct(static_cast<unsigned char>(c)) && c != '_' && c != '#') {
+		if (is_punct(c) && c != '_' && c != '#') {
 			if (c == ';' || c == ',' || c == '(' || c == ')' || c == '{' || c == '}' || c == '[' || c ==
 			    ']')
 				kind = TokenKind::Punctuation;
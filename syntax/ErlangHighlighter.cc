@@ -1,6 +1,5 @@
 #include "ErlangHighlighter.h"
-#include "../Buffer.h"
-#include <cctype>
+#include "LexTables.h"
 
 namespace kte {
 static void
@@ -11,47 +10,29 @@ push(std::vector<HighlightSpan> &out, int a, int b, TokenKind k)
 }
 
 
-static bool
-is_ident_start(char c)
-{
-	return std::isalpha(static_cast<unsigned char>(c)) || c == '_' || c == '\'';
-}
+// Atoms may open with a quote, and names run on through '@', ':' and '?'
+static constexpr CharClasses kChars = kCharClasses.With(kIdentStart, "'").With(kIdentChar, "@:?");
 
 
-static bool
-is_ident_char(char c)
-{
-	return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '@' || c == ':' || c == '?';
-}
-
+static constexpr std::string_view kKeywords[] = {
+	"after", "begin", "case", "catch", "cond", "div", "end", "fun", "if", "let", "of",
+	"receive", "when", "try", "rem", "and", "andalso", "orelse", "not", "band", "bor", "bxor",
+	"bnot", "xor", "module", "export", "import", "record", "define", "undef", "include", "include_lib"
+};
 
-ErlangHighlighter::ErlangHighlighter()
-{
-	const char *kw[] = {
-		"after", "begin", "case", "catch", "cond", "div", "end", "fun", "if", "let", "of",
-		"receive", "when", "try", "rem", "and", "andalso", "orelse", "not", "band", "bor", "bxor",
-		"bnot", "xor", "module", "export", "import", "record", "define", "undef", "include", "include_lib"
-	};
-	for (auto s: kw)
-		kws_.insert(s);
-}
+static constexpr KeywordTable kWords(kKeywords, true);
 
 
 void
-ErlangHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const
+ErlangHighlighter::HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const
 {
-	const auto &rows = buf.Rows();
-	if (row < 0 || static_cast<std::size_t>(row) >= rows.size())
-		return;
-	std::string s = static_cast<std::string>(rows[static_cast<std::size_t>(row)]);
-	int n         = static_cast<int>(s.size());
-	int i         = 0;
-
+	int n = static_cast<int>(line.size());
+	int i = 0;
 	while (i < n) {
-		char c = s[i];
+		char c = line[i];
 		if (c == ' ' || c == '\t') {
 			int j = i + 1;
-			while (j < n && (s[j] == ' ' || s[j] == '\t'))
+			while (j < n && (line[j] == ' ' || line[j] == '\t'))
 				++j;
 			push(out, i, j, TokenKind::Whitespace);
 			i = j;
@@ -67,7 +48,7 @@ ErlangHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<Highlig
 			int j    = i + 1;
 			bool esc = false;
 			while (j < n) {
-				char d = s[j++];
+				char d = line[j++];
 				if (esc) {
 					esc = false;
 					continue;
@@ -86,7 +67,7 @@ ErlangHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<Highlig
 		// char literal $X
 		if (c == '$') {
 			int j = i + 1;
-			if (j < n && s[j] == '\\' && j + 1 < n)
+			if (j < n && line[j] == '\\' && j + 1 < n)
 				j += 2;
 			else if (j < n)
 				++j;
@@ -95,25 +76,24 @@ ErlangHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<Highlig
 			continue;
 		}
 		// numbers
-		if (std::isdigit(static_cast<unsigned char>(c))) {
+		if (is_digit(c)) {
 			int j = i + 1;
-			while (j < n && (std::isalnum(static_cast<unsigned char>(s[j])) || s[j] == '#' || s[j] == '.' ||
-			                 s[j] == '_'))
+			while (j < n && (is_alnum(line[j]) || line[j] == '#' || line[j] == '.' || line[j] == '_'))
 				++j;
 			push(out, i, j, TokenKind::Number);
 			i = j;
 			continue;
 		}
 		// atoms/variables/identifiers (including quoted atoms)
-		if (is_ident_start(c)) {
+		if (kChars.Is(c, kIdentStart)) {
 			// quoted atom: '...'
 			if (c == '\'') {
 				int j    = i + 1;
 				bool esc = false;
 				while (j < n) {
-					char d = s[j++];
+					char d = line[j++];
 					if (d == '\'') {
-						if (j < n && s[j] == '\'') {
+						if (j < n && line[j] == '\'') {
 							++j;
 							continue;
 						}
@@ -127,23 +107,15 @@ ErlangHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<Highlig
 				continue;
 			}
 			int j = i + 1;
-			while (j < n && is_ident_char(s[j]))
+			while (j < n && kChars.Is(line[j], kIdentChar))
 				++j;
-			std::string id = s.substr(i, j - i);
-			// lowercase leading -> atom/function/module; uppercase or '_' -> variable
-			TokenKind k = TokenKind::Identifier;
-			// keyword check (lowercase)
-			std::string lower;
-			lower.reserve(id.size());
-			for (char ch: id)
-				lower.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(ch))));
-			if (kws_.count(lower))
-				k = TokenKind::Keyword;
-			push(out, i, j, k);
+			// lowercase leading -> atom/function/module; uppercase or '_' -> variable;
+			// keywords match in either case
+			push(out, i, j, kWords.Lookup(line.substr(i, j - i), TokenKind::Identifier));
 			i = j;
 			continue;
 		}
-		if (std::ispunct(static_cast<unsigned char>(c))) {
+		if (is_punct(c)) {
 			TokenKind k = TokenKind::Operator;
 			if (c == ',' || c == ';' || c == '(' || c == ')' || c == '[' || c == ']' || c == '{' || c ==
 			    '}')
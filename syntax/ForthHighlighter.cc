@@ -1,6 +1,5 @@
 #include "ForthHighlighter.h"
-#include "../Buffer.h"
-#include <cctype>
+#include "LexTables.h"
 
 namespace kte {
 static void
@@ -11,47 +10,36 @@ push(std::vector<HighlightSpan> &out, int a, int b, TokenKind k)
 }
 
 
-static bool
-is_word_char(char c)
-{
-	return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '>' || c == '<' || c == '?';
-}
+// Words run on through '>', '<' and '?' as well
+static constexpr CharClasses kChars = kCharClasses.With(kIdentChar, "><?");
 
 
-ForthHighlighter::ForthHighlighter()
-{
-	const char *kw[] = {
-		":", ";", "if", "else", "then", "begin", "until", "while", "repeat",
-		"do", "loop", "+loop", "leave", "again", "case", "of", "endof", "endcase",
-		".", ".r", ".s", ".\"", ",", "cr", "emit", "type", "key",
-		"+", "-", "*", "/", "mod", "/mod", "+-", "abs", "min", "max",
-		"dup", "drop", "swap", "over", "rot", "-rot", "nip", "tuck", "pick", "roll",
-		"and", "or", "xor", "invert", "lshift", "rshift",
-		"variable", "constant", "value", "to", "create", "does>", "allot", ",",
-		"cells", "cell+", "chars", "char+",
-		"[", "]", "immediate",
-		"s\"", ".\""
-	};
-	for (auto s: kw)
-		kws_.insert(s);
-}
+static constexpr std::string_view kKeywords[] = {
+	":", ";", "if", "else", "then", "begin", "until", "while", "repeat",
+	"do", "loop", "+loop", "leave", "again", "case", "of", "endof", "endcase",
+	".", ".r", ".s", ".\"", ",", "cr", "emit", "type", "key",
+	"+", "-", "*", "/", "mod", "/mod", "+-", "abs", "min", "max",
+	"dup", "drop", "swap", "over", "rot", "-rot", "nip", "tuck", "pick", "roll",
+	"and", "or", "xor", "invert", "lshift", "rshift",
+	"variable", "constant", "value", "to", "create", "does>", "allot", ",",
+	"cells", "cell+", "chars", "char+",
+	"[", "]", "immediate",
+	"s\"", ".\""
+};
+
+static constexpr KeywordTable kWords(kKeywords, true);
 
 
 void
-ForthHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const
+ForthHighlighter::HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const
 {
-	const auto &rows = buf.Rows();
-	if (row < 0 || static_cast<std::size_t>(row) >= rows.size())
-		return;
-	std::string s = static_cast<std::string>(rows[static_cast<std::size_t>(row)]);
-	int n         = static_cast<int>(s.size());
-	int i         = 0;
-
+	int n = static_cast<int>(line.size());
+	int i = 0;
 	while (i < n) {
-		char c = s[i];
+		char c = line[i];
 		if (c == ' ' || c == '\t') {
 			int j = i + 1;
-			while (j < n && (s[j] == ' ' || s[j] == '\t'))
+			while (j < n && (line[j] == ' ' || line[j] == '\t'))
 				++j;
 			push(out, i, j, TokenKind::Whitespace);
 			i = j;
@@ -65,7 +53,7 @@ ForthHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<Highligh
 		// parenthesis comment ( ... ) if at word boundary
 		if (c == '(') {
 			int j = i + 1;
-			while (j < n && s[j] != ')')
+			while (j < n && line[j] != ')')
 				++j;
 			if (j < n)
 				++j;
@@ -76,7 +64,7 @@ ForthHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<Highligh
 		// strings: ." ... " and S" ... " and raw "..."
 		if (c == '"') {
 			int j = i + 1;
-			while (j < n && s[j] != '"')
+			while (j < n && line[j] != '"')
 				++j;
 			if (j < n)
 				++j;
@@ -84,28 +72,24 @@ ForthHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<Highligh
 			i = j;
 			continue;
 		}
-		if (std::isdigit(static_cast<unsigned char>(c))) {
+		if (is_digit(c)) {
 			int j = i + 1;
-			while (j < n && (std::isalnum(static_cast<unsigned char>(s[j])) || s[j] == '.' || s[j] == '#'))
+			while (j < n && (is_alnum(line[j]) || line[j] == '.' || line[j] == '#'))
 				++j;
 			push(out, i, j, TokenKind::Number);
 			i = j;
 			continue;
 		}
 		// word/identifier
-		if (std::isalpha(static_cast<unsigned char>(c)) || std::ispunct(static_cast<unsigned char>(c))) {
+		if (is_alpha(c) || is_punct(c)) {
 			int j = i + 1;
-			while (j < n && is_word_char(s[j]))
+			while (j < n && kChars.Is(line[j], kIdentChar))
 				++j;
-			std::string w = s.substr(i, j - i);
-			// normalize to lowercase for keyword compare (Forth is case-insensitive typically)
-			std::string lower;
-			lower.reserve(w.size());
-			for (char ch: w)
-				lower.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(ch))));
-			TokenKind k = kws_.count(lower) ? TokenKind::Keyword : TokenKind::Identifier;
+			std::string_view w = line.substr(i, j - i);
+			// keywords match in either case (Forth is case-insensitive typically)
+			TokenKind k = kWords.Lookup(w, TokenKind::Identifier);
 			// Single-char punctuation fallback
-			if (w.size() == 1 && std::ispunct(static_cast<unsigned char>(w[0])) && !kws_.count(lower)) {
+			if (w.size() == 1 && is_punct(w[0]) && k != TokenKind::Keyword) {
 				k = (w[0] == '(' || w[0] == ')' || w[0] == ',')
 					    ? TokenKind::Punctuation
 					    : TokenKind::Operator;
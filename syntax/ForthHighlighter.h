@@ -2,16 +2,10 @@
 #pragma once
 
 #include "LanguageHighlighter.h"
-#include <unordered_set>
 
 namespace kte {
 class ForthHighlighter final : public LanguageHighlighter {
 public:
-	ForthHighlighter();
-
-	void HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const override;
-
-private:
-	std::unordered_set<std::string> kws_;
+	void HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const override;
 };
 } // namespace kte
\ No newline at end of file
@@ -1,6 +1,5 @@
 #include "GoHighlighter.h"
-#include "../Buffer.h"
-#include <cctype>
+#include "LexTables.h"
 
 namespace kte {
 static void
@@ -11,70 +10,48 @@ push(std::vector<HighlightSpan> &out, int a, int b, TokenKind k)
 }
 
 
-static bool
-is_ident_start(char c)
-{
-	return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
-}
-
-
-static bool
-is_ident_char(char c)
-{
-	return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
-}
+static constexpr std::string_view kKeywords[] = {
+	"break", "case", "chan", "const", "continue", "default", "defer", "else", "fallthrough", "for", "func",
+	"go", "goto", "if", "import", "interface", "map", "package", "range", "return", "select", "struct",
+	"switch", "type", "var"
+};
 
+static constexpr std::string_view kTypes[] = {
+	"bool", "byte", "complex64", "complex128", "error", "float32", "float64", "int", "int8", "int16",
+	"int32", "int64", "rune", "string", "uint", "uint8", "uint16", "uint32", "uint64", "uintptr"
+};
 
-GoHighlighter::GoHighlighter()
-{
-	const char *kw[] = {
-		"break", "case", "chan", "const", "continue", "default", "defer", "else", "fallthrough", "for", "func",
-		"go", "goto", "if", "import", "interface", "map", "package", "range", "return", "select", "struct",
-		"switch", "type", "var"
-	};
-	for (auto s: kw)
-		kws_.insert(s);
-	const char *tp[] = {
-		"bool", "byte", "complex64", "complex128", "error", "float32", "float64", "int", "int8", "int16",
-		"int32", "int64", "rune", "string", "uint", "uint8", "uint16", "uint32", "uint64", "uintptr"
-	};
-	for (auto s: tp)
-		types_.insert(s);
-}
+static constexpr KeywordTable kWords(kKeywords, kTypes);
 
 
 void
-GoHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const
+GoHighlighter::HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const
 {
-	const auto &rows = buf.Rows();
-	if (row < 0 || static_cast<std::size_t>(row) >= rows.size())
-		return;
-	std::string s = static_cast<std::string>(rows[static_cast<std::size_t>(row)]);
-	int n         = static_cast<int>(s.size());
-	int i         = 0;
-	int bol       = 0;
-	while (bol < n && (s[bol] == ' ' || s[bol] == '\t'))
+	int n   = static_cast<int>(line.size());
+	int i   = 0;
+	int bol = 0;
+	while (bol < n && (line[bol] == ' ' || line[bol] == '\t'))
 		++bol;
 	// line comment
 	while (i < n) {
-		char c = s[i];
+		char c = line[i];
 		if (c == ' ' || c == '\t') {
 			int j = i + 1;
-			while (j < n && (s[j] == ' ' || s[j] == '\t'))
+			while (j < n && (line[j] == ' ' || line[j] == '\t'))
 				++j;
 			push(out, i, j, TokenKind::Whitespace);
 			i = j;
 			continue;
 		}
-		if (c == '/' && i + 1 < n && s[i + 1] == '/') {
+		if (c == '/' && i + 1 < n && line[i + 1] == '/') {
 			push(out, i, n, TokenKind::Comment);
 			break;
 		}
-		if (c == '/' && i + 1 < n && s[i + 1] == '*') {
+		if (c == '/' && i + 1 < n && line[i + 1] == '*') {
 			int j       = i + 2;
 			bool closed = false;
 			while (j + 1 <= n) {
-				if (j + 1 < n && s[j] == '*' && s[j + 1] == '/') {
+				if (j + 1 < n && line[j] == '*' && line[j + 1] == '/') {
 					j += 2;
 					closed = true;
 					break;
@@ -95,13 +72,13 @@ GoHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<HighlightSp
 			int j    = i + 1;
 			bool esc = false;
 			if (q == '`') {
-				while (j < n && s[j] != '`')
+				while (j < n && line[j] != '`')
 					++j;
 				if (j < n)
 					++j;
 			} else {
 				while (j < n) {
-					char d = s[j++];
+					char d = line[j++];
 					if (esc) {
 						esc = false;
 						continue;
@@ -118,30 +95,24 @@ GoHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<HighlightSp
 			i = j;
 			continue;
 		}
-		if (std::isdigit(static_cast<unsigned char>(c))) {
+		if (is_digit(c)) {
 			int j = i + 1;
-			while (j < n && (std::isalnum(static_cast<unsigned char>(s[j])) || s[j] == '.' || s[j] == 'x' ||
-			                 s[j] == 'X' || s[j] == '_'))
+			while (j < n && (is_alnum(line[j]) || line[j] == '.' || line[j] == 'x' ||
+			                 line[j] == 'X' || line[j] == '_'))
 				++j;
 			push(out, i, j, TokenKind::Number);
 			i = j;
 			continue;
 		}
-		if (is_ident_start(c)) {
+		if (kCharClasses.Is(c, kIdentStart)) {
 			int j = i + 1;
-			while (j < n && is_ident_char(s[j]))
+			while (j < n && kCharClasses.Is(line[j], kIdentChar))
 				++j;
-			std::string id = s.substr(i, j - i);
-			TokenKind k    = TokenKind::Identifier;
-			if (kws_.count(id))
-				k = TokenKind::Keyword;
-			else if (types_.count(id))
-				k = TokenKind::Type;
-			push(out, i, j, k);
+			push(out, i, j, kWords.Lookup(line.substr(i, j - i), TokenKind::Identifier));
 			i = j;
 			continue;
 		}
-		if (std::ispunct(static_cast<unsigned char>(c))) {
+		if (is_punct(c)) {
 			TokenKind k = TokenKind::Operator;
 			if (c == ';' || c == ',' || c == '(' || c == ')' || c == '{' || c == '}' || c == '[' || c ==
 			    ']')
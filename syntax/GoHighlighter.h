@@ -2,17 +2,10 @@
 #pragma once
 
 #include "LanguageHighlighter.h"
-#include <unordered_set>
 
 namespace kte {
 class GoHighlighter final : public LanguageHighlighter {
 public:
-	GoHighlighter();
-
-	void HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const override;
-
-private:
-	std::unordered_set<std::string> kws_;
-	std::unordered_set<std::string> types_;
+	void HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const override;
 };
 } // namespace kte
\ No newline at end of file
@@ -1,25 +1,84 @@
 #include "HighlighterEngine.h"
 #include "../Buffer.h"
+#include "../WorkerPool.h"
 #include "LanguageHighlighter.h"
-#include <thread>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <iterator>
+#include <limits>
 
 namespace kte {
-HighlighterEngine::HighlighterEngine() = default;
+// Bytes of row without its newline, viewed in place in the piece table unless
+// the line spans pieces; empty past the end of the buffer
+static std::string_view
+line_bytes(const Buffer &buf, int row, std::string &scratch)
+{
+	if (row < 0 || static_cast<std::size_t>(row) >= buf.Nrows())
+		return {};
+	std::string_view line = buf.GetLineView(static_cast<std::size_t>(row), scratch);
+	if (!line.empty() && line.back() == '\n')
+		line.remove_suffix(1);
+	return line;
+}
+
+
+// Lets warming pieces in until the engine goes away
+struct HighlighterEngine::WarmGate {
+	std::mutex mtx;
+	std::condition_variable cv;
+	int running{0};
+	bool closed{false};
+
+
+	bool Enter()
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		if (closed)
+			return false;
+		++running;
+		return true;
+	}
+
+
+	void Leave()
+	{
+		std::lock_guard<std::mutex> lock(mtx);
+		--running;
+		cv.notify_all();
+	}
+
+
+	// Keep new pieces out and wait for the running ones
+	void Close()
+	{
+		std::unique_lock<std::mutex> lock(mtx);
+		closed = true;
+		cv.wait(lock, [this] {
+			return running == 0;
+		});
+	}
+};
+
+
+// One PrefetchViewport()'s warm-around. Pieces read the snapshot, so they
+// never touch the live buffer while the UI thread edits it.
+struct HighlighterEngine::WarmJob {
+	std::shared_ptr<WarmGate> gate;
+	std::shared_ptr<const Buffer> buf;
+	std::uint64_t version{0};
+	std::uint64_t epoch{0};
+	std::atomic<bool> superseded{false};
+};
+
+
+HighlighterEngine::HighlighterEngine()
+	: warm_gate_(std::make_shared<WarmGate>()) {}
 
 
 HighlighterEngine::~HighlighterEngine()
 {
-	// stop background worker
-	if (worker_running_.load()) {
-		{
-			std::lock_guard<std::mutex> lock(mtx_);
-			worker_running_.store(false);
-			has_request_ = true; // wake it up to exit
-		}
-		cv_.notify_one();
-		if (worker_.joinable())
-			worker_.join();
-	}
+	warm_gate_->Close();
 }
 
 
@@ -28,93 +87,200 @@ HighlighterEngine::SetHighlighter(std::unique_ptr<LanguageHighlighter> hl)
 {
 	std::lock_guard<std::mutex> lock(mtx_);
 	hl_ = std::move(hl);
-	cache_.clear();
-	state_cache_.clear();
-	state_last_contig_.clear();
+	cache_.Clear();
+	checkpoints_.clear();
+	trusted_ = 0;
+	dirty_.clear();
+	++epoch_;
 }
 
 
 LineHighlight
 HighlighterEngine::GetLine(const Buffer &buf, int row, std::uint64_t buf_version) const
 {
-	std::unique_lock<std::mutex> lock(mtx_);
-	auto it = cache_.find(row);
-	if (it != cache_.end() && it->second.version == buf_version) {
-		return it->second; // return by value (copy)
+	std::uint64_t epoch;
+	{
+		std::lock_guard<std::mutex> lock(mtx_);
+		if (const LineHighlight *lh = find_line(row)) {
+			LineHighlight result = *lh; // return by value (copy)
+			result.version       = buf_version;
+			return result;
+		}
+		epoch = epoch_;
 	}
-
-	// We'll compute into a local result to avoid exposing references to cache
 	LineHighlight result;
+	compute_rows(buf, row, row, buf_version, epoch, &result);
 	result.version = buf_version;
-	result.spans.clear();
+	return result;
+}
+
+
+int
+HighlighterEngine::settled_rows() const
+{
+	return dirty_.empty() ? std::numeric_limits<int>::max() : dirty_.front().first;
+}
+
+
+const LineHighlight *
+HighlighterEngine::find_line(int row) const
+{
+	const LineEntry *e = cache_.Find(row);
+	if (!e || !e->valid)
+		return nullptr;
+	// Below an unsettled edit only lines highlighted since then are current
+	return row < settled_rows() || e->edit_seq == edit_seq_ ? &e->line : nullptr;
+}
+
+
+void
+HighlighterEngine::compute_rows(const Buffer &buf, int first, int last, std::uint64_t buf_version,
+                                std::uint64_t epoch, LineHighlight *out) const
+{
+	// Rows past either end have no spans and are not cached
+	const int nrows = static_cast<int>(buf.Nrows());
+	first           = std::max(first, 0);
+	last            = std::min(last, nrows - 1);
+	if (first > last)
+		return;
+
+	std::unique_lock<std::mutex> lock(mtx_);
+	if (epoch != epoch_)
+		return;
+	if (out) {
+		if (const LineHighlight *lh = find_line(last)) {
+			*out = *lh;
+			return;
+		}
+	} else {
+		while (first <= last && find_line(first))
+			++first;
+		while (last >= first && find_line(last))
+			--last;
+		if (first > last)
+			return;
+	}
+
+	auto store = [&](int row, LineHighlight &&lh) {
+		if (out && row == last)
+			*out = lh;
+		cache_.At(row) = LineEntry{true, edit_seq_, std::move(lh)};
+	};
 
 	if (!hl_) {
-		// Cache empty result and return it
-		cache_[row] = result;
-		return result;
+		for (int r = first; r <= last; ++r)
+			store(r, LineHighlight{{}, buf_version});
+		return;
 	}
 
-	// Copy shared_ptr-like raw pointer for use outside critical sections
-	LanguageHighlighter *hl_ptr = hl_.get();
-	bool is_stateful            = dynamic_cast<StatefulHighlighter *>(hl_ptr) != nullptr;
+	// Raw pointer for use outside critical sections
+	const LanguageHighlighter *hl_ptr = hl_.get();
+	std::string scratch;
 
-	if (!is_stateful) {
-		// Stateless fast path: we can release the lock while computing to reduce contention
+	if (!hl_ptr->Stateful()) {
+		// Stateless: each row stands alone, so release the lock while computing
 		lock.unlock();
-		hl_ptr->HighlightLine(buf, row, result.spans);
-		// Update cache and return
-		std::lock_guard<std::mutex> gl(mtx_);
-		cache_[row] = result;
-		return result;
-	}
-
-	// Stateful path: we need to walk from a known previous state. Keep lock while consulting caches,
-	// but release during heavy computation.
-	auto *stateful = static_cast<StatefulHighlighter *>(hl_ptr);
-
-	StatefulHighlighter::LineState prev_state;
-	int start_row = -1;
-	if (!state_cache_.empty()) {
-		// linear search over map (unordered), track best candidate
-		int best = -1;
-		for (const auto &kv: state_cache_) {
-			int r = kv.first;
-			// Only use cached state if it's for the current version and row still exists
-			if (r <= row - 1 && kv.second.version == buf_version) {
-				// Validate that the cached row index is still valid in the buffer
-				if (r >= 0 && static_cast<std::size_t>(r) < buf.Rows().size()) {
-					if (r > best)
-						best = r;
-				}
-			}
-		}
-		if (best >= 0) {
-			start_row  = best;
-			prev_state = state_cache_.at(best).state;
+		for (int r = first; r <= last; ++r) {
+			LineHighlight lh;
+			lh.version = buf_version;
+			hl_ptr->HighlightLine(line_bytes(buf, r, scratch), lh.spans);
+			std::lock_guard<std::mutex> gl(mtx_);
+			if (epoch != epoch_)
+				return;
+			store(r, std::move(lh));
 		}
+		return;
 	}
 
-	// We'll compute states and the target line's spans without holding the lock for most of the work.
-	// Create a local copy of prev_state and iterate rows; we will update caches under lock.
+	// Stateful: walk from the nearest trusted checkpoint, keeping the spans
+	// computed on the way. The lock is only held between lines.
+	const auto *stateful = static_cast<const StatefulHighlighter *>(hl_ptr);
+	if (checkpoints_.empty()) {
+		checkpoints_.push_back(Checkpoint{true, 0, {}});
+		trusted_ = 1;
+	}
+	const std::size_t c = nearest_checkpoint(first);
+	int row             = checkpoints_[c].row;
+	StatefulHighlighter::LineState state = checkpoints_[c].state;
 	lock.unlock();
-	StatefulHighlighter::LineState cur_state = prev_state;
-	for (int r = start_row + 1; r <= row; ++r) {
-		std::vector<HighlightSpan> tmp;
-		std::vector<HighlightSpan> &out = (r == row) ? result.spans : tmp;
-		auto next_state                 = stateful->HighlightLineStateful(buf, r, cur_state, out);
-		// Update state cache for r
+	while (row <= last) {
+		LineHighlight lh;
+		lh.version = buf_version;
+		StatefulHighlighter::LineState next = stateful->HighlightLineStateful(
+			line_bytes(buf, row, scratch), state, lh.spans);
 		std::lock_guard<std::mutex> gl(mtx_);
-		StateEntry se;
-		se.version      = buf_version;
-		se.state        = next_state;
-		state_cache_[r] = se;
-		cur_state       = next_state;
+		if (epoch != epoch_)
+			return;
+		store(row, std::move(lh));
+		state = std::move(next);
+		if (!checkpoint(++row, state))
+			continue;
+		// After an early stop the rows ahead may be current again: resume
+		// at the first that is not, from the nearest checkpoint before it
+		while (first <= last && find_line(first))
+			++first;
+		if (first > last) {
+			if (out)
+				*out = *find_line(last);
+			return;
+		}
+		const std::size_t g = nearest_checkpoint(first);
+		if (checkpoints_[g].row > row) {
+			row   = checkpoints_[g].row;
+			state = checkpoints_[g].state;
+		}
 	}
+}
 
-	// Store in cache and return by value
-	lock.lock();
-	cache_[row] = result;
-	return result;
+
+std::size_t
+HighlighterEngine::nearest_checkpoint(int row) const
+{
+	std::size_t c = std::min(static_cast<std::size_t>(std::max(row, 0) / kCheckpointRows), trusted_ - 1);
+	// One moved by an edit may start after row; the one before cannot
+	if (checkpoints_[c].row > row)
+		--c;
+	return c;
+}
+
+
+bool
+HighlighterEngine::checkpoint(int row, const StatefulHighlighter::LineState &state) const
+{
+	const auto g = static_cast<std::size_t>(row / kCheckpointRows);
+	if (g < trusted_)
+		return false;
+	const bool stale = g < checkpoints_.size() && checkpoints_[g].valid;
+	if (stale ? checkpoints_[g].row > row : row % kCheckpointRows != 0)
+		return false;
+	if (stale && checkpoints_[g].row == row && checkpoints_[g].state == state) {
+		// Early stop: the edits above arrive at the state they left here,
+		// so nothing below changed up to the next edit
+		dirty_.erase(dirty_.begin(), std::find_if(dirty_.begin(), dirty_.end(),
+		                                          [row](const std::pair<int, int> &d) {
+			                                          return d.first >= row;
+		                                          }));
+		const int limit = settled_rows();
+		std::size_t t   = g;
+		while (t < checkpoints_.size() && checkpoints_[t].valid && checkpoints_[t].row <= limit)
+			++t;
+		trusted_ = t;
+		return true;
+	}
+
+	if (g >= checkpoints_.size())
+		checkpoints_.resize(g + 1);
+	checkpoints_[g] = Checkpoint{true, row, state};
+	trusted_        = g + 1;
+	// Any edit above still shows here, so the stale checkpoints after this
+	// one are unsettled from row on
+	auto it = dirty_.begin();
+	int end = row;
+	for (; it != dirty_.end() && it->first < row; ++it)
+		end = std::max(end, it->second);
+	if (it != dirty_.begin())
+		dirty_.insert(dirty_.erase(dirty_.begin(), it), std::make_pair(row, end));
+	return true;
 }
 
 
@@ -122,67 +288,118 @@ void
 HighlighterEngine::InvalidateFrom(int row)
 {
 	std::lock_guard<std::mutex> lock(mtx_);
-	if (cache_.empty())
+	row = std::max(row, 0);
+	++epoch_;
+	cache_.TruncateFrom(row);
+	// Checkpoints at or above row are unaffected; those below are dropped
+	auto keep = static_cast<std::size_t>(row / kCheckpointRows) + 1;
+	if (keep <= checkpoints_.size() && checkpoints_[keep - 1].row > row)
+		--keep;
+	if (checkpoints_.size() > keep)
+		checkpoints_.resize(keep);
+	trusted_ = std::min(trusted_, checkpoints_.size());
+	dirty_.erase(std::find_if(dirty_.begin(), dirty_.end(), [row](const std::pair<int, int> &d) {
+		             return d.first >= row;
+	             }), dirty_.end());
+}
+
+
+void
+HighlighterEngine::Edited(int row, int old_rows, int new_rows)
+{
+	std::lock_guard<std::mutex> lock(mtx_);
+	row = std::max(row, 0);
+	++epoch_;
+	++edit_seq_;
+	const int old_end = row + old_rows;
+	const int delta   = new_rows - old_rows;
+	for (int r = row; r < old_end; ++r) {
+		if (LineEntry *e = cache_.Find(r))
+			*e = LineEntry{};
+	}
+	cache_.Shift(old_end, delta);
+	if (!hl_ || !hl_->Stateful())
 		return;
-	// Simple implementation: erase all rows >= row
-	for (auto it = cache_.begin(); it != cache_.end();) {
-		if (it->first >= row)
-			it = cache_.erase(it);
-		else
-			++it;
-	}
-	if (!state_cache_.empty()) {
-		for (auto it = state_cache_.begin(); it != state_cache_.end();) {
-			if (it->first >= row)
-				it = state_cache_.erase(it);
-			else
-				++it;
+
+	// Rows [row, row + new_rows) join dirty_, along with any edit they
+	// touch; the edits below move with their rows
+	std::vector<std::pair<int, int> > dirty;
+	int lo = row;
+	int hi = row + new_rows;
+	for (const auto &[a, b]: dirty_) {
+		if (b < row) {
+			dirty.emplace_back(a, b);
+		} else if (a > old_end) {
+			dirty.emplace_back(a + delta, b + delta);
+		} else {
+			lo = std::min(lo, a);
+			hi = std::max(hi, b > old_end ? b + delta : row + new_rows);
+		}
+	}
+	dirty.insert(std::lower_bound(dirty.begin(), dirty.end(), std::make_pair(lo, hi)), std::make_pair(lo, hi));
+	dirty_ = std::move(dirty);
+
+	// Checkpoints at or above row stay trusted. Stale ones below the edit
+	// move with their rows; those inside it, or inside the edit it merged
+	// with, are gone.
+	const auto g = static_cast<std::size_t>(row / kCheckpointRows);
+	if (g < checkpoints_.size() && checkpoints_[g].row > row)
+		trusted_ = std::min(trusted_, g);
+	else
+		trusted_ = std::min(trusted_, g + 1);
+	std::vector<Checkpoint> moved;
+	for (std::size_t i = trusted_; i < checkpoints_.size(); ++i) {
+		Checkpoint &cp = checkpoints_[i];
+		if (!cp.valid)
+			continue;
+		if (cp.row > row) {
+			if (cp.row < old_end)
+				cp.valid = false;
+			cp.row += delta;
 		}
+		if (cp.valid && (cp.row <= lo || cp.row >= hi))
+			moved.push_back(std::move(cp));
+		cp = Checkpoint{};
+	}
+	for (Checkpoint &cp: moved) {
+		const auto i = static_cast<std::size_t>(cp.row / kCheckpointRows);
+		if (i >= checkpoints_.size())
+			checkpoints_.resize(i + 1);
+		// Two may land in one slot; keep the first, and never displace a
+		// trusted one
+		if (i >= trusted_ && (!checkpoints_[i].valid || checkpoints_[i].row > cp.row))
+			checkpoints_[i] = std::move(cp);
 	}
 }
 
 
 void
-HighlighterEngine::ensure_worker_started() const
+HighlighterEngine::post_warm(const std::shared_ptr<WarmJob> &job, int first, int last, int chain_last,
+                             long priority) const
 {
-	if (worker_running_.load())
-		return;
-	worker_running_.store(true);
-	worker_ = std::thread([this]() {
-		this->worker_loop();
+	WorkerPool::Shared().Post(priority, [this, job, first, last, chain_last, priority] {
+		if (job->superseded.load() || !job->gate->Enter())
+			return;
+		warm(job, first, last, chain_last, priority);
+		job->gate->Leave();
 	});
 }
 
 
 void
-HighlighterEngine::worker_loop() const
+HighlighterEngine::warm(const std::shared_ptr<WarmJob> &job, int first, int last, int chain_last,
+                        long priority) const
 {
-	std::unique_lock<std::mutex> lock(mtx_);
-	while (worker_running_.load()) {
-		cv_.wait(lock, [this]() {
-			return has_request_ || !worker_running_.load();
-		});
-		if (!worker_running_.load())
-			break;
-		WarmRequest req = pending_;
-		has_request_    = false;
-		// Copy locals then release lock while computing
-		lock.unlock();
-		if (req.buf) {
-			int start  = std::max(0, req.start_row);
-			int end    = std::max(start, req.end_row);
-			int skip_f = std::min(req.skip_first, req.skip_last);
-			int skip_l = std::max(req.skip_first, req.skip_last);
-			for (int r = start; r <= end; ++r) {
-				// Avoid touching rows that the foreground just computed/drew.
-				if (r >= skip_f && r <= skip_l)
-					continue;
-				// Compute line; GetLine is thread-safe and will refresh caches.
-				(void) this->GetLine(*req.buf, r, req.version);
-			}
-		}
-		lock.lock();
+	compute_rows(*job->buf, first, last, job->version, job->epoch, nullptr);
+	if (last >= chain_last || job->superseded.load())
+		return;
+	{
+		// An edit since the job was queued makes the rest of it stale
+		std::lock_guard<std::mutex> lock(mtx_);
+		if (job->epoch != epoch_)
+			return;
 	}
+	post_warm(job, last + 1, std::min(last + kCheckpointRows, chain_last), chain_last, priority + kCheckpointRows);
 }
 
 
@@ -201,24 +418,40 @@ HighlighterEngine::PrefetchViewport(const Buffer &buf, int first_row, int row_co
 	if (end >= max_rows)
 		end = max_rows - 1;
 
-	for (int r = start; r <= end; ++r) {
-		(void) GetLine(buf, r, buf_version);
+	std::uint64_t epoch;
+	{
+		std::lock_guard<std::mutex> lock(mtx_);
+		epoch = epoch_;
 	}
+	compute_rows(buf, start, end, buf_version, epoch, nullptr);
+
+	if (warm_margin <= 0)
+		return;
 
-	// Enqueue background warm-around
-	int warm_start = std::max(0, start - warm_margin);
-	int warm_end   = std::min(max_rows - 1, end + warm_margin);
+	// Warm around in the background, nearest the viewport first. Stateless
+	// rows stand alone, so their pieces can run side by side.
+	auto job     = std::make_shared<WarmJob>();
+	job->gate    = warm_gate_;
+	job->buf     = buf.Snapshot();
+	job->version = buf_version;
+	job->epoch   = epoch;
+	bool walk;
 	{
 		std::lock_guard<std::mutex> lock(mtx_);
-		pending_.buf        = &buf;
-		pending_.version    = buf_version;
-		pending_.start_row  = warm_start;
-		pending_.end_row    = warm_end;
-		pending_.skip_first = start;
-		pending_.skip_last  = end;
-		has_request_        = true;
-	}
-	ensure_worker_started();
-	cv_.notify_one();
+		walk = hl_ && hl_->Stateful();
+		if (warm_job_)
+			warm_job_->superseded.store(true);
+		warm_job_ = job;
+	}
+	auto post_range = [&](int from, int to) {
+		for (int r = from; r <= to; r += kCheckpointRows) {
+			const int last = std::min(r + kCheckpointRows - 1, to);
+			post_warm(job, r, last, walk ? to : last, r > end ? r - end : start - last);
+			if (walk)
+				break;
+		}
+	};
+	post_range(end + 1, std::min(max_rows - 1, end + warm_margin));
+	post_range(std::max(0, start - warm_margin), start - 1);
 }
-} // namespace kte
\ No newline at end of file
+} // namespace kte
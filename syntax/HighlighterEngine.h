@@ -1,14 +1,13 @@
 // HighlighterEngine.h - caching layer for per-line highlights
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
 #include <memory>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 #include <mutex>
-#include <condition_variable>
-#include <atomic>
-#include <thread>
 
 #include "../Highlight.h"
 #include "LanguageHighlighter.h"
@@ -26,12 +25,42 @@ public:
 
 	// Retrieve highlights for a given line and buffer version.
 	// Returns a copy to avoid lifetime issues across threads/renderers.
-	// If cache is stale, recompute using the current highlighter.
+	// If cache is stale, recompute using the current highlighter. Cached
+	// lines stay valid across versions: the buffer reports each edit through
+	// Edited(), which drops or shifts only the rows it touched.
 	LineHighlight GetLine(const Buffer &buf, int row, std::uint64_t buf_version) const;
 
+	// Zero-copy form of GetLine for renderers: call fn with the cached spans
+	// of row for buf_version, computing them first if needed. The spans are
+	// only valid during the call, which holds the engine's lock, so fn must
+	// not call back into the engine.
+	template<typename Fn>
+	void WithLine(const Buffer &buf, int row, std::uint64_t buf_version, Fn &&fn) const
+	{
+		static const std::vector<HighlightSpan> none;
+		std::unique_lock<std::mutex> lock(mtx_);
+		const LineHighlight *lh = find_line(row);
+		if (!lh) {
+			const std::uint64_t epoch = epoch_;
+			lock.unlock();
+			compute_rows(buf, row, row, buf_version, epoch, nullptr);
+			lock.lock();
+			// Normally cached now; an invalidation in between leaves none
+			lh = find_line(row);
+		}
+		fn(lh ? lh->spans : none);
+	}
+
+
 	// Invalidate cached lines from row (inclusive)
 	void InvalidateFrom(int row);
 
+	// Rows [row, row + old_rows) were replaced by new_rows rows. Only those
+	// rows are dropped; the rows below move with the edit and keep their
+	// highlights unless highlighting through the edit ends in a different
+	// state, which is found out on the next access below it.
+	void Edited(int row, int old_rows, int new_rows);
+
 
 	bool HasHighlighter() const
 	{
@@ -42,49 +71,169 @@ public:
 	// Phase 3: viewport-first prefetch and background warming
 	// Compute only the visible range now, and enqueue a background warm-around task.
 	// warm_margin: how many extra lines above/below to warm in the background.
+	// The rows nearest the viewport are warmed first; a later call, or an
+	// edit, cancels what is left of the one before.
 	void PrefetchViewport(const Buffer &buf, int first_row, int row_count, std::uint64_t buf_version,
 	                      int warm_margin = 200) const;
 
 private:
-	std::unique_ptr<LanguageHighlighter> hl_;
-	// Simple cache by row index (mutable to allow caching in const GetLine)
-	mutable std::unordered_map<int, LineHighlight> cache_;
+	// Per-row slots indexed by row, in fixed-size chunks allocated on first
+	// use: lookup is O(1), invalidating from a row only touches the rows
+	// after it, and rows never visited cost one null pointer per chunk.
+	template<typename T>
+	class RowCache {
+	public:
+		static constexpr int kChunkRows = 256;
+
+
+		T *Find(int row)
+		{
+			if (row < 0)
+				return nullptr;
+			const auto c = static_cast<std::size_t>(row / kChunkRows);
+			if (c >= chunks_.size() || !chunks_[c])
+				return nullptr;
+			return &(*chunks_[c])[row % kChunkRows];
+		}
+
+
+		T &At(int row)
+		{
+			const auto c = static_cast<std::size_t>(row / kChunkRows);
+			if (c >= chunks_.size())
+				chunks_.resize(c + 1);
+			if (!chunks_[c])
+				chunks_[c] = std::make_unique<Chunk>();
+			return (*chunks_[c])[row % kChunkRows];
+		}
+
+
+		// Reset the slots of row and every row after it
+		void TruncateFrom(int row)
+		{
+			const auto c = static_cast<std::size_t>(std::max(0, row) / kChunkRows);
+			if (c >= chunks_.size())
+				return;
+			if (chunks_[c]) {
+				for (int i = std::max(0, row) % kChunkRows; i < kChunkRows; ++i)
+					(*chunks_[c])[i] = T{};
+			}
+			chunks_.resize(c + 1);
+		}
+
+
+		// Move the slots of row and every row after it by delta rows, onto
+		// slots the caller has reset; the slots left behind are reset
+		void Shift(int row, int delta)
+		{
+			const int end = static_cast<int>(chunks_.size()) * kChunkRows;
+			row           = std::max(row, 0);
+			if (delta == 0 || row >= end)
+				return;
+			auto move = [this, delta](int r) {
+				T *src = Find(r);
+				if (!src || !src->valid)
+					return;
+				At(r + delta) = std::move(*src);
+				*src          = T{};
+			};
+			if (delta > 0) {
+				for (int r = end - 1; r >= row; --r)
+					move(r);
+			} else {
+				for (int r = row; r < end; ++r)
+					move(r);
+			}
+		}
+
+
+		void Clear()
+		{
+			chunks_.clear();
+		}
+
+	private:
+		using Chunk = std::array<T, kChunkRows>;
+		std::vector<std::unique_ptr<Chunk> > chunks_;
+	};
 
-	// For stateful highlighters, remember per-line state (state after finishing that row)
-	struct StateEntry {
-		std::uint64_t version{0};
-		// Using the interface type; forward-declare via header
+	struct LineEntry {
+		bool valid{false};
+		std::uint64_t edit_seq{0}; // edit_seq_ when computed
+		LineHighlight line;
+	};
+
+	// A stateful highlighter's state at the start of row, which lies in
+	// [i * kCheckpointRows, (i + 1) * kCheckpointRows) for checkpoints_[i]:
+	// checkpoints are taken at the first row of each, and only move off it
+	// when an edit above shifts them
+	struct Checkpoint {
+		bool valid{false};
+		int row{0};
 		StatefulHighlighter::LineState state;
 	};
 
-	mutable std::unordered_map<int, StateEntry> state_cache_;
+	static constexpr int kCheckpointRows = 64;
+
+	// Cached line for row, or null; mtx_ must be held
+	const LineHighlight *find_line(int row) const;
+
+	// Highlight the rows of [first, last] not cached yet, copying last's line
+	// to out if given; called without mtx_ held. Nothing is stored once an
+	// invalidation has moved epoch_ past epoch.
+	void compute_rows(const Buffer &buf, int first, int last, std::uint64_t buf_version, std::uint64_t epoch,
+	                  LineHighlight *out) const;
+
+	// Index of the trusted checkpoint nearest before row; mtx_ must be held
+	std::size_t nearest_checkpoint(int row) const;
 
-	// Track best known contiguous state row for a given version to avoid O(n) scans
-	mutable std::unordered_map<std::uint64_t, int> state_last_contig_;
+	// The walk in compute_rows() reached row in state: record a checkpoint
+	// if row starts an empty slot, or compare with the stale one there and,
+	// if it holds the same state, trust it and those after it again. Returns
+	// whether the trusted checkpoints changed; mtx_ must be held.
+	bool checkpoint(int row, const StatefulHighlighter::LineState &state) const;
 
-	// Thread-safety for caches and background worker state
+	// First row whose cached lines may predate an unsettled edit above them
+	int settled_rows() const;
+
+	std::unique_ptr<LanguageHighlighter> hl_;
+	// Caches by row index (mutable to allow caching in const GetLine)
+	mutable RowCache<LineEntry> cache_;
+	// Checkpoints by row / kCheckpointRows. The first trusted_ are known good
+	// and nearest-state lookup is O(1); valid ones after them are stale, left
+	// below an edit and moved with their rows, and kept until highlighting
+	// down from the edit reaches one: if its state matches, the edit changed
+	// nothing further and it and those after it up to the next edit are
+	// trusted again.
+	mutable std::vector<Checkpoint> checkpoints_;
+	mutable std::size_t trusted_{0};
+	// Rows [first, second) edited since the stale checkpoints were taken, in
+	// order and disjoint; none of those lie inside one
+	mutable std::vector<std::pair<int, int> > dirty_;
+	// Bumped by every invalidation so a walk begun before it stores nothing
+	mutable std::uint64_t epoch_{0};
+	// Bumped by every Edited()
+	mutable std::uint64_t edit_seq_{0};
+
+	// Thread-safety for caches and background warming state
 	mutable std::mutex mtx_;
 
-	// Background warmer
-	struct WarmRequest {
-		const Buffer *buf{nullptr};
-		std::uint64_t version{0};
-		int start_row{0};
-		int end_row{0}; // inclusive
-		// Visible rows to skip touching in the background (inclusive range).
-		// These are computed synchronously by PrefetchViewport.
-		int skip_first{0};
-		int skip_last{-1};
-	};
+	// Background warming runs on WorkerPool::Shared() in pieces of
+	// kCheckpointRows rows. Pieces outlive the engine in the pool's queue:
+	// each enters through warm_gate_, which the destructor closes, waiting
+	// for those already running.
+	struct WarmGate;
+	struct WarmJob;
 
-	mutable std::condition_variable cv_;
-	mutable std::thread worker_;
-	mutable std::atomic<bool> worker_running_{false};
-	mutable bool has_request_{false};
-	mutable WarmRequest pending_{};
+	// Queue the piece [first, last] of job; a stateful highlighter walks
+	// rows in order, so its pieces are chained one after the other up to
+	// chain_last
+	void post_warm(const std::shared_ptr<WarmJob> &job, int first, int last, int chain_last, long priority) const;
 
-	void ensure_worker_started() const;
+	void warm(const std::shared_ptr<WarmJob> &job, int first, int last, int chain_last, long priority) const;
 
-	void worker_loop() const;
+	std::shared_ptr<WarmGate> warm_gate_;
+	// The latest PrefetchViewport()'s job, superseding those before it
+	mutable std::shared_ptr<WarmJob> warm_job_;
 };
-} // namespace kte
\ No newline at end of file
+} // namespace kte
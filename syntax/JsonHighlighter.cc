@@ -1,34 +1,22 @@
 #include "JsonHighlighter.h"
-#include "../Buffer.h"
-#include <cctype>
+#include "LexTables.h"
 
 namespace kte {
-static bool
-is_digit(char c)
-{
-	return c >= '0' && c <= '9';
-}
-
-
 void
-JSONHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const
+JSONHighlighter::HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const
 {
-	const auto &rows = buf.Rows();
-	if (row < 0 || static_cast<std::size_t>(row) >= rows.size())
-		return;
-	std::string s = static_cast<std::string>(rows[static_cast<std::size_t>(row)]);
-	int n         = static_cast<int>(s.size());
-	auto push     = [&](int a, int b, TokenKind k) {
+	int n     = static_cast<int>(line.size());
+	auto push = [&](int a, int b, TokenKind k) {
 		if (b > a)
 			out.push_back({a, b, k});
 	};
 
 	int i = 0;
 	while (i < n) {
-		char c = s[i];
+		char c = line[i];
 		if (c == ' ' || c == '\t') {
 			int j = i + 1;
-			while (j < n && (s[j] == ' ' || s[j] == '\t'))
+			while (j < n && (line[j] == ' ' || line[j] == '\t'))
 				++j;
 			push(i, j, TokenKind::Whitespace);
 			i = j;
@@ -38,7 +26,7 @@ JSONHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<Highlight
 			int j    = i + 1;
 			bool esc = false;
 			while (j < n) {
-				char d = s[j++];
+				char d = line[j++];
 				if (esc) {
 					esc = false;
 					continue;
@@ -54,21 +42,21 @@ JSONHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<Highlight
 			i = j;
 			continue;
 		}
-		if (is_digit(c) || (c == '-' && i + 1 < n && is_digit(s[i + 1]))) {
+		if (is_digit(c) || (c == '-' && i + 1 < n && is_digit(line[i + 1]))) {
 			int j = i + 1;
-			while (j < n && (std::isdigit(static_cast<unsigned char>(s[j])) || s[j] == '.' || s[j] == 'e' ||
-			                 s[j] == 'E' || s[j] == '+' || s[j] == '-' || s[j] == '_'))
+			while (j < n && (is_digit(line[j]) || line[j] == '.' || line[j] == 'e' ||
+			                 line[j] == 'E' || line[j] == '+' || line[j] == '-' || line[j] == '_'))
 				++j;
 			push(i, j, TokenKind::Number);
 			i = j;
 			continue;
 		}
 		// booleans/null
-		if (std::isalpha(static_cast<unsigned char>(c))) {
+		if (is_alpha(c)) {
 			int j = i + 1;
-			while (j < n && std::isalpha(static_cast<unsigned char>(s[j])))
+			while (j < n && is_alpha(line[j]))
 				++j;
-			std::string id = s.substr(i, j - i);
+			std::string_view id = line.substr(i, j - i);
 			if (id == "true" || id == "false" || id == "null")
 				push(i, j, TokenKind::Constant);
 			else
@@ -7,6 +7,6 @@
 namespace kte {
 class JSONHighlighter final : public LanguageHighlighter {
 public:
-	void HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const override;
+	void HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const override;
 };
 } // namespace kte
\ No newline at end of file
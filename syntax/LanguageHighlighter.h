@@ -4,18 +4,19 @@
 #include <memory>
 #include <vector>
 #include <string>
+#include <string_view>
 
 #include "../Highlight.h"
 
-class Buffer;
-
 namespace kte {
 class LanguageHighlighter {
 public:
 	virtual ~LanguageHighlighter() = default;
 
-	// Produce highlight spans for a given buffer row. Implementations should append to out.
-	virtual void HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const = 0;
+	// Produce highlight spans for one line, given its bytes without the trailing newline.
+	// The engine hands the line over in place from the buffer's piece table, so
+	// line is only valid for the call. Implementations should append to out.
+	virtual void HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const = 0;
 
 
 	virtual bool Stateful() const
@@ -33,12 +34,13 @@ public:
 		bool in_raw_string{false};
 		// For raw strings, remember the delimiter between the opening R"delim( and closing )delim"
 		std::string raw_delim;
+
+		bool operator==(const LineState &) const = default;
 	};
 
 	// Highlight one line given the previous line state; return the resulting state after this line.
 	// Implementations should append spans for this line to out and compute the next state.
-	virtual LineState HighlightLineStateful(const Buffer &buf,
-	                                        int row,
+	virtual LineState HighlightLineStateful(std::string_view line,
 	                                        const LineState &prev,
 	                                        std::vector<HighlightSpan> &out) const = 0;
 
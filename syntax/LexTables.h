@@ -0,0 +1,270 @@
+// LexTables.h - character-class and keyword tables built at compile time for the highlighters
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+#include "../Highlight.h"
+
+namespace kte {
+// Classes a byte can belong to, as bits of a CharClasses entry
+enum CharClass : std::uint8_t {
+	kAlpha      = 1u << 0,
+	kDigit      = 1u << 1,
+	kPunct      = 1u << 2,
+	kSpace      = 1u << 3, // ' ' and '\t', the only blanks a line holds
+	kIdentStart = 1u << 4,
+	kIdentChar  = 1u << 5,
+	kAlnum      = kAlpha | kDigit,
+};
+
+
+// A class for each of the 256 byte values, so testing a byte is one load
+// and a mask rather than a <cctype> call. The letters, digits and
+// punctuation are ASCII's, matching <cctype> in the "C" locale kte runs in;
+// identifiers start with a letter or '_' and continue with those or a
+// digit. A language whose identifiers differ derives its own table with
+// With() and Without(), at compile time.
+class CharClasses {
+public:
+	constexpr CharClasses()
+	{
+		for (int c = 0; c < 256; ++c) {
+			std::uint8_t bits = 0;
+			if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+				bits |= kAlpha | kIdentStart | kIdentChar;
+			else if (c >= '0' && c <= '9')
+				bits |= kDigit | kIdentChar;
+			else if (c > ' ' && c < 0x7f)
+				bits |= kPunct;
+			else if (c == ' ' || c == '\t')
+				bits |= kSpace;
+			table_[static_cast<std::size_t>(c)] = bits;
+		}
+		table_['_'] |= kIdentStart | kIdentChar;
+	}
+
+
+	// This table with every byte of chars added to the classes in bits
+	[[nodiscard]] constexpr CharClasses With(std::uint8_t bits, std::string_view chars) const
+	{
+		CharClasses t = *this;
+		for (const char c: chars)
+			t.table_[static_cast<unsigned char>(c)] |= bits;
+		return t;
+	}
+
+
+	// This table with every byte of chars taken out of the classes in bits
+	[[nodiscard]] constexpr CharClasses Without(std::uint8_t bits, std::string_view chars) const
+	{
+		CharClasses t = *this;
+		for (const char c: chars)
+			t.table_[static_cast<unsigned char>(c)] &= static_cast<std::uint8_t>(~bits);
+		return t;
+	}
+
+
+	// Whether c is in any of the classes in bits
+	[[nodiscard]] constexpr bool Is(char c, std::uint8_t bits) const
+	{
+		return (table_[static_cast<unsigned char>(c)] & bits) != 0;
+	}
+
+private:
+	std::array<std::uint8_t, 256> table_{};
+};
+
+
+inline constexpr CharClasses kCharClasses{};
+
+
+constexpr bool
+is_alpha(char c)
+{
+	return kCharClasses.Is(c, kAlpha);
+}
+
+
+constexpr bool
+is_digit(char c)
+{
+	return kCharClasses.Is(c, kDigit);
+}
+
+
+constexpr bool
+is_alnum(char c)
+{
+	return kCharClasses.Is(c, kAlnum);
+}
+
+
+constexpr bool
+is_punct(char c)
+{
+	return kCharClasses.Is(c, kPunct);
+}
+
+
+constexpr char
+ascii_lower(char c)
+{
+	return c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+
+// Keywords and type names looked up by token, laid out at compile time in
+// an open-addressed table with a hash seed chosen so that the words land
+// in their home slots wherever possible: a lookup is usually a length
+// check, one hash and one compare. Built from one list of keywords and
+// optionally one of types, as
+//
+//	static constexpr std::string_view kKeywords[] = {"if", "else"};
+//	static constexpr KeywordTable kWords(kKeywords);
+//
+// With fold_case the table matches ASCII letters in either case, for the
+// case-insensitive languages. A word listed twice is kept once, as the
+// first kind it was listed with.
+template<std::size_t N>
+class KeywordTable {
+public:
+	template<std::size_t K>
+	constexpr explicit KeywordTable(const std::string_view (&keywords)[K], bool fold_case = false)
+		: fold_(fold_case)
+	{
+		for (const std::string_view w: keywords)
+			add(w, TokenKind::Keyword);
+		layout();
+	}
+
+
+	template<std::size_t K, std::size_t T>
+	constexpr KeywordTable(const std::string_view (&keywords)[K], const std::string_view (&types)[T],
+	                       bool fold_case = false)
+		: fold_(fold_case)
+	{
+		for (const std::string_view w: keywords)
+			add(w, TokenKind::Keyword);
+		for (const std::string_view w: types)
+			add(w, TokenKind::Type);
+		layout();
+	}
+
+
+	// The kind word was listed as, or otherwise when it is not in the table
+	[[nodiscard]] constexpr TokenKind Lookup(std::string_view word, TokenKind otherwise) const
+	{
+		if (word.size() >= 64 || !(lengths_ >> word.size() & 1u))
+			return otherwise;
+		for (std::size_t s = hash(word, seed_) & (kSlots - 1);; s = (s + 1) & (kSlots - 1)) {
+			const std::uint16_t e = slots_[s];
+			if (e == 0)
+				return otherwise;
+			if (same(words_[e - 1], word))
+				return kinds_[e - 1];
+		}
+	}
+
+
+	[[nodiscard]] constexpr bool Contains(std::string_view word) const
+	{
+		return Lookup(word, TokenKind::Default) != TokenKind::Default;
+	}
+
+private:
+	// At least four slots per word, so that a collision-free seed is quick
+	// to find
+	static constexpr std::size_t kSlots = std::bit_ceil(N < 4 ? std::size_t{16} : 4 * N);
+
+
+	constexpr void add(std::string_view w, TokenKind kind)
+	{
+		for (std::size_t i = 0; i < count_; ++i) {
+			if (same(words_[i], w))
+				return;
+		}
+		words_[count_] = w;
+		kinds_[count_] = kind;
+		++count_;
+		if (w.size() < 64)
+			lengths_ |= std::uint64_t{1} << w.size();
+	}
+
+
+	[[nodiscard]] constexpr bool same(std::string_view a, std::string_view b) const
+	{
+		if (a.size() != b.size())
+			return false;
+		if (!fold_)
+			return a == b;
+		for (std::size_t i = 0; i < a.size(); ++i) {
+			if (ascii_lower(a[i]) != ascii_lower(b[i]))
+				return false;
+		}
+		return true;
+	}
+
+
+	// FNV-1a from the seed, folding case when the table does
+	[[nodiscard]] constexpr std::size_t hash(std::string_view w, std::uint64_t seed) const
+	{
+		std::uint64_t h = 0xcbf29ce484222325ull ^ seed;
+		for (const char c: w) {
+			h ^= static_cast<unsigned char>(fold_ ? ascii_lower(c) : c);
+			h *= 0x100000001b3ull;
+		}
+		return static_cast<std::size_t>(h ^ (h >> 32));
+	}
+
+
+	// Try seeds until no word is displaced from its home slot, keeping the
+	// one with the fewest displaced words if none manages it
+	constexpr void layout()
+	{
+		std::size_t best = count_ + 1;
+		for (std::uint64_t seed = 0; seed < 256 && best > 0; ++seed) {
+			std::array<std::uint16_t, kSlots> slots{};
+			std::size_t displaced = 0;
+			for (std::size_t i = 0; i < count_; ++i) {
+				std::size_t s = hash(words_[i], seed) & (kSlots - 1);
+				if (slots[s] != 0)
+					++displaced;
+				while (slots[s] != 0)
+					s = (s + 1) & (kSlots - 1);
+				slots[s] = static_cast<std::uint16_t>(i + 1);
+			}
+			if (displaced < best) {
+				best   = displaced;
+				seed_  = seed;
+				slots_ = slots;
+			}
+		}
+	}
+
+
+	std::array<std::string_view, N> words_{};
+	std::array<TokenKind, N> kinds_{};
+	std::size_t count_      = 0;
+	bool fold_              = false;
+	std::uint64_t lengths_  = 0; // bit n set when some word has n bytes
+	std::uint64_t seed_     = 0;
+	std::array<std::uint16_t, kSlots> slots_{}; // index + 1 into words_, 0 when empty
+};
+
+
+template<std::size_t K>
+KeywordTable(const std::string_view (&)[K]) -> KeywordTable<K>;
+
+template<std::size_t K>
+KeywordTable(const std::string_view (&)[K], bool) -> KeywordTable<K>;
+
+template<std::size_t K, std::size_t T>
+KeywordTable(const std::string_view (&)[K], const std::string_view (&)[T]) -> KeywordTable<K + T>;
+
+template<std::size_t K, std::size_t T>
+KeywordTable(const std::string_view (&)[K], const std::string_view (&)[T], bool) -> KeywordTable<K + T>;
+} // namespace kte
@@ -1,6 +1,5 @@
 #include "LispHighlighter.h"
-#include "../Buffer.h"
-#include <cctype>
+#include "LexTables.h"
 
 namespace kte {
 static void
@@ -11,40 +10,36 @@ push(std::vector<HighlightSpan> &out, int a, int b, TokenKind k)
 }
 
 
-LispHighlighter::LispHighlighter()
-{
-	const char *kw[] = {
-		"defun", "lambda", "let", "let*", "define", "set!", "if", "cond", "begin", "quote", "quasiquote",
-		"unquote", "unquote-splicing", "loop", "do", "and", "or", "not"
-	};
-	for (auto s: kw)
-		kws_.insert(s);
-}
+static constexpr std::string_view kKeywords[] = {
+	"defun", "lambda", "let", "let*", "define", "set!", "if", "cond", "begin", "quote", "quasiquote",
+	"unquote", "unquote-splicing", "loop", "do", "and", "or", "not"
+};
+
+static constexpr KeywordTable kWords(kKeywords);
+
+// Symbols take in "*-+/" from the first byte and '!' after it
+static constexpr CharClasses kChars = kCharClasses.With(kIdentStart | kIdentChar, "*-+/").With(kIdentChar, "!");
 
 
 void
-LispHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const
+LispHighlighter::HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const
 {
-	const auto &rows = buf.Rows();
-	if (row < 0 || static_cast<std::size_t>(row) >= rows.size())
-		return;
-	std::string s = static_cast<std::string>(rows[static_cast<std::size_t>(row)]);
-	int n         = static_cast<int>(s.size());
-	int i         = 0;
-	int bol       = 0;
-	while (bol < n && (s[bol] == ' ' || s[bol] == '\t'))
+	int n   = static_cast<int>(line.size());
+	int i   = 0;
+	int bol = 0;
+	while (bol < n && (line[bol] == ' ' || line[bol] == '\t'))
 		++bol;
-	if (bol < n && s[bol] == ';') {
+	if (bol < n && line[bol] == ';') {
 		push(out, bol, n, TokenKind::Comment);
 		if (bol > 0)
 			push(out, 0, bol, TokenKind::Whitespace);
 		return;
 	}
 	while (i < n) {
-		char c = s[i];
+		char c = line[i];
 		if (c == ' ' || c == '\t') {
 			int j = i + 1;
-			while (j < n && (s[j] == ' ' || s[j] == '\t'))
+			while (j < n && (line[j] == ' ' || line[j] == '\t'))
 				++j;
 			push(out, i, j, TokenKind::Whitespace);
 			i = j;
@@ -58,7 +53,7 @@ LispHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<Highlight
 			int j    = i + 1;
 			bool esc = false;
 			while (j < n) {
-				char d = s[j++];
+				char d = line[j++];
 				if (esc) {
 					esc = false;
 					continue;
@@ -74,27 +69,23 @@ LispHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<Highlight
 			i = j;
 			continue;
 		}
-		if (std::isalpha(static_cast<unsigned char>(c)) || c == '*' || c == '-' || c == '+' || c == '/' || c ==
-		    '_') {
+		if (kChars.Is(c, kIdentStart)) {
 			int j = i + 1;
-			while (j < n && (std::isalnum(static_cast<unsigned char>(s[j])) || s[j] == '*' || s[j] == '-' ||
-			                 s[j] == '+' || s[j] == '/' || s[j] == '_' || s[j] == '!'))
+			while (j < n && kChars.Is(line[j], kIdentChar))
 				++j;
-			std::string id = s.substr(i, j - i);
-			TokenKind k    = kws_.count(id) ? TokenKind::Keyword : TokenKind::Identifier;
-			push(out, i, j, k);
+			push(out, i, j, kWords.Lookup(line.substr(i, j - i), TokenKind::Identifier));
 			i = j;
 			continue;
 		}
-		if (std::isdigit(static_cast<unsigned char>(c))) {
+		if (is_digit(c)) {
 			int j = i + 1;
-			while (j < n && (std::isdigit(static_cast<unsigned char>(s[j])) || s[j] == '.'))
+			while (j < n && (is_digit(line[j]) || line[j] == '.'))
 				++j;
 			push(out, i, j, TokenKind::Number);
 			i = j;
 			continue;
 		}
-		if (std::ispunct(static_cast<unsigned char>(c))) {
+		if (is_punct(c)) {
 			TokenKind k = TokenKind::Punctuation;
 			push(out, i, i + 1, k);
 			++i;
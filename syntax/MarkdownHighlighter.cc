@@ -1,5 +1,4 @@
 #include "MarkdownHighlighter.h"
-#include "../Buffer.h"
 #include <cctype>
 
 namespace kte {
@@ -12,29 +11,25 @@ push_span(std::vector<HighlightSpan> &out, int a, int b, TokenKind k)
 
 
 void
-MarkdownHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const
+MarkdownHighlighter::HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const
 {
 	LineState st; // not used in stateless entry
-	(void) HighlightLineStateful(buf, row, st, out);
+	(void) HighlightLineStateful(line, st, out);
 }
 
 
 StatefulHighlighter::LineState
-MarkdownHighlighter::HighlightLineStateful(const Buffer &buf, int row, const LineState &prev,
+MarkdownHighlighter::HighlightLineStateful(std::string_view line, const LineState &prev,
                                            std::vector<HighlightSpan> &out) const
 {
 	StatefulHighlighter::LineState state = prev;
-	const auto &rows                     = buf.Rows();
-	if (row < 0 || static_cast<std::size_t>(row) >= rows.size())
-		return state;
-	std::string s = static_cast<std::string>(rows[static_cast<std::size_t>(row)]);
-	int n         = static_cast<int>(s.size());
+	int n = static_cast<int>(line.size());
 
 	// Reuse in_block_comment flag as "in fenced code" state.
 	if (state.in_block_comment) {
 		// If line contains closing fence ``` then close after it
-		auto pos = s.find("```");
-		if (pos == std::string::npos) {
+		auto pos = line.find("```");
+		if (pos == std::string_view::npos) {
 			push_span(out, 0, n, TokenKind::String);
 			state.in_block_comment = true;
 			return state;
@@ -53,18 +48,18 @@ MarkdownHighlighter::HighlightLineStateful(const Buffer &buf, int row, const Lin
 
 	// Detect fenced code block start at beginning (allow leading spaces)
 	int bol = 0;
-	while (bol < n && (s[bol] == ' ' || s[bol] == '\t'))
+	while (bol < n && (line[bol] == ' ' || line[bol] == '\t'))
 		++bol;
-	if (bol + 3 <= n && s.compare(bol, 3, "```") == 0) {
+	if (bol + 3 <= n && line.compare(bol, 3, "```") == 0) {
 		push_span(out, bol, n, TokenKind::String);
 		state.in_block_comment = true; // enter fenced mode
 		return state;
 	}
 
 	// Headings: lines starting with 1-6 '#'
-	if (bol < n && s[bol] == '#') {
+	if (bol < n && line[bol] == '#') {
 		int j = bol;
-		while (j < n && s[j] == '#')
+		while (j < n && line[j] == '#')
 			++j; // hashes
 		// include following space and text as Keyword to stand out
 		push_span(out, bol, n, TokenKind::Keyword);
@@ -74,10 +69,10 @@ MarkdownHighlighter::HighlightLineStateful(const Buffer &buf, int row, const Lin
 	// Process inline: emphasis and code spans
 	int i = 0;
 	while (i < n) {
-		char c = s[i];
+		char c = line[i];
 		if (c == '`') {
 			int j = i + 1;
-			while (j < n && s[j] != '`')
+			while (j < n && line[j] != '`')
 				++j;
 			if (j < n)
 				++j;
@@ -89,7 +84,7 @@ MarkdownHighlighter::HighlightLineStateful(const Buffer &buf, int row, const Lin
 			// bold/italic markers: treat the marker and until next same marker as Type to highlight
 			char m = c;
 			int j  = i + 1;
-			while (j < n && s[j] != m)
+			while (j < n && line[j] != m)
 				++j;
 			if (j < n)
 				++j;
@@ -100,12 +95,12 @@ MarkdownHighlighter::HighlightLineStateful(const Buffer &buf, int row, const Lin
 		// links []() minimal: treat [text](url) as Function
 		if (c == '[') {
 			int j = i + 1;
-			while (j < n && s[j] != ']')
+			while (j < n && line[j] != ']')
 				++j;
 			if (j < n)
 				++j; // include ]
-			if (j < n && s[j] == '(') {
-				while (j < n && s[j] != ')')
+			if (j < n && line[j] == '(') {
+				while (j < n && line[j] != ')')
 					++j;
 				if (j < n)
 					++j;
@@ -117,7 +112,7 @@ MarkdownHighlighter::HighlightLineStateful(const Buffer &buf, int row, const Lin
 		// whitespace
 		if (c == ' ' || c == '\t') {
 			int j = i + 1;
-			while (j < n && (s[j] == ' ' || s[j] == '\t'))
+			while (j < n && (line[j] == ' ' || line[j] == '\t'))
 				++j;
 			push_span(out, i, j, TokenKind::Whitespace);
 			i = j;
@@ -6,9 +6,9 @@
 namespace kte {
 class MarkdownHighlighter final : public StatefulHighlighter {
 public:
-	void HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const override;
+	void HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const override;
 
-	LineState HighlightLineStateful(const Buffer &buf, int row, const LineState &prev,
+	LineState HighlightLineStateful(std::string_view line, const LineState &prev,
 	                                std::vector<HighlightSpan> &out) const override;
 };
 } // namespace kte
\ No newline at end of file
@@ -1,6 +1,5 @@
 #include "PythonHighlighter.h"
-#include "../Buffer.h"
-#include <cctype>
+#include "LexTables.h"
 
 namespace kte {
 static void
@@ -11,63 +10,42 @@ push(std::vector<HighlightSpan> &out, int a, int b, TokenKind k)
 }
 
 
-static bool
-is_ident_start(char c)
-{
-	return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
-}
-
+static constexpr std::string_view kKeywords[] = {
+	"and", "as", "assert", "break", "class", "continue", "def", "del", "elif", "else", "except", "False",
+	"finally", "for", "from", "global", "if", "import", "in", "is", "lambda", "None", "nonlocal", "not",
+	"or", "pass", "raise", "return", "True", "try", "while", "with", "yield"
+};
 
-static bool
-is_ident_char(char c)
-{
-	return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
-}
-
-
-PythonHighlighter::PythonHighlighter()
-{
-	const char *kw[] = {
-		"and", "as", "assert", "break", "class", "continue", "def", "del", "elif", "else", "except", "False",
-		"finally", "for", "from", "global", "if", "import", "in", "is", "lambda", "None", "nonlocal", "not",
-		"or", "pass", "raise", "return", "True", "try", "while", "with", "yield"
-	};
-	for (auto s: kw)
-		kws_.insert(s);
-}
+static constexpr KeywordTable kWords(kKeywords);
 
 
 void
-PythonHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const
+PythonHighlighter::HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const
 {
 	LineState st;
-	(void) HighlightLineStateful(buf, row, st, out);
+	(void) HighlightLineStateful(line, st, out);
 }
 
 
 StatefulHighlighter::LineState
-PythonHighlighter::HighlightLineStateful(const Buffer &buf, int row, const LineState &prev,
+PythonHighlighter::HighlightLineStateful(std::string_view line, const LineState &prev,
                                          std::vector<HighlightSpan> &out) const
 {
 	StatefulHighlighter::LineState state = prev;
-	const auto &rows                     = buf.Rows();
-	if (row < 0 || static_cast<std::size_t>(row) >= rows.size())
-		return state;
-	std::string s = static_cast<std::string>(rows[static_cast<std::size_t>(row)]);
-	int n         = static_cast<int>(s.size());
+	int n = static_cast<int>(line.size());
 
 	// Triple-quoted string continuation uses in_raw_string with raw_delim either "'''" or "\"\"\""
 	if (state.in_raw_string && (state.raw_delim == "'''" || state.raw_delim == "\"\"\"")) {
-		auto pos = s.find(state.raw_delim);
-		if (pos == std::string::npos) {
+		auto pos = line.find(state.raw_delim);
+		if (pos == std::string_view::npos) {
 			push(out, 0, n, TokenKind::String);
 			return state; // still inside
 		} else {
 			int end = static_cast<int>(pos + static_cast<int>(state.raw_delim.size()));
 			push(out, 0, end, TokenKind::String);
 			// remainder processed normally
-			s                   = s.substr(end);
-			n                   = static_cast<int>(s.size());
+			line                = line.substr(end);
+			n                   = static_cast<int>(line.size());
 			state.in_raw_string = false;
 			state.raw_delim.clear();
 			// Continue parsing remainder as a separate small loop
@@ -83,10 +61,10 @@ PythonHighlighter::HighlightLineStateful(const Buffer &buf, int row, const LineS
 	int i = 0;
 	// Detect comment start '#', ignoring inside strings
 	while (i < n) {
-		char c = s[i];
+		char c = line[i];
 		if (c == ' ' || c == '\t') {
 			int j = i + 1;
-			while (j < n && (s[j] == ' ' || s[j] == '\t'))
+			while (j < n && (line[j] == ' ' || line[j] == '\t'))
 				++j;
 			push(out, i, j, TokenKind::Whitespace);
 			i = j;
@@ -100,11 +78,11 @@ PythonHighlighter::HighlightLineStateful(const Buffer &buf, int row, const LineS
 		if (c == '"' || c == '\'') {
 			char q = c;
 			// triple?
-			if (i + 2 < n && s[i + 1] == q && s[i + 2] == q) {
+			if (i + 2 < n && line[i + 1] == q && line[i + 2] == q) {
 				std::string delim(3, q);
 				int j    = i + 3; // search for closing triple
-				auto pos = s.find(delim, static_cast<std::size_t>(j));
-				if (pos == std::string::npos) {
+				auto pos = line.find(delim, static_cast<std::size_t>(j));
+				if (pos == std::string_view::npos) {
 					push(out, i, n, TokenKind::String);
 					state.in_raw_string = true;
 					state.raw_delim     = delim;
@@ -119,7 +97,7 @@ PythonHighlighter::HighlightLineStateful(const Buffer &buf, int row, const LineS
 				int j    = i + 1;
 				bool esc = false;
 				while (j < n) {
-					char d = s[j++];
+					char d = line[j++];
 					if (esc) {
 						esc = false;
 						continue;
@@ -136,27 +114,23 @@ PythonHighlighter::HighlightLineStateful(const Buffer &buf, int row, const LineS
 				continue;
 			}
 		}
-		if (std::isdigit(static_cast<unsigned char>(c))) {
+		if (is_digit(c)) {
 			int j = i + 1;
-			while (j < n && (std::isalnum(static_cast<unsigned char>(s[j])) || s[j] == '.' || s[j] == '_'))
+			while (j < n && (is_alnum(line[j]) || line[j] == '.' || line[j] == '_'))
 				++j;
 			push(out, i, j, TokenKind::Number);
 			i = j;
 			continue;
 		}
-		if (is_ident_start(c)) {
+		if (kCharClasses.Is(c, kIdentStart)) {
 			int j = i + 1;
-			while (j < n && is_ident_char(s[j]))
+			while (j < n && kCharClasses.Is(line[j], kIdentChar))
 				++j;
-			std::string id = s.substr(i, j - i);
-			TokenKind k    = TokenKind::Identifier;
-			if (kws_.count(id))
-				k = TokenKind::Keyword;
-			push(out, i, j, k);
+			push(out, i, j, kWords.Lookup(line.substr(i, j - i), TokenKind::Identifier));
 			i = j;
 			continue;
 		}
-		if (std::ispunct(static_cast<unsigned char>(c))) {
+		if (is_punct(c)) {
 			TokenKind k = TokenKind::Operator;
 			if (c == ':' || c == ',' || c == '(' || c == ')' || c == '[' || c == ']')
 				k = TokenKind::Punctuation;
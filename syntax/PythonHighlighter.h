@@ -2,19 +2,13 @@
 #pragma once
 
 #include "LanguageHighlighter.h"
-#include <unordered_set>
 
 namespace kte {
 class PythonHighlighter final : public StatefulHighlighter {
 public:
-	PythonHighlighter();
+	void HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const override;
 
-	void HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const override;
-
-	LineState HighlightLineStateful(const Buffer &buf, int row, const LineState &prev,
+	LineState HighlightLineStateful(std::string_view line, const LineState &prev,
 	                                std::vector<HighlightSpan> &out) const override;
-
-private:
-	std::unordered_set<std::string> kws_;
 };
 } // namespace kte
\ No newline at end of file
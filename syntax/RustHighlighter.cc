@@ -1,6 +1,5 @@
 #include "RustHighlighter.h"
-#include "../Buffer.h"
-#include <cctype>
+#include "LexTables.h"
 
 namespace kte {
 static void
@@ -11,67 +10,45 @@ push(std::vector<HighlightSpan> &out, int a, int b, TokenKind k)
 }
 
 
-static bool
-is_ident_start(char c)
-{
-	return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
-}
-
-
-static bool
-is_ident_char(char c)
-{
-	return std::isalnum(static_cast<unsigned char>(c)) || c == '_';
-}
+static constexpr std::string_view kKeywords[] = {
+	"as", "break", "const", "continue", "crate", "else", "enum", "extern", "false", "fn", "for", "if",
+	"impl", "in", "let", "loop", "match", "mod", "move", "mut", "pub", "ref", "return", "self", "Self",
+	"static", "struct", "super", "trait", "true", "type", "unsafe", "use", "where", "while", "dyn", "async",
+	"await", "try"
+};
 
+static constexpr std::string_view kTypes[] = {
+	"u8", "u16", "u32", "u64", "u128", "usize", "i8", "i16", "i32", "i64", "i128", "isize", "f32", "f64",
+	"bool", "char", "str"
+};
 
-RustHighlighter::RustHighlighter()
-{
-	const char *kw[] = {
-		"as", "break", "const", "continue", "crate", "else", "enum", "extern", "false", "fn", "for", "if",
-		"impl", "in", "let", "loop", "match", "mod", "move", "mut", "pub", "ref", "return", "self", "Self",
-		"static", "struct", "super", "trait", "true", "type", "unsafe", "use", "where", "while", "dyn", "async",
-		"await", "try"
-	};
-	for (auto s: kw)
-		kws_.insert(s);
-	const char *tp[] = {
-		"u8", "u16", "u32", "u64", "u128", "usize", "i8", "i16", "i32", "i64", "i128", "isize", "f32", "f64",
-		"bool", "char", "str"
-	};
-	for (auto s: tp)
-		types_.insert(s);
-}
+static constexpr KeywordTable kWords(kKeywords, kTypes);
 
 
 void
-RustHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const
+RustHighlighter::HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const
 {
-	const auto &rows = buf.Rows();
-	if (row < 0 || static_cast<std::size_t>(row) >= rows.size())
-		return;
-	std::string s = static_cast<std::string>(rows[static_cast<std::size_t>(row)]);
-	int n         = static_cast<int>(s.size());
-	int i         = 0;
+	int n = static_cast<int>(line.size());
+	int i = 0;
 	while (i < n) {
-		char c = s[i];
+		char c = line[i];
 		if (c == ' ' || c == '\t') {
 			int j = i + 1;
-			while (j < n && (s[j] == ' ' || s[j] == '\t'))
+			while (j < n && (line[j] == ' ' || line[j] == '\t'))
 				++j;
 			push(out, i, j, TokenKind::Whitespace);
 			i = j;
 			continue;
 		}
-		if (c == '/' && i + 1 < n && s[i + 1] == '/') {
+		if (c == '/' && i + 1 < n && line[i + 1] == '/') {
 			push(out, i, n, TokenKind::Comment);
 			break;
 		}
-		if (c == '/' && i + 1 < n && s[i + 1] == '*') {
+		if (c == '/' && i + 1 < n && line[i + 1] == '*') {
 			int j       = i + 2;
 			bool closed = false;
 			while (j + 1 <= n) {
-				if (j + 1 < n && s[j] == '*' && s[j + 1] == '/') {
+				if (j + 1 < n && line[j] == '*' && line[j + 1] == '/') {
 					j += 2;
 					closed = true;
 					break;
@@ -91,7 +68,7 @@ RustHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<Highlight
 			int j    = i + 1;
 			bool esc = false;
 			while (j < n) {
-				char d = s[j++];
+				char d = line[j++];
 				if (esc) {
 					esc = false;
 					continue;
@@ -107,29 +84,23 @@ RustHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<Highlight
 			i = j;
 			continue;
 		}
-		if (std::isdigit(static_cast<unsigned char>(c))) {
+		if (is_digit(c)) {
 			int j = i + 1;
-			while (j < n && (std::isalnum(static_cast<unsigned char>(s[j])) || s[j] == '.' || s[j] == '_'))
+			while (j < n && (is_alnum(line[j]) || line[j] == '.' || line[j] == '_'))
 				++j;
 			push(out, i, j, TokenKind::Number);
 			i = j;
 			continue;
 		}
-		if (is_ident_start(c)) {
+		if (kCharClasses.Is(c, kIdentStart)) {
 			int j = i + 1;
-			while (j < n && is_ident_char(s[j]))
+			while (j < n && kCharClasses.Is(line[j], kIdentChar))
 				++j;
-			std::string id = s.substr(i, j - i);
-			TokenKind k    = TokenKind::Identifier;
-			if (kws_.count(id))
-				k = TokenKind::Keyword;
-			else if (types_.count(id))
-				k = TokenKind::Type;
-			push(out, i, j, k);
+			push(out, i, j, kWords.Lookup(line.substr(i, j - i), TokenKind::Identifier));
 			i = j;
 			continue;
 		}
-		if (std::ispunct(static_cast<unsigned char>(c))) {
+		if (is_punct(c)) {
 			TokenKind k = TokenKind::Operator;
 			if (c == ';' || c == ',' || c == '(' || c == ')' || c == '{' || c == '}' || c == '[' || c ==
 			    ']')
@@ -1,6 +1,5 @@
 #include "ShellHighlighter.h"
-#include "../Buffer.h"
-#include <cctype>
+#include "LexTables.h"
 
 namespace kte {
 static void
@@ -11,30 +10,33 @@ push(std::vector<HighlightSpan> &out, int a, int b, TokenKind k)
 }
 
 
+static constexpr std::string_view kKeywords[] = {
+	"if", "then", "fi", "for", "in", "do", "done", "case", "esac", "while", "function", "elif", "else"
+};
+
+static constexpr KeywordTable kWords(kKeywords);
+
+
 void
-ShellHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const
+ShellHighlighter::HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const
 {
-	const auto &rows = buf.Rows();
-	if (row < 0 || static_cast<std::size_t>(row) >= rows.size())
-		return;
-	std::string s = static_cast<std::string>(rows[static_cast<std::size_t>(row)]);
-	int n         = static_cast<int>(s.size());
-	int i         = 0;
+	int n = static_cast<int>(line.size());
+	int i = 0;
 	// if first non-space is '#', whole line is comment
 	int bol = 0;
-	while (bol < n && (s[bol] == ' ' || s[bol] == '\t'))
+	while (bol < n && (line[bol] == ' ' || line[bol] == '\t'))
 		++bol;
-	if (bol < n && s[bol] == '#') {
+	if (bol < n && line[bol] == '#') {
 		push(out, bol, n, TokenKind::Comment);
 		if (bol > 0)
 			push(out, 0, bol, TokenKind::Whitespace);
 		return;
 	}
 	while (i < n) {
-		char c = s[i];
+		char c = line[i];
 		if (c == ' ' || c == '\t') {
 			int j = i + 1;
-			while (j < n && (s[j] == ' ' || s[j] == '\t'))
+			while (j < n && (line[j] == ' ' || line[j] == '\t'))
 				++j;
 			push(out, i, j, TokenKind::Whitespace);
 			i = j;
@@ -49,7 +51,7 @@ ShellHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<Highligh
 			int j    = i + 1;
 			bool esc = false;
 			while (j < n) {
-				char d = s[j++];
+				char d = line[j++];
 				if (q == '"') {
 					if (esc) {
 						esc = false;
@@ -71,26 +73,15 @@ ShellHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<Highligh
 			continue;
 		}
 		// simple keywords
-		if (std::isalpha(static_cast<unsigned char>(c))) {
+		if (is_alpha(c)) {
 			int j = i + 1;
-			while (j < n && (std::isalnum(static_cast<unsigned char>(s[j])) || s[j] == '_'))
+			while (j < n && kCharClasses.Is(line[j], kIdentChar))
 				++j;
-			std::string id           = s.substr(i, j - i);
-			static const char *kws[] = {
-				"if", "then", "fi", "for", "in", "do", "done", "case", "esac", "while", "function",
-				"elif", "else"
-			};
-			bool kw = false;
-			for (auto k: kws)
-				if (id == k) {
-					kw = true;
-					break;
-				}
-			push(out, i, j, kw ? TokenKind::Keyword : TokenKind::Identifier);
+			push(out, i, j, kWords.Lookup(line.substr(i, j - i), TokenKind::Identifier));
 			i = j;
 			continue;
 		}
-		if (std::ispunct(static_cast<unsigned char>(c))) {
+		if (is_punct(c)) {
 			TokenKind k = TokenKind::Operator;
 			if (c == '(' || c == ')' || c == '{' || c == '}' || c == ',' || c == ';')
 				k = TokenKind::Punctuation;
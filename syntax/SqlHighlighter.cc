@@ -1,6 +1,5 @@
 #include "SqlHighlighter.h"
-#include "../Buffer.h"
-#include <cctype>
+#include "LexTables.h"
 
 namespace kte {
 static void
@@ -11,70 +10,50 @@ push(std::vector<HighlightSpan> &out, int a, int b, TokenKind k)
 }
 
 
-static bool
-is_ident_start(char c)
-{
-	return std::isalpha(static_cast<unsigned char>(c)) || c == '_';
-}
+// Identifiers may carry a '$' after their first byte
+static constexpr CharClasses kChars = kCharClasses.With(kIdentChar, "$");
 
 
-static bool
-is_ident_char(char c)
-{
-	return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '$';
-}
-
+static constexpr std::string_view kKeywords[] = {
+	"select", "insert", "update", "delete", "from", "where", "group", "by", "order", "limit",
+	"offset", "values", "into", "create", "table", "index", "unique", "on", "as", "and", "or",
+	"not", "null", "is", "primary", "key", "constraint", "foreign", "references", "drop", "alter",
+	"add", "column", "rename", "to", "if", "exists", "join", "left", "right", "inner", "outer",
+	"cross", "using", "set", "distinct", "having", "union", "all", "case", "when", "then", "else",
+	"end", "pragma", "transaction", "begin", "commit", "rollback", "replace"
+};
 
-SqlHighlighter::SqlHighlighter()
-{
-	const char *kw[] = {
-		"select", "insert", "update", "delete", "from", "where", "group", "by", "order", "limit",
-		"offset", "values", "into", "create", "table", "index", "unique", "on", "as", "and", "or",
-		"not", "null", "is", "primary", "key", "constraint", "foreign", "references", "drop", "alter",
-		"add", "column", "rename", "to", "if", "exists", "join", "left", "right", "inner", "outer",
-		"cross", "using", "set", "distinct", "having", "union", "all", "case", "when", "then", "else",
-		"end", "pragma", "transaction", "begin", "commit", "rollback", "replace"
-	};
-	for (auto s: kw)
-		kws_.insert(s);
+static constexpr std::string_view kTypes[] = {"integer", "real", "text", "blob", "numeric", "boolean", "date", "datetime"};
 
-	const char *types[] = {"integer", "real", "text", "blob", "numeric", "boolean", "date", "datetime"};
-	for (auto s: types)
-		types_.insert(s);
-}
+static constexpr KeywordTable kWords(kKeywords, kTypes, true);
 
 
 void
-SqlHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const
+SqlHighlighter::HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const
 {
-	const auto &rows = buf.Rows();
-	if (row < 0 || static_cast<std::size_t>(row) >= rows.size())
-		return;
-	std::string s = static_cast<std::string>(rows[static_cast<std::size_t>(row)]);
-	int n         = static_cast<int>(s.size());
-	int i         = 0;
-
+	int n = static_cast<int>(line.size());
+	int i = 0;
 	while (i < n) {
-		char c = s[i];
+		char c = line[i];
 		if (c == ' ' || c == '\t') {
 			int j = i + 1;
-			while (j < n && (s[j] == ' ' || s[j] == '\t'))
+			while (j < n && (line[j] == ' ' || line[j] == '\t'))
 				++j;
 			push(out, i, j, TokenKind::Whitespace);
 			i = j;
 			continue;
 		}
 		// line comments: -- ...
-		if (c == '-' && i + 1 < n && s[i + 1] == '-') {
+		if (c == '-' && i + 1 < n && line[i + 1] == '-') {
 			push(out, i, n, TokenKind::Comment);
 			break;
 		}
 		// simple block comment on same line: /* ... */
-		if (c == '/' && i + 1 < n && s[i + 1] == '*') {
+		if (c == '/' && i + 1 < n && line[i + 1] == '*') {
 			int j       = i + 2;
 			bool closed = false;
 			while (j + 1 <= n) {
-				if (j + 1 < n && s[j] == '*' && s[j + 1] == '/') {
+				if (j + 1 < n && line[j] == '*' && line[j + 1] == '/') {
 					j += 2;
 					closed = true;
 					break;
@@ -96,10 +75,10 @@ SqlHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<HighlightS
 			int j    = i + 1;
 			bool esc = false;
 			while (j < n) {
-				char d = s[j++];
+				char d = line[j++];
 				if (d == q) {
 					// Handle doubled quote escaping for SQL single quotes
-					if (q == '\'' && j < n && s[j] == '\'') {
+					if (q == '\'' && j < n && line[j] == '\'') {
 						++j;
 						continue;
 					}
@@ -115,33 +94,23 @@ SqlHighlighter::HighlightLine(const Buffer &buf, int row, std::vector<HighlightS
 			i = j;
 			continue;
 		}
-		if (std::isdigit(static_cast<unsigned char>(c))) {
+		if (is_digit(c)) {
 			int j = i + 1;
-			while (j < n && (std::isalnum(static_cast<unsigned char>(s[j])) || s[j] == '.' || s[j] == '_'))
+			while (j < n && (is_alnum(line[j]) || line[j] == '.' || line[j] == '_'))
 				++j;
 			push(out, i, j, TokenKind::Number);
 			i = j;
 			continue;
 		}
-		if (is_ident_start(c)) {
+		if (kChars.Is(c, kIdentStart)) {
 			int j = i + 1;
-			while (j < n && is_ident_char(s[j]))
+			while (j < n && kChars.Is(line[j], kIdentChar))
 				++j;
-			std::string id = s.substr(i, j - i);
-			std::string lower;
-			lower.reserve(id.size());
-			for (char ch: id)
-				lower.push_back(static_cast<char>(std::tolower(static_cast<unsigned char>(ch))));
-			TokenKind k = TokenKind::Identifier;
-			if (kws_.count(lower))
-				k = TokenKind::Keyword;
-			else if (types_.count(lower))
-				k = TokenKind::Type;
-			push(out, i, j, k);
+			push(out, i, j, kWords.Lookup(line.substr(i, j - i), TokenKind::Identifier));
 			i = j;
 			continue;
 		}
-		if (std::ispunct(static_cast<unsigned char>(c))) {
+		if (is_punct(c)) {
 			TokenKind k = TokenKind::Operator;
 			if (c == ',' || c == ';' || c == '(' || c == ')')
 				k = TokenKind::Punctuation;
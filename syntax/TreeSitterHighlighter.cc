@@ -33,7 +33,7 @@ TreeSitterHighlighter::disposeParser() const
 
 
 void
-TreeSitterHighlighter::HighlightLine(const Buffer &/*buf*/, int /*row*/, std::vector<HighlightSpan> &/*out*/) const
+TreeSitterHighlighter::HighlightLine(std::string_view /*line*/, std::vector<HighlightSpan> &/*out*/) const
 {
 	// For now, no-op. When tree-sitter is wired, map nodes to TokenKind spans per line.
 }
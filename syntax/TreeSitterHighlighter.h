@@ -16,6 +16,8 @@ struct TSParser;
 struct TSTree;
 }
 
+class Buffer;
+
 namespace kte {
 // A minimal adapter that uses Tree-sitter to parse the whole buffer and then, for now,
 // does very limited token classification. This acts as a scaffold for future richer
@@ -26,7 +28,7 @@ public:
 
 	~TreeSitterHighlighter() override;
 
-	void HighlightLine(const Buffer &buf, int row, std::vector<HighlightSpan> &out) const override;
+	void HighlightLine(std::string_view line, std::vector<HighlightSpan> &out) const override;
 
 private:
 	const TSLanguage *language_{nullptr};
@@ -0,0 +1,297 @@
+// Verify Buffer open/save round trips, including memory-mapped originals
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Buffer.h"
+#include "MappedFile.h"
+
+
+static std::string
+read_file(const std::string &path)
+{
+	std::ifstream in(path, std::ios::binary);
+	std::stringstream ss;
+	ss << in.rdbuf();
+	return ss.str();
+}
+
+
+static void
+write_file(const std::string &path, const std::string &data)
+{
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out << data;
+}
+
+
+static std::string
+make_lines(std::size_t n)
+{
+	std::string s;
+	for (std::size_t i = 0; i < n; ++i)
+		s += "line " + std::to_string(i) + " of a file big enough to be mapped\n";
+	return s;
+}
+
+
+static void
+test_mapped_round_trip()
+{
+	const std::string path = "/tmp/kte_test_buffer_io_mapped.txt";
+	std::string expect     = make_lines(20000);
+	assert(expect.size() >= kte::MappedFile::kMapThreshold);
+	write_file(path, expect);
+
+	Buffer buf;
+	std::string err;
+	assert(buf.OpenFromFile(path, err));
+	assert(buf.Nrows() == 20001);
+	assert(buf.GetLineString(7) == "line 7 of a file big enough to be mapped");
+
+	// Edits land in the add buffer; saving must not read back a truncated mapping
+	buf.insert_text(5, 0, "EDIT ");
+	expect.insert(expect.find("line 5 "), "EDIT ");
+	assert(buf.Save(err));
+	assert(read_file(path) == expect);
+
+	// The mapping now belongs to the replaced inode; later saves still see it intact
+	buf.delete_row(0);
+	expect.erase(0, expect.find('\n') + 1);
+	assert(buf.Save(err));
+	assert(read_file(path) == expect);
+}
+
+
+static void
+test_mapped_changed_on_disk()
+{
+	const std::string path = "/tmp/kte_test_buffer_io_changed.txt";
+	write_file(path, make_lines(20000));
+
+	Buffer buf;
+	std::string err;
+	assert(buf.OpenFromFile(path, err));
+	{
+		// Rewrite the mapped file in place behind the buffer's back
+		std::ofstream out(path, std::ios::binary | std::ios::app);
+		out << "appended elsewhere\n";
+	}
+	buf.insert_text(0, 0, "x");
+	assert(!buf.Save(err));
+	assert(err.find("changed on disk") != std::string::npos);
+}
+
+
+// Another process truncating the mapped file must not kill the editor: the
+// pages cut off read as zeros, and the buffer notices and keeps its edits
+static void
+test_mapped_truncated()
+{
+	const std::string path = "/tmp/kte_test_buffer_io_truncated.txt";
+	const std::string text = make_lines(20000);
+	write_file(path, text);
+
+	Buffer buf;
+	std::string err;
+	assert(buf.OpenFromFile(path, err));
+	buf.insert_text(1, 0, "kept ");
+	assert(!buf.CheckOnDisk());
+	assert(!buf.ChangedOnDisk());
+
+	// As `> file` or logrotate's copytruncate would
+	std::filesystem::resize_file(path, 4096);
+	std::size_t bytes = 0;
+	for (std::size_t r = 0; r < buf.Nrows(); ++r)
+		bytes += buf.GetLineString(r).size();
+	assert(bytes > 0);
+	assert(buf.GetLineString(1) == "kept line 1 of a file big enough to be mapped");
+	assert(buf.GetLineString(19999).find_first_not_of('\0') == std::string::npos);
+
+	buf.SetDirty(false);
+	assert(buf.CheckOnDisk());
+	assert(buf.ChangedOnDisk() && buf.Dirty());
+	assert(!buf.CheckOnDisk()); // reported once
+
+	// Saving over the truncated file is refused; saving elsewhere keeps the edit
+	assert(!buf.Save(err));
+	const std::string other = "/tmp/kte_test_buffer_io_truncated_copy.txt";
+	assert(buf.SaveAs(other, err));
+	assert(read_file(other).find("kept line 1 of") != std::string::npos);
+
+	// An in-place rewrite of the same size is noticed by its stamp
+	write_file(path, text);
+	Buffer again;
+	assert(again.OpenFromFile(path, err));
+	std::string same = text;
+	same[0]          = 'L';
+	{
+		std::fstream out(path, std::ios::binary | std::ios::in | std::ios::out);
+		out << same;
+	}
+	std::filesystem::last_write_time(path, std::filesystem::last_write_time(path) + std::chrono::seconds(1));
+	assert(again.CheckOnDisk() && again.ChangedOnDisk());
+}
+
+
+static void
+test_small_file()
+{
+	const std::string path = "/tmp/kte_test_buffer_io_small.txt";
+	write_file(path, "alpha\nbeta\n");
+
+	Buffer buf;
+	std::string err;
+	assert(buf.OpenFromFile(path, err));
+	assert(buf.Nrows() == 3);
+	buf.split_line(0, 2);
+	assert(buf.Save(err));
+	assert(read_file(path) == "al\npha\nbeta\n");
+
+	const std::string other = "/tmp/kte_test_buffer_io_small_copy.txt";
+	assert(buf.SaveAs(other, err));
+	assert(read_file(other) == "al\npha\nbeta\n");
+	assert(buf.Filename() == other);
+}
+
+
+static void
+test_save_replaces_atomically()
+{
+	namespace fs           = std::filesystem;
+	const std::string dir  = "/tmp/kte_test_buffer_io_atomic";
+	const std::string path = dir + "/file.txt";
+	const std::string link = dir + "/link.txt";
+	fs::remove_all(dir);
+	fs::create_directory(dir);
+	write_file(path, make_lines(100));
+	fs::permissions(path, fs::perms::owner_read | fs::perms::owner_write | fs::perms::group_read);
+	fs::create_symlink(path, link);
+
+	// Saving through a symlink replaces its target and keeps the link
+	Buffer buf;
+	std::string err;
+	assert(buf.OpenFromFile(link, err));
+	buf.insert_text(0, 0, "saved ");
+	assert(buf.Save(err));
+	assert(fs::is_symlink(link));
+	assert(read_file(path).rfind("saved line 0 ", 0) == 0);
+	assert(fs::status(path).permissions() == (fs::perms::owner_read | fs::perms::owner_write | fs::perms::group_read));
+
+	// No temporary files are left behind
+	std::size_t entries = 0;
+	for (const auto &e: fs::directory_iterator(dir)) {
+		(void) e;
+		++entries;
+	}
+	assert(entries == 2);
+	fs::remove_all(dir);
+}
+
+
+// Where replacing the file would lose something, the save keeps the inode:
+// other hard links see the new contents, and a file in a directory we cannot
+// write to is still saved. A replacement keeps the owner when we may set it.
+static void
+test_save_keeps_file()
+{
+	namespace fs          = std::filesystem;
+	const std::string dir = "/tmp/kte_test_buffer_io_keep";
+	fs::remove_all(dir);
+	fs::create_directory(dir);
+
+	// A mapped file with a second name is rewritten in place, and the
+	// buffer no longer reads it through the mapping
+	const std::string path = dir + "/file.txt";
+	const std::string link = dir + "/hardlink.txt";
+	std::string expect     = make_lines(20000);
+	write_file(path, expect);
+	fs::create_hard_link(path, link);
+	struct stat before{};
+	assert(::stat(path.c_str(), &before) == 0);
+
+	Buffer buf;
+	std::string err;
+	assert(buf.OpenFromFile(path, err));
+	buf.insert_text(3, 0, "linked ");
+	expect.insert(expect.find("line 3 "), "linked ");
+	buf.delete_row(0);
+	expect.erase(0, expect.find('\n') + 1);
+	assert(buf.Save(err));
+	assert(read_file(link) == expect);
+	struct stat after{};
+	assert(::stat(path.c_str(), &after) == 0);
+	assert(after.st_ino == before.st_ino && after.st_nlink == 2);
+	assert(buf.Content().GetRange(0, buf.Content().Size()) == expect);
+	assert(buf.GetLineString(0) == "line 1 of a file big enough to be mapped");
+	assert(!buf.CheckOnDisk());
+	buf.delete_row(0);
+	expect.erase(0, expect.find('\n') + 1);
+	assert(buf.Save(err));
+	assert(read_file(path) == expect);
+	assert(buf.Content().GetRange(0, buf.Content().Size()) == expect);
+
+	// Likewise when the rewrite runs in the background
+	std::string bg_expect = make_lines(20000);
+	write_file(path, bg_expect);
+	Buffer bg;
+	assert(bg.OpenFromFile(path, err));
+	bg.delete_row(0);
+	bg_expect.erase(0, bg_expect.find('\n') + 1);
+	assert(bg.StartSave(err));
+	assert(bg.GetLineString(5000) == "line 5001 of a file big enough to be mapped");
+	bg.WaitSave();
+	Buffer::SaveResult result;
+	assert(bg.PollSave(result) && result.ok);
+	assert(read_file(link) == bg_expect);
+	assert(bg.Content().GetRange(0, bg.Content().Size()) == bg_expect);
+	assert(!bg.CheckOnDisk());
+
+	// No temporary file can be made beside it
+	const std::string locked = dir + "/locked";
+	fs::create_directory(locked);
+	write_file(locked + "/file.txt", "alpha\n");
+	fs::permissions(locked, fs::perms::owner_read | fs::perms::owner_exec);
+	Buffer small;
+	assert(small.OpenFromFile(locked + "/file.txt", err));
+	small.insert_text(0, 0, "saved ");
+	assert(small.Save(err));
+	assert(read_file(locked + "/file.txt") == "saved alpha\n");
+	fs::permissions(locked, fs::perms::owner_all);
+
+	// Saving someone else's file as root leaves it theirs
+	if (::geteuid() == 0) {
+		const std::string theirs = dir + "/theirs.txt";
+		write_file(theirs, "beta\n");
+		assert(::chown(theirs.c_str(), 4321, 4321) == 0);
+		Buffer other;
+		assert(other.OpenFromFile(theirs, err));
+		other.insert_text(0, 0, "b");
+		assert(other.Save(err));
+		struct stat st{};
+		assert(::stat(theirs.c_str(), &st) == 0);
+		assert(st.st_uid == 4321 && st.st_gid == 4321);
+		assert(read_file(theirs) == "bbeta\n");
+	}
+	fs::remove_all(dir);
+}
+
+
+int
+main()
+{
+	test_mapped_round_trip();
+	test_mapped_changed_on_disk();
+	test_mapped_truncated();
+	test_small_file();
+	test_save_replaces_atomically();
+	test_save_keeps_file();
+	std::cout << "test_buffer_io: ok\n";
+	return 0;
+}
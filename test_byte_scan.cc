@@ -0,0 +1,125 @@
+// Verify every supported ByteScan kernel against a scalar reference, and
+// case folding against known pairs
+#include <cassert>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "ByteScan.h"
+
+
+static void
+check_kernel(kte::ScanKernel k, const std::string &text)
+{
+	const bool ok = kte::SetScanKernel(k);
+	assert(ok);
+	(void) ok;
+	// Exercise every alignment and tail length around the vector widths
+	for (std::size_t off = 0; off < 40 && off <= text.size(); ++off) {
+		const char *data      = text.data() + off;
+		const std::size_t len = text.size() - off;
+
+		std::vector<std::size_t> ref;
+		for (std::size_t i = 0; i < len; ++i)
+			if (data[i] == '\n')
+				ref.push_back(100 + i);
+
+		assert(kte::CountNewlines(data, len) == ref.size());
+		std::vector<std::size_t> got;
+		kte::FindNewlines(data, len, 100, got);
+		assert(got == ref);
+
+		for (char c: {'\n', 'q', '\0'}) {
+			const void *want = len ? std::memchr(data, c, len) : nullptr;
+			assert(kte::FindByte(data, len, c) == want);
+		}
+	}
+}
+
+
+// Reference for FindSubstringFolded, for valid UTF-8 needles
+static const char *
+ref_find_folded(const std::string &text, const std::string &needle)
+{
+	const std::size_t at = kte::FoldCase(text).find(kte::FoldCase(needle));
+	return at == std::string::npos ? nullptr : text.data() + at;
+}
+
+
+static void
+check_folded(kte::ScanKernel k)
+{
+	const bool ok = kte::SetScanKernel(k);
+	assert(ok);
+	(void) ok;
+	// Letters as {lower, upper}; the rest fold to themselves
+	static const char *const cases[][2] = {
+		{"a", "A"}, {"q", "Q"}, {"\xC3\xA9", "\xC3\x89"}, {"\xC5\x82", "\xC5\x81"}, {"\xD0\xB6", "\xD0\x96"},
+		{"\xD1\x91", "\xD0\x81"}, {"\xCF\x83", "\xCE\xA3"}, {"\xCF\x82", "\xCE\xA3"}, {" ", " "}, {"1", "1"},
+		{"\n", "\n"}
+	};
+	constexpr std::size_t ncases = sizeof(cases) / sizeof(cases[0]);
+	std::mt19937 rng(11);
+	for (int round = 0; round < 400; ++round) {
+		std::vector<std::size_t> letters(1 + rng() % 6);
+		for (auto &l: letters)
+			l = rng() % ncases;
+		std::string needle;
+		for (const std::size_t l: letters)
+			needle += cases[l][rng() % 2];
+		std::string text;
+		const std::size_t len = rng() % 240;
+		while (text.size() < len) {
+			if (rng() % 16 == 0) {
+				for (const std::size_t l: letters)
+					text += cases[l][rng() % 2];
+			} else {
+				text += cases[rng() % ncases][rng() % 2];
+			}
+		}
+
+		const kte::FoldedNeedle folded = kte::FoldNeedle(needle);
+		for (std::size_t off = 0; off < 40 && off <= text.size(); ++off) {
+			const std::string sub = text.substr(off);
+			const char *want      = ref_find_folded(sub, needle);
+			assert(kte::FindSubstringFolded(sub.data(), sub.size(), folded) == want);
+		}
+	}
+}
+
+
+int
+main()
+{
+	std::mt19937 rng(7);
+	std::uniform_int_distribution<int> ch_d(0, 15);
+	std::vector<std::string> inputs = {"", "\n", "abc", std::string(5000, '\n')};
+	for (std::size_t len: {15u, 16u, 31u, 32u, 33u, 64u, 255u * 32u + 7u, 100000u}) {
+		std::string s(len, 'a');
+		for (auto &c: s)
+			c = ch_d(rng) == 0 ? '\n' : static_cast<char>('a' + ch_d(rng));
+		inputs.push_back(s);
+	}
+
+	for (auto k: {kte::ScanKernel::Scalar, kte::ScanKernel::SSE2, kte::ScanKernel::AVX2}) {
+		if (!kte::ScanKernelSupported(k)) {
+			std::cout << "test_byte_scan: skipping " << kte::ScanKernelName(k) << "\n";
+			continue;
+		}
+		for (const auto &s: inputs)
+			check_kernel(k, s);
+		check_folded(k);
+	}
+
+	assert(kte::FoldCase("Hello, WORLD_42") == "hello, world_42");
+	assert(kte::FoldCase("\xC3\x80\xC3\x9C \xC3\x97\xC3\x9F \xC5\xB8") == "\xC3\xA0\xC3\xBC \xC3\x97\xC3\x9F \xC3\xBF");
+	assert(kte::FoldCase("\xC4\x80\xC5\x81\xC5\xBD \xC4\xB0") == "\xC4\x81\xC5\x82\xC5\xBE \xC4\xB0");
+	assert(kte::FoldCase("\xCE\x91\xCE\x86\xCE\x8F\xCF\x82") == "\xCE\xB1\xCE\xAC\xCF\x8E\xCF\x83");
+	assert(kte::FoldCase("\xD0\x9F\xD0\x81\xD1\xA2") == "\xD0\xBF\xD1\x91\xD1\xA3");
+	assert(kte::FoldCase("\xC3") == "\xC3"); // a truncated sequence is left as is
+	std::cout << "test_byte_scan: ok\n";
+	return 0;
+}
@@ -0,0 +1,225 @@
+// Verify editing commands change the document itself (not a row cache)
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <string>
+
+#include "Buffer.h"
+#include "Command.h"
+#include "Editor.h"
+#include "TestFrontend.h"
+
+
+static std::string
+contents(const Buffer &buf)
+{
+	const PieceTable &pt = buf.Content();
+	return pt.GetRange(0, pt.Size());
+}
+
+
+static Buffer &
+open_with(Editor &ed, const std::string &text)
+{
+	const std::string path = "/tmp/kte_test_command_edit.txt";
+	{
+		std::ofstream out(path, std::ios::binary | std::ios::trunc);
+		out << text;
+	}
+	std::string err;
+	const bool ok = ed.OpenFile(path, err);
+	assert(ok);
+	(void) ok;
+	return *ed.CurrentBuffer();
+}
+
+
+static void
+test_typing()
+{
+	Editor ed;
+	ed.SetDimensions(24, 80);
+	Buffer &buf = open_with(ed, "alpha\nbeta");
+
+	buf.SetCursor(5, 0);
+	Execute(ed, CommandId::InsertText, "!");
+	Execute(ed, CommandId::Newline);
+	Execute(ed, CommandId::InsertText, "new");
+	assert(contents(buf) == "alpha!\nnew\nbeta");
+	assert(buf.Cury() == 1 && buf.Curx() == 3);
+
+	for (int i = 0; i < 4; ++i)
+		Execute(ed, CommandId::Backspace);
+	assert(contents(buf) == "alpha!\nbeta");
+	assert(buf.Cury() == 0 && buf.Curx() == 6);
+
+	Execute(ed, CommandId::DeleteChar);
+	assert(contents(buf) == "alpha!beta");
+	assert(buf.Nrows() == 1);
+}
+
+
+static void
+test_kill_and_yank()
+{
+	Editor ed;
+	ed.SetDimensions(24, 80);
+	Buffer &buf = open_with(ed, "one two\nthree\nfour");
+
+	buf.SetCursor(3, 0);
+	Execute(ed, CommandId::KillToEOL);
+	assert(contents(buf) == "one\nthree\nfour");
+	assert(ed.KillRingHead() == " two");
+
+	// Killing the last line must drop the row, not leave an empty one behind
+	ed.SetKillChain(false);
+	buf.SetCursor(0, 2);
+	Execute(ed, CommandId::KillLine);
+	assert(contents(buf) == "one\nthree");
+	assert(ed.KillRingHead() == "four\n");
+
+	buf.SetCursor(0, 0);
+	Execute(ed, CommandId::Yank);
+	assert(contents(buf) == "four\none\nthree");
+
+	buf.SetCursor(4, 2);
+	Execute(ed, CommandId::DeleteWordPrev);
+	assert(buf.GetLineString(2) == "e");
+	assert(ed.KillRingHead() == "thre");
+}
+
+
+static void
+test_region_commands()
+{
+	Editor ed;
+	ed.SetDimensions(24, 80);
+	Buffer &buf = open_with(ed, "a\n  b\nc\n\nthe quick\nbrown   fox\n\nend\n");
+
+	buf.SetMark(0, 0);
+	buf.SetCursor(1, 2);
+	Execute(ed, CommandId::IndentRegion);
+	assert(buf.GetLineString(0) == "\ta" && buf.GetLineString(1) == "\t  b" && buf.GetLineString(2) == "\tc");
+
+	for (int i = 0; i < 2; ++i) {
+		buf.SetMark(0, 0);
+		buf.SetCursor(1, 2);
+		Execute(ed, CommandId::UnindentRegion);
+	}
+	assert(buf.GetLineString(0) == "a" && buf.GetLineString(1) == "b" && buf.GetLineString(2) == "c");
+
+	buf.SetCursor(0, 4);
+	Execute(ed, CommandId::ReflowParagraph);
+	assert(contents(buf) == "a\nb\nc\n\nthe quick brown fox\n\nend\n");
+}
+
+
+// Answer the two replace prompts
+static void
+replace_all(Editor &ed, const CommandId start, const std::string &find, const std::string &with)
+{
+	Execute(ed, start);
+	Execute(ed, CommandId::InsertText, find);
+	Execute(ed, CommandId::Newline);
+	Execute(ed, CommandId::InsertText, with);
+	Execute(ed, CommandId::Newline);
+}
+
+
+static void
+test_replace_all()
+{
+	Editor ed;
+	ed.SetDimensions(24, 80);
+	Buffer &buf = open_with(ed, "foo bar foo\nbarfoo\nfoofoo end\n");
+
+	replace_all(ed, CommandId::SearchReplace, "foo", "qux");
+	assert(contents(buf) == "qux bar qux\nbarqux\nquxqux end\n");
+	assert(ed.Status() == "Replaced 5 occurrences");
+
+	replace_all(ed, CommandId::RegexpReplace, "(q)ux", "$1");
+	assert(contents(buf) == "q bar q\nbarq\nqq end\n");
+	assert(ed.Status() == "Regex replaced 5 match(es) in 3 line(s)");
+
+	// Replacements may add and remove lines
+	replace_all(ed, CommandId::RegexpReplace, "^b", "\nB");
+	assert(contents(buf) == "q bar q\n\nBarq\nqq end\n");
+	replace_all(ed, CommandId::SearchReplace, "q", "");
+	assert(contents(buf) == " bar \n\nBar\n end\n");
+
+	// Find options: Esc c toggles case, Esc w in a find prompt whole words
+	buf.insert_text(0, 0, "barber ");
+	Execute(ed, CommandId::ToggleSearchCase);
+	assert(ed.Status() == "ignorecase: on");
+	Execute(ed, CommandId::SearchReplace);
+	Execute(ed, CommandId::InsertText, "bar");
+	Execute(ed, CommandId::CopyRegion);
+	assert(ed.FindOptions().whole_word && ed.Status().rfind("Find [iw]: bar", 0) == 0);
+	Execute(ed, CommandId::Newline);
+	Execute(ed, CommandId::InsertText, "X");
+	Execute(ed, CommandId::Newline);
+	assert(contents(buf) == "barber  X \n\nX\n end\n");
+	assert(ed.Status() == "Replaced 2 occurrences");
+	Execute(ed, CommandId::SetOption, "ignorecase=off");
+	Execute(ed, CommandId::SetOption, "wholeword=off");
+	assert(ed.FindOptions() == SearchOptions{});
+}
+
+
+static std::string
+file_contents(const std::string &path)
+{
+	std::ifstream in(path, std::ios::binary);
+	return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+
+// Saves run on a worker; the frontend step reports them and settles the dirty flag
+static void
+test_background_save()
+{
+	Editor ed;
+	TestFrontend fe;
+	fe.Init(ed);
+	bool running = true;
+	Buffer &buf  = open_with(ed, "one\ntwo\n");
+	const std::string path = buf.Filename();
+
+	buf.SetCursor(3, 0);
+	Execute(ed, CommandId::InsertText, "!");
+	assert(buf.Dirty());
+	fe.Input().QueueCommand(CommandId::Save);
+	fe.Step(ed, running);
+	buf.WaitSave();
+	fe.Step(ed, running);
+	assert(!buf.SaveInProgress());
+	assert(ed.Status() == "Saved " + path);
+	assert(!buf.Dirty());
+	assert(file_contents(path) == "one!\ntwo\n");
+
+	// An edit made while the save runs is not in the file and keeps the buffer dirty
+	Execute(ed, CommandId::Save);
+	assert(ed.Status() == "Saving " + path + "...");
+	Execute(ed, CommandId::InsertText, "?");
+	buf.WaitSave();
+	fe.Step(ed, running);
+	assert(buf.Dirty());
+	assert(ed.Status().find("modified since save started") != std::string::npos);
+	assert(file_contents(path) == "one!\ntwo\n");
+	assert(contents(buf) == "one!?\ntwo\n");
+}
+
+
+int
+main()
+{
+	InstallDefaultCommands();
+	test_typing();
+	test_kill_and_yank();
+	test_region_commands();
+	test_replace_all();
+	test_background_save();
+	std::cout << "test_command_edit: ok\n";
+	return 0;
+}
@@ -0,0 +1,204 @@
+// Verify project-wide search: hits, ordering, skipped files, open buffers
+// searched as edited, files truncated mid-search, and jumping to a hit
+// from +GREP+
+#include <cassert>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+
+#include "Buffer.h"
+#include "Command.h"
+#include "Editor.h"
+#include "Grep.h"
+#include "PieceTable.h"
+
+
+namespace fs = std::filesystem;
+
+
+static void
+write_file(const fs::path &path, const std::string &text)
+{
+	fs::create_directories(path.parent_path());
+	std::ofstream out(path, std::ios::binary | std::ios::trunc);
+	out << text;
+}
+
+
+static fs::path
+make_tree()
+{
+	const fs::path root = fs::temp_directory_path() / ("kte_test_grep_" + std::to_string(getpid()));
+	fs::remove_all(root);
+	write_file(root / "a.txt", "one needle\ntwo\nneedle needle three\n");
+	write_file(root / "sub" / "b.txt", "nothing here\r\nlast needle");
+	write_file(root / "sub" / "none.txt", "no match at all\n");
+	write_file(root / ".hidden" / "c.txt", "needle in a hidden dir\n");
+	write_file(root / "blob.bin", std::string("needle\0binary", 13));
+	return fs::weakly_canonical(root);
+}
+
+
+static std::string
+drain(kte::Grep &grep)
+{
+	grep.Wait();
+	std::string lines;
+	while (grep.Running())
+		grep.Poll(lines);
+	return lines;
+}
+
+
+static void
+test_files(const fs::path &root)
+{
+	for (const bool regex: {false, true}) {
+		kte::Grep grep;
+		std::string err;
+		const bool ok = grep.Start({}, root.string(), regex ? "ne+dle" : "needle", regex, err);
+		assert(ok && err.empty());
+		(void) ok;
+		const std::string lines = drain(grep);
+
+		// One hit per matching line, at its first match; hidden dirs and
+		// binary files are skipped
+		const auto &hits = grep.Hits();
+		assert(hits.size() == 3);
+		assert(grep.FilesSearched() == 3);
+		assert(grep.BinarySkipped() == 1);
+		assert(!grep.Truncated());
+		std::size_t a = 0, b = 0;
+		for (const kte::Grep::Hit &h: hits) {
+			if (h.path == (root / "a.txt").string()) {
+				assert((a == 0 && h.line == 0 && h.col == 4) || (a == 1 && h.line == 2 && h.col == 0));
+				++a;
+			} else {
+				assert(h.path == (root / "sub" / "b.txt").string());
+				assert(h.line == 1 && h.col == 5);
+				++b;
+			}
+		}
+		assert(a == 2 && b == 1);
+		assert(lines.find("a.txt:1:5: one needle\n") != std::string::npos);
+		assert(lines.find("a.txt:3:1: needle needle three\n") != std::string::npos);
+		assert(lines.find("sub/b.txt:2:6: last needle\n") != std::string::npos);
+		assert(lines.find("hidden") == std::string::npos);
+	}
+
+	kte::Grep grep;
+	std::string err;
+	assert(!grep.Start({}, root.string(), "(", true, err));
+	assert(!err.empty());
+}
+
+
+static void
+test_sources(const fs::path &root)
+{
+	// An open buffer is searched instead of its file, and comes first
+	auto text = std::make_shared<PieceTable>();
+	const std::string edited = "edited\nneedle moved\n";
+	text->Insert(0, edited.data(), edited.size());
+	auto scratch = std::make_shared<PieceTable>();
+	scratch->Insert(0, "needle", 6);
+
+	kte::Grep grep;
+	std::string err;
+	grep.Start({{(root / "a.txt").string(), text}, {"+scratch+", scratch}}, root.string(), "needle", false,
+	           err);
+	const std::string lines = drain(grep);
+	const auto &hits        = grep.Hits();
+	assert(hits.size() == 3);
+	assert(hits[0].path == (root / "a.txt").string() && hits[0].line == 1 && hits[0].col == 0);
+	assert(hits[1].path == "+scratch+" && hits[1].line == 0);
+	assert(hits[2].path == (root / "sub" / "b.txt").string());
+	assert(lines.rfind("a.txt:2:1: needle moved\n+scratch+:1:1: needle\n", 0) == 0);
+}
+
+
+static void
+test_truncated(const fs::path &root)
+{
+	// A mapped file cut short while the pool scans it: the search survives
+	// and either finishes the file, finds it already short, or drops it
+	const fs::path dir  = root.parent_path() / (root.filename().string() + "_cut");
+	const fs::path path = dir / "big.txt";
+	std::string text;
+	for (int i = 0; i < 400000; ++i)
+		text += "filler line " + std::to_string(i) + "\n";
+	text += "needle at the end\n";
+	for (const int delay_us: {0, 200, 1000, 3000, 10000, 30000}) {
+		write_file(path, text);
+		kte::Grep grep;
+		std::string err;
+		grep.Start({}, dir.string(), "nee+dle", true, err);
+		std::this_thread::sleep_for(std::chrono::microseconds(delay_us));
+		fs::resize_file(path, 4096);
+		drain(grep);
+		assert(grep.FilesSearched() + grep.BinarySkipped() + grep.ChangedSkipped() == 1);
+		if (grep.ChangedSkipped() == 1)
+			assert(grep.Hits().empty());
+		else if (grep.FilesSearched() == 1)
+			assert(grep.Hits().size() <= 1);
+	}
+	fs::remove_all(dir);
+}
+
+
+static void
+test_commands(const fs::path &root)
+{
+	const fs::path cwd = fs::current_path();
+	fs::current_path(root);
+	Editor ed;
+	ed.SetDimensions(24, 80);
+	std::string err;
+	const bool ok = ed.OpenFile((root / "a.txt").string(), err);
+	assert(ok);
+	(void) ok;
+
+	Execute(ed, CommandId::Grep, "needle");
+	ed.GrepSearch().Wait();
+	while (ed.GrepSearch().Running())
+		PollSearch(ed);
+	const std::size_t grep_index = ed.CurrentBufferIndex();
+	Buffer *results              = ed.CurrentBuffer();
+	assert(results->Filename() == "+GREP+" && results->IsReadOnly());
+	assert(results->Nrows() >= 4);
+	std::size_t row = 0;
+	while (row < results->Nrows() && results->GetLineString(row).rfind("sub/b.txt:2:6:", 0) != 0)
+		++row;
+	assert(row < results->Nrows());
+
+	// Enter on a hit opens its file at the match
+	results->SetCursor(0, row);
+	Execute(ed, CommandId::Newline);
+	const Buffer *dst = ed.CurrentBuffer();
+	assert(dst->Filename() == (root / "sub" / "b.txt").string());
+	assert(dst->Cury() == 1 && dst->Curx() == 5);
+
+	// The results buffer is left untouched
+	results = &ed.Buffers()[grep_index];
+	assert(results->Nrows() >= 4 && !results->Dirty());
+	fs::current_path(cwd);
+}
+
+
+int
+main()
+{
+	InstallDefaultCommands();
+	const fs::path root = make_tree();
+	test_files(root);
+	test_sources(root);
+	test_truncated(root);
+	test_commands(root);
+	fs::remove_all(root);
+	std::cout << "test_grep: ok\n";
+	return 0;
+}
@@ -0,0 +1,330 @@
+// Verify HighlighterEngine's cached highlights match highlighting the buffer
+// from the top, in any access order and across invalidation and edits
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "Buffer.h"
+#include "syntax/CppHighlighter.h"
+#include "syntax/HighlighterEngine.h"
+
+
+using Spans = std::vector<kte::HighlightSpan>;
+
+
+// CppHighlighter counting the lines it is asked to highlight
+class CountingHighlighter final : public kte::StatefulHighlighter {
+public:
+	explicit CountingHighlighter(std::atomic<int> &lines) : lines_(lines) {}
+
+
+	void HighlightLine(std::string_view line, Spans &out) const override
+	{
+		++lines_;
+		cpp_.HighlightLine(line, out);
+	}
+
+
+	LineState HighlightLineStateful(std::string_view line, const LineState &prev, Spans &out) const override
+	{
+		++lines_;
+		return cpp_.HighlightLineStateful(line, prev, out);
+	}
+
+private:
+	kte::CppHighlighter cpp_;
+	std::atomic<int> &lines_;
+};
+
+
+static bool
+same(const Spans &a, const Spans &b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		if (a[i].col_start != b[i].col_start || a[i].col_end != b[i].col_end || a[i].kind != b[i].kind)
+			return false;
+	}
+	return true;
+}
+
+
+// CppHighlighter's stateless form, counting lines likewise
+class CountingLineHighlighter final : public kte::LanguageHighlighter {
+public:
+	explicit CountingLineHighlighter(std::atomic<int> &lines) : lines_(lines) {}
+
+
+	void HighlightLine(std::string_view line, Spans &out) const override
+	{
+		++lines_;
+		cpp_.HighlightLine(line, out);
+	}
+
+private:
+	kte::CppHighlighter cpp_;
+	std::atomic<int> &lines_;
+};
+
+
+// Every row's spans, highlighted statefully from row 0
+static std::vector<Spans>
+reference(const Buffer &buf)
+{
+	const kte::CppHighlighter hl;
+	std::vector<Spans> rows(buf.Nrows());
+	kte::StatefulHighlighter::LineState state;
+	for (std::size_t r = 0; r < buf.Nrows(); ++r)
+		state = hl.HighlightLineStateful(buf.GetLineString(r), state, rows[r]);
+	return rows;
+}
+
+
+static Buffer
+make_source(const int lines)
+{
+	std::string text;
+	for (int i = 0; i < lines; ++i) {
+		if (i % 97 == 0)
+			text += "/* comment opened on " + std::to_string(i) + "\n";
+		else if (i % 97 == 3)
+			text += "   and closed */ int after = 1;\n";
+		else if (i % 301 == 7)
+			text += "auto s = R\"x(raw\n";
+		else if (i % 301 == 9)
+			text += "still raw)x\"; // done\n";
+		else
+			text += "static int v" + std::to_string(i) + " = f(\"s\", 0x" + std::to_string(i) + ");\n";
+	}
+	Buffer buf;
+	buf.insert_text(0, 0, text);
+	return buf;
+}
+
+
+static void
+check(const kte::HighlighterEngine &eng, const Buffer &buf, const std::vector<Spans> &ref, const int row)
+{
+	bool called = false;
+	eng.WithLine(buf, row, buf.Version(), [&](const Spans &spans) {
+		assert(same(spans, ref[static_cast<std::size_t>(row)]));
+		called = true;
+	});
+	assert(called);
+	const kte::LineHighlight lh = eng.GetLine(buf, row, buf.Version());
+	assert(lh.version == buf.Version());
+	assert(same(lh.spans, ref[static_cast<std::size_t>(row)]));
+}
+
+
+// Rows far apart and out of order: the stateful walk has to resume from
+// whatever earlier row was cached, across stretches never visited
+static void
+test_random_access()
+{
+	Buffer buf = make_source(5000);
+	const std::vector<Spans> ref = reference(buf);
+	kte::HighlighterEngine eng;
+	eng.SetHighlighter(std::make_unique<kte::CppHighlighter>());
+	check(eng, buf, ref, 4000);
+	check(eng, buf, ref, 10);
+	check(eng, buf, ref, 2500);
+	std::mt19937 rng(3);
+	for (int i = 0; i < 500; ++i)
+		check(eng, buf, ref, static_cast<int>(rng() % buf.Nrows()));
+}
+
+
+// After an edit, invalidating from the edited row is enough for rows below
+// it to pick up a comment opened there
+static void
+test_invalidate()
+{
+	Buffer buf = make_source(3000);
+	kte::HighlighterEngine eng;
+	eng.SetHighlighter(std::make_unique<kte::CppHighlighter>());
+	eng.PrefetchViewport(buf, 0, 3000, buf.Version(), 0);
+	check(eng, buf, reference(buf), 2999);
+
+	std::mt19937 rng(5);
+	for (int i = 0; i < 40; ++i) {
+		const int row = static_cast<int>(rng() % buf.Nrows());
+		buf.insert_text(row, 0, i % 2 ? "/* " : "*/ ");
+		eng.InvalidateFrom(row);
+		const std::vector<Spans> ref = reference(buf);
+		for (int r = row; r < static_cast<int>(buf.Nrows()); r += 37)
+			check(eng, buf, ref, r);
+		for (int k = 0; k < 20; ++k)
+			check(eng, buf, ref, static_cast<int>(rng() % buf.Nrows()));
+	}
+}
+
+
+// An in-place edit only costs the lines whose state it changed: after it,
+// reaching the last row rehighlights from the edit until the state matches
+// what was cached, then skips ahead
+static void
+test_early_stop()
+{
+	Buffer buf = make_source(20000);
+	std::atomic<int> lines{0};
+	kte::HighlighterEngine eng;
+	eng.SetHighlighter(std::make_unique<CountingHighlighter>(lines));
+	check(eng, buf, reference(buf), 19999);
+	assert(lines >= 20000);
+
+	// Row 150 is a plain statement; the edit leaves every state alone
+	buf.insert_text(150, 0, "x = 1; ");
+	eng.Edited(150, 1, 1);
+	lines = 0;
+	std::vector<Spans> ref = reference(buf);
+	check(eng, buf, ref, 19999);
+	assert(lines < 200);
+	check(eng, buf, ref, 150);
+	check(eng, buf, ref, 10);
+
+	// Opening a comment there changes rows down to the next "*/" only
+	buf.insert_text(150, 0, "/* ");
+	eng.Edited(150, 1, 1);
+	lines = 0;
+	ref   = reference(buf);
+	check(eng, buf, ref, 19999);
+	assert(lines < 300);
+	for (int r = 140; r < 400; ++r)
+		check(eng, buf, ref, r);
+
+	// Several edits before the next access, one of them after the row read
+	buf.insert_text(5000, 0, "*/ ");
+	eng.Edited(5000, 1, 1);
+	buf.insert_text(150, 0, "y; ");
+	eng.Edited(150, 1, 1);
+	ref = reference(buf);
+	check(eng, buf, ref, 3000);
+	check(eng, buf, ref, 19999);
+	check(eng, buf, ref, 5001);
+}
+
+
+// Random in-place edits between reads of cached rows: a row below an edit
+// is never served from before the edit unless its state is known unchanged
+static void
+test_random_edits()
+{
+	Buffer buf = make_source(4000);
+	kte::HighlighterEngine eng;
+	eng.SetHighlighter(std::make_unique<kte::CppHighlighter>());
+	eng.PrefetchViewport(buf, 0, 4000, buf.Version(), 0);
+
+	static const char *const kInserts[] = {"/* ", "*/ ", "R\"q(", ")q\" ", "v; "};
+	std::mt19937 rng(11);
+	for (int i = 0; i < 60; ++i) {
+		for (int k = static_cast<int>(rng() % 3); k >= 0; --k) {
+			const int row = static_cast<int>(rng() % buf.Nrows());
+			buf.insert_text(row, 0, kInserts[rng() % 5]);
+			eng.Edited(row, 1, 1);
+		}
+		const std::vector<Spans> ref = reference(buf);
+		for (int k = 0; k < 30; ++k)
+			check(eng, buf, ref, static_cast<int>(rng() % buf.Nrows()));
+	}
+}
+
+
+// Every kind of edit made through a buffer reaches its own engine, which
+// moves the rows below along and keeps them across the new version
+static void
+test_buffer_edits()
+{
+	Buffer buf = make_source(6000);
+	std::atomic<int> lines{0};
+	buf.EnsureHighlighter();
+	const kte::HighlighterEngine &eng = *buf.Highlighter();
+	buf.Highlighter()->SetHighlighter(std::make_unique<CountingHighlighter>(lines));
+	check(eng, buf, reference(buf), 5999);
+
+	// A new line near the top shifts every row below it by one
+	buf.split_line(20, 4);
+	buf.SetDirty(true);
+	lines = 0;
+	std::vector<Spans> ref = reference(buf);
+	check(eng, buf, ref, 6000);
+	assert(lines < 300);
+
+	std::mt19937 rng(17);
+	for (int i = 0; i < 200; ++i) {
+		const int row = static_cast<int>(rng() % buf.Nrows());
+		switch (rng() % 6) {
+		case 0:
+			buf.insert_text(row, 0, i % 2 ? "/* x\n y */ " : "a\nb\n");
+			break;
+		case 1:
+			buf.delete_text(row, 0, rng() % 200);
+			break;
+		case 2:
+			buf.split_line(row, static_cast<int>(rng() % 8));
+			break;
+		case 3:
+			buf.join_lines(row);
+			break;
+		case 4:
+			buf.insert_row(row, "*/ int z;");
+			break;
+		default:
+			buf.delete_row(row);
+			break;
+		}
+		buf.SetDirty(true);
+		ref = reference(buf);
+		for (int k = 0; k < 10; ++k)
+			check(eng, buf, ref, static_cast<int>(rng() % buf.Nrows()));
+	}
+}
+
+
+// The rows around a viewport are warmed on the shared worker pool, and an engine
+// can go away with its warming still queued or running
+static void
+test_background_warm()
+{
+	Buffer buf = make_source(3000);
+	std::atomic<int> lines{0};
+	{
+		kte::HighlighterEngine eng;
+		eng.SetHighlighter(std::make_unique<CountingLineHighlighter>(lines));
+		eng.PrefetchViewport(buf, 1000, 100, buf.Version(), 300);
+		// 100 visible rows now, then 300 on either side, each exactly once
+		for (int i = 0; i < 1000 && lines < 700; ++i)
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+		assert(lines == 700);
+		for (int r = 700; r < 1400; ++r)
+			eng.WithLine(buf, r, buf.Version(), [](const Spans &) {});
+		assert(lines == 700);
+	}
+
+	for (int i = 0; i < 40; ++i) {
+		kte::HighlighterEngine eng;
+		eng.SetHighlighter(std::make_unique<kte::CppHighlighter>());
+		eng.PrefetchViewport(buf, i * 50, 50, buf.Version(), 2000);
+	}
+}
+
+
+int
+main()
+{
+	test_random_access();
+	test_invalidate();
+	test_early_stop();
+	test_random_edits();
+	test_buffer_edits();
+	test_background_warm();
+	std::cout << "test_highlighter_engine: ok\n";
+	return 0;
+}
@@ -0,0 +1,111 @@
+// Verify the highlighters' compile-time character classes agree with
+// <cctype> and that KeywordTable finds exactly the words it was built from
+#include <cassert>
+#include <cctype>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "syntax/LexTables.h"
+
+
+using kte::KeywordTable;
+using kte::TokenKind;
+
+
+static void
+test_char_classes()
+{
+	for (int b = 0; b < 256; ++b) {
+		const char c = static_cast<char>(b);
+		assert(kte::is_alpha(c) == (std::isalpha(b) != 0));
+		assert(kte::is_digit(c) == (std::isdigit(b) != 0));
+		assert(kte::is_alnum(c) == (std::isalnum(b) != 0));
+		assert(kte::is_punct(c) == (std::ispunct(b) != 0));
+		assert(kte::ascii_lower(c) == static_cast<char>(std::tolower(b)));
+		assert(kte::kCharClasses.Is(c, kte::kSpace) == (c == ' ' || c == '\t'));
+		assert(kte::kCharClasses.Is(c, kte::kIdentStart) == (std::isalpha(b) || c == '_'));
+		assert(kte::kCharClasses.Is(c, kte::kIdentChar) == (std::isalnum(b) || c == '_'));
+	}
+
+	constexpr kte::CharClasses lisp = kte::kCharClasses.With(kte::kIdentStart | kte::kIdentChar, "*-")
+		.Without(kte::kIdentStart, "_");
+	static_assert(lisp.Is('*', kte::kIdentStart) && lisp.Is('-', kte::kIdentChar));
+	static_assert(!lisp.Is('_', kte::kIdentStart) && lisp.Is('_', kte::kIdentChar));
+	static_assert(!kte::kCharClasses.Is('*', kte::kIdentStart));
+}
+
+
+static constexpr std::string_view kKeywords[] = {
+	"if", "else", "for", "while", "return", "struct", "class", "if", "does>", "+loop", ".\"", "x"
+};
+
+static constexpr std::string_view kTypes[] = {"int", "char", "uint64_t", "else"};
+
+
+static void
+test_keywords()
+{
+	static constexpr KeywordTable words(kKeywords, kTypes);
+	static_assert(words.Lookup("while", TokenKind::Identifier) == TokenKind::Keyword);
+	static_assert(words.Lookup("uint64_t", TokenKind::Identifier) == TokenKind::Type);
+	static_assert(words.Lookup("whilst", TokenKind::Identifier) == TokenKind::Identifier);
+
+	for (const std::string_view w: kKeywords)
+		assert(words.Lookup(w, TokenKind::Identifier) == TokenKind::Keyword);
+	// Listed as a keyword first, so the later type entry is ignored
+	assert(words.Lookup("else", TokenKind::Identifier) == TokenKind::Keyword);
+	assert(words.Lookup("char", TokenKind::Default) == TokenKind::Type);
+	assert(words.Contains("+loop") && words.Contains(".\""));
+
+	// Near misses: prefixes, extensions, case and lengths no word has
+	static constexpr std::string_view kMisses[] = {
+		"", "i", "iff", "If", "IF", "els", "elses", "Int", "in", "uint64", "uint64_tt", "does", "does>>", "X",
+		"y", "classes", "returned"
+	};
+	for (const std::string_view w: kMisses)
+		assert(!words.Contains(w));
+	assert(!words.Contains(std::string(100, 'a')));
+	assert(!words.Contains(std::string_view("i\0", 2)));
+
+	// Every other string up to three letters long
+	std::string s;
+	for (char a = 'a'; a <= 'z'; ++a) {
+		for (char b = 'a' - 1; b <= 'z'; ++b) {
+			for (char c = 'a' - 1; c <= 'z'; ++c) {
+				s.assign(1, a);
+				if (b >= 'a')
+					s += b;
+				if (b >= 'a' && c >= 'a')
+					s += c;
+				const bool listed = s == "if" || s == "for" || s == "x" || s == "int";
+				assert(words.Contains(s) == listed);
+			}
+		}
+	}
+}
+
+
+static void
+test_fold_case()
+{
+	static constexpr std::string_view kSql[] = {"select", "from", "where", "does>"};
+	static constexpr KeywordTable sql(kSql, true);
+	static_assert(sql.Contains("SELECT") && sql.Contains("From") && sql.Contains("wHeRe"));
+	assert(sql.Contains("DOES>") && sql.Contains("does>"));
+	assert(!sql.Contains("selects") && !sql.Contains("DOES") && !sql.Contains("frm"));
+
+	static constexpr KeywordTable exact(kSql);
+	assert(exact.Contains("select") && !exact.Contains("SELECT"));
+}
+
+
+int
+main()
+{
+	test_char_classes();
+	test_keywords();
+	test_fold_case();
+	std::cout << "test_lex_tables: ok\n";
+	return 0;
+}
@@ -0,0 +1,187 @@
+// Verify MatchIndex stays equal to a fresh scan across query refinements and
+// random buffer edits
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Buffer.h"
+#include "MatchIndex.h"
+
+
+static bool
+same(const std::vector<SearchMatch> &a, const std::vector<SearchMatch> &b)
+{
+	if (a.size() != b.size())
+		return false;
+	for (std::size_t i = 0; i < a.size(); ++i) {
+		if (a[i].y != b[i].y || a[i].x != b[i].x || a[i].len != b[i].len)
+			return false;
+	}
+	return true;
+}
+
+
+// Update index for query from the start of buf and wait for the full count
+static bool
+update_all(MatchIndex &index, const Buffer &buf, const std::string &query, const bool regex)
+{
+	std::string err;
+	const bool ok = index.Update(buf, query, regex, 0, 0, err);
+	index.Wait();
+	index.Poll();
+	assert(index.Complete());
+	return ok;
+}
+
+
+// Compare buf's incrementally maintained matches with a fresh index
+static void
+check(Buffer &buf, const std::string &query, const bool regex, const SearchOptions &opts = {})
+{
+	buf.SearchMatches().SetOptions(opts);
+	const bool ok = update_all(buf.SearchMatches(), buf, query, regex);
+	assert(ok);
+	MatchIndex fresh;
+	fresh.SetOptions(opts);
+	update_all(fresh, buf, query, regex);
+	if (!same(buf.SearchMatches().Matches(), fresh.Matches())) {
+		std::cerr << "mismatch for '" << query << "': " << buf.SearchMatches().Matches().size() << " vs "
+			<< fresh.Matches().size() << "\n";
+		assert(false);
+	}
+	(void) ok;
+}
+
+
+static void
+insert_text(Buffer &buf, const std::string &text)
+{
+	buf.insert_text(0, 0, text);
+}
+
+
+static void
+test_refine_and_backspace()
+{
+	Buffer buf;
+	insert_text(buf, "aaab aab ab\nbaaaab abab\n\naab");
+	// "aa" overlaps itself, so "aab" cannot be narrowed from its matches
+	for (const char *q: {"a", "aa", "aab", "aa", "a", "ab", "aba", "abab", "ab", "b", ""})
+		check(buf, q, false);
+}
+
+
+static void
+test_random_edits(const bool regex)
+{
+	std::mt19937 rng(regex ? 7 : 3);
+	static const char *const pieces[] = {"ab", "a", "b", "\n", "abc\n", "x", "cab", "\nab\n"};
+	Buffer buf;
+	insert_text(buf, "abc ab\nxab\n\nab ab ab\nc");
+	const std::string query = regex ? "a+b|^c" : "ab";
+	for (int i = 0; i < 3000; ++i) {
+		if (i % 5 == 0)
+			check(buf, query, regex);
+		const std::size_t nrows = buf.Nrows();
+		const int row           = static_cast<int>(rng() % nrows);
+		const int col           = static_cast<int>(rng() % (buf.LineLength(static_cast<std::size_t>(row)) + 1));
+		switch (rng() % 6) {
+		case 0:
+		case 1:
+			buf.insert_text(row, col, pieces[rng() % 8]);
+			break;
+		case 2:
+			buf.delete_text(row, col, rng() % 8);
+			break;
+		case 3:
+			buf.split_line(row, col);
+			break;
+		case 4:
+			buf.join_lines(row);
+			break;
+		case 5:
+			if (rng() % 2)
+				buf.insert_row(row, pieces[rng() % 3]);
+			else if (nrows > 1)
+				buf.delete_row(row);
+			break;
+		}
+	}
+	check(buf, query, regex);
+}
+
+
+// Case-insensitive and whole-word queries, refined, after edits and with
+// the options changed under an active query
+static void
+test_options()
+{
+	Buffer buf;
+	insert_text(buf, "Foo foo FOOD food_ x.foo\n\xC3\x89t\xC3\xA9 \xC3\xA9T\xC3\x89\nfoofoo Foo\n");
+	const SearchOptions all[] = {{true, false}, {false, true}, {true, true}};
+	for (const SearchOptions &opts: all) {
+		for (const char *q: {"f", "fo", "foo", "food", "foo", "fo", "\xC3\xA9", "\xC3\xA9t", "\xC3\xA9"})
+			check(buf, q, false, opts);
+	}
+
+	MatchIndex &index = buf.SearchMatches();
+	const std::pair<SearchOptions, std::size_t> counts[] = {
+		{{false, false}, 5}, {{true, false}, 8}, {{false, true}, 2}, {{true, true}, 4}
+	};
+	for (const auto &[opts, n]: counts) {
+		index.SetOptions(opts);
+		update_all(index, buf, "foo", false);
+		assert(index.Matches().size() == n);
+	}
+	update_all(index, buf, "\xC3\xA9t\xC3\xA9", false);
+	assert(index.Matches().size() == 2);
+
+	buf.insert_text(2, 0, "FOO ");
+	buf.delete_text(0, 0, 4);
+	check(buf, "foo", false, {true, true});
+}
+
+
+// A buffer too large to scan on the spot: Update finds the first match
+// after the origin, and the total arrives from the background count
+static void
+test_background_count()
+{
+	std::string text;
+	for (int i = 0; i < 100000; ++i)
+		text += i % 1000 == 999 ? "a needle in line " + std::to_string(i) + "\n" : "just some hay here\n";
+	Buffer buf;
+	insert_text(buf, text);
+
+	MatchIndex &index = buf.SearchMatches();
+	std::string err;
+	index.Update(buf, "needle", false, 50000, 0, err);
+	assert(!index.Complete());
+	assert(!index.Matches().empty() && index.Matches().front().y == 50999);
+	index.Wait();
+	assert(index.Poll());
+	assert(index.Complete() && index.Matches().size() == 100);
+	assert(!index.Poll());
+
+	// An edit while counting drops the count; the next Update starts over
+	index.Update(buf, "hay", false, 0, 0, err);
+	buf.insert_text(0, 0, "hay ");
+	assert(index.Complete() && index.Matches().empty());
+	update_all(index, buf, "hay", false);
+	assert(index.Matches().size() == 99901);
+}
+
+
+int
+main()
+{
+	test_refine_and_backspace();
+	test_options();
+	test_background_count();
+	test_random_edits(false);
+	test_random_edits(true);
+	std::cout << "test_match_index: ok\n";
+	return 0;
+}
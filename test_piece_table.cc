@@ -0,0 +1,315 @@
+// Verify PieceTable against a std::string reference under random edit sequences
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "PieceTable.h"
+
+
+static std::size_t
+ref_line_count(const std::string &s)
+{
+	std::size_t n = 1;
+	for (char c: s)
+		if (c == '\n')
+			++n;
+	return n;
+}
+
+
+// Full rebuild of the line index from scratch, the way a rescan would produce it
+static std::vector<std::size_t>
+ref_line_starts(const std::string &s)
+{
+	std::vector<std::size_t> starts{0};
+	for (std::size_t i = 0; i < s.size(); ++i)
+		if (s[i] == '\n')
+			starts.push_back(i + 1);
+	return starts;
+}
+
+
+static void
+check_lines(const PieceTable &pt, const std::string &ref, std::mt19937 &rng)
+{
+	const auto starts = ref_line_starts(ref);
+	assert(pt.LineCount() == starts.size());
+	for (std::size_t i = 0; i < starts.size(); ++i) {
+		const std::size_t end = i + 1 < starts.size() ? starts[i + 1] : ref.size();
+		assert(pt.GetLineRange(i) == std::make_pair(starts[i], end));
+		std::string line = ref.substr(starts[i], end - starts[i]);
+		if (!line.empty() && line.back() == '\n')
+			line.pop_back();
+		assert(pt.GetLine(i) == line);
+		assert(pt.LineColToByteOffset(i, 0) == starts[i]);
+		assert(pt.LineColToByteOffset(i, std::numeric_limits<std::size_t>::max()) == starts[i] + line.size());
+	}
+	assert(pt.GetLineRange(starts.size()) == std::make_pair(std::size_t{0}, std::size_t{0}));
+	assert(pt.LineColToByteOffset(starts.size(), 0) == ref.size());
+
+	std::uniform_int_distribution<std::size_t> off_d(0, ref.size());
+	for (int i = 0; i < 50; ++i) {
+		const std::size_t off = off_d(rng);
+		auto it               = std::upper_bound(starts.begin(), starts.end(), off);
+		const auto row        = static_cast<std::size_t>(it - starts.begin()) - 1;
+		assert(pt.ByteOffsetToLineCol(off) == std::make_pair(row, off - starts[row]));
+	}
+}
+
+
+static void
+check_equal(const PieceTable &pt, const std::string &ref)
+{
+	assert(pt.Size() == ref.size());
+	const char *d = pt.Data();
+	assert(ref.empty() || std::string(d, pt.Size()) == ref);
+	assert(pt.LineCount() == ref_line_count(ref));
+}
+
+
+static void
+run_random_edits(unsigned seed, int ops, std::size_t piece_limit)
+{
+	std::mt19937 rng(seed);
+	PieceTable pt(0, piece_limit, 64, 4096);
+	std::string ref;
+	const std::string alphabet = "abcdef\n\n xyz";
+	std::uniform_int_distribution<int> op_d(0, 9);
+	std::uniform_int_distribution<int> len_d(1, 12);
+	std::uniform_int_distribution<int> ch_d(0, static_cast<int>(alphabet.size()) - 1);
+
+	for (int i = 0; i < ops; ++i) {
+		const int op = op_d(rng);
+		if (op < 6 || ref.empty()) {
+			std::string text(static_cast<std::size_t>(len_d(rng)), 'a');
+			for (auto &c: text)
+				c = alphabet[static_cast<std::size_t>(ch_d(rng))];
+			std::uniform_int_distribution<std::size_t> pos_d(0, ref.size());
+			const std::size_t pos = pos_d(rng);
+			pt.Insert(pos, text.data(), text.size());
+			ref.insert(pos, text);
+		} else {
+			std::uniform_int_distribution<std::size_t> pos_d(0, ref.size() - 1);
+			const std::size_t pos = pos_d(rng);
+			const auto len        = static_cast<std::size_t>(len_d(rng));
+			pt.Delete(pos, len);
+			ref.erase(pos, len);
+		}
+		if (i % 64 == 0) {
+			check_equal(pt, ref);
+			check_lines(pt, ref, rng);
+		}
+	}
+	check_equal(pt, ref);
+	check_lines(pt, ref, rng);
+
+	// Substring extraction and search agree with the reference
+	for (int i = 0; i < 200 && !ref.empty(); ++i) {
+		std::uniform_int_distribution<std::size_t> pos_d(0, ref.size() - 1);
+		const std::size_t pos = pos_d(rng);
+		const auto len        = static_cast<std::size_t>(len_d(rng));
+		assert(pt.GetRange(pos, len) == ref.substr(pos, len));
+	}
+	const std::size_t found = pt.Find("ab", 0);
+	const std::size_t rpos  = ref.find("ab");
+	assert(rpos == std::string::npos ? found == std::numeric_limits<std::size_t>::max() : found == rpos);
+
+	// Chunked reads and searches must see matches that straddle piece boundaries
+	for (int i = 0; i < 50 && !ref.empty(); ++i) {
+		std::uniform_int_distribution<std::size_t> pos_d(0, ref.size() - 1);
+		const std::size_t pos = pos_d(rng);
+		const auto len        = static_cast<std::size_t>(len_d(rng)) * 8;
+		std::string joined;
+		pt.ForEachChunk(pos, len, [&joined](std::string_view chunk) {
+			joined.append(chunk);
+			return true;
+		});
+		assert(joined == ref.substr(pos, len));
+
+		const std::string needle = ref.substr(pos, static_cast<std::size_t>(len_d(rng)));
+		const std::size_t from   = pos / 2;
+		const std::size_t expect = ref.find(needle, from);
+		assert(pt.Find(needle, from) == expect);
+	}
+
+	// Copies share structure but must not observe later edits
+	PieceTable copy(pt);
+	pt.Insert(0, "zz", 2);
+	check_equal(copy, ref);
+	ref.insert(0, "zz");
+	check_equal(pt, ref);
+}
+
+
+static void
+test_append_prepend()
+{
+	PieceTable pt;
+	std::string ref;
+	for (int i = 0; i < 1000; ++i) {
+		const std::string s = std::to_string(i) + (i % 7 == 0 ? "\n" : "");
+		if (i % 3 == 0) {
+			pt.Prepend(s.data(), s.size());
+			ref.insert(0, s);
+		} else {
+			pt.Append(s.data(), s.size());
+			ref += s;
+		}
+	}
+	pt.AppendChar('x');
+	pt.PrependChar('y');
+	ref = "y" + ref + "x";
+	check_equal(pt, ref);
+
+	pt.Clear();
+	assert(pt.Size() == 0);
+	assert(pt.LineCount() == 1);
+}
+
+
+// Snapshots stay fixed while the live table is edited on another thread, and
+// copies that share an add block can both keep appending to it.
+static void
+test_snapshots()
+{
+	std::mt19937 rng(7);
+	PieceTable pt;
+	std::string ref;
+	for (int i = 0; i < 500; ++i) {
+		const std::string s = "line " + std::to_string(i) + "\n";
+		pt.Insert(ref.size() / 2, s.data(), s.size());
+		ref.insert(ref.size() / 2, s);
+	}
+	// A paste large enough to get a block of its own
+	std::string paste;
+	for (int i = 0; i < 4000; ++i)
+		paste += "pasted " + std::to_string(i) + "\n";
+	pt.Insert(100, paste.data(), paste.size());
+	ref.insert(100, paste);
+	check_lines(pt, ref, rng);
+
+	auto snap = pt.Snapshot();
+	assert(snap->Version() == pt.Version());
+	const std::string frozen = ref;
+	std::thread reader([&snap, &frozen] {
+		for (int i = 0; i < 50; ++i) {
+			std::string joined;
+			snap->ForEachChunk(0, snap->Size(), [&joined](std::string_view chunk) {
+				joined.append(chunk);
+				return true;
+			});
+			assert(joined == frozen);
+			assert(snap->LineCount() == ref_line_count(frozen));
+		}
+	});
+	for (int i = 0; i < 2000; ++i) {
+		const std::size_t pos = (static_cast<std::size_t>(i) * 7919) % (ref.size() + 1);
+		if (i % 3 == 2) {
+			pt.Delete(pos, 5);
+			ref.erase(std::min(pos, ref.size()), 5);
+		} else {
+			pt.Insert(pos, "ab\n", 3);
+			ref.insert(pos, "ab\n");
+		}
+	}
+	reader.join();
+	assert(snap->Version() != pt.Version());
+	check_equal(*snap, frozen);
+	check_equal(pt, ref);
+
+	PieceTable copy(pt);
+	std::string copy_ref = ref;
+	for (int i = 0; i < 100; ++i) {
+		pt.Insert(0, "x", 1);
+		ref.insert(0, "x");
+		copy.Insert(copy_ref.size(), "y\n", 2);
+		copy_ref += "y\n";
+	}
+	check_equal(pt, ref);
+	check_equal(copy, copy_ref);
+	check_lines(copy, copy_ref, rng);
+}
+
+
+// Bulk replacement against applying the same splices to a string, on tables
+// made of many small pieces, one original piece, and dense replacements
+static void
+test_replace_all()
+{
+	std::mt19937 rng(11);
+	for (int round = 0; round < 60; ++round) {
+		PieceTable pt;
+		std::string ref;
+		if (round % 3 == 0) {
+			std::string text;
+			for (int i = 0; i < 3000; ++i)
+				text += "original line " + std::to_string(i) + "\n";
+			char *data = new char[text.size()];
+			std::copy(text.begin(), text.end(), data);
+			pt.LoadOriginal(std::shared_ptr<const char>(data, std::default_delete<const char[]>()), text.size());
+			ref = text;
+		} else {
+			for (int i = 0; i < 2000; ++i) {
+				const std::string s = "w" + std::to_string(rng() % 100) + (rng() % 4 ? " " : "\n");
+				const std::size_t at = rng() % (ref.size() + 1);
+				pt.Insert(at, s.data(), s.size());
+				ref.insert(at, s);
+			}
+		}
+		auto snap = pt.Snapshot();
+		const std::string before = ref;
+
+		// Dense rounds replace often and over short gaps
+		const std::size_t gap = round % 2 ? 4 : 400;
+		static const char *const texts[] = {"", "X", "new\n", "\n\n", "a longer replacement text here"};
+		std::vector<PieceTable::Splice> splices;
+		std::string expect;
+		std::size_t pos = 0;
+		for (std::size_t at = rng() % gap; at <= ref.size(); at += 1 + rng() % gap) {
+			const std::size_t len = std::min<std::size_t>(rng() % 12, ref.size() - at);
+			const std::string_view t = texts[rng() % 5];
+			splices.push_back(PieceTable::Splice{at, len, t});
+			expect.append(ref, pos, at - pos);
+			expect.append(t);
+			pos = at + len;
+			at += len;
+		}
+		expect.append(ref, pos, std::string::npos);
+		pt.ReplaceAll(splices);
+		check_equal(pt, expect);
+		check_lines(pt, expect, rng);
+		check_equal(*snap, before);
+
+		// The result edits like any other table
+		pt.Insert(pt.Size() / 2, "tail\n", 5);
+		expect.insert(expect.size() / 2, "tail\n");
+		pt.Delete(0, 3);
+		expect.erase(0, 3);
+		check_equal(pt, expect);
+		check_lines(pt, expect, rng);
+	}
+}
+
+
+int
+main()
+{
+	test_append_prepend();
+	test_snapshots();
+	test_replace_all();
+	for (unsigned seed = 1; seed <= 20; ++seed)
+		run_random_edits(seed, 2000, 4096);
+	// Force consolidation to kick in frequently
+	for (unsigned seed = 100; seed <= 105; ++seed)
+		run_random_edits(seed, 4000, 16);
+	std::cout << "test_piece_table: ok\n";
+	return 0;
+}
@@ -0,0 +1,271 @@
+// Verify kte::Regex against std::regex (ECMAScript) on generated patterns and
+// texts, plus syntax errors, replacement formats and inputs that would
+// overflow a backtracking matcher's stack
+#include <cassert>
+#include <cstdio>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "Regex.h"
+
+
+using Span = kte::Regex::Span;
+
+static constexpr std::size_t npos = static_cast<std::size_t>(-1);
+
+
+static std::vector<Span>
+to_spans(const std::smatch &m, const std::string &text)
+{
+	std::vector<Span> groups;
+	for (std::size_t g = 0; g < m.size(); ++g) {
+		if (m[g].matched) {
+			const auto b = static_cast<std::size_t>(m[g].first - text.begin());
+			groups.emplace_back(b, b + static_cast<std::size_t>(m[g].length()));
+		} else {
+			groups.emplace_back(npos, npos);
+		}
+	}
+	return groups;
+}
+
+
+// Every match and its groups, iterated as std::sregex_iterator does but with
+// match_prev_avail on every search after the first. (libstdc++ leaves it off
+// for the retry after a first empty match, so ^ and \b would hold mid-text.)
+static std::vector<std::vector<Span> >
+ref_matches(const std::regex &rx, const std::string &text)
+{
+	std::vector<std::vector<Span> > res;
+	std::smatch m;
+	if (!std::regex_search(text, m, rx))
+		return res;
+	const auto prev = std::regex_constants::match_prev_avail;
+	while (true) {
+		res.push_back(to_spans(m, text));
+		auto start = m[0].second;
+		if (m[0].first == m[0].second) {
+			if (start == text.end())
+				break;
+			const auto flags = prev | std::regex_constants::match_not_null | std::regex_constants::match_continuous;
+			if (std::regex_search(start, text.cend(), m, rx, start == text.begin() ? flags & ~prev : flags))
+				continue;
+			++start;
+		}
+		if (!std::regex_search(start, text.cend(), m, rx, start == text.begin() ? std::regex_constants::match_default : prev))
+			break;
+	}
+	return res;
+}
+
+
+// Whole-match spans from FindAll, with the groups of the first match from
+// Search in place of its whole span
+static std::vector<std::vector<Span> >
+got_matches(kte::Regex &rx, const std::string &text)
+{
+	std::vector<std::vector<Span> > res;
+	std::vector<Span> all;
+	rx.FindAll(text, all);
+	for (const Span &m: all)
+		res.push_back({m});
+	if (!res.empty()) {
+		const bool ok = rx.Search(text, 0, res.front());
+		assert(ok);
+		(void) ok;
+	}
+	return res;
+}
+
+
+// Random pattern over a three-letter alphabet. Quantified groups are never
+// nullable: backtracking engines disagree on how empty loop iterations
+// capture, and libstdc++ departs from ECMAScript there.
+static std::string
+gen_pattern(std::mt19937 &rng, int depth, bool &nullable)
+{
+	auto pick = [&rng](int n) {
+		return static_cast<int>(rng() % static_cast<unsigned>(n));
+	};
+	std::string out;
+	nullable        = true;
+	const int items = 1 + pick(3);
+	for (int i = 0; i < items; ++i) {
+		std::string atom;
+		bool atom_nullable = false;
+		switch (pick(depth > 2 ? 6 : 9)) {
+		case 0:
+		case 1:
+		case 2:
+			atom = std::string(1, "abc"[pick(3)]);
+			break;
+		case 3:
+			atom = ".";
+			break;
+		case 4:
+			atom = pick(2) ? "[ab]" : "[^a]";
+			break;
+		case 5:
+			out += pick(3) == 0 ? "\\b" : (pick(2) ? "^" : "$");
+			continue; // assertions take no quantifier
+		case 6:
+		case 7:
+			atom = "(" + gen_pattern(rng, depth + 1, atom_nullable) + ")";
+			break;
+		default: {
+			bool other = false;
+			atom = "(?:" + gen_pattern(rng, depth + 1, atom_nullable) + "|" + gen_pattern(rng, depth + 1, other) +
+			       ")";
+			atom_nullable = atom_nullable || other;
+			break;
+		}
+		}
+		static const char *const quants[] = {"", "", "", "*", "+", "?", "{1,2}", "*?", "+?", "??", "{2}"};
+		const char *q = atom_nullable ? "" : quants[pick(11)];
+		atom += q;
+		out += atom;
+		const bool optional = q[0] == '*' || q[0] == '?';
+		nullable            = nullable && (atom_nullable || optional);
+	}
+	if (depth == 0 && pick(4) == 0) {
+		bool other = false;
+		out += "|" + gen_pattern(rng, depth + 1, other);
+		nullable = nullable || other;
+	}
+	return out;
+}
+
+
+static void
+differential()
+{
+	std::mt19937 rng(20240601);
+	int checked = 0;
+	for (int i = 0; i < 2000; ++i) {
+		bool nullable         = false;
+		const std::string pat = gen_pattern(rng, 0, nullable);
+		std::regex ref;
+		try {
+			ref = std::regex(pat);
+		} catch (const std::regex_error &) {
+			continue;
+		}
+		kte::Regex rx;
+		std::string err;
+		const bool compiled = rx.Compile(pat, err);
+		if (!compiled)
+			std::fprintf(stderr, "failed to compile %s: %s\n", pat.c_str(), err.c_str());
+		assert(compiled);
+		for (int t = 0; t < 8; ++t) {
+			std::string text(rng() % 12, ' ');
+			for (auto &c: text)
+				c = "abc "[rng() % 4];
+			auto want = ref_matches(ref, text);
+			for (std::size_t m = 1; m < want.size(); ++m)
+				want[m].resize(1);
+			const auto got = got_matches(rx, text);
+			if (got != want)
+				std::fprintf(stderr, "mismatch: /%s/ on \"%s\"\n", pat.c_str(), text.c_str());
+			assert(got == want);
+			++checked;
+		}
+	}
+	assert(checked > 8000);
+}
+
+
+static void
+syntax()
+{
+	const char *const good[] = {
+		"", "a{", "a{1", "a{x}", "}", "]", "[]a]", "[a-]", "[-a]", "[\\]]", "\\.", "\\x41", "[\\d_]", "(?:)",
+		"a|", "|", "\\bfoo\\B", "[^]"
+	};
+	const char *const bad[] = {
+		"(", ")", "a)", "(?=a)", "(?!a)", "(?<=a)", "\\1", "(a)\\1", "*", "a**", "+a", "a{2,1}", "[b-a]", "[a",
+		"\\", "a\\", "\\q", "\\xZZ", "a{100000}"
+	};
+	kte::Regex rx;
+	std::string err;
+	for (const char *p: good) {
+		const bool ok = rx.Compile(p, err);
+		if (!ok)
+			std::fprintf(stderr, "rejected %s: %s\n", p, err.c_str());
+		assert(ok);
+	}
+	for (const char *p: bad) {
+		err.clear();
+		const bool ok = rx.Compile(p, err);
+		assert(!ok && !err.empty() && !rx.Valid());
+		(void) ok;
+	}
+
+	// Nesting deep enough to overflow a recursive parser is an error, not a crash
+	const std::string deep = std::string(100000, '(') + std::string(100000, ')');
+	assert(!rx.Compile(deep, err));
+}
+
+
+static void
+replace()
+{
+	kte::Regex rx;
+	std::string err;
+	std::string out;
+	assert(rx.Compile("(\\w+)@(\\w+)", err));
+	assert(rx.Replace("mail bob@host now", "<$2:$1|$&|$$>", out) == 1);
+	assert(out == "mail <host:bob|bob@host|$> now");
+	assert(rx.Replace("a@b c@d", "[$`|$']", out) == 2);
+	assert(out == "[| c@d] [a@b |]");
+	assert(rx.Replace("no match", "x", out) == 0 && out == "no match");
+
+	// Empty matches are iterated like std::regex_replace does
+	assert(rx.Compile("x*", err));
+	std::string want = std::regex_replace(std::string("axxb"), std::regex("x*"), "-");
+	assert(rx.Replace("axxb", "-", out) == 4 && out == want);
+
+	// $n beyond the group count and unknown $ escapes are kept as text
+	assert(rx.Compile("(a)", err));
+	want = std::regex_replace(std::string("a"), std::regex("(a)"), "$1$2$x$");
+	rx.Replace("a", "$1$2$x$", out);
+	assert(out == want);
+}
+
+
+// Inputs where a backtracking matcher recurses per character or explodes
+static void
+pathological()
+{
+	kte::Regex rx;
+	std::string err;
+	std::vector<Span> groups;
+
+	const std::string long_line(1 << 18, 'a');
+	assert(rx.Compile("(a|b)*c", err));
+	assert(!rx.Search(long_line, 0, groups));
+	assert(rx.Compile("(a|b)*", err));
+	assert(rx.Search(long_line, 0, groups));
+	assert(groups[0] == Span(0, long_line.size()));
+	assert(groups[1] == Span(long_line.size() - 1, long_line.size()));
+
+	// (a*)*b is exponential for backtracking engines
+	const std::string as(5000, 'a');
+	assert(rx.Compile("(a*)*b", err));
+	assert(!rx.Search(as, 0, groups));
+	assert(rx.Compile("(x+x+)+y", err));
+	assert(!rx.Search(std::string(5000, 'x'), 0, groups));
+}
+
+
+int
+main()
+{
+	syntax();
+	replace();
+	pathological();
+	differential();
+	std::printf("test_regex: ok\n");
+	return 0;
+}
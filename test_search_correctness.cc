@@ -1,11 +1,22 @@
-// Verify OptimizedSearch against std::string reference across patterns and sizes
+// Verify OptimizedSearch against std::string reference across patterns, sizes,
+// scan kernels and piece layouts
+#include <algorithm>
 #include <cassert>
 #include <cstddef>
+#include <cstdio>
 #include <random>
 #include <string>
 #include <vector>
 
+#include "ByteScan.h"
 #include "OptimizedSearch.h"
+#include "PieceTable.h"
+
+
+// Above the size OptimizedSearch starts searching in parallel
+static constexpr std::size_t kParallelTestBytes = 12u << 20;
+
+static const kte::ScanKernel kKernels[] = {kte::ScanKernel::Scalar, kte::ScanKernel::SSE2, kte::ScanKernel::AVX2};
 
 
 static std::vector<std::size_t>
@@ -26,11 +37,31 @@ ref_find_all(const std::string &text, const std::string &pat)
 }
 
 
+// Build a table holding text as many small pieces, so matches straddle piece
+// boundaries. Slices are prepended last to first, so no two neighbours are
+// adjacent in the add buffer and merge back into one piece.
+static PieceTable
+fragmented(const std::string &text, std::size_t slice)
+{
+	PieceTable pt(0, static_cast<std::size_t>(-1), 0, 0);
+	std::size_t off = (text.size() / slice) * slice;
+	if (off == text.size() && off > 0)
+		off -= slice;
+	for (;; off -= slice) {
+		pt.Insert(0, text.data() + off, std::min(slice, text.size() - off));
+		if (off == 0)
+			break;
+	}
+	return pt;
+}
+
+
 static void
 run_case(std::size_t textLen, std::size_t patLen, unsigned seed)
 {
 	std::mt19937 rng(seed);
-	std::uniform_int_distribution<int> dist('a', 'z');
+	// A small alphabet makes partial first/last byte hits common
+	std::uniform_int_distribution<int> dist('a', 'd');
 	std::string text(textLen, '\0');
 	for (auto &ch: text)
 		ch = static_cast<char>(dist(rng));
@@ -45,30 +76,164 @@ run_case(std::size_t textLen, std::size_t patLen, unsigned seed)
 			std::copy(pat.begin(), pat.end(), text.begin() + static_cast<long>(pos));
 	}
 
+	const auto ref = ref_find_all(text, pat);
+	const std::size_t ref_first = ref.empty() ? std::string::npos : ref.front();
+	(void) ref_first;
 	OptimizedSearch os;
-	auto got = os.find_all(text, pat, 0);
-	auto ref = ref_find_all(text, pat);
-	assert(got == ref);
+	assert(os.find_all(text, pat, 0) == ref);
+	assert(patLen == 0 || os.find_first(text, pat, 0) == ref_first);
+
+	PieceTable whole;
+	whole.Insert(0, text.data(), text.size());
+	assert(os.find_all(whole, pat, 0) == ref);
+	for (std::size_t slice: {1u, 3u, 7u, 64u}) {
+		if (textLen > 1100 && slice < 64)
+			continue;
+		PieceTable pt = fragmented(text, slice);
+		assert(os.find_all(pt, pat, 0) == ref);
+		assert(patLen == 0 || os.find_first(pt, pat, 0) == ref_first);
+		assert(patLen == 0 || pt.Find(pat, 0) == ref_first);
+		// Starting mid-document must agree too
+		const std::size_t from = textLen / 2;
+		const auto ref_from    = ref_find_all(text.substr(std::min(from, text.size())), pat);
+		auto got               = os.find_all(pt, pat, from);
+		for (auto &g: got)
+			g -= from;
+		assert(got == ref_from);
+	}
+}
+
+
+// Large documents are searched in parallel ranges; the stitched result must
+// equal a sequential scan, also for patterns whose matches can overlap
+static void
+parallel_case()
+{
+	std::mt19937 rng(99);
+	std::string text(kParallelTestBytes, '\0');
+	for (auto &ch: text)
+		ch = rng() % 4 ? 'a' : 'b';
+	PieceTable whole;
+	whole.Insert(0, text.data(), text.size());
+	PieceTable pieces;
+	for (std::size_t off = 0; off < text.size(); off += 4093)
+		pieces.Insert(off, text.data() + off, std::min<std::size_t>(4093, text.size() - off));
+
+	OptimizedSearch seq;
+	OptimizedSearch par;
+	seq.SetThreads(1);
+	par.SetThreads(4);
+	for (const std::string pat: {"b", "aaaa", "aabaa", "bab", "aaaaaaaaaaaaaaaaaaaaaaaaaaaab"}) {
+		const auto ref = ref_find_all(text, pat);
+		for (const PieceTable *pt: {&whole, &pieces}) {
+			assert(seq.find_all(*pt, pat) == ref);
+			assert(par.find_all(*pt, pat) == ref);
+			const std::size_t from = text.size() / 3 + 1;
+			assert(par.find_all(*pt, pat, from) == seq.find_all(*pt, pat, from));
+		}
+	}
+}
+
+
+static bool
+is_word(const int c)
+{
+	return c >= 0x80 || c == '_' || (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+
+// folded is kte::FoldCase(text)
+static std::vector<std::size_t>
+ref_find_all(const std::string &text, const std::string &folded, const std::string &pat, const SearchOptions &opts)
+{
+	const std::string &hay   = opts.ignore_case ? folded : text;
+	const std::string needle = opts.ignore_case ? kte::FoldCase(pat) : pat;
+	std::vector<std::size_t> res;
+	for (std::size_t from = 0, at; (at = hay.find(needle, from)) != std::string::npos;) {
+		const int before = at > 0 ? static_cast<unsigned char>(text[at - 1]) : -1;
+		const int after  = at + pat.size() < text.size() ? static_cast<unsigned char>(text[at + pat.size()]) : -1;
+		if (opts.whole_word && ((is_word(static_cast<unsigned char>(pat.front())) && is_word(before)) ||
+		                        (is_word(static_cast<unsigned char>(pat.back())) && is_word(after)))) {
+			from = at + 1;
+			continue;
+		}
+		res.push_back(at);
+		from = at + pat.size();
+	}
+	return res;
+}
+
+
+// Case-insensitive and whole-word matching, on strings, fragmented tables
+// and (for a large document) in parallel
+static void
+options_case(const std::size_t size, const unsigned seed)
+{
+	static const char *const words[] = {
+		"foo", "Foo", "FOO", "foobar", "_foo", "fo", " ", ".", "\n", "\xC3\xA9", "\xC3\x89", "\xD0\x96"
+	};
+	std::mt19937 rng(seed);
+	std::string text;
+	while (text.size() < size)
+		text += words[rng() % 12];
+	const std::string folded = kte::FoldCase(text);
+	PieceTable whole;
+	whole.Insert(0, text.data(), text.size());
+	const bool small = size < 100000;
+	std::vector<PieceTable> pieces;
+	if (small) {
+		for (std::size_t slice: {1u, 5u, 64u})
+			pieces.push_back(fragmented(text, slice));
+	}
+	for (const std::string pat: {"foo", "FOO", "oo", "foo.", "\xC3\x89", "\xC3\xA9" "foo", "o f", "\xD0\xB6"}) {
+		for (const SearchOptions opts: {SearchOptions{true, false}, SearchOptions{false, true},
+		                                SearchOptions{true, true}}) {
+			const auto ref = ref_find_all(text, folded, pat, opts);
+			OptimizedSearch os;
+			os.SetOptions(opts);
+			os.SetThreads(small ? 1 : 4);
+			assert(os.find_all(whole, pat) == ref);
+			if (!small)
+				continue;
+			assert(os.find_all(text, pat) == ref);
+			assert(os.find_first(text, pat) == (ref.empty() ? std::string::npos : ref.front()));
+			for (const PieceTable &pt: pieces) {
+				assert(os.find_all(pt, pat) == ref);
+				assert(os.find_first(pt, pat) == (ref.empty() ? std::string::npos : ref.front()));
+			}
+		}
+	}
 }
 
 
 int
 main()
 {
-	// Edge cases
-	run_case(0, 0, 1);
-	run_case(0, 1, 2);
-	run_case(1, 0, 3);
-	run_case(1, 1, 4);
-
-	// Various sizes
-	for (std::size_t t = 128; t <= 4096; t *= 2) {
-		for (std::size_t p = 1; p <= 64; p *= 2) {
-			run_case(t, p, static_cast<unsigned>(t + p));
+	const kte::ScanKernel best = kte::ActiveScanKernel();
+	for (auto k: kKernels) {
+		if (!kte::SetScanKernel(k))
+			continue;
+		// Edge cases
+		run_case(0, 0, 1);
+		run_case(0, 1, 2);
+		run_case(1, 0, 3);
+		run_case(1, 1, 4);
+
+		// Various sizes, including ones that end inside a vector-width tail
+		for (std::size_t t = 128; t <= 4096; t *= 2) {
+			for (std::size_t p = 1; p <= 64; p *= 2) {
+				run_case(t, p, static_cast<unsigned>(t + p));
+				run_case(t + 31, p + 1, static_cast<unsigned>(t * p));
+			}
 		}
+		// Larger random
+		run_case(100000, 16, 12345);
+		run_case(250000, 32, 67890);
+		options_case(3000, 5);
 	}
-	// Larger random
-	run_case(100000, 16, 12345);
-	run_case(250000, 32, 67890);
+	kte::SetScanKernel(best);
+	parallel_case();
+	options_case(kParallelTestBytes, 6);
+	std::printf("test_search_correctness: ok\n");
 	return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,102 @@
+// Verify SearchOverlay returns the hits a per-line scan finds while
+// scrolling, editing and changing the query, and keeps only a window of rows
+#include <cassert>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "Buffer.h"
+#include "OptimizedSearch.h"
+#include "Regex.h"
+#include "SearchOverlay.h"
+
+
+using Ranges = std::vector<SearchOverlay::Range>;
+
+
+static Ranges
+expected(const Buffer &buf, const std::size_t row, const std::string &query, const bool regex,
+         const SearchOptions &opts)
+{
+	std::string line = buf.GetLineString(row);
+	if (!line.empty() && line.back() == '\n')
+		line.pop_back();
+	Ranges out;
+	if (regex) {
+		kte::Regex rx;
+		std::string err;
+		if (rx.Compile(query, err))
+			rx.FindAll(line, out);
+		return out;
+	}
+	OptimizedSearch os;
+	os.SetOptions(opts);
+	for (std::size_t pos = 0; (pos = os.find_in(line, query, pos)) != std::string::npos; pos += query.size())
+		out.emplace_back(pos, pos + query.size());
+	return out;
+}
+
+
+// Prefetch a screen of rows at first and check each of them
+static void
+check_screen(Buffer &buf, const std::size_t first, const std::size_t rows, const std::string &query,
+             const bool regex, const SearchOptions &opts = {})
+{
+	SearchOverlay &overlay = buf.SearchHighlights();
+	overlay.PrefetchViewport(buf, first, rows, buf.Version(), query, regex, opts);
+	for (std::size_t row = first; row < first + rows && row < buf.Nrows(); ++row)
+		assert(overlay.Hits(buf, row) == expected(buf, row, query, regex, opts));
+	assert(overlay.CachedRows() <= 3 * rows);
+}
+
+
+int
+main()
+{
+	std::mt19937 rng(19);
+	static const char *const words[] = {"needle", "Needle", "hay", "stack", " ", " ", "nee", "dle"};
+	std::string text;
+	for (int line = 0; line < 20000; ++line) {
+		for (int w = rng() % 12; w > 0; --w)
+			text += words[rng() % 8];
+		text += '\n';
+	}
+	Buffer buf;
+	buf.insert_text(0, 0, text);
+	buf.SetDirty(true);
+
+	// Scroll down a screen at a time, then back up a line at a time
+	const std::size_t rows = 40;
+	for (std::size_t first = 0; first < buf.Nrows(); first += rows)
+		check_screen(buf, first, rows, "needle", false);
+	for (std::size_t first = 500; first > 300; --first)
+		check_screen(buf, first, rows, "needle", false);
+
+	// Other queries, options and modes
+	check_screen(buf, 1000, rows, "needle", false, {true, false});
+	check_screen(buf, 1000, rows, "needle", false, {true, true});
+	check_screen(buf, 1000, rows, "ne+dle|hay", true);
+	check_screen(buf, 1000, rows, "(", true); // invalid: no hits
+
+	// Edits show up once the buffer's version moves
+	for (int i = 0; i < 50; ++i) {
+		const auto row = static_cast<int>(1000 + rng() % rows);
+		if (rng() % 2)
+			buf.insert_text(row, 0, "needle ");
+		else
+			buf.delete_row(row);
+		buf.SetDirty(true);
+		check_screen(buf, 1000, rows, "needle", false);
+	}
+
+	// A row outside the prefetched window is computed on demand
+	SearchOverlay &overlay = buf.SearchHighlights();
+	assert(overlay.Hits(buf, 15000) == expected(buf, 15000, "needle", false, {}));
+	assert(overlay.Hits(buf, buf.Nrows()).empty());
+	overlay.Clear();
+	assert(overlay.CachedRows() == 0);
+
+	std::cout << "test_search_overlay: ok\n";
+	return 0;
+}
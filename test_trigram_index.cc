@@ -0,0 +1,230 @@
+// Verify TrigramIndex never drops a line that could match, across edits and
+// memory limits, and that searches narrowed by it find what a full scan does
+#include <cassert>
+#include <cctype>
+#include <iostream>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Buffer.h"
+#include "MatchIndex.h"
+#include "Regex.h"
+#include "TrigramIndex.h"
+
+
+using Ranges = std::vector<std::pair<std::size_t, std::size_t> >;
+
+
+static std::string
+lower(std::string s)
+{
+	for (char &c: s)
+		c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+	return s;
+}
+
+
+// About bytes of log lines, with "Needle" on every 20011th
+static std::string
+make_log(const std::size_t bytes)
+{
+	std::string text;
+	for (std::size_t i = 0; text.size() < bytes; ++i) {
+		text += "12:00:" + std::to_string(i % 60) + " request " + std::to_string(i) + " took " +
+			std::to_string(i % 89) + "ms";
+		if (i % 20011 == 9000)
+			text += " Needle";
+		text += '\n';
+	}
+	return text;
+}
+
+
+static Buffer
+indexed(const std::string &text)
+{
+	Buffer buf;
+	buf.Trigrams().SetMode(TrigramIndex::Mode::On);
+	buf.insert_text(0, 0, text);
+	buf.Trigrams().Refresh(buf.Content());
+	buf.Trigrams().Wait();
+	buf.Trigrams().Poll();
+	assert(buf.Trigrams().Ready());
+	return buf;
+}
+
+
+// Every line holding needle (ignoring case) lies in the candidate ranges;
+// returns the fraction of rows they cover
+static double
+check_candidates(Buffer &buf, const std::string &needle)
+{
+	Ranges ranges;
+	const bool narrowed = buf.Trigrams().Candidates(buf.Content(), {lower(needle)}, ranges);
+	assert(narrowed);
+	(void) narrowed;
+	std::size_t covered = 0;
+	for (std::size_t i = 0; i < ranges.size(); ++i) {
+		assert(ranges[i].first < ranges[i].second && ranges[i].second <= buf.Nrows());
+		assert(i == 0 || ranges[i - 1].second < ranges[i].first);
+		covered += ranges[i].second - ranges[i].first;
+	}
+	std::size_t r = 0;
+	for (std::size_t y = 0; y < buf.Nrows(); ++y) {
+		if (lower(buf.GetLineString(y)).find(lower(needle)) == std::string::npos)
+			continue;
+		while (r < ranges.size() && ranges[r].second <= y)
+			++r;
+		assert(r < ranges.size() && ranges[r].first <= y);
+	}
+	return static_cast<double>(covered) / static_cast<double>(buf.Nrows());
+}
+
+
+static void
+test_required_literals()
+{
+	struct Case {
+		const char *pattern;
+		std::vector<std::string> required;
+	};
+	const Case cases[] = {
+		{"needle", {"needle"}},
+		{"foo(bar|baz)Qux", {"foo", "qux"}},
+		{"ERROR \\d+ ms", {"error ", " ms"}},
+		{"[Hh]ello, (?:world)", {"hello, world"}},
+		{"(ab){2}c", {"ababc"}},
+		{"x+yz", {"x", "yz"}},
+		{"^took \\b", {"took "}},
+		{"a|b", {}},
+		{".*", {}},
+	};
+	for (const Case &c: cases) {
+		kte::Regex rx;
+		std::string err;
+		const bool ok = rx.Compile(c.pattern, err);
+		assert(ok);
+		(void) ok;
+		assert(rx.RequiredLiterals() == c.required);
+	}
+}
+
+
+static void
+test_candidates()
+{
+	Buffer buf = indexed(make_log(4u << 20));
+	assert(buf.Trigrams().Blocks() > 16);
+	assert(check_candidates(buf, "Needle") < 0.9);
+	assert(check_candidates(buf, "NEEDLE") < 0.9);
+	check_candidates(buf, "request");
+
+	// Too short to narrow
+	Ranges ranges;
+	assert(!buf.Trigrams().Candidates(buf.Content(), {"ne"}, ranges));
+
+	// A string that appears nowhere rules out (nearly) everything
+	assert(check_candidates(buf, "zebra crossing") < 0.1);
+}
+
+
+static void
+test_edits()
+{
+	std::mt19937 rng(17);
+	Buffer buf = indexed(make_log(2u << 20));
+	for (int i = 0; i < 300; ++i) {
+		const std::size_t y = rng() % buf.Nrows();
+		switch (rng() % 4) {
+		case 0:
+			buf.insert_text(static_cast<int>(y), 0, "haystack needle\n");
+			break;
+		case 1:
+			buf.insert_text(static_cast<int>(y), 0, std::string(200000, 'x') + " needle\nx");
+			break;
+		case 2:
+			buf.delete_text(static_cast<int>(y), 0, rng() % 5000);
+			break;
+		default:
+			buf.insert_row(static_cast<int>(y), "a needle row");
+			break;
+		}
+		if (i % 60 == 0)
+			check_candidates(buf, "needle");
+	}
+	check_candidates(buf, "needle");
+
+	// Edits made while the index is being built are applied once it is
+	buf.Trigrams().Clear();
+	buf.Trigrams().Refresh(buf.Content());
+	buf.insert_text(0, 0, "late needle\n");
+	buf.delete_text(100, 0, 3000);
+	buf.Trigrams().Wait();
+	check_candidates(buf, "needle");
+	check_candidates(buf, "late needle");
+}
+
+
+static void
+test_limit()
+{
+	Buffer buf;
+	buf.Trigrams().SetMode(TrigramIndex::Mode::On);
+	buf.Trigrams().SetLimit(256u << 10);
+	buf.insert_text(0, 0, make_log(8u << 20));
+	buf.Trigrams().Refresh(buf.Content());
+	buf.Trigrams().Wait();
+	check_candidates(buf, "Needle");
+	assert(buf.Trigrams().Bytes() <= buf.Trigrams().Limit());
+	assert(buf.Trigrams().BlockBytes() > (64u << 10));
+
+	// Appends grow the last block rather than the index
+	for (int i = 0; i < 50; ++i)
+		buf.insert_text(static_cast<int>(buf.Nrows() - 1), 0, std::string(100000, 'y') + "\n");
+	check_candidates(buf, "Needle");
+	assert(buf.Trigrams().Bytes() <= buf.Trigrams().Limit());
+}
+
+
+// A search narrowed by the index finds exactly what a full scan does
+static void
+test_search()
+{
+	Buffer buf = indexed(make_log(6u << 20));
+	buf.insert_text(1000, 0, "needle in lower case\n");
+	const Buffer plain(buf); // not indexed: below TrigramIndex::kAutoBytes
+	for (const auto &[query, regex]: std::vector<std::pair<std::string, bool> >{
+		     {"Needle", false}, {"request 12345 ", false}, {"took \\d+ms Ne+dle", true},
+		     {"[Nn]eedle", true}, {"zebra", false}
+	     }) {
+		std::string err;
+		MatchIndex narrowed;
+		narrowed.Update(buf, query, regex, 0, 0, err);
+		narrowed.Wait();
+		narrowed.Poll();
+		MatchIndex full;
+		full.Update(plain, query, regex, 0, 0, err);
+		full.Wait();
+		full.Poll();
+		assert(narrowed.Matches().size() == full.Matches().size());
+		for (std::size_t i = 0; i < full.Matches().size(); ++i) {
+			assert(narrowed.Matches()[i].y == full.Matches()[i].y);
+			assert(narrowed.Matches()[i].x == full.Matches()[i].x);
+		}
+	}
+}
+
+
+int
+main()
+{
+	test_required_literals();
+	test_candidates();
+	test_edits();
+	test_limit();
+	test_search();
+	std::cout << "test_trigram_index: ok\n";
+	return 0;
+}